@@ -11,8 +11,10 @@
 #include "trajectory_publisher.h"
 #include "path_planner_common/TrajectoryDisplayerHelper.h"
 #include <path_planner_common/UpdateReferenceTrajectory.h>
+#include <path_planner_common/UpdatePlanDelta.h>
 #include <path_planner_common/DubinsPlan.h>
 #include <path_planner_common/DubinsPath.h>
+#include <path_planner_common/PlanDelta.h>
 #include <geographic_visualization_msgs/GeoVizItem.h>
 #include <project11_transformations/local_services.h>
 
@@ -34,6 +36,7 @@ public:
         m_display_pub = m_node_handle.advertise<geographic_visualization_msgs::GeoVizItem>("/project11/display",1);
 
         m_update_reference_trajectory_client = m_node_handle.serviceClient<path_planner_common::UpdateReferenceTrajectory>("/mpc/update_reference_trajectory");
+        m_update_plan_delta_client = m_node_handle.serviceClient<path_planner_common::UpdatePlanDelta>("/mpc/update_plan_delta");
 
         m_position_sub = m_node_handle.subscribe("/position_map", 10, &NodeBase::positionCallback, this);
         m_heading_sub = m_node_handle.subscribe("/heading", 10, &NodeBase::headingCallback, this);
@@ -199,8 +202,18 @@ public:
      * @return
      */
     static path_planner_common::Plan convertToPlanMsg(const DubinsPlan& plan) {
+        return convertToPlanMsg(plan.get(), plan.getEndTime());
+    }
+
+    /**
+     * Convert some Dubins paths to a ROS message, as the paths of a plan ending at endTime.
+     * @param paths
+     * @param endTime
+     * @return
+     */
+    static path_planner_common::Plan convertToPlanMsg(const std::vector<DubinsWrapper>& paths, double endTime) {
         path_planner_common::Plan planMsg;
-        for (const auto& d : plan.get()) {
+        for (const auto& d : paths) {
             path_planner_common::DubinsPath path;
             auto p = d.unwrap();
             path.initial_x = p.qi[0];
@@ -215,26 +228,45 @@ public:
             path.start_time = d.getStartTime();
             planMsg.paths.push_back(path);
         }
-        planMsg.endtime = plan.getEndTime();
+        planMsg.endtime = endTime;
         return planMsg;
     }
 
     /**
-     * Update the controller's reference trajectory and return the state it provides.
+     * Update the controller's reference trajectory and return the state it provides. If the controller offers the
+     * delta service, only the paths it doesn't already have go out (see PlanDelta), unless it turns out not to have
+     * the plan they build on, in which case the whole plan goes again. Otherwise (or if a delta call fails) the whole
+     * plan goes through the original UpdateReferenceTrajectory service, as it always has.
+     *
+     * Looking for the delta service asks the master, which blocks, so without it we only look again every so often.
      * @param plan
      * @return
      */
     State publishPlan(const DubinsPlan& plan) {
-        path_planner_common::UpdateReferenceTrajectoryRequest req;
-        path_planner_common::UpdateReferenceTrajectoryResponse res;
-        req.plan = convertToPlanMsg(plan);
-        if (m_update_reference_trajectory_client.call(req, res)) {
-            auto s = m_TrajectoryDisplayer.convertToStateFromMsg(res.state);
-            displayPlannerStart(s);
-            return s;
-        } else {
-            return State();
+        path_planner_common::StateMsg state;
+        if (!m_DeltasSupported) {
+            auto now = ros::WallTime::now();
+            if (now >= m_DeltasCheckedAt + ros::WallDuration(c_DeltaServiceRecheckSeconds)) {
+                m_DeltasCheckedAt = now;
+                m_DeltasSupported = m_update_plan_delta_client.exists();
+            }
         }
+        if (!m_DeltasSupported || !publishPlanDelta(plan, state)) {
+            if (m_DeltasSupported) {
+                // the call failed, so it's gone or broken; look again once the interval's up
+                m_DeltasSupported = false;
+                m_DeltasCheckedAt = ros::WallTime::now();
+            }
+            m_PlanEncoder.reset();
+            path_planner_common::UpdateReferenceTrajectoryRequest req;
+            path_planner_common::UpdateReferenceTrajectoryResponse res;
+            req.plan = convertToPlanMsg(plan);
+            if (!m_update_reference_trajectory_client.call(req, res)) return State();
+            state = res.state;
+        }
+        auto s = m_TrajectoryDisplayer.convertToStateFromMsg(state);
+        displayPlannerStart(s);
+        return s;
     }
 
 protected:
@@ -264,8 +296,53 @@ protected:
     ros::Subscriber m_piloting_mode_sub;
 
     ros::ServiceClient m_update_reference_trajectory_client;
+    ros::ServiceClient m_update_plan_delta_client;
+
+    PlanDeltaEncoder m_PlanEncoder;
+    // whether the controller offers the delta service, as of the last time we looked
+    bool m_DeltasSupported = false;
+    ros::WallTime m_DeltasCheckedAt;
+    // how long to go between looking for the delta service when the controller doesn't have it
+    static constexpr double c_DeltaServiceRecheckSeconds = 10;
 
     project11::Transformations m_CoordinateConverter;
+
+private:
+    /**
+     * Send a plan through the delta service, in full if the controller didn't have the base.
+     * @param plan
+     * @param state set to the state the controller provides
+     * @return whether the calls went through
+     */
+    bool publishPlanDelta(const DubinsPlan& plan, path_planner_common::StateMsg& state) {
+        path_planner_common::UpdatePlanDeltaResponse res;
+        auto delta = m_PlanEncoder.encode(plan);
+        if (!sendPlanDelta(delta, plan.getEndTime(), res)) return false;
+        if (!m_PlanEncoder.acknowledge(res.version) && !delta.full()) {
+            delta = m_PlanEncoder.encode(plan);
+            if (!sendPlanDelta(delta, plan.getEndTime(), res)) return false;
+            m_PlanEncoder.acknowledge(res.version);
+        }
+        state = res.state;
+        return true;
+    }
+
+    /**
+     * Call the controller's delta service.
+     * @param delta
+     * @param endTime when the whole plan ends
+     * @param res the controller's response
+     * @return whether the call went through
+     */
+    bool sendPlanDelta(const PlanDelta& delta, double endTime, path_planner_common::UpdatePlanDeltaResponse& res) {
+        path_planner_common::UpdatePlanDeltaRequest req;
+        req.plan = convertToPlanMsg(delta.Segments, endTime);
+        req.version = delta.Version;
+        req.base_version = delta.BaseVersion;
+        req.keep_from = delta.KeepFrom;
+        req.keep_count = delta.KeepCount;
+        return m_update_plan_delta_client.call(req, res);
+    }
 };
 
 
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "DensityKernel.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define PATH_PLANNER_DENSITY_AVX2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PATH_PLANNER_DENSITY_NEON
+#endif
+
+constexpr double DensityKernel::ExpRelativeError;
+
+namespace {
+constexpr double c_InverseTwoPi = 0.15915494309189535;
+constexpr double c_Ln2 = 0.6931471805599453;
+constexpr double c_InverseLn2 = 1.4426950408889634;
+constexpr double c_MaxQuadform = 4; // two standard deviations
+// 1/n! for n = 11 down to 2, for Horner's method (the last two coefficients are 1)
+constexpr double c_Taylor[] = {
+        2.505210838544172e-08, 2.755731922398589e-07, 2.7557319223985893e-06, 2.48015873015873e-05,
+        1.984126984126984e-4, 1.388888888888889e-3, 8.333333333333333e-3, 4.1666666666666664e-2,
+        0.16666666666666666, 0.5,
+};
+
+// adding 1.5 * 2^52 rounds to an integer, which ends up in the low bits of the mantissa
+constexpr double c_Shifter = 6755399441055744.0;
+
+double scalarExp(double x) {
+    auto k = (x * c_InverseLn2 + c_Shifter) - c_Shifter;
+    auto r = x - k * c_Ln2;
+    auto p = c_Taylor[0];
+    for (int i = 1; i < 10; i++) p = p * r + c_Taylor[i];
+    p = p * r + 1;
+    p = p * r + 1;
+    // k is in [-3, 0], so its power of two is exact and can be made straight from the exponent bits
+    auto exponent = (uint64_t)((int64_t)k + 1023) << 52;
+    double scale;
+    std::memcpy(&scale, &exponent, sizeof(scale));
+    return p * scale;
+}
+
+double scalarDensity(double dx, double dy, double a, double b, double c) {
+    auto det = a * c - b * b;
+    auto quadform = (c * dx * dx - 2 * b * dx * dy + a * dy * dy) / det;
+    if (!(quadform <= c_MaxQuadform)) return 0;
+    return c_InverseTwoPi / sqrt(det) * scalarExp(-0.5 * quadform);
+}
+}
+
+double DensityKernel::exp(double x) {
+    return scalarExp(x);
+}
+
+void DensityKernel::evaluateReference(const double* dx, const double* dy, const double* a, const double* b,
+                                      const double* c, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        auto det = a[i] * c[i] - b[i] * b[i];
+        auto quadform = (c[i] * dx[i] * dx[i] - 2 * b[i] * dx[i] * dy[i] + a[i] * dy[i] * dy[i]) / det;
+        out[i] = quadform > c_MaxQuadform ? 0 : c_InverseTwoPi / sqrt(det) * std::exp(-0.5 * quadform);
+    }
+}
+
+#if defined(PATH_PLANNER_DENSITY_AVX2)
+
+const char* DensityKernel::implementation() {
+    return "AVX2";
+}
+
+void DensityKernel::evaluate(const double* dx, const double* dy, const double* a, const double* b, const double* c,
+                             double* out, size_t n) {
+    const auto half = _mm256_set1_pd(0.5), two = _mm256_set1_pd(2), one = _mm256_set1_pd(1);
+    const auto maxQuadform = _mm256_set1_pd(c_MaxQuadform), norm = _mm256_set1_pd(c_InverseTwoPi);
+    const auto ln2 = _mm256_set1_pd(c_Ln2), inverseLn2 = _mm256_set1_pd(c_InverseLn2);
+    const auto shifter = _mm256_set1_pd(c_Shifter);
+    const auto bias = _mm256_set1_epi64x(1023);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm256_loadu_pd(dx + i), y = _mm256_loadu_pd(dy + i);
+        auto va = _mm256_loadu_pd(a + i), vb = _mm256_loadu_pd(b + i), vc = _mm256_loadu_pd(c + i);
+        auto det = _mm256_fmsub_pd(va, vc, _mm256_mul_pd(vb, vb));
+        auto q = _mm256_mul_pd(vc, _mm256_mul_pd(x, x));
+        q = _mm256_fnmadd_pd(_mm256_mul_pd(two, vb), _mm256_mul_pd(x, y), q);
+        q = _mm256_fmadd_pd(va, _mm256_mul_pd(y, y), q);
+        q = _mm256_div_pd(q, det);
+        auto inside = _mm256_cmp_pd(q, maxQuadform, _CMP_LE_OQ);
+        // keep discarded lanes in range so the exponent bits stay sane
+        auto e = _mm256_mul_pd(half, _mm256_min_pd(q, maxQuadform));
+        e = _mm256_sub_pd(_mm256_setzero_pd(), e);
+        auto k = _mm256_round_pd(_mm256_mul_pd(e, inverseLn2), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        auto r = _mm256_fnmadd_pd(k, ln2, e);
+        auto p = _mm256_set1_pd(c_Taylor[0]);
+        for (int j = 1; j < 10; j++) p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c_Taylor[j]));
+        p = _mm256_fmadd_pd(p, r, one);
+        p = _mm256_fmadd_pd(p, r, one);
+        auto ki = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(k, shifter)), _mm256_castpd_si256(shifter));
+        auto scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(ki, bias), 52));
+        auto d = _mm256_div_pd(_mm256_mul_pd(p, scale), _mm256_sqrt_pd(det));
+        _mm256_storeu_pd(out + i, _mm256_and_pd(inside, _mm256_mul_pd(norm, d)));
+    }
+    for (; i < n; i++) out[i] = scalarDensity(dx[i], dy[i], a[i], b[i], c[i]);
+}
+
+#elif defined(PATH_PLANNER_DENSITY_NEON)
+
+const char* DensityKernel::implementation() {
+    return "NEON";
+}
+
+void DensityKernel::evaluate(const double* dx, const double* dy, const double* a, const double* b, const double* c,
+                             double* out, size_t n) {
+    const auto two = vdupq_n_f64(2), one = vdupq_n_f64(1), minusHalf = vdupq_n_f64(-0.5);
+    const auto maxQuadform = vdupq_n_f64(c_MaxQuadform), norm = vdupq_n_f64(c_InverseTwoPi);
+    const auto ln2 = vdupq_n_f64(c_Ln2), inverseLn2 = vdupq_n_f64(c_InverseLn2);
+    const auto bias = vdupq_n_s64(1023);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto x = vld1q_f64(dx + i), y = vld1q_f64(dy + i);
+        auto va = vld1q_f64(a + i), vb = vld1q_f64(b + i), vc = vld1q_f64(c + i);
+        auto det = vfmsq_f64(vmulq_f64(va, vc), vb, vb);
+        auto q = vmulq_f64(vc, vmulq_f64(x, x));
+        q = vfmsq_f64(q, vmulq_f64(two, vb), vmulq_f64(x, y));
+        q = vfmaq_f64(q, va, vmulq_f64(y, y));
+        q = vdivq_f64(q, det);
+        auto inside = vcleq_f64(q, maxQuadform);
+        auto e = vmulq_f64(minusHalf, vminq_f64(q, maxQuadform));
+        auto k = vrndnq_f64(vmulq_f64(e, inverseLn2));
+        auto r = vfmsq_f64(e, k, ln2);
+        auto p = vdupq_n_f64(c_Taylor[0]);
+        for (int j = 1; j < 10; j++) p = vfmaq_f64(vdupq_n_f64(c_Taylor[j]), p, r);
+        p = vfmaq_f64(one, p, r);
+        p = vfmaq_f64(one, p, r);
+        auto scale = vreinterpretq_f64_s64(vshlq_n_s64(vaddq_s64(vcvtq_s64_f64(k), bias), 52));
+        auto d = vdivq_f64(vmulq_f64(p, scale), vsqrtq_f64(det));
+        d = vmulq_f64(norm, d);
+        vst1q_f64(out + i, vreinterpretq_f64_u64(vandq_u64(inside, vreinterpretq_u64_f64(d))));
+    }
+    for (; i < n; i++) out[i] = scalarDensity(dx[i], dy[i], a[i], b[i], c[i]);
+}
+
+#else
+
+const char* DensityKernel::implementation() {
+    return "scalar";
+}
+
+void DensityKernel::evaluate(const double* dx, const double* dy, const double* a, const double* b, const double* c,
+                             double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = scalarDensity(dx[i], dy[i], a[i], b[i], c[i]);
+}
+
+#endif
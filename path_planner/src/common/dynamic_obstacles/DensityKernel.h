@@ -0,0 +1,53 @@
+#ifndef SRC_DENSITYKERNEL_H
+#define SRC_DENSITYKERNEL_H
+
+#include <cstddef>
+
+/**
+ * Truncated two dimensional Gaussian densities for a batch of points, as struct-of-arrays. This is the inner loop of
+ * evaluating dynamic obstacles along a whole edge at once.
+ *
+ * Uses AVX2 (four lanes) when compiled with it (see the AVX2 CMake option) and NEON (two lanes) on 64 bit ARM,
+ * otherwise a plain loop. All of them use the same exp approximation, which is good to ExpRelativeError over the range
+ * we need.
+ */
+class DensityKernel {
+public:
+    /**
+     * Compute densities. Lane i is the density at offset (dx[i], dy[i]) from the mean of a Gaussian with covariance
+     * [[a[i], b[i]], [b[i], c[i]]], or 0 if it's more than two standard deviations (Mahalanobis) away.
+     * @param dx
+     * @param dy
+     * @param a
+     * @param b
+     * @param c
+     * @param out
+     * @param n number of lanes
+     */
+    static void evaluate(const double* dx, const double* dy, const double* a, const double* b, const double* c,
+                         double* out, size_t n);
+
+    /**
+     * The same thing with one point at a time and std::exp, for reference.
+     */
+    static void evaluateReference(const double* dx, const double* dy, const double* a, const double* b,
+                                  const double* c, double* out, size_t n);
+
+    /**
+     * The exp approximation, for x in [-2, 0]. Range reduction to x = k ln 2 + r with |r| <= ln 2 / 2, then a degree
+     * 11 Taylor polynomial in r, whose remainder is below 7e-15 relative; the rest of ExpRelativeError is rounding.
+     * @param x
+     * @return
+     */
+    static double exp(double x);
+
+    /**
+     * @return "AVX2", "NEON" or "scalar"
+     */
+    static const char* implementation();
+
+    static constexpr double ExpRelativeError = 1e-13;
+};
+
+
+#endif //SRC_DENSITYKERNEL_H
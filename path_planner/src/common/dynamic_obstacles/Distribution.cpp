@@ -79,6 +79,12 @@ double Distribution::density(double x, double y) const {
     return density(test);
 }
 
+void Distribution::covariance(double& xx, double& xy, double& yy) const {
+    xx = m_Covariance[0][0];
+    xy = m_Covariance[0][1];
+    yy = m_Covariance[1][1];
+}
+
 double Distribution::heading() const {
     return m_Heading;
 }
@@ -49,6 +49,14 @@ public:
 
     const double (&mean() const) [2];
 
+    /**
+     * Get the covariance matrix entries.
+     * @param xx
+     * @param xy
+     * @param yy
+     */
+    void covariance(double& xx, double& xy, double& yy) const;
+
 private:
     // by convention, order the means (and covariance) x, y
     double m_Mean[2];
@@ -72,7 +80,7 @@ private:
         };
         double xMinusMean[2] = {x[0] - mean[0], x[1] - mean[1]};
         double intermediate[2] = { xMinusMean[0] * inverseCovariance[0][0] + xMinusMean[1] * inverseCovariance[0][1],
-                                   xMinusMean[1] * inverseCovariance[1][0] + xMinusMean[1] * inverseCovariance[1][1]};
+                                   xMinusMean[0] * inverseCovariance[1][0] + xMinusMean[1] * inverseCovariance[1][1]};
         double quadform = intermediate[0] * xMinusMean[0] + intermediate[1] * xMinusMean[1]; // (x - mu)T * Sigma^-1 * (x - mu)
         assert(std::isfinite(quadform) && quadform >= 0);
         double mahalanobisDistance = sqrt(quadform);
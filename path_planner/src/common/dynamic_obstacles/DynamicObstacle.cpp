@@ -1,13 +1,44 @@
+#include <cassert>
+#include <cfloat>
 #include "DynamicObstacle.h"
+#include "DensityKernel.h"
 
 double DynamicObstacle::distanceToEdge(double x, double y, double speed, double time) const {
-    // TODO! -- implement
-    return 0;
+    if (m_Distributions.empty() || speed <= 0) return 0;
+    if (m_Distributions.size() < 2) {
+        // not going anywhere
+        const auto& d = m_Distributions.front();
+        auto dx = x - d.mean()[0], dy = y - d.mean()[1];
+        return fmax(0, sqrt(dx * dx + dy * dy) - reach(d));
+    }
+    // largest footprint and fastest the mean moves over the lookahead
+    auto endTime = time + c_LookaheadTime;
+    unsigned long lower, upper, endLower, endUpper;
+    bracket(time, lower, upper);
+    bracket(endTime, endLower, endUpper);
+    auto now = m_Distributions[lower].interpolate(m_Distributions[upper], time);
+    auto later = m_Distributions[endLower].interpolate(m_Distributions[endUpper], endTime);
+    auto largestReach = fmax(reach(now), reach(later));
+    double fastest = 0;
+    for (auto i = lower; i < endUpper; i++) {
+        const auto& a = m_Distributions[i];
+        const auto& b = m_Distributions[i + 1];
+        if (b.time() > time && b.time() < endTime) largestReach = fmax(largestReach, reach(b));
+        auto dt = b.time() - a.time();
+        if (dt <= 0) continue;
+        auto dx = b.mean()[0] - a.mean()[0], dy = b.mean()[1] - a.mean()[1];
+        fastest = fmax(fastest, sqrt(dx * dx + dy * dy) / dt);
+    }
+    // the gap closes no faster than if we were both heading straight for each other
+    auto dx = x - now.mean()[0], dy = y - now.mean()[1];
+    auto gap = sqrt(dx * dx + dy * dy) - largestReach;
+    if (gap <= 0) return 0;
+    return fmin(speed * gap / (speed + fastest), speed * c_LookaheadTime);
 }
 
-double DynamicObstacle::collisionDensityAt(double x, double y, double time) const {
+void DynamicObstacle::bracket(double time, unsigned long& lower, unsigned long& upper) const {
     // find the highest time lower than the desired time with a binary search
-    unsigned long lower = 0, upper = m_Distributions.size() - 1;
+    lower = 0, upper = m_Distributions.size() - 1;
     auto i = upper / 2;
     while (lower + 1 < upper){
         if (m_Distributions[i].time() <= time) {
@@ -17,28 +48,153 @@ double DynamicObstacle::collisionDensityAt(double x, double y, double time) cons
         }
         i = (lower + upper) / 2;
     }
-    auto interpolated = m_Distributions[lower].interpolate(m_Distributions[upper], time);
-    // could this all be done any faster?
-    // calculate the distance from the test point to the mean
-    auto dx = x - interpolated.mean()[0];
-    auto dy = y - interpolated.mean()[1];
-    auto d = sqrt(dx*dx + dy*dy);
-    // convert the distance to be in terms of our length and width (because we're rotated by our heading)
-    auto beta = atan2(dy, dx);
-    auto alpha = beta + interpolated.heading(); // I think this is right because we're using heading not yaw
-    auto dl = d * sin(alpha);
-    auto dw = d * cos(alpha);
+}
+
+double DynamicObstacle::reach(const Distribution& distribution) const {
+    double a, b, c;
+    distribution.covariance(a, b, c);
+    // largest eigenvalue of [[a, b], [b, c]]
+    auto largest = (a + c) / 2 + sqrt((a - c) * (a - c) / 4 + b * b);
+    return 2 * sqrt(fmax(0, largest)) + sqrt(m_Length * m_Length + m_Width * m_Width) / 2;
+}
+
+void DynamicObstacle::bounds(double startTime, double endTime, double (&box)[4]) const {
+    box[0] = box[1] = DBL_MAX;
+    box[2] = box[3] = -DBL_MAX;
+    auto include = [&](const Distribution& d) {
+        auto r = reach(d);
+        box[0] = fmin(box[0], d.mean()[0] - r);
+        box[1] = fmin(box[1], d.mean()[1] - r);
+        box[2] = fmax(box[2], d.mean()[0] + r);
+        box[3] = fmax(box[3], d.mean()[1] + r);
+    };
+    if (m_Distributions.size() < 2) {
+        for (const auto& d : m_Distributions) include(d);
+        return;
+    }
+    // the means and covariances are piecewise linear in time (and the largest eigenvalue is convex), so checking the
+    // ends and the distributions in between covers everything
+    unsigned long lower, upper;
+    bracket(startTime, lower, upper);
+    include(m_Distributions[lower].interpolate(m_Distributions[upper], startTime));
+    bracket(endTime, lower, upper);
+    include(m_Distributions[lower].interpolate(m_Distributions[upper], endTime));
+    for (const auto& d : m_Distributions) {
+        if (d.time() > startTime && d.time() < endTime) include(d);
+    }
+}
+
+double DynamicObstacle::collisionDensityAt(double x, double y, double time) const {
+    if (m_Segments.empty()) return 0;
+    unsigned long lower = 0, upper;
+    if (m_Distributions.size() > 1) bracket(time, lower, upper);
+    const auto& segment = m_Segments[lower];
+    auto t = time - segment.StartTime;
+    double a = segment.Covariance[0] + segment.CovarianceRate[0] * t;
+    double b = segment.Covariance[1] + segment.CovarianceRate[1] * t;
+    double c = segment.Covariance[2] + segment.CovarianceRate[2] * t;
+    auto dx = x - (segment.Mean[0] + segment.MeanRate[0] * t);
+    auto dy = y - (segment.Mean[1] + segment.MeanRate[1] * t);
+    // nothing out here (see reach()). This also stops the rectangle check and the translation below from finding
+    // density far away
+    auto largest = (a + c) / 2 + sqrt((a - c) * (a - c) / 4 + b * b);
+    auto reach = 2 * sqrt(fmax(0, largest)) + sqrt(m_Length * m_Length + m_Width * m_Width) / 2;
+    if (dx * dx + dy * dy > reach * reach) return 0;
+
+    auto det = a * c - b * b;
+    assert(std::isfinite(det) && det > 0);
+    auto norm = 0.1591549430918953 / sqrt(det); // 1 / (2 pi sqrt(det))
+    // convert the offset to be in terms of our length and width (because we're rotated by our heading)
+    auto heading = segment.Heading + segment.HeadingRate * t;
+    auto sinHeading = sin(heading), cosHeading = cos(heading);
+    auto dl = dy * cosHeading + dx * sinHeading;
+    auto dw = dx * cosHeading - dy * sinHeading;
     // check if the test point is inside our rectangle
     if (dl < m_Length / 2 && dw < m_Width / 2) {
-        return interpolated.density(interpolated.mean()); // it is, so just return the density at the mean
+        return norm; // it is, so just return the density at the mean
     }
+    if (dl == 0) return 0;
     // move us toward the mean of the distribution by an amount dictated by our size and orientation
-    auto dInner = m_Length / (2 * sin(alpha));
-    x -= dInner * cos(beta);
-    y -= dInner * sin(beta);
+    auto scale = 1 - m_Length / (2 * dl);
+    dx *= scale;
+    dy *= scale;
+
+    // return the density at the translated test point, truncated at two standard deviations
+    auto quadform = (c * dx * dx - 2 * b * dx * dy + a * dy * dy) / det; // (x - mu)T * Sigma^-1 * (x - mu)
+    if (quadform > 4) return 0;
+    return norm * exp(-0.5 * quadform);
+}
 
-    // return the density at the translated test point
-    return interpolated.density(x, y);
+void DynamicObstacle::addCollisionDensities(const std::vector<double>& xs, const std::vector<double>& ys,
+                                            const std::vector<double>& times, std::vector<double>& densities) const {
+    if (m_Segments.empty()) return;
+    // the same as collisionDensityAt up to the Gaussian, which goes into these for the kernel (a point inside the
+    // rectangle gets the density at the mean)
+    static thread_local std::vector<double> dxs, dys, as, bs, cs, out;
+    static thread_local std::vector<size_t> lanes;
+    dxs.clear(); dys.clear(); as.clear(); bs.clear(); cs.clear(); lanes.clear();
+    auto halfDiagonal = sqrt(m_Length * m_Length + m_Width * m_Width) / 2;
+    for (size_t i = 0; i < xs.size(); i++) {
+        unsigned long lower = 0, upper;
+        if (m_Distributions.size() > 1) bracket(times[i], lower, upper);
+        const auto& segment = m_Segments[lower];
+        auto t = times[i] - segment.StartTime;
+        double a = segment.Covariance[0] + segment.CovarianceRate[0] * t;
+        double b = segment.Covariance[1] + segment.CovarianceRate[1] * t;
+        double c = segment.Covariance[2] + segment.CovarianceRate[2] * t;
+        auto dx = xs[i] - (segment.Mean[0] + segment.MeanRate[0] * t);
+        auto dy = ys[i] - (segment.Mean[1] + segment.MeanRate[1] * t);
+        auto largest = (a + c) / 2 + sqrt((a - c) * (a - c) / 4 + b * b);
+        auto reach = 2 * sqrt(fmax(0, largest)) + halfDiagonal;
+        if (dx * dx + dy * dy > reach * reach) continue;
+        assert(std::isfinite(a * c - b * b) && a * c - b * b > 0);
+        auto heading = segment.Heading + segment.HeadingRate * t;
+        auto sinHeading = sin(heading), cosHeading = cos(heading);
+        auto dl = dy * cosHeading + dx * sinHeading;
+        auto dw = dx * cosHeading - dy * sinHeading;
+        if (dl < m_Length / 2 && dw < m_Width / 2) {
+            dx = dy = 0;
+        } else {
+            if (dl == 0) continue;
+            auto scale = 1 - m_Length / (2 * dl);
+            dx *= scale;
+            dy *= scale;
+        }
+        dxs.push_back(dx); dys.push_back(dy);
+        as.push_back(a); bs.push_back(b); cs.push_back(c);
+        lanes.push_back(i);
+    }
+    if (lanes.empty()) return;
+    out.resize(lanes.size());
+    DensityKernel::evaluate(dxs.data(), dys.data(), as.data(), bs.data(), cs.data(), out.data(), lanes.size());
+    for (size_t j = 0; j < lanes.size(); j++) densities[lanes[j]] += out[j];
+}
+
+void DynamicObstacle::compile() {
+    m_Segments.clear();
+    auto segment = [](const Distribution& first, const Distribution& second) {
+        Segment s{};
+        s.StartTime = first.time();
+        double covariance[2][3];
+        first.covariance(covariance[0][0], covariance[0][1], covariance[0][2]);
+        second.covariance(covariance[1][0], covariance[1][1], covariance[1][2]);
+        auto dt = second.time() - first.time();
+        for (int i = 0; i < 2; i++) {
+            s.Mean[i] = first.mean()[i];
+            s.MeanRate[i] = dt == 0 ? 0 : (second.mean()[i] - first.mean()[i]) / dt;
+        }
+        for (int i = 0; i < 3; i++) {
+            s.Covariance[i] = covariance[0][i];
+            s.CovarianceRate[i] = dt == 0 ? 0 : (covariance[1][i] - covariance[0][i]) / dt;
+        }
+        s.Heading = first.heading();
+        s.HeadingRate = dt == 0 ? 0 : (second.heading() - first.heading()) / dt;
+        return s;
+    };
+    if (m_Distributions.size() == 1) m_Segments.push_back(segment(m_Distributions[0], m_Distributions[0]));
+    for (size_t i = 0; i + 1 < m_Distributions.size(); i++) {
+        m_Segments.push_back(segment(m_Distributions[i], m_Distributions[i + 1]));
+    }
 }
 
 DynamicObstacle::DynamicObstacle(const std::vector<Distribution>& distributions)
@@ -48,8 +204,10 @@ DynamicObstacle::DynamicObstacle(const std::vector<Distribution>& distributions,
     m_Length = length;
     m_Width = width;
     m_Distributions = distributions;
+    compile();
 }
 
 void DynamicObstacle::update(const std::vector<Distribution>& distributions) {
     m_Distributions = distributions;
+    compile();
 }
@@ -32,12 +32,14 @@ public:
     void update(const std::vector<Distribution>& distributions);
 
     /**
-     * Find the shortest distance from a point to the edge of the distribution at the specified time.
+     * Find a lower bound on how far we can go from a point at the given speed before we could possibly run into this
+     * obstacle, i.e. before collisionDensityAt might be non-zero. Takes into account how fast the obstacle is moving
+     * and how much its footprint grows over the next c_LookaheadTime seconds (and won't promise more than that).
      * @param x
      * @param y
-     * @param speed
+     * @param speed our speed
      * @param time
-     * @return
+     * @return distance (m)
      */
     double distanceToEdge(double x, double y, double speed, double time) const;
 
@@ -51,11 +53,66 @@ public:
      */
     double collisionDensityAt(double x, double y, double time) const;
 
+    /**
+     * Add this obstacle's collision density at each of a batch of points to densities. The Gaussians for every point
+     * that needs one are evaluated together with DensityKernel, so this is much faster than calling
+     * collisionDensityAt in a loop.
+     * @param xs
+     * @param ys
+     * @param times
+     * @param densities same size as xs, accumulated into
+     */
+    void addCollisionDensities(const std::vector<double>& xs, const std::vector<double>& ys,
+                               const std::vector<double>& times, std::vector<double>& densities) const;
+
+    /**
+     * Find a bounding box around everywhere collisionDensityAt can be non-zero between two times.
+     * @param startTime
+     * @param endTime
+     * @param box filled in with min x, min y, max x, max y
+     */
+    void bounds(double startTime, double endTime, double (&box)[4]) const;
+
+    const std::vector<Distribution>& distributions() const { return m_Distributions; }
+
+    double length() const { return m_Length; }
+
+    double width() const { return m_Width; }
+
 private:
     std::vector<Distribution> m_Distributions;
     double m_Length, m_Width;
 
+    /**
+     * Everything collisionDensityAt needs to interpolate between a pair of distributions (or extrapolate off the end
+     * of them), worked out when the distributions are set so each query is just a few multiply-adds.
+     */
+    struct Segment {
+        double StartTime;
+        double Mean[2], MeanRate[2];
+        double Covariance[3], CovarianceRate[3]; // xx, xy, yy
+        double Heading, HeadingRate;
+    };
+    std::vector<Segment> m_Segments; // one per pair of consecutive distributions (or one for a single distribution)
+
+    /**
+     * Rebuild m_Segments from m_Distributions.
+     */
+    void compile();
+
     static constexpr double c_DefaultWidth = 3, c_DefaultLength = 3;
+    static constexpr double c_LookaheadTime = 30;
+
+    /**
+     * Get the distributions to interpolate between for a time (extrapolating off either end).
+     */
+    void bracket(double time, unsigned long& lower, unsigned long& upper) const;
+
+    /**
+     * How far from the mean of a distribution the density can be non-zero: the truncation at two standard deviations
+     * along the major axis, plus half our diagonal.
+     */
+    double reach(const Distribution& distribution) const;
 
 };
 
@@ -3,6 +3,24 @@
 #include <algorithm>
 #include <cassert>
 
+template <class F>
+double DynamicObstaclesManager::forEachNear(double x, double y, double time, F fn) const {
+    const auto& s = slot(time);
+    for (const auto* o : s.Everywhere) {
+        if (!fn(*o)) return 0;
+    }
+    auto cx = floor(x / c_CellSize), cy = floor(y / c_CellSize);
+    auto it = s.Cells.find(cellKey((int64_t)cx, (int64_t)cy));
+    if (it != s.Cells.end()) {
+        for (const auto* o : it->second) {
+            if (!fn(*o)) return 0;
+        }
+    }
+    auto dx = fmin(x - cx * c_CellSize, (cx + 1) * c_CellSize - x);
+    auto dy = fmin(y - cy * c_CellSize, (cy + 1) * c_CellSize - y);
+    return fmin(dx, dy);
+}
+
 double DynamicObstaclesManager::collisionExists(const State &s) const{
     return collisionExists(s.x(), s.y(), s.time());
 }
@@ -11,40 +29,137 @@ double DynamicObstaclesManager::distanceToNearestPossibleCollision(const State &
     return distanceToNearestPossibleCollision(s.x(), s.y(), s.speed(), s.time());
 }
 
+DynamicObstaclesManager::DynamicObstaclesManager(const DynamicObstaclesManager& other)
+    : m_Obstacles(other.m_Obstacles), m_IgnoreList(other.m_IgnoreList) {}
+
+DynamicObstaclesManager& DynamicObstaclesManager::operator=(const DynamicObstaclesManager& other) {
+    if (this == &other) return *this;
+    m_Obstacles = other.m_Obstacles;
+    m_IgnoreList = other.m_IgnoreList;
+    invalidateIndex();
+    return *this;
+}
+
 double DynamicObstaclesManager::distanceToNearestPossibleCollision(double x, double y, double speed, double time) const {
+    // stop as soon as something's close enough that we'll have to look at densities anyway
     auto min = DBL_MAX;
-    for (const auto& o : m_Obstacles) {
-        min = fmin(min, o.second.distanceToEdge(x, y, speed, time));
+    if (!indexed()) {
+        for (const auto& o : m_Obstacles) {
+            min = fmin(min, o.second->distanceToEdge(x, y, speed, time));
+            if (min <= 0) return 0;
+        }
+        return min;
     }
-    return min;
+    auto outside = forEachNear(x, y, time, [&](const DynamicObstacle& o) {
+        min = fmin(min, o.distanceToEdge(x, y, speed, time));
+        return min > 0;
+    });
+    // the others are outside the cell, at least until the slot ends
+    auto slotEnd = (floor(time / c_SlotDuration) + 1) * c_SlotDuration;
+    return fmin(min, fmin(outside, (slotEnd - time) * speed));
 }
 
 double DynamicObstaclesManager::collisionExists(double x, double y, double time) const {
     // we're not using true probabilities anymore so just use sum of densities
     double sum = 0;
-    for (const auto& o : m_Obstacles) {
-        sum += o.second.collisionDensityAt(x, y, time);
-        assert(std::isfinite(sum));
+    if (!indexed()) {
+        for (const auto& o : m_Obstacles) {
+            sum += o.second->collisionDensityAt(x, y, time);
+            assert(std::isfinite(sum));
+        }
+        return sum;
     }
+    forEachNear(x, y, time, [&](const DynamicObstacle& o) {
+        sum += o.collisionDensityAt(x, y, time);
+        assert(std::isfinite(sum));
+        return true;
+    });
     return sum;
 }
 
+void DynamicObstaclesManager::collisionExists(const std::vector<double>& xs, const std::vector<double>& ys,
+                                              const std::vector<double>& times, std::vector<double>& results) const {
+    results.assign(xs.size(), 0);
+    if (xs.empty()) return;
+    double box[4] = {DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX};
+    auto startTime = DBL_MAX, endTime = -DBL_MAX;
+    for (size_t i = 0; i < xs.size(); i++) {
+        box[0] = fmin(box[0], xs[i]);
+        box[1] = fmin(box[1], ys[i]);
+        box[2] = fmax(box[2], xs[i]);
+        box[3] = fmax(box[3], ys[i]);
+        startTime = fmin(startTime, times[i]);
+        endTime = fmax(endTime, times[i]);
+    }
+    for (const auto& o : m_Obstacles) {
+        double bounds[4];
+        o.second->bounds(startTime, endTime, bounds);
+        if (bounds[0] > box[2] || bounds[2] < box[0] || bounds[1] > box[3] || bounds[3] < box[1]) continue;
+        o.second->addCollisionDensities(xs, ys, times, results);
+    }
+}
+
+bool DynamicObstaclesManager::indexed() const {
+    return m_Obstacles.size() >= c_IndexThreshold;
+}
+
+int64_t DynamicObstaclesManager::cellKey(int64_t cx, int64_t cy) {
+    return (cx << 32) ^ (cy & 0xffffffff);
+}
+
+const DynamicObstaclesManager::Slot& DynamicObstaclesManager::slot(double time) const {
+    auto index = (int64_t)floor(time / c_SlotDuration);
+    std::lock_guard<std::mutex> lock(m_IndexMutex);
+    auto it = m_Slots.find(index);
+    if (it != m_Slots.end()) return it->second;
+    Slot& slot = m_Slots[index];
+    for (const auto& o : m_Obstacles) {
+        double box[4];
+        o.second->bounds(index * c_SlotDuration, (index + 1) * c_SlotDuration, box);
+        if (box[0] > box[2]) continue; // no distributions
+        auto x0 = (int64_t)floor(box[0] / c_CellSize), y0 = (int64_t)floor(box[1] / c_CellSize);
+        auto x1 = (int64_t)floor(box[2] / c_CellSize), y1 = (int64_t)floor(box[3] / c_CellSize);
+        if ((x1 - x0 + 1) * (y1 - y0 + 1) > c_MaxCellsPerObstacle) {
+            slot.Everywhere.push_back(o.second.get());
+            continue;
+        }
+        for (auto cx = x0; cx <= x1; cx++) {
+            for (auto cy = y0; cy <= y1; cy++) slot.Cells[cellKey(cx, cy)].push_back(o.second.get());
+        }
+    }
+    return slot;
+}
+
+void DynamicObstaclesManager::invalidateIndex() {
+    std::lock_guard<std::mutex> lock(m_IndexMutex);
+    m_Slots.clear();
+}
+
 void DynamicObstaclesManager::update(uint32_t mmsi, const std::vector<Distribution>& distributions) {
     if (std::find(m_IgnoreList.begin(), m_IgnoreList.end(), mmsi) != m_IgnoreList.end()) return;
-    auto pair = m_Obstacles.emplace(mmsi, distributions);
-    if (!pair.second) pair.first->second.update(distributions);
+    auto it = m_Obstacles.find(mmsi);
+    if (it == m_Obstacles.end()) {
+        m_Obstacles.emplace(mmsi, std::make_shared<const DynamicObstacle>(distributions));
+    } else {
+        // copies might still be using the old one
+        auto obstacle = std::make_shared<DynamicObstacle>(*it->second);
+        obstacle->update(distributions);
+        it->second = std::move(obstacle);
+    }
+    invalidateIndex();
 }
 
 void DynamicObstaclesManager::add(uint32_t mmsi, const std::vector<Distribution>& distributions,
         double width, double length) {
     if (std::find(m_IgnoreList.begin(), m_IgnoreList.end(), mmsi) != m_IgnoreList.end()) return;
     // hopefully there's nothing already there...
-    auto pair = m_Obstacles.insert(std::unordered_map<uint32_t, DynamicObstacle>::value_type(mmsi,
-            DynamicObstacle(distributions, length, width)));
+    m_Obstacles.emplace(mmsi, std::make_shared<const DynamicObstacle>(distributions, length, width));
+    invalidateIndex();
 }
 
 void DynamicObstaclesManager::forget(uint32_t mmsi) {
     m_Obstacles.erase(mmsi);
+    invalidateIndex();
 }
 
 void DynamicObstaclesManager::addIgnore(uint32_t mmsi) {
@@ -52,5 +167,12 @@ void DynamicObstaclesManager::addIgnore(uint32_t mmsi) {
 }
 
 void DynamicObstaclesManager::removeIgnore(uint32_t mmsi) {
-    m_IgnoreList.erase(std::remove(m_IgnoreList.begin(), m_IgnoreList.end(), 8), m_IgnoreList.end());
+    m_IgnoreList.erase(std::remove(m_IgnoreList.begin(), m_IgnoreList.end(), mmsi), m_IgnoreList.end());
+}
+
+void DynamicObstaclesManager::forEachObstacle(const std::function<void(uint32_t, const DynamicObstacle&)>& f) const {
+    std::vector<uint32_t> ids;
+    for (const auto& o : m_Obstacles) ids.push_back(o.first);
+    std::sort(ids.begin(), ids.end());
+    for (auto id : ids) f(id, *m_Obstacles.at(id));
 }
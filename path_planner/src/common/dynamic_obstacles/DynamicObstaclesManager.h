@@ -4,13 +4,34 @@
 
 #include <path_planner_common/State.h>
 #include "DynamicObstacle.h"
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 /**
  * Manages the dynamic obstacles for the executive.
+ *
+ * Once there are a few obstacles, queries go through a spatio-temporal index so they only look at obstacles that could
+ * be near: time is split into slots, and for each slot (built the first time it's queried) every obstacle is bucketed
+ * into the grid cells its bounds over that slot overlap. Changing the obstacles throws the index away. Queries are
+ * safe from multiple threads.
+ *
+ * The obstacles themselves are never changed once made: updating one replaces it. So a copy shares every obstacle
+ * with the original, and taking one (say, a snapshot for the planner) is just copying pointers.
  */
 class DynamicObstaclesManager {
 public:
+    DynamicObstaclesManager() = default;
+
+    /**
+     * Copy the obstacles (sharing them, see above). The index isn't copied; the copy builds its own.
+     * @param other
+     */
+    DynamicObstaclesManager(const DynamicObstaclesManager& other);
+
+    DynamicObstaclesManager& operator=(const DynamicObstaclesManager& other);
+
     /**
      * Return a number weighted by increasing chance of collision. Not a probability, necessarily. Good luck tuning this.
      * @param s
@@ -19,6 +40,18 @@ public:
     double collisionExists(const State& s) const;
     double collisionExists(double x, double y, double time) const;
 
+    /**
+     * Evaluate collisionExists at a batch of points (usually the samples along an edge). Only obstacles whose bounds
+     * over the batch's time span overlap the points' bounding box are looked at, and each of those evaluates all the
+     * points at once (see DynamicObstacle::addCollisionDensities).
+     * @param xs
+     * @param ys
+     * @param times
+     * @param results resized to match and filled in
+     */
+    void collisionExists(const std::vector<double>& xs, const std::vector<double>& ys, const std::vector<double>& times,
+                         std::vector<double>& results) const;
+
     /**
      * Find the distance to the edge of the nearest truncated distribution representing a dynamic obstacle. Check to
      * make sure it's implemented before you use it.
@@ -62,9 +95,62 @@ public:
      */
     void removeIgnore(uint32_t mmsi);
 
+    /**
+     * Call a function on each obstacle, in order of ID so anything made from them comes out the same every time.
+     * @param f takes the ID and the obstacle
+     */
+    void forEachObstacle(const std::function<void(uint32_t, const DynamicObstacle&)>& f) const;
+
+    /**
+     * @return the IDs being ignored
+     */
+    const std::vector<uint32_t>& ignored() const { return m_IgnoreList; }
+
 private:
-    std::unordered_map<uint32_t, DynamicObstacle> m_Obstacles;
+    std::unordered_map<uint32_t, std::shared_ptr<const DynamicObstacle>> m_Obstacles;
     std::vector<uint32_t> m_IgnoreList;
+
+    /**
+     * The obstacles bucketed by cell for one time slot.
+     */
+    struct Slot {
+        std::unordered_map<int64_t, std::vector<const DynamicObstacle*>> Cells;
+        // obstacles that would cover too many cells
+        std::vector<const DynamicObstacle*> Everywhere;
+    };
+
+    mutable std::mutex m_IndexMutex;
+    mutable std::unordered_map<int64_t, Slot> m_Slots;
+
+    /**
+     * @return whether there are enough obstacles to bother with the index
+     */
+    bool indexed() const;
+
+    /**
+     * Get the slot for a time, building it if necessary. The slot stays valid until the obstacles change.
+     */
+    const Slot& slot(double time) const;
+
+    /**
+     * Call fn on every obstacle that could matter at a point and time, until it returns false. Returns the distance
+     * from the point to the edge of its cell, beyond which the rest of the obstacles are (until the end of the slot),
+     * or 0 if stopped early.
+     */
+    template <class F>
+    double forEachNear(double x, double y, double time, F fn) const;
+
+    /**
+     * Forget the index after changing the obstacles.
+     */
+    void invalidateIndex();
+
+    static int64_t cellKey(int64_t cx, int64_t cy);
+
+    static constexpr size_t c_IndexThreshold = 8;
+    static constexpr double c_CellSize = 100; // meters
+    static constexpr double c_SlotDuration = 10; // seconds
+    static constexpr long c_MaxCellsPerObstacle = 256;
 };
 
 
@@ -0,0 +1,149 @@
+#ifndef SRC_DISTANCEFIELD_H
+#define SRC_DISTANCEFIELD_H
+
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+/**
+ * How distances are squeezed into the storage type T. Encoding always rounds down so a stored distance is never more
+ * than the real one (and so the brushfire never sees a cell as farther than it set it to). DBL_MAX means unblocked.
+ * @tparam T
+ */
+template <class T>
+struct DistanceEncoding;
+
+template <>
+struct DistanceEncoding<double> {
+    static double encode(double d) { return d; }
+    static double decode(double v) { return v; }
+};
+
+template <>
+struct DistanceEncoding<float> {
+    static float encode(double d) {
+        if (d >= FLT_MAX) return FLT_MAX;
+        auto f = (float)d;
+        return f > d ? std::nextafter(f, -FLT_MAX) : f;
+    }
+    static double decode(float v) { return v == FLT_MAX ? DBL_MAX : v; }
+};
+
+/**
+ * 16 bit quantized distances, in steps of Resolution meters starting at -1 (blocked). Anything too far to fit is
+ * stored as the largest representable distance (about 6.5km) and UINT16_MAX is reserved for unblocked.
+ */
+template <>
+struct DistanceEncoding<uint16_t> {
+    static constexpr double Resolution = 0.1;
+    static uint16_t encode(double d) {
+        if (d >= DBL_MAX) return UINT16_MAX;
+        auto v = floor((d + 1) / Resolution);
+        if (v < 0) return 0;
+        if (v >= UINT16_MAX - 1) return UINT16_MAX - 1;
+        return (uint16_t)v;
+    }
+    static double decode(uint16_t v) { return v == UINT16_MAX ? DBL_MAX : v * Resolution - 1; }
+};
+
+/**
+ * Row-major grid of distances to the nearest obstacle, stored in one contiguous buffer. The buffer is shared between
+ * copies, and can be memory someone else owns (like a mapped cache file) in which case the field is read only.
+ * @tparam T storage type - double, float or (quantized) uint16_t
+ */
+template <class T>
+class DistanceField {
+public:
+    typedef T Cell;
+
+    /**
+     * Construct an empty field.
+     */
+    DistanceField() = default;
+
+    /**
+     * Construct a field with everything unblocked.
+     * @param cols
+     * @param rows
+     */
+    DistanceField(int cols, int rows)
+        : m_Cols(cols), m_Rows(rows), m_Owner(new T[std::max<size_t>(1, (size_t)cols * rows)], std::default_delete<T[]>()),
+          m_Cells(m_Owner.get()) {
+        std::fill(m_Cells, m_Cells + size(), DistanceEncoding<T>::encode(DBL_MAX));
+    }
+
+    /**
+     * Make a read only field over existing cells.
+     * @param cols
+     * @param rows
+     * @param cells encoded distances, row-major
+     * @param owner keeps the cells alive
+     * @return
+     */
+    static DistanceField view(int cols, int rows, const T* cells, std::shared_ptr<const void> owner) {
+        DistanceField field;
+        field.m_Cols = cols, field.m_Rows = rows;
+        field.m_Owner = std::shared_ptr<T>(owner, const_cast<T*>(cells));
+        field.m_Cells = const_cast<T*>(cells);
+        return field;
+    }
+
+    int cols() const { return m_Cols; }
+    int rows() const { return m_Rows; }
+
+    /**
+     * Get the distance at a cell. No bounds checking.
+     * @param x column
+     * @param y row
+     * @return
+     */
+    double get(int x, int y) const { return DistanceEncoding<T>::decode(m_Cells[(size_t)y * m_Cols + x]); }
+
+    /**
+     * Set the distance at a cell. No bounds checking, and not for views.
+     * @param x column
+     * @param y row
+     * @param d
+     */
+    void set(int x, int y, double d) { m_Cells[(size_t)y * m_Cols + x] = DistanceEncoding<T>::encode(d); }
+
+    /**
+     * Look up the distance at fractional cell coordinates, which are truncated towards zero (so the same way the old
+     * nested vectors were indexed).
+     * @param x column
+     * @param y row
+     * @return the distance, or -1 outside the field (or for NaNs)
+     */
+    double lookup(double x, double y) const {
+        if (!(x > -1 && y > -1 && x < m_Cols && y < m_Rows)) return -1;
+        return get((int)x, (int)y);
+    }
+
+    /**
+     * @return the memory used by the distances
+     */
+    size_t bytes() const { return size() * sizeof(T); }
+
+    /**
+     * @return the encoded cells, row-major
+     */
+    const T* data() const { return m_Cells; }
+
+private:
+    size_t size() const { return (size_t)m_Cols * m_Rows; }
+
+    int m_Cols = 0, m_Rows = 0;
+    std::shared_ptr<T> m_Owner;
+    T* m_Cells = nullptr;
+};
+
+#ifdef PATH_PLANNER_QUANTIZED_MAPS
+typedef DistanceField<uint16_t> MapDistanceField;
+#else
+typedef DistanceField<float> MapDistanceField;
+#endif
+
+
+#endif //SRC_DISTANCEFIELD_H
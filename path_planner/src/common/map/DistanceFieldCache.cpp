@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "DistanceFieldCache.h"
+
+namespace {
+const char c_Magic[8] = {'P', 'P', 'D', 'I', 'S', 'T', 'F', '\0'};
+}
+
+std::string DistanceFieldCache::cachePath(const std::string& sourcePath) {
+    return sourcePath + ".distances";
+}
+
+bool DistanceFieldCache::describeSource(const std::string& sourcePath, Header& header) {
+    struct stat st{};
+    if (stat(sourcePath.c_str(), &st) != 0) return false;
+    header.SourceSize = st.st_size;
+    header.SourceModifiedSeconds = st.st_mtim.tv_sec;
+    header.SourceModifiedNanoseconds = st.st_mtim.tv_nsec;
+    // FNV-1a over the start of the file, which for a GeoTiff includes the header and tags
+    std::ifstream in(sourcePath, std::ios::binary);
+    if (!in) return false;
+    std::vector<char> buffer(c_HashedBytes);
+    in.read(buffer.data(), buffer.size());
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::streamsize i = 0; i < in.gcount(); i++) {
+        hash ^= (unsigned char)buffer[i];
+        hash *= 1099511628211ULL;
+    }
+    header.SourceHash = hash;
+    return true;
+}
+
+bool DistanceFieldCache::load(const std::string& sourcePath, Metadata& metadata, MapDistanceField& field) {
+    Header expected{};
+    if (!describeSource(sourcePath, expected)) return false;
+
+    auto path = cachePath(sourcePath);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    size_t length = st.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (mapped == MAP_FAILED) return false;
+    std::shared_ptr<const void> mapping(mapped, [length](const void* p) { munmap(const_cast<void*>(p), length); });
+
+    Header header{};
+    memcpy(&header, mapped, sizeof(Header));
+    auto cells = (size_t)header.Cols * header.Rows;
+    if (memcmp(header.Magic, c_Magic, sizeof(c_Magic)) != 0 || header.Version != c_Version ||
+        header.CellBytes != sizeof(MapDistanceField::Cell) || header.Cols < 0 || header.Rows < 0 ||
+        length != sizeof(Header) + cells * header.CellBytes ||
+        header.SourceSize != expected.SourceSize ||
+        header.SourceModifiedSeconds != expected.SourceModifiedSeconds ||
+        header.SourceModifiedNanoseconds != expected.SourceModifiedNanoseconds ||
+        header.SourceHash != expected.SourceHash ||
+        header.Meta.Longitude != metadata.Longitude || header.Meta.Latitude != metadata.Latitude) {
+        return false;
+    }
+
+    metadata = header.Meta;
+    auto data = static_cast<const char*>(mapped) + sizeof(Header);
+    field = MapDistanceField::view(header.Cols, header.Rows, reinterpret_cast<const MapDistanceField::Cell*>(data),
+                                   mapping);
+    return true;
+}
+
+bool DistanceFieldCache::save(const std::string& sourcePath, const Metadata& metadata, const MapDistanceField& field) {
+    Header header{};
+    if (!describeSource(sourcePath, header)) return false;
+    memcpy(header.Magic, c_Magic, sizeof(c_Magic));
+    header.Version = c_Version;
+    header.CellBytes = sizeof(MapDistanceField::Cell);
+    header.Cols = field.cols();
+    header.Rows = field.rows();
+    header.Meta = metadata;
+
+    auto path = cachePath(sourcePath);
+    auto temporary = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(field.data()), field.bytes());
+        if (!out) {
+            std::cerr << "Could not write distance field cache " << temporary << std::endl;
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not move distance field cache into place at " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
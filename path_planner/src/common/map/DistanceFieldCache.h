@@ -0,0 +1,76 @@
+#ifndef SRC_DISTANCEFIELDCACHE_H
+#define SRC_DISTANCEFIELDCACHE_H
+
+#include <cstdint>
+#include <string>
+#include "DistanceField.h"
+
+/**
+ * On-disk cache of a map's distance field, kept next to the source file (at the source path plus ".distances").
+ *
+ * The file is a small versioned header followed by the encoded cells, and loading it just maps it into memory, so
+ * reloading a known chart is near instant and every planner process on the host shares the same pages. The cache is
+ * only used if it was written for the same source file (size, modification time and a hash of its first bytes), the
+ * same origin and the same storage type. Writes go to a temporary file that's renamed into place, so readers never
+ * see a half written cache.
+ */
+class DistanceFieldCache {
+public:
+    /**
+     * Everything the map needs besides the distances.
+     */
+    struct Metadata {
+        double Longitude = 0, Latitude = 0; // origin used to make it, in WGS84
+        double XOrigin = 0, YOrigin = 0; // origin in the map's projection
+        double InverseGeoTransform[6] = {};
+    };
+
+    /**
+     * Try to load the cache for a source file.
+     * @param sourcePath
+     * @param metadata Longitude and Latitude must be set; the rest is filled in on success
+     * @param field set on success
+     * @return whether there was a valid cache
+     */
+    static bool load(const std::string& sourcePath, Metadata& metadata, MapDistanceField& field);
+
+    /**
+     * Write the cache for a source file. Failures (like a read only chart directory) are reported to std::cerr but
+     * otherwise ignored since the cache is only an optimization.
+     * @param sourcePath
+     * @param metadata
+     * @param field
+     * @return whether it was written
+     */
+    static bool save(const std::string& sourcePath, const Metadata& metadata, const MapDistanceField& field);
+
+    /**
+     * @param sourcePath
+     * @return where the cache for the source file lives
+     */
+    static std::string cachePath(const std::string& sourcePath);
+
+private:
+    struct Header {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t CellBytes; // tells float and quantized fields apart
+        int32_t Cols, Rows;
+        uint64_t SourceSize;
+        int64_t SourceModifiedSeconds, SourceModifiedNanoseconds;
+        uint64_t SourceHash;
+        Metadata Meta;
+    };
+
+    /**
+     * Fill in the source file part of the header.
+     * @return false if the source can't be read
+     */
+    static bool describeSource(const std::string& sourcePath, Header& header);
+
+    static constexpr uint32_t c_Version = 1;
+    static constexpr size_t c_HashedBytes = 1 << 16;
+};
+
+
+#endif //SRC_DISTANCEFIELDCACHE_H
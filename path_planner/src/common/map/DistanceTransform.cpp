@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <thread>
+#include "DistanceTransform.h"
+
+template <class F>
+void DistanceTransform::parallelFor(int n, unsigned threads, F fn) {
+    if (threads <= 1 || n <= 1) {
+        fn(0, n);
+        return;
+    }
+    threads = std::min(threads, (unsigned)n);
+    std::vector<std::thread> workers;
+    int chunk = (n + threads - 1) / threads;
+    for (int begin = 0; begin < n; begin += chunk) {
+        int end = std::min(n, begin + chunk);
+        workers.emplace_back([=] { fn(begin, end); });
+    }
+    for (auto& w : workers) w.join();
+}
+
+void DistanceTransform::transform1D(const std::vector<double>& f, double spacing, std::vector<double>& d,
+                                    std::vector<int>& v, std::vector<double>& z) {
+    int n = f.size();
+    auto w2 = spacing * spacing;
+    int k = -1;
+    for (int q = 0; q < n; q++) {
+        if (f[q] == DBL_MAX) continue; // no parabola here
+        if (k < 0) {
+            k = 0;
+            v[0] = q;
+            z[0] = -DBL_MAX;
+            z[1] = DBL_MAX;
+            continue;
+        }
+        double s;
+        while (true) {
+            auto r = v[k];
+            s = ((f[q] + w2 * q * q) - (f[r] + w2 * r * r)) / (2 * w2 * (q - r));
+            if (s > z[k]) break;
+            k--; // z[0] is -DBL_MAX so this stops at zero
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = DBL_MAX;
+    }
+    if (k < 0) {
+        std::fill(d.begin(), d.end(), DBL_MAX);
+        return;
+    }
+    k = 0;
+    for (int p = 0; p < n; p++) {
+        while (z[k + 1] < p) k++;
+        d[p] = w2 * (p - v[k]) * (p - v[k]) + f[v[k]];
+    }
+}
+
+MapDistanceField DistanceTransform::compute(const std::vector<bool>& blocked, int cols, int rows, double xScale,
+                                            double yScale, unsigned threads) {
+    MapDistanceField field(cols, rows);
+    if (cols <= 0 || rows <= 0) return field;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = (unsigned)std::max(1L, std::min((long)threads, (long)cols * rows / c_MinCellsPerThread));
+    }
+
+    // first pass: cells to the nearest blocked cell in the same column. Each thread takes a band of columns but walks
+    // it a row at a time to stay cache friendly.
+    std::vector<int> g((size_t)cols * rows);
+    parallelFor(cols, threads, [&](int begin, int end) {
+        for (int y = 0; y < rows; y++) {
+            for (int x = begin; x < end; x++) {
+                auto i = (size_t)y * cols + x;
+                if (blocked[i]) g[i] = 0;
+                else if (y == 0 || g[i - cols] == INT_MAX) g[i] = INT_MAX;
+                else g[i] = g[i - cols] + 1;
+            }
+        }
+        for (int y = rows - 2; y >= 0; y--) {
+            for (int x = begin; x < end; x++) {
+                auto i = (size_t)y * cols + x;
+                if (g[i + cols] != INT_MAX && g[i + cols] + 1 < g[i]) g[i] = g[i + cols] + 1;
+            }
+        }
+    });
+
+    // second pass: combine along rows
+    auto offset = std::min(xScale, yScale);
+    parallelFor(rows, threads, [&](int begin, int end) {
+        std::vector<double> f(cols), d(cols), z(cols + 1);
+        std::vector<int> v(cols);
+        for (int y = begin; y < end; y++) {
+            for (int x = 0; x < cols; x++) {
+                auto cells = g[(size_t)y * cols + x];
+                f[x] = cells == INT_MAX ? DBL_MAX : (cells * yScale) * (cells * yScale);
+            }
+            transform1D(f, xScale, d, v, z);
+            for (int x = 0; x < cols; x++) {
+                if (blocked[(size_t)y * cols + x]) field.set(x, y, -1);
+                else if (d[x] == DBL_MAX) field.set(x, y, DBL_MAX);
+                else field.set(x, y, std::max(0.0, sqrt(d[x]) - offset));
+            }
+        }
+    });
+    return field;
+}
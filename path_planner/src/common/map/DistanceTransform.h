@@ -0,0 +1,48 @@
+#ifndef SRC_DISTANCETRANSFORM_H
+#define SRC_DISTANCETRANSFORM_H
+
+#include <vector>
+#include "DistanceField.h"
+
+/**
+ * Exact Euclidean distance transform (Felzenszwalb and Huttenlocher's lower envelope of parabolas), used by the maps
+ * to turn an occupancy grid into a distance field. It's linear in the number of cells, and both passes are split
+ * across threads (columns for the first, rows for the second).
+ *
+ * Values follow what the old brushfire produced: -1 for blocked cells, 0 for cells touching a blocked one, and
+ * otherwise the distance between cell centers less one cell. Unblocked maps are DBL_MAX everywhere.
+ */
+class DistanceTransform {
+public:
+    /**
+     * Compute the distance field for an occupancy grid.
+     * @param blocked row-major occupancy, cols * rows
+     * @param cols
+     * @param rows
+     * @param xScale width of a cell in meters
+     * @param yScale height of a cell in meters
+     * @param threads number of threads to use, or 0 for the hardware concurrency (fewer for small maps)
+     * @return
+     */
+    static MapDistanceField compute(const std::vector<bool>& blocked, int cols, int rows, double xScale,
+                                    double yScale, unsigned threads = 0);
+
+private:
+    /**
+     * One dimensional squared distance transform of f, with samples spacing apart, into d. Uses v and z as scratch.
+     */
+    static void transform1D(const std::vector<double>& f, double spacing, std::vector<double>& d,
+                            std::vector<int>& v, std::vector<double>& z);
+
+    /**
+     * Run fn(begin, end) over [0, n) split into chunks across threads.
+     */
+    template <class F>
+    static void parallelFor(int n, unsigned threads, F fn);
+
+    // when picking the thread count, give each at least this many cells
+    static constexpr long c_MinCellsPerThread = 1 << 16;
+};
+
+
+#endif //SRC_DISTANCETRANSFORM_H
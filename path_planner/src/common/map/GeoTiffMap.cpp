@@ -1,11 +1,23 @@
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <ogr_spatialref.h>
 #include <cfloat>
-#include <queue>
 #include "GeoTiffMap.h"
+#include "DistanceTransform.h"
+#include "DistanceFieldCache.h"
+
+GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double originLatitude,
+                       const std::atomic<bool>* cancelled) {
+    DistanceFieldCache::Metadata metadata;
+    metadata.Longitude = originLongitude, metadata.Latitude = originLatitude;
+    if (DistanceFieldCache::load(path, metadata, m_Distances)) {
+        m_InverseGeoTransform = std::vector<double>(metadata.InverseGeoTransform, metadata.InverseGeoTransform + 6);
+        m_XOrigin = metadata.XOrigin, m_YOrigin = metadata.YOrigin;
+        std::cerr << "Loaded map distances from " << DistanceFieldCache::cachePath(path) << std::endl;
+        return;
+    }
 
-GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double originLatitude) {
     GDALAllRegister();
     auto dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GDALAccess::GA_ReadOnly));
     if (!dataset) throw std::runtime_error("GeoTiffMap failed to load map file");
@@ -22,21 +34,25 @@ GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double o
         throw std::runtime_error("GeoTiffMap failed to invert geo transform");
     }
     int rasterCols = band->GetXSize(), rasterRows = band->GetYSize();
-    auto data = std::vector<std::vector<float>>(rasterRows);
-    auto line = static_cast<float*>(CPLMalloc(sizeof(float) * rasterCols));
+    // depths, row-major
+    auto data = std::vector<float>((size_t)rasterCols * rasterRows);
     // Read a row at a time. Efficiency shouldn't matter here and I'm more comfortable programming it this way
+    auto checkCancelled = [&] {
+        if (!cancelled || !*cancelled) return;
+        GDALClose(dataset);
+        delete[] geoTransform;
+        throw std::runtime_error("GeoTiffMap load cancelled");
+    };
     for (int i = 0; i < rasterRows; i++) {
+        checkCancelled();
+        auto line = data.data() + (size_t)i * rasterCols;
         auto err3 = band->RasterIO(GF_Read, 0, i, rasterCols, 1, line, rasterCols, 1, GDT_Float32, 0, 0);
         if (err3 != CE_None) {
             std::ostringstream stringStream;
             stringStream << "GeoTiffMap failed to access data at row " << i << "of band 1";
             throw std::runtime_error(stringStream.str());
         }
-        for (int j = 0; j < rasterCols; j++) {
-            data[i].push_back(line[j]);
-        }
     }
-    CPLFree(line);
 
     std::cerr << "Done reading map. Starting distances calculations" << std::endl;
 
@@ -52,55 +68,32 @@ GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double o
     m_XOrigin = originLongitude, m_YOrigin = originLatitude;
     projectTransformation->Transform(1, &m_XOrigin, &m_YOrigin);
 
-    // little local class for BrushFire algorithm
-    class BrushFireCell {
-    public:
-        BrushFireCell(int x, int y, double distanceToBlocked) : x(x), y(y), DistanceToBlocked(distanceToBlocked) {}
-        double DistanceToBlocked;
-        int x, y;
-        void pushNeighbors(std::queue<BrushFireCell>& queue, int xMax, int yMax, const double geoTransform[6]) {
-            for (int i = x - 1; i <= x + 1; i++) {
-                for (int j = y - 1; j <= y + 1; j++){
-                    if (i == x && j == y) continue;
-                    // This should fix the fact that the distance is in pixels...
-                    auto d = sqrt(((i - x)*geoTransform[1] + (j - y)*geoTransform[2])*((i - x)*geoTransform[1] + (j - y)*geoTransform[2]) +
-                                     ((i - x)*geoTransform[4] + (j - y)*geoTransform[5])*((i - x)*geoTransform[4] + (j - y)*geoTransform[5]));
-                    if (DistanceToBlocked == -1) d = 1;
-                    BrushFireCell cell(i, j, DistanceToBlocked + d);
-                    if (cell.valid(xMax, yMax)) queue.push(cell);
-                }
-            }
-        }
-        bool valid(int xMax, int yMax) const {
-            return 0 < x && 0 < y && x < xMax && y < yMax;
-        }
-    };
-    std::queue<BrushFireCell> brushFireQueue;
-    m_Distances = std::vector<std::vector<double>>(rasterRows, std::vector<double>(rasterCols, DBL_MAX));
-
+    std::vector<bool> blocked((size_t)rasterCols * rasterRows);
     int blockedCount = 0;
-    for (int y = 0; y < rasterRows; y++) {
-        for (int x = 0; x < rasterCols; x++) {
-            if (data[y][x] < c_MinimumDepth) {
-                brushFireQueue.push(BrushFireCell(x, y, -1));
-                blockedCount++;
-            }
+    for (size_t i = 0; i < blocked.size(); i++) {
+        if (data[i] < c_MinimumDepth) {
+            blocked[i] = true;
+            blockedCount++;
         }
     }
+    data = std::vector<float>();
 
     std::cerr << blockedCount << " out of " << rasterCols*rasterRows << " cells blocked" << std::endl;
+    checkCancelled();
 
-    while (!brushFireQueue.empty()) {
-        auto& cell = brushFireQueue.front();
-        if (m_Distances[cell.y][cell.x] > cell.DistanceToBlocked) { // cell has not been set yet (or found shorter distance?)
-            m_Distances[cell.y][cell.x] = cell.DistanceToBlocked;
-            cell.pushNeighbors(brushFireQueue, rasterCols, rasterRows, geoTransform);
-        }
-        brushFireQueue.pop();
-    }
+    // pixel size in meters along each raster axis
+    auto xScale = sqrt(geoTransform[1] * geoTransform[1] + geoTransform[4] * geoTransform[4]);
+    auto yScale = sqrt(geoTransform[2] * geoTransform[2] + geoTransform[5] * geoTransform[5]);
+    m_Distances = DistanceTransform::compute(blocked, rasterCols, rasterRows, xScale, yScale);
 
     std::cerr << "Done loading map from " << path << std::endl;
 
+    metadata.XOrigin = m_XOrigin, metadata.YOrigin = m_YOrigin;
+    std::copy(m_InverseGeoTransform.begin(), m_InverseGeoTransform.end(), metadata.InverseGeoTransform);
+    if (DistanceFieldCache::save(path, metadata, m_Distances)) {
+        std::cerr << "Cached map distances at " << DistanceFieldCache::cachePath(path) << std::endl;
+    }
+
     delete[] geoTransform;
 }
 
@@ -120,9 +113,22 @@ double GeoTiffMap::getUnblockedDistance(double x, double y) const {
 //    std::cerr << "Depth at " << x << ", " << y << ": " << getDepth(x, y) << std::endl;
     auto xi = m_InverseGeoTransform[0] + x * m_InverseGeoTransform[1] + y * m_InverseGeoTransform[2];
     auto yi = m_InverseGeoTransform[3] + x * m_InverseGeoTransform[4] + y * m_InverseGeoTransform[5];
-    try {
-        return m_Distances.at((int)yi).at((int)xi);
-    } catch (std::out_of_range&) {
-        return -1;
+    return m_Distances.lookup(xi, yi);
+}
+
+void GeoTiffMap::getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                                       std::vector<double>& distances) const {
+    distances.resize(xs.size());
+    const auto* t = m_InverseGeoTransform.data();
+    for (size_t i = 0; i < xs.size(); i++) {
+        auto x = xs[i] + m_XOrigin, y = ys[i] + m_YOrigin;
+        distances[i] = m_Distances.lookup(t[0] + x * t[1] + y * t[2], t[3] + x * t[4] + y * t[5]);
     }
 }
+
+double GeoTiffMap::cellDiagonal() const {
+    // a pixel is the inverse of a unit step along each raster axis
+    const auto* t = m_InverseGeoTransform.data();
+    auto xScale = 1 / sqrt(t[1] * t[1] + t[2] * t[2]), yScale = 1 / sqrt(t[4] * t[4] + t[5] * t[5]);
+    return sqrt(xScale * xScale + yScale * yScale);
+}
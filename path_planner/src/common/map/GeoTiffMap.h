@@ -2,8 +2,10 @@
 #define SRC_GEOTIFFMAP_H
 
 #include <gdal_priv.h>
+#include <atomic>
 #include <string>
 #include "Map.h"
+#include "DistanceField.h"
 
 /**
  * Represent a map loaded from a GeoTiff.
@@ -16,8 +18,11 @@ public:
      * @param path path to the map file.
      * @param longitude origin longitude
      * @param originLatitude origin latitude
+     * @param cancelled if given, checked as the map is read and before the distances are computed, throwing a runtime
+     * error if it's set
      */
-    explicit GeoTiffMap(const std::string& path, double longitude, double originLatitude);
+    explicit GeoTiffMap(const std::string& path, double longitude, double originLatitude,
+                        const std::atomic<bool>* cancelled = nullptr);
 
     ~GeoTiffMap() override = default;
 
@@ -25,10 +30,15 @@ public:
 
     double getUnblockedDistance(double x, double y) const override;
 
+    void getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                               std::vector<double>& distances) const override;
+
+    double cellDiagonal() const override;
+
 private:
 //    GDALDataset* m_Dataset;
 //    std::vector<std::vector<float>> m_Data;
-    std::vector<std::vector<double>> m_Distances;
+    MapDistanceField m_Distances;
     std::vector<double> m_InverseGeoTransform;
     double m_XOrigin, m_YOrigin;
     static constexpr double c_MinimumDepth = 0;
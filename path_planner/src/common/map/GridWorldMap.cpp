@@ -1,18 +1,24 @@
 #include <fstream>
 #include <sstream>
-#include <queue>
 #include <cmath>
 #include <cfloat>
 #include "GridWorldMap.h"
+#include "DistanceTransform.h"
 #include <algorithm>
 
 double GridWorldMap::getUnblockedDistance(double x, double y) const {
-    try {
-        return m_Distances.at(y / m_Resolution).at(x / m_Resolution);
-    }
-    catch (std::out_of_range&) {
-        return -1;
-    }
+    return m_Distances.lookup(x / m_Resolution, y / m_Resolution);
+}
+
+void GridWorldMap::getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                                         std::vector<double>& distances) const {
+    distances.resize(xs.size());
+    double resolution = m_Resolution;
+    for (size_t i = 0; i < xs.size(); i++) distances[i] = m_Distances.lookup(xs[i] / resolution, ys[i] / resolution);
+}
+
+double GridWorldMap::cellDiagonal() const {
+    return sqrt(2) * m_Resolution;
 }
 
 GridWorldMap::GridWorldMap(const std::string& path) {
@@ -32,44 +38,11 @@ GridWorldMap::GridWorldMap(const std::string& path) {
     }
     std::reverse(lines.begin(), lines.end());
 
-    class BrushFireCell {
-    public:
-        BrushFireCell(int x, int y, double distanceToBlocked) : x(x), y(y), DistanceToBlocked(distanceToBlocked) {}
-        double DistanceToBlocked;
-        int x, y;
-        void pushNeighbors(std::queue<BrushFireCell>& queue, int xMax, int yMax, int resolution) {
-            for (int i = x - 1; i <= x + 1; i++) {
-                for (int j = y - 1; j <= y + 1; j++){
-                    if (i == x && j == y) continue;
-                    auto d = sqrt((i - x)*(i - x)*resolution*resolution + (j - y)*(j - y)*resolution*resolution);
-                    if (DistanceToBlocked == -1) d = 1;
-                    BrushFireCell cell(i, j, DistanceToBlocked + d);
-                    if (cell.valid(xMax, yMax)) queue.push(cell);
-                }
-            }
-        }
-        bool valid(int xMax, int yMax) const {
-            return 0 <= x && 0 <= y && x < xMax && y < yMax;
-        }
-    };
-    std::queue<BrushFireCell> brushFireQueue;
-    m_Distances = std::vector<std::vector<double>>(rows, std::vector<double>(cols, DBL_MAX));
-
-    // do brushfire over the strings into m_Distances
+    std::vector<bool> blocked((size_t)cols * rows);
     for (int y = 0; y < rows; y++) {
         for (int x = 0; x < cols; x++) {
-            if (lines[y][x] == '#') {
-                brushFireQueue.push(BrushFireCell(x, y, -1));
-            }
-        }
-    }
-
-    while (!brushFireQueue.empty()) {
-        auto& cell = brushFireQueue.front();
-        if (m_Distances[cell.y][cell.x] > cell.DistanceToBlocked) { // cell has not been set yet (or found shorter distance?)
-            m_Distances[cell.y][cell.x] = cell.DistanceToBlocked;
-            cell.pushNeighbors(brushFireQueue, cols, rows, m_Resolution);
+            blocked[(size_t)y * cols + x] = lines[y][x] == '#';
         }
-        brushFireQueue.pop();
     }
+    m_Distances = DistanceTransform::compute(blocked, cols, rows, m_Resolution, m_Resolution);
 }
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "Map.h"
+#include "DistanceField.h"
 
 /**
  * Represent a map loaded from a grid-world text file.
@@ -19,8 +20,13 @@ public:
 
     double getUnblockedDistance(double x, double y) const override;
 
+    void getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                               std::vector<double>& distances) const override;
+
+    double cellDiagonal() const override;
+
 private:
-    std::vector<std::vector<double>> m_Distances;
+    MapDistanceField m_Distances;
     int m_Resolution;
 };
 
@@ -4,3 +4,13 @@
 double Map::getUnblockedDistance(double x, double y) const {
     return DBL_MAX;
 }
+
+void Map::getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                                std::vector<double>& distances) const {
+    distances.resize(xs.size());
+    for (size_t i = 0; i < xs.size(); i++) distances[i] = getUnblockedDistance(xs[i], ys[i]);
+}
+
+double Map::cellDiagonal() const {
+    return 0;
+}
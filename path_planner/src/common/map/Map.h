@@ -3,6 +3,7 @@
 
 
 #include <memory>
+#include <vector>
 
 /**
  * Abstract class to represent a map. The maps need a slight re-write because the planner doesn't actually need the
@@ -22,6 +23,23 @@ public:
      * @return
      */
     virtual double getUnblockedDistance(double x, double y) const;
+
+    /**
+     * Get the unblocked distance for a batch of points, like a whole edge's worth of samples. One virtual call for the
+     * lot, and the maps can do it in a tight loop. By default just calls getUnblockedDistance for each point.
+     * @param xs
+     * @param ys same length as xs
+     * @param distances resized and filled in
+     */
+    virtual void getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                                       std::vector<double>& distances) const;
+
+    /**
+     * Unblocked distances are per cell, so they can differ from the distance actually moved by up to the size of a
+     * cell. Used to get a safe bound on how far away the nearest obstacle can be.
+     * @return the diagonal of a cell in meters, 0 for maps without cells
+     */
+    virtual double cellDiagonal() const;
 };
 
 
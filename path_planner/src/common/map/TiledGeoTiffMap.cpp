@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <ogr_spatialref.h>
+#include "TiledGeoTiffMap.h"
+
+TiledGeoTiffMap::Raster::Raster(const std::string& path) {
+    GDALAllRegister();
+    Dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GDALAccess::GA_ReadOnly));
+    if (!Dataset) throw std::runtime_error("TiledGeoTiffMap failed to load map file");
+    if (Dataset->GetGeoTransform(GeoTransform) == CPLErr::CE_Failure) {
+        GDALClose(Dataset);
+        throw std::runtime_error("TiledGeoTiffMap failed to find geo transform");
+    }
+    auto band = Dataset->GetRasterBand(1);
+    Cols = band->GetXSize(), Rows = band->GetYSize();
+    // pixel size in meters along each raster axis
+    XScale = sqrt(GeoTransform[1] * GeoTransform[1] + GeoTransform[4] * GeoTransform[4]);
+    YScale = sqrt(GeoTransform[2] * GeoTransform[2] + GeoTransform[5] * GeoTransform[5]);
+}
+
+TiledGeoTiffMap::TiledGeoTiffMap(const std::string& path, double originLongitude, double originLatitude)
+    : TiledGeoTiffMap(Raster(path), originLongitude, originLatitude) {
+    std::cerr << "Opened tiled GeoTiff map " << path << std::endl;
+}
+
+TiledGeoTiffMap::TiledGeoTiffMap(const Raster& raster, double originLongitude, double originLatitude)
+    : TiledMap(raster.Cols, raster.Rows, raster.XScale, raster.YScale), m_Dataset(raster.Dataset),
+      m_Band(raster.Dataset->GetRasterBand(1)) {
+    double geoTransform[6];
+    std::copy(raster.GeoTransform, raster.GeoTransform + 6, geoTransform);
+    if (!GDALInvGeoTransform(geoTransform, m_InverseGeoTransform)) { // it's a bool not a return code
+        GDALClose(m_Dataset);
+        throw std::runtime_error("TiledGeoTiffMap failed to invert geo transform");
+    }
+
+    char* projection = const_cast<char*> (m_Dataset->GetProjectionRef());
+    if (projection[0] == 0) projection = const_cast<char*>(m_Dataset->GetGCPProjection());
+    OGRSpatialReference projected, wgs84;
+    projected.importFromWkt(&projection);
+    wgs84.SetWellKnownGeogCS("WGS84");
+    auto projectTransformation = OGRCreateCoordinateTransformation(&wgs84, &projected);
+    m_XOrigin = originLongitude, m_YOrigin = originLatitude;
+    projectTransformation->Transform(1, &m_XOrigin, &m_YOrigin);
+}
+
+TiledGeoTiffMap::~TiledGeoTiffMap() {
+    GDALClose(m_Dataset);
+}
+
+long TiledGeoTiffMap::rasterCells(const std::string& path) {
+    GDALAllRegister();
+    auto dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GDALAccess::GA_ReadOnly));
+    if (!dataset) return -1;
+    auto cells = (long)dataset->GetRasterXSize() * dataset->GetRasterYSize();
+    GDALClose(dataset);
+    return cells;
+}
+
+void TiledGeoTiffMap::toCell(double x, double y, double& col, double& row) const {
+    x += m_XOrigin; y += m_YOrigin;
+    col = m_InverseGeoTransform[0] + x * m_InverseGeoTransform[1] + y * m_InverseGeoTransform[2];
+    row = m_InverseGeoTransform[3] + x * m_InverseGeoTransform[4] + y * m_InverseGeoTransform[5];
+}
+
+void TiledGeoTiffMap::readBlocked(int col, int row, int cols, int rows, std::vector<bool>& blocked) const {
+    m_Depths.resize((size_t)cols * rows);
+    auto err = m_Band->RasterIO(GF_Read, col, row, cols, rows, m_Depths.data(), cols, rows, GDT_Float32, 0, 0);
+    if (err != CE_None) {
+        std::ostringstream stringStream;
+        stringStream << "TiledGeoTiffMap failed to read " << cols << "x" << rows << " at " << col << ", " << row;
+        throw std::runtime_error(stringStream.str());
+    }
+    for (size_t i = 0; i < m_Depths.size(); i++) blocked[i] = m_Depths[i] < c_MinimumDepth;
+}
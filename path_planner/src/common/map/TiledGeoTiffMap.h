@@ -0,0 +1,58 @@
+#ifndef SRC_TILEDGEOTIFFMAP_H
+#define SRC_TILEDGEOTIFFMAP_H
+
+#include <gdal_priv.h>
+#include <string>
+#include "TiledMap.h"
+
+/**
+ * GeoTiff map that reads the chart a tile at a time as the planner needs it, instead of all at once like GeoTiffMap.
+ * GDAL keeps its own cache of raster blocks underneath, so neighbouring tiles don't re-decode the same blocks.
+ */
+class TiledGeoTiffMap : public TiledMap {
+public:
+    /**
+     * Open a map at the given path. Only the metadata is read here.
+     * @param path path to the map file
+     * @param originLongitude origin longitude
+     * @param originLatitude origin latitude
+     */
+    TiledGeoTiffMap(const std::string& path, double originLongitude, double originLatitude);
+
+    ~TiledGeoTiffMap() override;
+
+    /**
+     * @param path
+     * @return the number of cells in the chart at path, or -1 if it can't be opened
+     */
+    static long rasterCells(const std::string& path);
+
+protected:
+    void toCell(double x, double y, double& col, double& row) const override;
+
+    void readBlocked(int col, int row, int cols, int rows, std::vector<bool>& blocked) const override;
+
+private:
+    /**
+     * Open the dataset and read what the TiledMap constructor needs. Throws if anything's missing.
+     */
+    struct Raster {
+        Raster(const std::string& path);
+        GDALDataset* Dataset;
+        int Cols, Rows;
+        double GeoTransform[6];
+        double XScale, YScale;
+    };
+
+    explicit TiledGeoTiffMap(const Raster& raster, double originLongitude, double originLatitude);
+
+    GDALDataset* m_Dataset;
+    GDALRasterBand* m_Band;
+    double m_InverseGeoTransform[6];
+    double m_XOrigin, m_YOrigin;
+    mutable std::vector<float> m_Depths; // scratch for reads
+    static constexpr double c_MinimumDepth = 0;
+};
+
+
+#endif //SRC_TILEDGEOTIFFMAP_H
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "TiledMap.h"
+#include "DistanceTransform.h"
+
+TiledMap::TiledMap(int cols, int rows, double xScale, double yScale, int tileSize, int halo, size_t maxTiles)
+    : m_Cols(cols), m_Rows(rows), m_XScale(xScale), m_YScale(yScale), m_TileSize(tileSize), m_Halo(halo),
+      m_MaxTiles(std::max<size_t>(1, maxTiles)) {
+    if (tileSize <= 0 || halo < 0) throw std::logic_error("TiledMap needs a positive tile size and halo");
+    m_TilesAcross = (cols + tileSize - 1) / tileSize;
+}
+
+double TiledMap::saturationDistance() const {
+    return m_Halo * std::min(m_XScale, m_YScale);
+}
+
+double TiledMap::cellDiagonal() const {
+    return sqrt(m_XScale * m_XScale + m_YScale * m_YScale);
+}
+
+double TiledMap::getUnblockedDistance(double x, double y) const {
+    double col, row;
+    toCell(x, y, col, row);
+    // same truncation as the other maps
+    if (!(col > -1 && row > -1 && col < m_Cols && row < m_Rows)) return -1;
+    int c = (int)col, r = (int)row;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto& t = tile(c / m_TileSize, r / m_TileSize);
+    return t.Distances.get(c % m_TileSize, r % m_TileSize);
+}
+
+void TiledMap::getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                                     std::vector<double>& distances) const {
+    distances.resize(xs.size());
+    // consecutive points are nearly always in the same tile, so only lock once and remember the last tile
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const Tile* last = nullptr;
+    int lastX = -1, lastY = -1;
+    for (size_t i = 0; i < xs.size(); i++) {
+        double col, row;
+        toCell(xs[i], ys[i], col, row);
+        if (!(col > -1 && row > -1 && col < m_Cols && row < m_Rows)) {
+            distances[i] = -1;
+            continue;
+        }
+        int c = (int)col, r = (int)row;
+        int tx = c / m_TileSize, ty = r / m_TileSize;
+        if (!last || tx != lastX || ty != lastY) {
+            last = &tile(tx, ty);
+            lastX = tx, lastY = ty;
+        }
+        distances[i] = last->Distances.get(c % m_TileSize, r % m_TileSize);
+    }
+}
+
+void TiledMap::prefetch(double x, double y, double radius) const {
+    double col, row;
+    toCell(x, y, col, row);
+    auto cells = radius / std::min(m_XScale, m_YScale);
+    auto tileX0 = std::max(0, (int)floor((col - cells) / m_TileSize));
+    auto tileY0 = std::max(0, (int)floor((row - cells) / m_TileSize));
+    auto tileX1 = std::min(m_TilesAcross - 1, (int)floor((col + cells) / m_TileSize));
+    auto tileY1 = std::min((m_Rows - 1) / m_TileSize, (int)floor((row + cells) / m_TileSize));
+    if ((size_t)(tileX1 - tileX0 + 1) * (tileY1 - tileY0 + 1) > m_MaxTiles) return; // would just thrash
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (int ty = tileY0; ty <= tileY1; ty++) {
+        for (int tx = tileX0; tx <= tileX1; tx++) tile(tx, ty);
+    }
+}
+
+size_t TiledMap::tilesLoaded() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Tiles.size();
+}
+
+const TiledMap::Tile& TiledMap::tile(int tx, int ty) const {
+    auto key = (int64_t)ty * m_TilesAcross + tx;
+    auto it = m_Tiles.find(key);
+    if (it != m_Tiles.end()) {
+        m_Recency.splice(m_Recency.begin(), m_Recency, it->second.Recency);
+        return it->second;
+    }
+
+    if (m_Tiles.size() >= m_MaxTiles) {
+        m_Tiles.erase(m_Recency.back());
+        m_Recency.pop_back();
+    }
+
+    // read the tile plus its halo, clipped to the raster
+    int col0 = tx * m_TileSize, row0 = ty * m_TileSize;
+    int tileCols = std::min(m_TileSize, m_Cols - col0), tileRows = std::min(m_TileSize, m_Rows - row0);
+    int windowCol = std::max(0, col0 - m_Halo), windowRow = std::max(0, row0 - m_Halo);
+    int windowCols = std::min(m_Cols, col0 + tileCols + m_Halo) - windowCol;
+    int windowRows = std::min(m_Rows, row0 + tileRows + m_Halo) - windowRow;
+    std::vector<bool> blocked((size_t)windowCols * windowRows);
+    readBlocked(windowCol, windowRow, windowCols, windowRows, blocked);
+    // tiles are small, so don't bother with threads
+    auto window = DistanceTransform::compute(blocked, windowCols, windowRows, m_XScale, m_YScale, 1);
+
+    auto saturation = saturationDistance();
+    Tile t;
+    t.Distances = MapDistanceField(tileCols, tileRows);
+    for (int r = 0; r < tileRows; r++) {
+        for (int c = 0; c < tileCols; c++) {
+            auto d = window.get(col0 - windowCol + c, row0 - windowRow + r);
+            t.Distances.set(c, r, std::min(d, saturation));
+        }
+    }
+    m_Recency.push_front(key);
+    t.Recency = m_Recency.begin();
+    return m_Tiles.emplace(key, std::move(t)).first->second;
+}
@@ -0,0 +1,113 @@
+#ifndef SRC_TILEDMAP_H
+#define SRC_TILEDMAP_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Map.h"
+#include "DistanceField.h"
+
+/**
+ * Map backend for charts too big to hold in memory. The raster is split into square tiles which are read and have
+ * their distances computed the first time they're needed, and the least recently used tiles are thrown away once
+ * there are too many. Memory is then bounded by the area around the boat rather than by the size of the chart.
+ *
+ * Each tile's distance transform also looks at a halo of cells around it, so distances are exact up to the halo
+ * width and saturate there (see saturationDistance()). An obstacle outside the halo is at least that far away, so the
+ * saturated values are still safe. The planner only cares about distances comparable to the collision checking
+ * increment anyway.
+ *
+ * Subclasses provide the occupancy and the world to cell transform. Lookups lock, so it's safe to share between the
+ * planner and executive threads.
+ */
+class TiledMap : public Map {
+public:
+    /**
+     * @param cols raster width
+     * @param rows raster height
+     * @param xScale width of a cell in meters
+     * @param yScale height of a cell in meters
+     * @param tileSize tile width and height in cells
+     * @param halo extra cells read around each tile
+     * @param maxTiles how many tiles to keep
+     */
+    TiledMap(int cols, int rows, double xScale, double yScale, int tileSize = c_DefaultTileSize,
+             int halo = c_DefaultHalo, size_t maxTiles = c_DefaultMaxTiles);
+
+    ~TiledMap() override = default;
+
+    double getUnblockedDistance(double x, double y) const override;
+
+    void getUnblockedDistances(const std::vector<double>& xs, const std::vector<double>& ys,
+                               std::vector<double>& distances) const override;
+
+    double cellDiagonal() const override;
+
+    /**
+     * Load the tiles within radius of a point (usually the start state), so the planner doesn't stall on them.
+     * @param x
+     * @param y
+     * @param radius
+     */
+    void prefetch(double x, double y, double radius) const;
+
+    /**
+     * @return how many tiles are in memory
+     */
+    size_t tilesLoaded() const;
+
+    /**
+     * @return the largest distance reported for an unblocked cell
+     */
+    double saturationDistance() const;
+
+    static constexpr int c_DefaultTileSize = 256;
+    static constexpr int c_DefaultHalo = 64;
+    static constexpr size_t c_DefaultMaxTiles = 64;
+
+protected:
+    /**
+     * Convert world coordinates into (fractional) raster coordinates.
+     * @param x
+     * @param y
+     * @param col
+     * @param row
+     */
+    virtual void toCell(double x, double y, double& col, double& row) const = 0;
+
+    /**
+     * Read occupancy for a window of the raster. Called with the lock held so needn't be thread safe.
+     * @param col
+     * @param row
+     * @param cols
+     * @param rows
+     * @param blocked row-major, cols * rows, to be filled in
+     */
+    virtual void readBlocked(int col, int row, int cols, int rows, std::vector<bool>& blocked) const = 0;
+
+private:
+    struct Tile {
+        MapDistanceField Distances;
+        std::list<int64_t>::iterator Recency;
+    };
+
+    /**
+     * Find a tile, loading it (and evicting another) if necessary. Must hold the lock.
+     */
+    const Tile& tile(int tx, int ty) const;
+
+    int m_Cols, m_Rows;
+    double m_XScale, m_YScale;
+    int m_TileSize, m_Halo;
+    size_t m_MaxTiles;
+    int m_TilesAcross;
+
+    mutable std::mutex m_Mutex;
+    mutable std::unordered_map<int64_t, Tile> m_Tiles;
+    mutable std::list<int64_t> m_Recency; // most recent at the front
+};
+
+
+#endif //SRC_TILEDMAP_H
@@ -0,0 +1,47 @@
+#include "Fleet.h"
+#include <stdexcept>
+
+Fleet::Fleet(unsigned threads)
+    : m_World(std::make_shared<WorldModel>(&Executive::loadMap)), m_ExpansionPool(std::make_shared<ThreadPool>(threads)) {}
+
+Fleet::~Fleet() {
+    cancelPlanners();
+}
+
+Executive& Fleet::addVessel(uint32_t id, TrajectoryPublisher* trajectoryPublisher) {
+    if (m_Vessels.count(id)) throw std::logic_error("Vessel " + std::to_string(id) + " is already in the fleet");
+    auto& executive = m_Vessels[id];
+    executive.reset(new Executive(trajectoryPublisher));
+    executive->setWorld(m_World, id);
+    executive->setExpansionPool(m_ExpansionPool);
+    // a contact reported before it joined is about to be replaced by its plans
+    m_World->forgetDynamicObstacle(id);
+    return *executive;
+}
+
+Executive& Fleet::vessel(uint32_t id) {
+    return *m_Vessels.at(id);
+}
+
+void Fleet::refreshMap(const std::string& path, double latitude, double longitude) {
+    // through each executive, so they all know which map it is (for recordings); the world only loads it once
+    for (auto& v : m_Vessels) v.second->refreshMap(path, latitude, longitude);
+    if (m_Vessels.empty()) m_World->refreshMap(path, latitude, longitude);
+}
+
+void Fleet::updateDynamicObstacle(uint32_t mmsi, State obstacle) {
+    updateDynamicObstacle(mmsi, Executive::inventDistributions(obstacle));
+}
+
+void Fleet::updateDynamicObstacle(uint32_t mmsi, const std::vector<Distribution>& obstacle) {
+    if (m_Vessels.count(mmsi)) return;
+    m_World->updateDynamicObstacle(mmsi, obstacle);
+}
+
+void Fleet::startPlanners() {
+    for (auto& v : m_Vessels) v.second->startPlanner();
+}
+
+void Fleet::cancelPlanners() {
+    for (auto& v : m_Vessels) v.second->cancelPlanner();
+}
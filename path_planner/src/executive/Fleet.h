@@ -0,0 +1,89 @@
+#ifndef SRC_FLEET_H
+#define SRC_FLEET_H
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <thread>
+#include "executive.h"
+
+/**
+ * Plans for several vessels from one process. Each vessel gets an executive of its own (its own ribbons, planner and
+ * controller), but they all share one WorldModel, so the chart is loaded and the contacts are tracked once for all of
+ * them, and each vessel's plans are contacts the others plan around.
+ *
+ * A vessel's ID is the one its plans go into the world under, which should be its MMSI: AIS reports for vessels in the
+ * fleet are dropped, since their plans say more about where they're going.
+ *
+ * The vessels also share one ThreadPool for computing true costs, so a machine planning for several of them has one
+ * set of workers instead of one per vessel. Each executive still has to be configured with more than one expansion
+ * thread to use it. The parallel and portfolio planners keep pools of their own, since their threads have to all be
+ * running at once.
+ *
+ * This is a library for now: nothing in the ROS nodes makes a fleet. path_planner_node plans for one vessel, and
+ * NodeBase uses absolute topic and service names, so hosting several would need each vessel's node moved into a
+ * namespace of its own first.
+ */
+class Fleet {
+public:
+    /**
+     * @param threads total threads for the shared expansion pool
+     */
+    explicit Fleet(unsigned threads = std::max(1u, std::thread::hardware_concurrency()));
+
+    /**
+     * Stops every vessel's planner.
+     */
+    ~Fleet();
+
+    /**
+     * Add a vessel to the fleet.
+     * @param id
+     * @param trajectoryPublisher where its plans go (see Executive)
+     * @return its executive, for setting it up and giving it ribbons and positions
+     */
+    Executive& addVessel(uint32_t id, TrajectoryPublisher* trajectoryPublisher);
+
+    /**
+     * @param id
+     * @return the vessel's executive (throws std::out_of_range if there's no such vessel)
+     */
+    Executive& vessel(uint32_t id);
+
+    /**
+     * @return how many vessels there are
+     */
+    size_t size() const { return m_Vessels.size(); }
+
+    /**
+     * Load a map for the whole fleet (see Executive::refreshMap).
+     * @param path
+     * @param latitude origin latitude
+     * @param longitude origin longitude
+     */
+    void refreshMap(const std::string& path, double latitude, double longitude);
+
+    /**
+     * Update a contact for the whole fleet. Ignored if it's one of the fleet's own vessels.
+     * @param mmsi
+     * @param obstacle
+     */
+    void updateDynamicObstacle(uint32_t mmsi, State obstacle);
+    void updateDynamicObstacle(uint32_t mmsi, const std::vector<Distribution>& obstacle);
+
+    void startPlanners();
+
+    void cancelPlanners();
+
+    const WorldModel::SharedPtr& world() const { return m_World; }
+
+    const std::shared_ptr<ThreadPool>& expansionPool() const { return m_ExpansionPool; }
+
+private:
+    WorldModel::SharedPtr m_World;
+    std::shared_ptr<ThreadPool> m_ExpansionPool;
+    std::map<uint32_t, std::unique_ptr<Executive>> m_Vessels;
+};
+
+
+#endif //SRC_FLEET_H
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <iostream>
+#include "MapLoader.h"
+
+MapLoader::MapLoader(Factory factory) : m_Factory(std::move(factory)), m_Cancelled(false) {
+    // start the thread last, once everything it uses is set up
+    m_Thread = std::thread(&MapLoader::run, this);
+}
+
+MapLoader::~MapLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+        m_Cancelled = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+}
+
+void MapLoader::request(const std::string& path, double latitude, double longitude) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // whatever else was wanted isn't any more
+    m_HasPending = false;
+    if (!m_LoadingPath.empty() && m_LoadingPath != path) m_Cancelled = true;
+    // on its way (if it's been cancelled it has to start over)
+    if (path == m_LoadingPath && !m_Cancelled) return;
+    // what we've already got (anything else loading was just cancelled)
+    if (path == m_LoadedPath && path != m_LoadingPath) return;
+    m_Pending = Request{path, latitude, longitude};
+    m_HasPending = true;
+    m_Wake.notify_one();
+}
+
+Map::SharedPtr MapLoader::map() const {
+    return std::atomic_load(&m_Map);
+}
+
+MapLoader::Progress MapLoader::progress() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto progress = m_Progress;
+    if (progress.Loading) progress.Seconds = now() - m_LoadStart;
+    return progress;
+}
+
+void MapLoader::run() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [this] { return m_Stop || m_HasPending; });
+            if (m_Stop) return;
+            request = m_Pending;
+            m_HasPending = false;
+            m_LoadingPath = request.Path;
+            m_Cancelled = false;
+            m_LoadStart = now();
+            m_Progress.Path = request.Path;
+            m_Progress.Loading = true;
+        }
+        std::cerr << "Loading map at path " << request.Path << std::endl;
+        Map::SharedPtr map;
+        std::string error;
+        try {
+            // could take some time for I/O, distances on the entire map
+            map = m_Factory(request.Path, request.Latitude, request.Longitude, m_Cancelled);
+            if (!map) error = "no map made";
+        } catch (const std::exception& e) {
+            error = e.what();
+        } catch (...) {
+            error = "unknown error";
+        }
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto seconds = now() - m_LoadStart;
+        m_LoadingPath.clear();
+        m_Progress.Loading = false;
+        m_Progress.Seconds = seconds;
+        if (m_Cancelled) {
+            std::cerr << "Dropped map at path " << request.Path << " after " << seconds << "s; another was asked for"
+                      << std::endl;
+            m_Progress.Cancelled++;
+            m_Progress.Path = m_LoadedPath;
+        } else if (!error.empty()) {
+            std::cerr << "Encountered an error loading map at path " << request.Path << " (" << error
+                      << ").\nMap was not updated." << std::endl;
+            m_Progress.Failed++;
+            // so asking again tries again
+            m_LoadedPath.clear();
+            m_Progress.Path.clear();
+        } else {
+            std::cerr << "Loaded map at path " << request.Path << " in " << seconds << "s" << std::endl;
+            m_Progress.Completed++;
+            m_LoadedPath = request.Path;
+            std::atomic_store(&m_Map, map);
+        }
+    }
+}
+
+double MapLoader::now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
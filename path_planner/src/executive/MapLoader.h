@@ -0,0 +1,85 @@
+#ifndef SRC_MAPLOADER_H
+#define SRC_MAPLOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../common/map/Map.h"
+
+/**
+ * Loads maps in the background on a single thread of its own, so changing charts never holds up planning. Only the
+ * latest request matters: asking for a new map replaces any request that hasn't started yet and cancels the load in
+ * progress (loaders that can check the flag stop early; otherwise the result is just thrown away). The last map to
+ * finish loading is swapped in atomically, so map() never waits.
+ */
+class MapLoader {
+public:
+    /**
+     * Makes a map from a path (and origin), checking the flag now and then if it can. Throws or returns null to fail.
+     */
+    typedef std::function<Map::SharedPtr(const std::string& path, double latitude, double longitude,
+                                         const std::atomic<bool>& cancelled)> Factory;
+
+    /**
+     * How loading is going.
+     */
+    struct Progress {
+        std::string Path; // being loaded, or else the last one loaded (empty if none)
+        bool Loading = false;
+        double Seconds = 0; // spent on the current load so far, or else how long the last one took
+        int Completed = 0, Failed = 0, Cancelled = 0;
+    };
+
+    explicit MapLoader(Factory factory);
+
+    /**
+     * Cancels any load in progress and waits for the thread to finish.
+     */
+    ~MapLoader();
+
+    /**
+     * Ask for the map at a path. Does nothing if it's already loaded or on its way.
+     * @param path
+     * @param latitude origin latitude
+     * @param longitude origin longitude
+     */
+    void request(const std::string& path, double latitude, double longitude);
+
+    /**
+     * @return the last map to finish loading (null if none has). Lock free.
+     */
+    Map::SharedPtr map() const;
+
+    Progress progress() const;
+
+private:
+    struct Request {
+        std::string Path;
+        double Latitude, Longitude;
+    };
+
+    Factory m_Factory;
+    Map::SharedPtr m_Map; // only accessed with std::atomic_load/store
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Stop = false;
+    bool m_HasPending = false;
+    Request m_Pending;
+    std::string m_LoadingPath, m_LoadedPath;
+    std::atomic<bool> m_Cancelled;
+    double m_LoadStart = 0;
+    Progress m_Progress;
+
+    std::thread m_Thread;
+
+    void run();
+
+    static double now();
+};
+
+
+#endif //SRC_MAPLOADER_H
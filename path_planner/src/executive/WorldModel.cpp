@@ -0,0 +1,34 @@
+#include "WorldModel.h"
+
+WorldModel::WorldModel(MapLoader::Factory factory) : m_MapLoader(std::move(factory)) {}
+
+void WorldModel::refreshMap(const std::string& path, double latitude, double longitude) {
+    m_MapLoader.request(path, latitude, longitude);
+}
+
+Map::SharedPtr WorldModel::map() const {
+    return m_MapLoader.map();
+}
+
+void WorldModel::updateDynamicObstacle(uint32_t mmsi, const std::vector<Distribution>& distributions) {
+    std::lock_guard<std::mutex> lock(m_ObstaclesMutex);
+    m_Obstacles.update(mmsi, distributions);
+    m_ObstaclesVersion++;
+}
+
+void WorldModel::forgetDynamicObstacle(uint32_t mmsi) {
+    std::lock_guard<std::mutex> lock(m_ObstaclesMutex);
+    m_Obstacles.forget(mmsi);
+    m_ObstaclesVersion++;
+}
+
+std::shared_ptr<const DynamicObstaclesManager> WorldModel::obstacles(uint64_t& version) {
+    std::lock_guard<std::mutex> lock(m_ObstaclesMutex);
+    version = m_ObstaclesVersion;
+    if (!m_Snapshot || m_SnapshotVersion != version) {
+        // copying shares the obstacles themselves, so this is cheap
+        m_Snapshot = std::make_shared<const DynamicObstaclesManager>(m_Obstacles);
+        m_SnapshotVersion = version;
+    }
+    return m_Snapshot;
+}
@@ -0,0 +1,77 @@
+#ifndef SRC_WORLDMODEL_H
+#define SRC_WORLDMODEL_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "MapLoader.h"
+#include "../common/dynamic_obstacles/DynamicObstaclesManager.h"
+
+/**
+ * What the planner plans around: the chart, and the contacts. An executive has one of its own, but any number of them
+ * can share one (see Fleet), so a shore-side machine planning for several vessels loads each chart and tracks each
+ * contact once.
+ *
+ * The map loads on the MapLoader's thread and is swapped in whole. Contacts are kept behind a mutex, and each change
+ * bumps a version number, so an executive can tell whether to take a new snapshot without locking anything. The
+ * snapshot for each version is made once and shared by everyone who asks for it.
+ */
+class WorldModel {
+public:
+    typedef std::shared_ptr<WorldModel> SharedPtr;
+
+    /**
+     * @param factory makes maps (see MapLoader)
+     */
+    explicit WorldModel(MapLoader::Factory factory);
+
+    /**
+     * Start loading a map, if it's not the one already loaded or on its way (see MapLoader::request).
+     * @param path
+     * @param latitude origin latitude
+     * @param longitude origin longitude
+     */
+    void refreshMap(const std::string& path, double latitude, double longitude);
+
+    /**
+     * @return the last map to finish loading (null if none has). Lock free.
+     */
+    Map::SharedPtr map() const;
+
+    /**
+     * Add or update a contact.
+     * @param mmsi
+     * @param distributions
+     */
+    void updateDynamicObstacle(uint32_t mmsi, const std::vector<Distribution>& distributions);
+
+    /**
+     * Stop tracking a contact.
+     * @param mmsi
+     */
+    void forgetDynamicObstacle(uint32_t mmsi);
+
+    /**
+     * @return bumped each time the contacts change. Lock free.
+     */
+    uint64_t obstaclesVersion() const { return m_ObstaclesVersion.load(); }
+
+    /**
+     * A snapshot of the contacts, which never changes afterwards.
+     * @param version set to the version it's of
+     * @return
+     */
+    std::shared_ptr<const DynamicObstaclesManager> obstacles(uint64_t& version);
+
+private:
+    MapLoader m_MapLoader;
+
+    std::mutex m_ObstaclesMutex;
+    DynamicObstaclesManager m_Obstacles;
+    std::atomic<uint64_t> m_ObstaclesVersion{1};
+    std::shared_ptr<const DynamicObstaclesManager> m_Snapshot;
+    uint64_t m_SnapshotVersion = 0;
+};
+
+
+#endif //SRC_WORLDMODEL_H
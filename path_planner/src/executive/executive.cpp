@@ -6,8 +6,11 @@
 #include "executive.h"
 #include "../planner/SamplingBasedPlanner.h"
 #include "../planner/AStarPlanner.h"
+#include "../planner/ParallelAStarPlanner.h"
+#include "../planner/PortfolioPlanner.h"
 #include "../common/map/GeoTiffMap.h"
 #include "../common/map/GridWorldMap.h"
+#include "../common/map/TiledGeoTiffMap.h"
 
 using namespace std;
 
@@ -15,6 +18,7 @@ Executive::Executive(TrajectoryPublisher *trajectoryPublisher)
 {
     m_TrajectoryPublisher = trajectoryPublisher;
     m_PlannerConfig.setNowFunction([&] { return m_TrajectoryPublisher->getTime(); });
+    m_PlannerConfig.setClockCheckInterval(c_ClockCheckInterval);
 }
 
 Executive::~Executive() {
@@ -32,17 +36,53 @@ double Executive::getCurrentTime()
 void Executive::updateCovered(double x, double y, double speed, double heading, double t)
 {
     if ((m_LastHeading - heading) / m_LastUpdateTime <= c_CoverageHeadingRateMax) {
-        std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
-        m_RibbonManager.cover(x, y);
+        if (!m_CoveredPoints.push({x, y})) {
+            // the planner's fallen behind, so do its share (this is the only time this waits on it)
+            std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
+            drainCoveredPoints();
+            m_CoveredPoints.push({x, y});
+        }
     }
     m_LastUpdateTime = t; m_LastHeading = heading;
-    m_LastState = State(x, y, heading, speed, t);
+    m_LastState.back() = State(x, y, heading, speed, t);
+    m_LastState.publish();
+}
+
+std::shared_ptr<const RibbonManager> Executive::ribbonSnapshot() const {
+    return std::atomic_load(&m_RibbonSnapshot);
+}
+
+RibbonOrdering::SharedPtr Executive::ribbonOrdering() const {
+    return std::atomic_load(&m_RibbonOrdering);
+}
+
+void Executive::drainCoveredPoints() {
+    CoveredPoint p;
+    while (m_CoveredPoints.pop(p)) m_RibbonManager.cover(p.X, p.Y);
 }
 
 void Executive::planLoop() {
     cerr << "Initializing planner" << endl;
-
-    auto planner = std::unique_ptr<Planner>(new AStarPlanner);
+    // samples from whatever we were doing last time aren't much use
+    m_WarmStart->clear();
+
+    // a portfolio or more than one search thread picks the other planners, and changing that swaps planners between
+    // iterations
+    enum PlannerKind { Single, Parallel, Portfolio };
+    auto plannerKind = [this] {
+        if (m_PlannerConfig.portfolioSize() > 1) return Portfolio;
+        if (m_PlannerConfig.searchThreads() > 1) return Parallel;
+        return Single;
+    };
+    auto makePlanner = [this](PlannerKind kind) {
+        if (kind == Portfolio) return std::unique_ptr<Planner>(new PortfolioPlanner);
+        // the single searches pick up where the last cycle left off
+        std::unique_ptr<AStarPlanner> planner(kind == Parallel ? new ParallelAStarPlanner : new AStarPlanner);
+        planner->setWarmStart(m_WarmStart);
+        return std::unique_ptr<Planner>(std::move(planner));
+    };
+    auto kind = plannerKind();
+    auto planner = makePlanner(kind);
 
     { // new scope to use RAII and not mess with later "lock" variable
         unique_lock<mutex> lock(m_PlannerStateMutex);
@@ -59,6 +99,34 @@ void Executive::planLoop() {
     State startState;
     // declare plan here so that it persists between loops
     DubinsPlan plan;
+    // samples of the plan to display, kept so it doesn't allocate every iteration
+    std::vector<State> displaySamples;
+
+    // with pipelined publishing, plans go out and the controller's answers come back through these
+    bool pipelined = m_PipelinedPublishing;
+    TripleBuffer<DubinsPlan> plans;
+    TripleBuffer<PublishResult> publishResults;
+    std::atomic<bool> stopPublishing(false);
+    std::future<void> publisher;
+    // stop it however we leave (the future waits for it when it goes out of scope)
+    struct StopOnExit {
+        std::atomic<bool>& Stop;
+        ~StopOnExit() { Stop = true; }
+    } stopOnExit{stopPublishing};
+    if (pipelined) {
+        publisher = async(launch::async, [&] { publishLoop(plans, publishResults, stopPublishing); });
+    }
+
+    // with hierarchical planning, the ribbons go to the ordering thread each cycle and the order comes back
+    bool hierarchical = m_HierarchicalPlanning;
+    std::atomic_store(&m_RibbonOrdering, RibbonOrdering::SharedPtr());
+    TripleBuffer<OrderingRequest> orderingRequests;
+    std::atomic<bool> stopOrdering(false);
+    std::future<void> orderer;
+    StopOnExit stopOrderingOnExit{stopOrdering};
+    if (hierarchical) {
+        orderer = async(launch::async, [&] { orderingLoop(orderingRequests, stopOrdering); });
+    }
 
     while (true) {
         double startTime = m_TrajectoryPublisher->getTime();
@@ -70,34 +138,42 @@ void Executive::planLoop() {
                 break;
             }
         }
+        // catch up on coverage, and take this cycle's copy of the ribbons
+        std::shared_ptr<const RibbonManager> ribbons;
         { // and again
             std::lock_guard<std::mutex> lock1(m_RibbonManagerMutex);
-            if (m_RibbonManager.done()) {
-                // tell the node we're done
-                cerr << "Finished covering ribbons" << endl;
-                m_TrajectoryPublisher->allDone();
-                break;
-            }
+            drainCoveredPoints();
+            ribbons = make_shared<const RibbonManager>(m_RibbonManager);
         }
-        // display ribbons
-        { // one more time
-            std::lock_guard<std::mutex> lock1(m_RibbonManagerMutex);
-            m_TrajectoryPublisher->displayRibbons(m_RibbonManager);
+        std::atomic_store(&m_RibbonSnapshot, ribbons);
+        m_LastState.update();
+        if (ribbons->done()) {
+            // tell the node we're done
+            cerr << "Finished covering ribbons" << endl;
+            m_TrajectoryPublisher->allDone();
+            break;
         }
+        // display ribbons
+        m_TrajectoryPublisher->displayRibbons(*ribbons);
 
-        // copy the map pointer if it's been set (don't wait for the mutex because it may be a while)
-        if (m_MapMutex.try_lock()) {
-            if (m_NewMap) {
-                // TODO! -- Dunno what's going on but the map is messed up
-                m_PlannerConfig.setMap(m_NewMap);
-            }
-            m_NewMap = nullptr;
-            m_MapMutex.unlock();
-        }
+        // pick up the latest map if a new one's finished loading
+        auto map = m_World->map();
+        if (map && map != m_PlannerConfig.map()) m_PlannerConfig.setMap(map);
 
         // if the state estimator returned an error naively do it ourselves
         if (startState.time() == -1) {
-            startState = m_LastState.push(m_TrajectoryPublisher->getTime() + c_PlanningTimeSeconds - m_LastState.time());
+            const auto& lastState = m_LastState.front();
+            startState = lastState.push(m_TrajectoryPublisher->getTime() + c_PlanningTimeSeconds - lastState.time());
+        }
+
+        // make sure the chart around us is loaded before the planner needs it
+        if (auto tiledMap = dynamic_pointer_cast<TiledMap>(m_PlannerConfig.map())) {
+            tiledMap->prefetch(startState.x(), startState.y(), m_PlannerConfig.maxSpeed() * DubinsPlan::timeHorizon());
+        }
+
+        if (plannerKind() != kind) {
+            kind = plannerKind();
+            planner = makePlanner(kind);
         }
 
         if (!c_ReusePlanEnabled) plan = DubinsPlan();
@@ -111,20 +187,30 @@ void Executive::planLoop() {
             m_RadiusShrink += c_RadiusShrinkAmount;
         }
 
+        // adaptively, the planner can stop early once the plan stops getting better, or go on to the full second if it is
+        bool adaptive = m_AdaptivePlanning;
+        m_PlannerConfig.setSoftTimeLimit(adaptive ? c_SoftPlanningTimeSeconds : INFINITY);
+
         try {
-            // TODO! -- low-key data race with the ribbon manager here but it might be fine
-            // its estimates of our trajectory
-            m_PlannerConfig.setObstacles(m_DynamicObstaclesManager);
+            // only when they've changed, so the planner keeps the index its queries have built up
+            if (auto obstacles = takeDynamicObstacles()) m_PlannerConfig.setObstacles(obstacles);
             // trying to fix seg fault by eliminating concurrent access to ribbon manager (idk what the real problem is)
-            RibbonManager ribbonManagerCopy;
-            {
-                std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
-                ribbonManagerCopy = m_RibbonManager;
+            RibbonManager ribbonManagerCopy = *ribbons;
+            if (hierarchical) {
+                auto& request = orderingRequests.back();
+                request.Ribbons = ribbons;
+                request.Start = startState;
+                request.TurningRadius = m_PlannerConfig.coverageTurningRadius();
+                orderingRequests.publish();
+                // only the next few, if there's an order yet
+                if (auto ordering = ribbonOrdering()) ribbonManagerCopy = ordering->nextRibbons(*ribbons, c_LocalRibbonCount);
             }
             // cover up to the state that we're planning from
-            ribbonManagerCopy.coverBetween(m_LastState.x(), m_LastState.y(), startState.x(), startState.y());
-            plan = planner->plan(ribbonManagerCopy, startState, m_PlannerConfig, plan,
-                                 startTime + c_PlanningTimeSeconds - m_TrajectoryPublisher->getTime());
+            const auto& lastState = m_LastState.front();
+            ribbonManagerCopy.coverBetween(lastState.x(), lastState.y(), startState.x(), startState.y());
+            double timeRemaining = startTime + c_PlanningTimeSeconds - m_TrajectoryPublisher->getTime();
+            recordCycle(ribbonManagerCopy, startState, plan, timeRemaining);
+            plan = planner->plan(ribbonManagerCopy, startState, m_PlannerConfig, plan, timeRemaining);
         } catch(const std::exception& e) {
             cerr << "Exception thrown while planning:" << endl;
             cerr << e.what() << endl;
@@ -135,48 +221,52 @@ void Executive::planLoop() {
             cancelPlanner();
             throw;
         }
+        if (Instrumentation::enabled()) m_TrajectoryPublisher->publishStatistics(Instrumentation::take());
 
-        // calculate remaining time (to sleep)
+        // calculate remaining time (to sleep). Adaptively, a plan that's done early goes out now instead of waiting out
+        // the second, and the time saved goes to the next cycle (which starts from further back)
+        double period = adaptive ? c_MinPlanningPeriodSeconds : c_PlanningTimeSeconds;
         double endTime = m_TrajectoryPublisher->getTime();
-        int sleepTime = (endTime - startTime <= c_PlanningTimeSeconds) ? ((int)((c_PlanningTimeSeconds - (endTime - startTime)) * 1000)) : 0;
+        int sleepTime = (endTime - startTime <= period) ? ((int)((period - (endTime - startTime)) * 1000)) : 0;
 
         this_thread::sleep_for(chrono::milliseconds(sleepTime));
 
+        if (pipelined) {
+            // if the controller says it won't be following the last plan, this one (planned from along it) is no good
+            if (publishResults.update() && !publishResults.front().OnPlan) {
+                resetRadiusShrink();
+                plan = DubinsPlan();
+                startState = State();
+                continue;
+            }
+            if (!plan.empty()) {
+                // hand it over, and plan the next one from where this one will have got us to by the time it's done
+                plans.back() = plan;
+                plans.publish();
+                startState = State();
+                startState.time() = plan.getStartTime() + c_PlanningTimeSeconds;
+                if (plan.containsTime(startState.time())) plan.sample(startState);
+                else startState = State();
+                m_RadiusShrink += c_RadiusShrinkAmount;
+            } else {
+                cerr << "Planner returned empty trajectory." << endl;
+                startState = State();
+            }
+            continue;
+        }
+
         // display the trajectory
-        m_TrajectoryPublisher->displayTrajectory(plan.getHalfSecondSamples(), true);
+        plan.getHalfSecondSamples(displaySamples);
+        m_TrajectoryPublisher->displayTrajectory(displaySamples, true);
 
         if (!plan.empty()) {
             // send trajectory to controller
             startState = m_TrajectoryPublisher->publishPlan(plan);
-            State expectedStartState(startState);
-            plan.sample(expectedStartState);
-            if (!startState.isCoLocated(expectedStartState)) {
+            sharePlan(plan);
+            if (!startStateOnPlan(startState, plan)) {
                 // reset plan because controller says we can't make it
                 plan = DubinsPlan();
-
-                // reset turning radius shrink because we can't follow original plan anymore
-                if (c_RadiusShrinkEnabled) {
-                    m_PlannerConfig.setTurningRadius(m_PlannerConfig.turningRadius() + m_RadiusShrink);
-                    m_PlannerConfig.setCoverageTurningRadius(m_PlannerConfig.coverageTurningRadius() + m_RadiusShrink);
-                    m_RadiusShrink = 0;
-                }
-
-                // debugging:
-                cerr << "Start state is not along previous plan; did the controller let us know?" << endl;
-                if (startState.x() != expectedStartState.x()) {
-                    if (startState.y() != expectedStartState.y()) {
-                        cerr << "Position is different: (" << startState.x() << ", " << startState.y() << ") vs (" << expectedStartState.x() << ", " << expectedStartState.y() << "). ";
-                    } else {
-                        cerr << "X is different: " << startState.x() << " vs " << expectedStartState.x() << ". ";
-                    }
-                } else if (startState.y() != expectedStartState.y()) {
-                    cerr << "Y is different: " << startState.y() << " vs " << expectedStartState.y() << ". ";
-                }
-                if (startState.headingDifference(expectedStartState) != 0) {
-                    cerr << "Headings are different: " << startState.heading() << " vs " << expectedStartState.heading() << ". ";
-                }
-                cerr << endl;
-
+                resetRadiusShrink();
             } else {
                 // expected start state is along plan so allow plan to be passed to planner as previous plan
                 m_RadiusShrink += c_RadiusShrinkAmount;
@@ -187,11 +277,113 @@ void Executive::planLoop() {
         }
     }
 
+    stopPublishing = true;
+    if (publisher.valid()) publisher.wait();
+    stopOrdering = true;
+    if (orderer.valid()) orderer.wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_RecordingMutex);
+        if (!m_RecordingPath.empty()) {
+            try {
+                PlanningRecord::save(m_RecordingPath, {m_Recording.begin(), m_Recording.end()});
+                cerr << "Saved " << m_Recording.size() << " planning cycles to " << m_RecordingPath << endl;
+            } catch (const std::exception& e) {
+                cerr << "Couldn't save the recording: " << e.what() << endl;
+            }
+        }
+    }
+
+    // the rest of the fleet can't go by our plans any more
+    if (m_InFleet) m_World->forgetDynamicObstacle(m_VesselId);
+
     unique_lock<mutex> lock2(m_PlannerStateMutex);
     m_PlannerState = PlannerState::Inactive;
     m_CancelCV.notify_all(); // do I need this?
 }
 
+void Executive::publishLoop(TripleBuffer<DubinsPlan>& plans, TripleBuffer<PublishResult>& results,
+                            const std::atomic<bool>& stop) {
+    std::vector<State> displaySamples;
+    while (!stop) {
+        if (!plans.update()) {
+            this_thread::sleep_for(chrono::milliseconds((int)(c_PublishPollSeconds * 1000)));
+            continue;
+        }
+        const auto& plan = plans.front();
+        plan.getHalfSecondSamples(displaySamples);
+        m_TrajectoryPublisher->displayTrajectory(displaySamples, true);
+        auto& result = results.back();
+        try {
+            result.StartState = m_TrajectoryPublisher->publishPlan(plan);
+            sharePlan(plan);
+            result.OnPlan = startStateOnPlan(result.StartState, plan);
+        } catch (const std::exception& e) {
+            cerr << "Exception thrown while publishing plan: " << e.what() << endl;
+            result.OnPlan = false;
+        }
+        results.publish();
+    }
+}
+
+void Executive::orderingLoop(TripleBuffer<OrderingRequest>& requests, const std::atomic<bool>& stop) {
+    uint64_t orderedVersion = 0;
+    while (!stop) {
+        if (!requests.update() || !requests.front().Ribbons || requests.front().Ribbons->version() == orderedVersion) {
+            this_thread::sleep_for(chrono::milliseconds((int)(c_OrderingPollSeconds * 1000)));
+            continue;
+        }
+        const auto& request = requests.front();
+        auto ribbons = request.Ribbons->get();
+        auto previous = ribbonOrdering();
+        try {
+            auto ordering = make_shared<const RibbonOrdering>(std::vector<Ribbon>(ribbons.begin(), ribbons.end()),
+                                                              request.Start, request.TurningRadius, previous.get(),
+                                                              &stop);
+            std::atomic_store(&m_RibbonOrdering, ordering);
+            orderedVersion = request.Ribbons->version();
+        } catch (const std::exception& e) {
+            cerr << "Exception thrown while ordering ribbons: " << e.what() << endl;
+        }
+    }
+}
+
+bool Executive::startStateOnPlan(const State& startState, const DubinsPlan& plan) {
+    if (!plan.containsTime(startState.time())) {
+        cerr << "Start state is not in the time covered by the previous plan; did the controller let us know?" << endl;
+        return false;
+    }
+    State expectedStartState(startState);
+    plan.sample(expectedStartState);
+    if (startState.isCoLocated(expectedStartState)) return true;
+
+    // debugging:
+    cerr << "Start state is not along previous plan; did the controller let us know?" << endl;
+    if (startState.x() != expectedStartState.x()) {
+        if (startState.y() != expectedStartState.y()) {
+            cerr << "Position is different: (" << startState.x() << ", " << startState.y() << ") vs (" << expectedStartState.x() << ", " << expectedStartState.y() << "). ";
+        } else {
+            cerr << "X is different: " << startState.x() << " vs " << expectedStartState.x() << ". ";
+        }
+    } else if (startState.y() != expectedStartState.y()) {
+        cerr << "Y is different: " << startState.y() << " vs " << expectedStartState.y() << ". ";
+    }
+    if (startState.headingDifference(expectedStartState) != 0) {
+        cerr << "Headings are different: " << startState.heading() << " vs " << expectedStartState.heading() << ". ";
+    }
+    cerr << endl;
+    return false;
+}
+
+void Executive::resetRadiusShrink() {
+    // reset turning radius shrink because we can't follow original plan anymore
+    if (c_RadiusShrinkEnabled) {
+        m_PlannerConfig.setTurningRadius(m_PlannerConfig.turningRadius() + m_RadiusShrink);
+        m_PlannerConfig.setCoverageTurningRadius(m_PlannerConfig.coverageTurningRadius() + m_RadiusShrink);
+    }
+    m_RadiusShrink = 0;
+}
+
 void Executive::terminate()
 {
     // cancel planner so thread can finish
@@ -199,36 +391,79 @@ void Executive::terminate()
 }
 
 void Executive::updateDynamicObstacle(uint32_t mmsi, State obstacle) {
-    m_DynamicObstaclesManager.update(mmsi, inventDistributions(obstacle));
+    updateDynamicObstacle(mmsi, inventDistributions(obstacle));
+}
+
+std::shared_ptr<const DynamicObstaclesManager> Executive::takeDynamicObstacles() {
+    if (m_World->obstaclesVersion() == m_ObstaclesVersion) return nullptr;
+    auto obstacles = m_World->obstacles(m_ObstaclesVersion);
+    if (!m_InFleet) return obstacles;
+    // the shared snapshot has our own plan in it, which we don't need to avoid
+    auto withoutUs = make_shared<DynamicObstaclesManager>(*obstacles);
+    withoutUs->forget(m_VesselId);
+    return withoutUs;
+}
+
+void Executive::setWorld(WorldModel::SharedPtr world, uint32_t vesselId) {
+    m_World = std::move(world);
+    m_ObstaclesVersion = 0;
+    m_InFleet = true;
+    m_VesselId = vesselId;
+}
+
+void Executive::setExpansionPool(std::shared_ptr<ThreadPool> pool) {
+    m_PlannerConfig.setExpansionPool(std::move(pool));
+}
+
+void Executive::sharePlan(const DubinsPlan& plan) {
+    if (m_InFleet && !plan.empty()) m_World->updateDynamicObstacle(m_VesselId, planDistributions(plan));
+}
+
+std::vector<Distribution> Executive::planDistributions(const DubinsPlan& plan) {
+    std::vector<Distribution> distributions;
+    if (plan.empty()) return distributions;
+    State s;
+    for (auto time = plan.getStartTime(); ; time += c_PlanDistributionSeconds) {
+        s.time() = fmin(time, plan.getEndTime());
+        // a gap between paths has nothing to sample
+        if (plan.containsTime(s.time())) {
+            plan.sample(s);
+            double variance = 1 + c_PlanVarianceGrowth * (s.time() - plan.getStartTime());
+            double mean[2] = {s.x(), s.y()};
+            double covariance[2][2] = {{variance, 0}, {0, variance}};
+            distributions.emplace_back(mean, covariance, s.heading(), s.time());
+        }
+        if (time >= plan.getEndTime()) break;
+    }
+    return distributions;
 }
 
 void Executive::refreshMap(const std::string& pathToMapFile, double latitude, double longitude) {
-    // Run asynchronously and headless. The ol' fire-off-and-pray method
-    thread([this, pathToMapFile, latitude, longitude] {
-        std::lock_guard<std::mutex> lock(m_MapMutex);
-        if (m_CurrentMapPath != pathToMapFile) {
-            // could take some time for I/O, Dijkstra on entire map
-            try {
-                // If the name looks like it's one of our gridworld maps, load it in that format, otherwise assume GeoTIFF
-                if (pathToMapFile.find(".map") == -1) {
-                    m_NewMap = make_shared<GeoTiffMap>(pathToMapFile, longitude, latitude);
-                } else {
-                    m_NewMap = make_shared<GridWorldMap>(pathToMapFile);
-                }
-                m_CurrentMapPath = pathToMapFile;
-            }
-            catch (...) {
-                // swallow all errors in this thread
-                cerr << "Encountered an error loading map at path " << pathToMapFile << ".\nMap was not updated." << endl;
-                m_NewMap = nullptr;
-                m_CurrentMapPath = "";
-            }
+    {
+        std::lock_guard<std::mutex> lock(m_RecordingMutex);
+        m_MapPath = pathToMapFile;
+        m_MapLatitude = latitude;
+        m_MapLongitude = longitude;
+    }
+    // doesn't wait; a load that's already going is cancelled if it's for some other map
+    m_World->refreshMap(pathToMapFile, latitude, longitude);
+}
+
+Map::SharedPtr Executive::loadMap(const std::string& path, double latitude, double longitude,
+                                  const std::atomic<bool>& cancelled) {
+    // If the name looks like it's one of our gridworld maps, load it in that format, otherwise assume GeoTIFF
+    if (path.find(".map") == std::string::npos) {
+        if (TiledGeoTiffMap::rasterCells(path) > c_MaxWholeMapCells) {
+            return make_shared<TiledGeoTiffMap>(path, longitude, latitude);
         }
-    }).detach();
+        return make_shared<GeoTiffMap>(path, longitude, latitude, &cancelled);
+    }
+    return make_shared<GridWorldMap>(path);
 }
 
 void Executive::addRibbon(double x1, double y1, double x2, double y2) {
     std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
+    drainCoveredPoints(); // covered before this one was added
     m_RibbonManager.add(x1, y1, x2, y2);
 }
 
@@ -247,16 +482,25 @@ std::vector<Distribution> Executive::inventDistributions(State obstacle) {
 
 void Executive::clearRibbons() {
     std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
+    drainCoveredPoints(); // those were for the old ribbons
     m_RibbonManager = RibbonManager(RibbonManager::Heuristic::TspPointRobotNoSplitKRibbons, m_PlannerConfig.turningRadius(), 2);
+    m_RibbonManager.setCoverageModel(m_CoverageModel);
 }
 
 void Executive::setConfiguration(double turningRadius, double coverageTurningRadius, double maxSpeed,
-                                 double lineWidth, int k, int heuristic) {
+                                 double lineWidth, int k, int heuristic, int expansionThreads,
+                                 int searchThreads, int portfolioSize, int samplingStrategy,
+                                 double heuristicWeight) {
     m_PlannerConfig.setMaxSpeed(maxSpeed);
     m_PlannerConfig.setTurningRadius(turningRadius);
     m_PlannerConfig.setCoverageTurningRadius(coverageTurningRadius);
     RibbonManager::setRibbonWidth(lineWidth);
     m_PlannerConfig.setBranchingFactor(k);
+    m_PlannerConfig.setExpansionThreads(expansionThreads);
+    m_PlannerConfig.setSearchThreads(searchThreads);
+    m_PlannerConfig.setPortfolioSize(portfolioSize);
+    m_PlannerConfig.setHeuristicWeight(heuristicWeight);
+    std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
     switch (heuristic) {
         // check the .cfg file if this is breaking or if you change these
         case 0: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::MaxDistance); break;
@@ -264,8 +508,68 @@ void Executive::setConfiguration(double turningRadius, double coverageTurningRad
         case 2: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::TspPointRobotNoSplitKRibbons); break;
         case 3: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::TspDubinsNoSplitAllRibbons); break;
         case 4: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::TspDubinsNoSplitKRibbons); break;
+        case 5: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::MstLowerBound); break;
         default: cerr << "Unknown heuristic. Ignoring." << endl; break;
     }
+    switch (samplingStrategy) {
+        // same deal as the heuristic
+        case 0: m_PlannerConfig.setSamplingStrategy(StateGenerator::Uniform); break;
+        case 1: m_PlannerConfig.setSamplingStrategy(StateGenerator::Halton); break;
+        case 2: m_PlannerConfig.setSamplingStrategy(StateGenerator::Informed); break;
+        case 3: m_PlannerConfig.setSamplingStrategy(StateGenerator::RibbonBiased); break;
+        default: cerr << "Unknown sampling strategy. Ignoring." << endl; break;
+    }
+}
+
+void Executive::setPipelinedPublishing(bool pipelined) {
+    m_PipelinedPublishing = pipelined;
+}
+
+void Executive::setAdaptivePlanning(bool adaptive) {
+    m_AdaptivePlanning = adaptive;
+}
+
+void Executive::setHierarchicalPlanning(bool hierarchical) {
+    m_HierarchicalPlanning = hierarchical;
+}
+
+void Executive::setLatticePlanning(bool lattice) {
+    m_PlannerConfig.setLatticeSearch(lattice);
+}
+
+void Executive::setBitmapCoverage(bool bitmap) {
+    std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
+    drainCoveredPoints(); // covered under the old model
+    m_CoverageModel = bitmap ? RibbonManager::Bitmap : RibbonManager::Split;
+    m_RibbonManager.setCoverageModel(m_CoverageModel);
+}
+
+void Executive::setRecording(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_RecordingMutex);
+    m_RecordingPath = path;
+    if (path.empty()) m_Recording.clear();
+}
+
+void Executive::saveRecording(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(m_RecordingMutex);
+    PlanningRecord::save(path, {m_Recording.begin(), m_Recording.end()});
+}
+
+void Executive::recordCycle(const RibbonManager& ribbonManager, const State& startState,
+                            const DubinsPlan& previousPlan, double timeRemaining) {
+    std::lock_guard<std::mutex> lock(m_RecordingMutex);
+    if (m_RecordingPath.empty()) return;
+    PlanningRecord record(m_PlannerConfig);
+    record.Ribbons = ribbonManager;
+    record.Start = startState;
+    record.PreviousPlan = previousPlan;
+    record.WarmStart = m_WarmStart->planStates();
+    record.TimeRemaining = timeRemaining;
+    record.MapPath = m_MapPath;
+    record.MapLatitude = m_MapLatitude;
+    record.MapLongitude = m_MapLongitude;
+    m_Recording.push_back(std::move(record));
+    if (m_Recording.size() > c_RecordedCycles) m_Recording.pop_front();
 }
 
 void Executive::startPlanner() {
@@ -281,14 +585,15 @@ void Executive::cancelPlanner() {
         m_PlannerState = PlannerState::Cancelled;
 }
 
-void Executive::setPlannerVisualization(bool visualize, const std::string& visualizationFilePath) {
+void Executive::setPlannerVisualization(bool visualize, const std::string& visualizationFilePath, bool binary) {
     m_PlannerConfig.setVisualizations(visualize);
     if (visualize) {
-        m_Visualizer = Visualizer::UniquePtr(new Visualizer(visualizationFilePath));
+        m_Visualizer = Visualizer::UniquePtr(new Visualizer(visualizationFilePath,
+                                                            binary ? Visualizer::Binary : Visualizer::Text));
         m_PlannerConfig.setVisualizer(&m_Visualizer);
     }
 }
 
 void Executive::updateDynamicObstacle(uint32_t mmsi, const std::vector<Distribution>& obstacle) {
-    m_DynamicObstaclesManager.update(mmsi, obstacle);
+    m_World->updateDynamicObstacle(mmsi, obstacle);
 }
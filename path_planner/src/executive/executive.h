@@ -3,8 +3,17 @@
 
 #include <condition_variable>
 #include "../planner/utilities/RibbonManager.h"
+#include "../planner/utilities/RibbonOrdering.h"
 #include "../trajectory_publisher.h"
 #include "../planner/Planner.h"
+#include "../planner/utilities/WarmStart.h"
+#include "../planner/utilities/TripleBuffer.h"
+#include "../planner/utilities/SpscRing.h"
+#include "../planner/PlanningRecord.h"
+#include "MapLoader.h"
+#include "WorldModel.h"
+#include <atomic>
+#include <deque>
 #include <future>
 #include <fstream>
 
@@ -14,6 +23,33 @@
  * The planner runs in its own thread. Its information gets updated asynchronously through this interface by the ROS node.
  * The trajectory returned by the planner gets sent to the controller via a service call, the response of which contains
  * the start state for the next planning iteration.
+ *
+ * With pipelined publishing on, that service call happens on another thread instead, so the planner doesn't spend its
+ * time waiting on the controller. The planner hands each plan over through a TripleBuffer and goes straight on to the
+ * next one, from where the plan it just handed over says we'll be. The controller's answers come back the same way a
+ * cycle later, and if one says the vehicle won't be on the plan after all the planner starts over from where it is.
+ *
+ * Position updates don't wait on the planner either: the points they cover go in a lock free queue that the planner
+ * empties into the ribbons at the start of each cycle, and the latest state goes in a TripleBuffer. Each cycle the
+ * planner then hands out a copy of the ribbons (see ribbonSnapshot()) that's never changed afterwards, so displaying
+ * them doesn't hold anything up.
+ *
+ * With adaptive planning on, cycles aren't a fixed second. The planner stops once the plan's provably optimal or it's
+ * past half a second and the plan's stopped getting much better, and the plan goes out right away; the time that
+ * saves goes to the next cycle, which plans from where the controller says we'll be a second from then.
+ *
+ * Maps load on a MapLoader's thread. Asking for a different map cancels the one loading, and the planner picks up
+ * whichever finished last at the start of a cycle without waiting on anything. The map and the contacts are kept in a
+ * WorldModel, which executives planning for vessels in the same fleet share (see Fleet); each of those also puts its
+ * plans in the world as a contact for the others to stay clear of.
+ *
+ * With hierarchical planning on, another thread keeps an order to cover all the ribbons in (see RibbonOrdering),
+ * repairing it from the ribbons each cycle hands it whenever they've changed. The planner is then only given the next
+ * few ribbons in that order instead of all of them, so a big survey costs it no more than a small one. Until there's
+ * an order it gets everything, as usual.
+ *
+ * With recording on, the executive keeps what it gave the planner for the last few cycles (see PlanningRecord) and
+ * saves them when the planner stops, so a mission that went wrong can be planned again offline with replay_planner.
  */
 class Executive
 {
@@ -40,6 +76,19 @@ public:
      */
     void updateCovered(double x, double y, double speed, double heading, double t);
 
+    /**
+     * The ribbons as of the start of the latest planning cycle. Lock free, and the ribbon manager pointed to doesn't
+     * change, so it's safe to hold onto and use from any thread.
+     * @return null before the planner's started
+     */
+    std::shared_ptr<const RibbonManager> ribbonSnapshot() const;
+
+    /**
+     * The latest order for the ribbons, with hierarchical planning. Lock free, like ribbonSnapshot().
+     * @return null if there isn't one yet
+     */
+    RibbonOrdering::SharedPtr ribbonOrdering() const;
+
     /**
      * Add a new survey line.
      * @param x1
@@ -80,6 +129,37 @@ public:
      */
     void refreshMap(const std::string& pathToMapFile, double latitude, double longitude);
 
+    /**
+     * Share a world (map and contacts) with other executives, as a vessel in a fleet. Each plan this executive
+     * publishes goes in the world as a contact with the vessel's ID, and the planner leaves that contact out of what it
+     * avoids. Set it up before starting the planner or feeding the executive anything.
+     * @param world
+     * @param vesselId
+     */
+    void setWorld(WorldModel::SharedPtr world, uint32_t vesselId);
+
+    /**
+     * Compute true costs on a pool shared with other executives instead of one of the planner's own (see
+     * PlannerConfig::expansionPool). Only used with more than one expansion thread. Set it before starting the planner.
+     * @param pool
+     */
+    void setExpansionPool(std::shared_ptr<ThreadPool> pool);
+
+    /**
+     * Nothing provides the distributions for dynamic obstacles yet so the executive invents them.
+     * @param obstacle
+     * @return
+     */
+    static std::vector<Distribution> inventDistributions(State obstacle);
+
+    /**
+     * Copy a plan into distributions a vessel following it could be found in, to make it a contact for other planners.
+     * The further ahead, the less sure.
+     * @param plan
+     * @return
+     */
+    static std::vector<Distribution> planDistributions(const DubinsPlan& plan);
+
     /**
      * Utility to get the current time. Public for testing, and only used when disconnected from ROS.
      * @return
@@ -94,15 +174,83 @@ public:
      * @param lineWidth
      * @param k
      * @param heuristic
+     * @param expansionThreads threads used to compute edge costs during search
+     * @param searchThreads threads for the parallel A* planner (1 uses the single threaded one)
+     * @param portfolioSize searches for the portfolio planner to run at once (1 to not use it)
+     * @param samplingStrategy how to draw samples (see StateGenerator::Strategy)
+     * @param heuristicWeight starting heuristic weight for anytime weighted A* (1 for plain A*)
      */
-    void setConfiguration(double turningRadius, double coverageTurningRadius, double maxSpeed, double lineWidth, int k, int heuristic);
+    void setConfiguration(double turningRadius, double coverageTurningRadius, double maxSpeed, double lineWidth, int k,
+                          int heuristic, int expansionThreads = 1, int searchThreads = 1, int portfolioSize = 1,
+                          int samplingStrategy = 2, double heuristicWeight = 1);
 
     /**
      * Update the planner visualization status with a new visualization file. If visualize is false the path is ignored.
      * @param visualize
      * @param visualizationFilePath
+     * @param binary write compact binary records from a background thread instead of text (see Visualizer)
+     */
+    void setPlannerVisualization(bool visualize, const std::string& visualizationFilePath, bool binary = false);
+
+    /**
+     * Publish plans from a separate thread (see above). Takes effect the next time the planner is started.
+     * @param pipelined
+     */
+    void setPipelinedPublishing(bool pipelined);
+
+    /**
+     * Let planning cycles be shorter than a second (see above). Takes effect from the next cycle.
+     * @param adaptive
+     */
+    void setAdaptivePlanning(bool adaptive);
+
+    /**
+     * Keep track of coverage with a bitmap along each survey line instead of splitting them (see
+     * RibbonManager::CoverageModel). Takes effect straight away, keeping what's been covered.
+     * @param bitmap
+     */
+    void setBitmapCoverage(bool bitmap);
+
+    /**
+     * Order the ribbons on another thread and only plan for the next few (see above). Takes effect the next time the
+     * planner is started.
+     * @param hierarchical
+     */
+    void setHierarchicalPlanning(bool hierarchical);
+
+    /**
+     * Search a state lattice of motion primitives instead of random samples (see MotionPrimitives). Takes effect from
+     * the next cycle.
+     * @param lattice
+     */
+    void setLatticePlanning(bool lattice);
+
+    /**
+     * Record each planning cycle's inputs, and save the last c_RecordedCycles of them to a file when the planner stops.
+     * @param path where to save them (empty to stop recording)
      */
-    void setPlannerVisualization(bool visualize, const std::string& visualizationFilePath);
+    void setRecording(const std::string& path);
+
+    /**
+     * Save the cycles recorded so far, oldest first.
+     * @param path
+     */
+    void saveRecording(const std::string& path) const;
+
+    /**
+     * Make a map from a file, picking the format from the name (and how big it is), for the MapLoader. Public so
+     * replaying can load maps the same way.
+     * @param path
+     * @param latitude origin latitude
+     * @param longitude origin longitude
+     * @param cancelled checked while loading GeoTIFFs small enough to load whole
+     * @return
+     */
+    static Map::SharedPtr loadMap(const std::string& path, double latitude, double longitude,
+                                  const std::atomic<bool>& cancelled);
+
+    // how many cycles a recording keeps
+    static constexpr size_t c_RecordedCycles = 64;
 
 private:
 
@@ -120,23 +268,40 @@ private:
     std::mutex m_PlannerStateMutex;
     std::condition_variable m_CancelCV;
 
+    // charts with more cells than this are loaded a tile at a time
+    static constexpr long c_MaxWholeMapCells = 64L * 1024 * 1024;
+    // points covered between planning cycles, at up to a few hundred poses a second
+    static constexpr size_t c_CoveredPointCapacity = 4096;
+
+    // anything changing the ribbons (or taking points off the queue below) holds the mutex
     std::mutex m_RibbonManagerMutex;
     RibbonManager m_RibbonManager;
+    RibbonManager::CoverageModel m_CoverageModel = RibbonManager::Split;
+    std::shared_ptr<const RibbonManager> m_RibbonSnapshot; // only accessed with std::atomic_load/store
+    struct CoveredPoint {
+        double X, Y;
+    };
+    SpscRing<CoveredPoint, c_CoveredPointCapacity> m_CoveredPoints;
+    // only touched by the position callback
     double m_LastUpdateTime = 1; // could use the time in m_LastState I think but this is cleaner
     double m_LastHeading = 0; // TODO! -- use moving average or something
-    State m_LastState;
+    // latest state from the position callback; only the planning thread reads it
+    TripleBuffer<State> m_LastState;
 
     // TODO! -- use ROS_INFO
     PlannerConfig m_PlannerConfig = PlannerConfig(&std::cerr);
 
     Visualizer::UniquePtr m_Visualizer;
 
-    DynamicObstaclesManager m_DynamicObstaclesManager;
+    // the map and contacts, our own unless we're in a fleet. The planner takes a snapshot of the contacts whenever
+    // their version's moved on from the one it has. With a vessel ID, our plans are contacts in the world too
+    WorldModel::SharedPtr m_World = std::make_shared<WorldModel>(&Executive::loadMap);
+    uint64_t m_ObstaclesVersion = 0;
+    bool m_InFleet = false;
+    uint32_t m_VesselId = 0;
 
-    // start with no new map
-    std::shared_ptr<Map> m_NewMap = nullptr;
-    std::string m_CurrentMapPath = "";
-    std::mutex m_MapMutex;
+    // what each planning cycle leaves for the next
+    WarmStart::SharedPtr m_WarmStart = std::make_shared<WarmStart>();
 
     // hold onto the thread doing planning, for elegant error handling and shutdown I guess
     std::future<void> m_PlanningFuture;
@@ -146,12 +311,84 @@ private:
 
     double m_RadiusShrink = 0;
 
+    std::atomic<bool> m_PipelinedPublishing{false};
+    std::atomic<bool> m_AdaptivePlanning{false};
+    std::atomic<bool> m_HierarchicalPlanning{false};
+    RibbonOrdering::SharedPtr m_RibbonOrdering; // only accessed with std::atomic_load/store
+
+    // the last few cycles when recording, oldest first, and the map last asked for
+    mutable std::mutex m_RecordingMutex;
+    std::string m_RecordingPath;
+    std::deque<PlanningRecord> m_Recording;
+    std::string m_MapPath;
+    double m_MapLatitude = 0, m_MapLongitude = 0;
+
+    /**
+     * Keep what the planner's about to be given this cycle, if recording. Planning thread only.
+     * @param ribbonManager
+     * @param startState
+     * @param previousPlan
+     * @param timeRemaining
+     */
+    void recordCycle(const RibbonManager& ribbonManager, const State& startState, const DubinsPlan& previousPlan,
+                     double timeRemaining);
+
+    /**
+     * What the publishing thread hands back to the planner after sending a plan to the controller.
+     */
+    struct PublishResult {
+        State StartState;
+        bool OnPlan = true;
+    };
+
+    /**
+     * What the planner hands the ordering thread each cycle.
+     */
+    struct OrderingRequest {
+        std::shared_ptr<const RibbonManager> Ribbons;
+        State Start;
+        double TurningRadius = 0;
+    };
+
     static constexpr bool c_RadiusShrinkEnabled = false;
     static constexpr double c_RadiusShrinkAmount = 1e-6;
 
     static constexpr bool c_ReusePlanEnabled = true;
     static constexpr double c_CoverageHeadingRateMax = 0.1; // (in radians/sec)
     static constexpr double c_PlanningTimeSeconds = 1;
+    // pops between reads of the clock; an expansion takes long enough that a few of them late don't matter
+    static constexpr int c_ClockCheckInterval = 8;
+    // with adaptive planning, how long the planner goes before stopping if the plan's not getting better any more, and
+    // the shortest a cycle can be (so a plan that's quickly optimal isn't republished over and over)
+    static constexpr double c_SoftPlanningTimeSeconds = 0.5;
+    static constexpr double c_MinPlanningPeriodSeconds = 0.25;
+    // how often the publishing thread looks for a new plan
+    static constexpr double c_PublishPollSeconds = 0.005;
+    // with hierarchical planning, how many ribbons the planner is given (what the TSP heuristics can take, less one to
+    // leave room for an end being split off), and how often the ordering thread looks for new ribbons
+    static constexpr size_t c_LocalRibbonCount = 4;
+    static constexpr double c_OrderingPollSeconds = 0.05;
+    // how far apart the distributions made from a plan are, and how much less sure of where on it a vessel is we get
+    // with each second ahead (as a variance, m^2)
+    static constexpr double c_PlanDistributionSeconds = 2;
+    static constexpr double c_PlanVarianceGrowth = 0.5;
+
+    /**
+     * A snapshot of the dynamic obstacles, if they've changed since the last one. Leaves out our own plan.
+     * @return null if they haven't
+     */
+    std::shared_ptr<const DynamicObstaclesManager> takeDynamicObstacles();
+
+    /**
+     * Put a plan that's just gone to the controller in the world for the rest of the fleet, if we're in one.
+     * @param plan
+     */
+    void sharePlan(const DubinsPlan& plan);
+
+    /**
+     * Cover the points the position callback has queued up since last time. Hold m_RibbonManagerMutex.
+     */
+    void drainCoveredPoints();
 
     /**
      * Make sure the threads can exit and kill the planner (if it's running).
@@ -164,11 +401,35 @@ private:
     void planLoop();
 
     /**
-     * Nothing provides the distributions for dynamic obstacles yet so the executive invents them.
-     * @param obstacle
+     * With pipelined publishing, display and publish the plans the planner hands over, as they come, until told to stop.
+     * @param plans
+     * @param results
+     * @param stop
+     */
+    void publishLoop(TripleBuffer<DubinsPlan>& plans, TripleBuffer<PublishResult>& results,
+                     const std::atomic<bool>& stop);
+
+    /**
+     * With hierarchical planning, repair the ribbon order whenever the planner hands over ribbons that have changed,
+     * until told to stop.
+     * @param requests
+     * @param stop
+     */
+    void orderingLoop(TripleBuffer<OrderingRequest>& requests, const std::atomic<bool>& stop);
+
+    /**
+     * Check whether the controller's start state for the next plan is on the one just sent to it, explaining how it
+     * isn't if it's not.
+     * @param startState
+     * @param plan
      * @return
      */
-    static std::vector<Distribution> inventDistributions(State obstacle);
+    static bool startStateOnPlan(const State& startState, const DubinsPlan& plan);
+
+    /**
+     * The vehicle won't be following the last plan, so put the turning radii back if they'd been shrinking.
+     */
+    void resetRadiusShrink();
 };
 
 #endif //SRC_EXECUTIVE_H
@@ -13,6 +13,7 @@
 #include "NodeBase.h"
 #include <path_planner/path_plannerConfig.h>
 #include <dynamic_reconfigure/server.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "OCInconsistentNamingInspection"
@@ -31,6 +32,9 @@ public:
 
     m_contact_sub = m_node_handle.subscribe("/contact", 10, &PathPlanner::contactCallback, this);
     m_origin_sub = m_node_handle.subscribe("/origin", 1, &PathPlanner::originCallback, this);
+    if (Instrumentation::enabled()) {
+        m_statistics_pub = m_node_handle.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+    }
 
     dynamic_reconfigure::Server<path_planner::path_plannerConfig>::CallbackType f;
     f = boost::bind(&PathPlanner::reconfigureCallback, this, _1, _2);
@@ -147,7 +151,7 @@ public:
 //        }
 //    }
 
-    void displayTrajectory(std::vector<State> trajectory, bool plannerTrajectory) override
+    void displayTrajectory(const std::vector<State>& trajectory, bool plannerTrajectory) override
     {
         m_TrajectoryDisplayer.displayTrajectory(trajectory, plannerTrajectory);
     }
@@ -171,8 +175,17 @@ public:
     void reconfigureCallback(path_planner::path_plannerConfig &config, uint32_t level) {
         m_Executive->refreshMap(config.planner_geotiff_map, m_origin.latitude, m_origin.longitude);
         m_Executive->setConfiguration(config.non_coverage_turning_radius, config.coverage_turning_radius,
-                                      config.max_speed, config.line_width, config.branching_factor, config.heuristic);
-        m_Executive->setPlannerVisualization(config.dump_visualization, config.visualization_file);
+                                      config.max_speed, config.line_width, config.branching_factor, config.heuristic,
+                                      config.expansion_threads, config.search_threads, config.portfolio_size,
+                                      config.sampling_strategy, config.heuristic_weight);
+        m_Executive->setPlannerVisualization(config.dump_visualization, config.visualization_file,
+                                             config.binary_visualization);
+        m_Executive->setPipelinedPublishing(config.pipelined_publishing);
+        m_Executive->setAdaptivePlanning(config.adaptive_planning);
+        m_Executive->setBitmapCoverage(config.bitmap_coverage);
+        m_Executive->setHierarchicalPlanning(config.hierarchical_planning);
+        m_Executive->setLatticePlanning(config.lattice_planning);
+        m_Executive->setRecording(config.recording_file);
     }
 
     void originCallback(const geographic_msgs::GeoPointConstPtr& inmsg) {
@@ -208,6 +221,29 @@ public:
         return NodeBase::publishPlan(plan);
     }
 
+    void publishStatistics(const Instrumentation::Report& report) override {
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = "path_planner: planning cycle";
+        status.message = "Counts and times for the last planning cycle";
+        for (int i = 0; i < Instrumentation::CounterCount; i++) {
+            diagnostic_msgs::KeyValue keyValue;
+            keyValue.key = Instrumentation::Report::name((Instrumentation::Counter)i);
+            keyValue.value = std::to_string(report.Counts[i]);
+            status.values.push_back(keyValue);
+        }
+        for (int i = 0; i < Instrumentation::TimerCount; i++) {
+            diagnostic_msgs::KeyValue keyValue;
+            keyValue.key = Instrumentation::Report::name((Instrumentation::Timer)i);
+            keyValue.value = std::to_string(report.Seconds[i]);
+            status.values.push_back(keyValue);
+        }
+        diagnostic_msgs::DiagnosticArray array;
+        array.header.stamp = ros::Time::now();
+        array.status.push_back(status);
+        m_statistics_pub.publish(array);
+    }
+
 private:
     ros::NodeHandle m_node_handle; // TODO
 
@@ -215,6 +251,7 @@ private:
 
     ros::Subscriber m_contact_sub;
     ros::Subscriber m_origin_sub;
+    ros::Publisher m_statistics_pub;
 
     dynamic_reconfigure::Server<path_planner::path_plannerConfig> m_Dynamic_Reconfigure_Server;
 
@@ -3,21 +3,31 @@
 
 using std::shared_ptr;
 
-std::function<bool(shared_ptr<Vertex> v1, shared_ptr<Vertex> v2)> AStarPlanner::getVertexComparator() {
-    return [] (const shared_ptr<Vertex>& v1, const shared_ptr<Vertex>& v2) {
-        return v1->f() > v2->f();
-    };
+double AStarPlanner::openListKey(const Vertex::SharedPtr& vertex) {
+    if (m_HeuristicWeight == 1) return vertex->f();
+    return vertex->currentCost() + m_HeuristicWeight * vertex->approxToGo();
 }
 
 DubinsPlan AStarPlanner::plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
                               const DubinsPlan& previousPlan, double timeRemaining) {
-    m_Config = std::move(config); // gotta do this before we can call now()
-    double endTime = timeRemaining + now();
+    m_Config = std::move(config);
+    m_Budget.start(m_Config.budgetMode(), [this] { return now(); }, timeRemaining, m_Config.workPerSecond(),
+                   m_Config.clockCheckInterval());
     m_Config.setStartStateTime(start.time());
     m_RibbonManager = ribbonManager;
     m_RibbonManager.changeHeuristicIfTooManyRibbons(); // make sure ribbon heuristic is calculable
     m_ExpandedCount = 0;
     m_IterationCount = 0;
+    m_DuplicatesPruned = 0;
+    m_HeuristicWeight = fmax(1, m_Config.heuristicWeight());
+    m_SuboptimalityBound = INFINITY;
+    m_FirstPlanSeconds = -1;
+    m_HeuristicCache.clear();
+    m_HeuristicCache.setHeuristic(m_RibbonManager.heuristic());
+    m_GeometryCache.clear();
+    m_GeometryCache.setCapacity(m_Config.geometryCacheCapacity());
+    clearEdgeCache();
+    prepareLattice(start);
     m_StartStateTime = start.time();
     m_Samples.clear();
     double minX, maxX, minY, maxY, minSpeed = m_Config.maxSpeed(), maxSpeed = m_Config.maxSpeed();
@@ -26,8 +36,13 @@ DubinsPlan AStarPlanner::plan(const RibbonManager& ribbonManager, const State& s
     maxX = start.x() + magnitude;
     minY = start.y() - magnitude;
     maxY = start.y() + magnitude;
-    StateGenerator generator = StateGenerator(minX, maxX, minY, maxY, minSpeed, maxSpeed, 7, m_RibbonManager); // lucky seed
-    auto startV = Vertex::makeRoot(start, m_RibbonManager);
+    StateGenerator generator = StateGenerator(minX, maxX, minY, maxY, minSpeed, maxSpeed, m_Seed, m_RibbonManager);
+    generator.setStrategy(m_Config.samplingStrategy());
+    // start with what the last search found that's still in reach
+    if (m_WarmStart) for (const auto& s : m_WarmStart->samplesWithin(minX, maxX, minY, maxY)) m_Samples.add(s);
+    // the whole tree for this call comes out of one arena, and goes back when the last vertex is let go
+    auto startV = Vertex::makeRoot(start, m_RibbonManager, std::make_shared<SearchArena>(), &m_HeuristicCache,
+                                   m_GeometryCache.capacity() > 0 ? &m_GeometryCache : nullptr);
     startV->state().speed() = m_Config.maxSpeed(); // state's speed is used to compute h so need to use max
     startV->computeApproxToGo();
     m_BestVertex = nullptr;
@@ -40,40 +55,82 @@ DubinsPlan AStarPlanner::plan(const RibbonManager& ribbonManager, const State& s
         for (const auto& p : previousPlan.get()) {
             lastPlanEnd = Vertex::connect(lastPlanEnd, p);
             lastPlanEnd->parentEdge()->computeTrueCost(m_Config);
+            m_Budget.addWork();
             if (lastPlanEnd->parentEdge()->infeasible()) {
                 lastPlanEnd = startV;
                 break;
             }
         }
     }
+    // whether the last iteration got the plan down by enough to be worth going past the soft time limit
+    bool improving = true;
     // big loop
-    while (now() < endTime) {
+    while (!m_Budget.spentNow()) {
         clearVertexQueue();
         if (m_BestVertex && m_BestVertex->f() <= startV->f()) {
             *m_Config.output() << "Found best possible plan, assuming heuristic admissibility" << std::endl;
+            m_SuboptimalityBound = 1;
             break;
         }
-        visualizeVertex(startV, "start");
+        if (!improving && m_Budget.elapsed() >= m_Config.softTimeLimit()) {
+            *m_Config.output() << "Plan stopped improving, finishing early" << std::endl;
+            break;
+        }
+        visualizeVertex(startV, Visualizer::StartTag);
         pushVertexQueue(startV);
         if (lastPlanEnd != startV) pushVertexQueue(lastPlanEnd);
         // manually expand starting node to include states on nearby ribbons far enough away such that the boat doesn't
         // have to loop around
         expandToCoverSpecificSamples(startV, ribbonSamples, m_Config.obstacles(), true);
         expandToCoverSpecificSamples(startV, otherRibbonSamples, m_Config.obstacles(), true);
-        // On the first iteration add c_InitialSamples samples, otherwise just double them
-        if (m_Samples.size() < c_InitialSamples) addSamples(generator, c_InitialSamples);
-        else addSamples(generator); // linearly increase samples (changed to not double)
-        auto v = aStar(m_Config.obstacles(), endTime);
+        // On the first iteration add c_InitialSamples samples, otherwise just double them (the lattice doesn't use any)
+        if (!m_Config.latticeSearch()) {
+            if (m_IterationCount == 0 || m_Samples.size() < c_InitialSamples) addSamples(generator, c_InitialSamples);
+            else addSamples(generator); // linearly increase samples (changed to not double)
+        }
+        auto v = aStar(m_Config.obstacles());
+        // if the search didn't run out of time whatever plan we have is within the weight of the best one
+        auto finished = !m_Budget.spentNow();
+        // (not having a plan yet counts as improving)
+        auto previousCost = m_BestVertex ? m_BestVertex->f() : INFINITY;
+        improving = previousCost == INFINITY ||
+                (v && previousCost - v->f() >= m_Config.extensionImprovement() * previousCost);
         if (!m_BestVertex || (v && v->f() < m_BestVertex->f())) {
             // found a (better) plan
+            if (v && !m_BestVertex) m_FirstPlanSeconds = m_Budget.elapsed();
             m_BestVertex = v;
-            if (v) visualizeVertex(v, "goal");
+            if (v) visualizeVertex(v, Visualizer::GoalTag);
+            if (v && m_SharedIncumbent) m_SharedIncumbent->offer(v->f());
+            // anything further away than we could get in the incumbent's cost can't be on a better plan
+            if (v) generator.setMaxDistance((v->f() - startV->currentCost()) / Edge::timePenaltyFactor() *
+                                            m_Config.maxSpeed());
+        }
+        // the lattice is the same every iteration, so once a search of it with no weight finishes (or any search of
+        // it finishes without a plan) there's nothing more to find
+        auto exhausted = m_Config.latticeSearch() && finished && (!m_BestVertex || m_HeuristicWeight == 1);
+        if (finished && m_BestVertex) {
+            m_SuboptimalityBound = fmin(m_SuboptimalityBound, m_HeuristicWeight);
+            // the open list starts over each iteration, reusing the edges, so just lower the weight for the next one
+            m_HeuristicWeight = 1 + (m_HeuristicWeight - 1) * c_WeightDecay;
+            if (m_HeuristicWeight < 1.01) m_HeuristicWeight = 1;
         }
         m_IterationCount++;
+        if (exhausted) {
+            *m_Config.output() << "Searched the whole lattice, finishing early" << std::endl;
+            break;
+        }
     }
     // Add expected final cost, total accrued cost (not here)
     *m_Config.output() << m_Samples.size() << " total samples, " << m_ExpandedCount << " expanded in "
-        << m_IterationCount << " iterations" << std::endl;
+        << m_IterationCount << " iterations, " << m_HeuristicCache.summary() << ", " << m_GeometryCache.summary()
+        << ", " << m_DuplicatesPruned << " duplicates pruned" << std::endl;
+    if (m_BestVertex) {
+        *m_Config.output() << "First plan after " << m_FirstPlanSeconds << "s, suboptimality bound: "
+            << m_SuboptimalityBound << std::endl;
+    }
+    // let the tree go, keeping what's worth keeping for next time
+    rememberSearch();
+    clearEdgeCache();
     if (!m_BestVertex) {
         *m_Config.output() << "Failed to find a plan" << std::endl;
         return DubinsPlan();
@@ -82,14 +139,21 @@ DubinsPlan AStarPlanner::plan(const RibbonManager& ribbonManager, const State& s
     }
 }
 
-shared_ptr<Vertex> AStarPlanner::aStar(const DynamicObstaclesManager& obstacles, double endTime) {
+void AStarPlanner::setSeed(unsigned long seed) {
+    m_Seed = seed;
+}
+
+shared_ptr<Vertex> AStarPlanner::aStar(const DynamicObstaclesManager& obstacles) {
     auto vertex = popVertexQueue();
-    while (now() < endTime) {
-        // with filter on vertex queue this second check is unnecessary
-        if (goalCondition(vertex) && (!m_BestVertex || vertex->f() < m_BestVertex->f())) {
-            return vertex;
+    while (!m_Budget.spent()) {
+        // skip it if a cheaper way to the same state was pushed after it was
+        if (!superseded(vertex)) {
+            // with filter on vertex queue this second check is unnecessary
+            if (goalCondition(vertex) && (!m_BestVertex || vertex->f() < m_BestVertex->f())) {
+                return vertex;
+            }
+            expand(vertex, obstacles);
         }
-        expand(vertex, obstacles);
 
         if (vertexQueueEmpty()) return Vertex::SharedPtr(nullptr);
         vertex = popVertexQueue();
@@ -101,12 +165,12 @@ shared_ptr<Vertex> AStarPlanner::aStar(const DynamicObstaclesManager& obstacles,
 void AStarPlanner::expandToCoverSpecificSamples(Vertex::SharedPtr root, const std::vector<State>& samples,
                                                 const DynamicObstaclesManager& obstacles, bool coverageAllowed) {
     if (m_Config.coverageTurningRadius() > 0) {
+        std::vector<Vertex::SharedPtr> children;
         for (auto s : samples) {
             s.speed() = m_Config.maxSpeed();
-            auto destinationVertex = Vertex::connect(root, s, m_Config.coverageTurningRadius(), coverageAllowed);
-            destinationVertex->parentEdge()->computeTrueCost(m_Config);
-            pushVertexQueue(destinationVertex);
+            children.push_back(connect(root, s, m_Config.coverageTurningRadius(), coverageAllowed));
         }
+        computeTrueCostsAndPush(children);
     }
 }
 
@@ -19,18 +19,42 @@ public:
     DubinsPlan plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
                     const DubinsPlan& previousPlan, double timeRemaining) override;
 
+    /**
+     * Set the seed for sample generation.
+     * @param seed
+     */
+    void setSeed(unsigned long seed);
+
+    /**
+     * How far from optimal (as a factor on the cost) the last plan() call's plan can be, over the samples it had, by
+     * the last heuristic weight it finished a search with. 1 for plain A*, infinity if it didn't finish one.
+     * @return
+     */
+    double suboptimalityBound() const { return m_SuboptimalityBound; }
+
+    /**
+     * @return how long (by PlannerConfig::now()) the last plan() call took to find its first plan, or -1 if it didn't
+     */
+    double firstPlanSeconds() const { return m_FirstPlanSeconds; }
+
 protected:
     int m_IterationCount = 0;
+    double m_HeuristicWeight = 1;
+    double m_SuboptimalityBound = INFINITY;
+    double m_FirstPlanSeconds = -1;
+    unsigned long m_Seed = c_DefaultSeed;
+
+    HeuristicCache m_HeuristicCache;
+    EdgeGeometryCache m_GeometryCache;
 
-    std::function<bool(std::shared_ptr<Vertex> v1, std::shared_ptr<Vertex> v2)> getVertexComparator() override;
+    double openListKey(const Vertex::SharedPtr& vertex) override;
 
     /**
-     * Perform A* search using the open list, vertex queue, start state, etc.
+     * Perform A* search using the open list, vertex queue, start state, etc., until the budget's spent.
      * @param obstacles
-     * @param endTime
      * @return
      */
-    std::shared_ptr<Vertex> aStar(const DynamicObstaclesManager& obstacles, double endTime);
+    virtual std::shared_ptr<Vertex> aStar(const DynamicObstaclesManager& obstacles);
 
     /**
      * Specifically expand root to connect to the given samples.
@@ -43,6 +67,9 @@ protected:
                                       const DynamicObstaclesManager& obstacles, bool coverageAllowed);
 
     static constexpr double c_InitialSamples = 100;
+    // after each finished iteration the weight goes this much of the way to 1 (and snaps to 1 when close)
+    static constexpr double c_WeightDecay = 0.5;
+    static constexpr unsigned long c_DefaultSeed = 7; // lucky seed
 };
 
 
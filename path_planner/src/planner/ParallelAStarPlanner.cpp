@@ -0,0 +1,121 @@
+#include <cfloat>
+#include <condition_variable>
+#include <cstdint>
+#include <sstream>
+#include "ParallelAStarPlanner.h"
+#include "utilities/Instrumentation.h"
+
+using std::shared_ptr;
+
+DubinsPlan ParallelAStarPlanner::plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
+                                      const DubinsPlan& previousPlan, double timeRemaining) {
+    m_ThreadExpansions.assign(std::max(1, config.searchThreads()), 0);
+    auto plan = AStarPlanner::plan(ribbonManager, start, std::move(config), previousPlan, timeRemaining);
+    std::stringstream stream;
+    stream << "Expansions per thread:";
+    for (auto n : m_ThreadExpansions) stream << " " << n;
+    *m_Config.output() << stream.str() << std::endl;
+    return plan;
+}
+
+const std::vector<unsigned long>& ParallelAStarPlanner::threadExpansions() const {
+    return m_ThreadExpansions;
+}
+
+int ParallelAStarPlanner::threads() const {
+    return m_Config.visualizationsSingleThreaded() ? 1 : std::max(1, m_Config.searchThreads());
+}
+
+shared_ptr<Vertex> ParallelAStarPlanner::aStar(const DynamicObstaclesManager& obstacles) {
+    auto threads = this->threads();
+    m_ThreadExpansions.resize(std::max<size_t>(m_ThreadExpansions.size(), threads), 0);
+    if (threads == 1) {
+        auto expanded = m_ExpandedCount;
+        auto v = AStarPlanner::aStar(obstacles);
+        m_ThreadExpansions[0] += m_ExpandedCount - expanded;
+        return v;
+    }
+    if (!m_SearchPool || m_SearchPool->size() != (unsigned)threads) m_SearchPool.reset(new ThreadPool(threads));
+
+    // everything below is shared between the threads and guarded by the mutex
+    std::mutex mutex;
+    std::condition_variable changed;
+    shared_ptr<Vertex> incumbent;
+    auto incumbentF = m_BestVertex ? m_BestVertex->f() : DBL_MAX;
+    int busy = 0;
+    bool finished = false;
+
+    m_SearchPool->run(threads, [&](size_t thread) {
+        std::vector<Vertex::SharedPtr> children;
+        // each thread collision checks its own expansions' children together, when batching
+        EdgeBatch batch;
+        std::vector<size_t> indices;
+        while (true) {
+            Vertex::SharedPtr vertex;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return finished || !vertexQueueEmpty() || busy == 0; });
+                if (finished) return;
+                if (vertexQueueEmpty() || m_Budget.spent()) {
+                    // either nobody's left to push anything or we're out of time
+                    finished = true;
+                    changed.notify_all();
+                    return;
+                }
+                vertex = popVertexQueue();
+                if (superseded(vertex)) continue;
+                // assuming the heuristic is admissible nothing under here can do better
+                if (vertex->f() >= incumbentF) continue;
+                if (goalCondition(vertex)) {
+                    incumbent = vertex;
+                    incumbentF = vertex->f();
+                    // nothing worse is worth holding on to
+                    pruneVertexQueue(incumbentF);
+                    continue;
+                }
+                busy++;
+            }
+            children.clear();
+            try {
+                selectChildren(vertex, children);
+                if (m_Config.batchedTrueCosts()) {
+                    batch.clear();
+                    indices.assign(children.size(), SIZE_MAX);
+                    for (size_t i = 0; i < children.size(); i++) {
+                        auto& edge = *children[i]->parentEdge();
+                        if (!edge.hasTrueCost()) indices[i] = edge.addToBatch(m_Config, batch);
+                    }
+                    batch.evaluate(*m_Config.map(), m_Config.obstacles(), Edge::collisionCheckingIncrement());
+                }
+                for (size_t i = 0; i < children.size(); i++) {
+                    const auto& c = children[i];
+                    if (!c->parentEdge()->hasTrueCost()) {
+                        if (m_Config.batchedTrueCosts()) c->parentEdge()->computeTrueCost(m_Config, batch, indices[i]);
+                        else c->parentEdge()->computeTrueCost(m_Config);
+                        m_Budget.addWork();
+                    }
+                    if (!c->parentEdge()->infeasible()) c->approxToGo(); // outside the lock
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished = true;
+                changed.notify_all();
+                throw;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (const auto& c : children) {
+                    if (c->parentEdge()->infeasible() || c->f() >= incumbentF) continue;
+                    pushVertexQueue(c);
+                }
+                m_ExpandedCount++;
+                m_Budget.addWork();
+                m_ThreadExpansions[thread]++;
+                Instrumentation::count(Instrumentation::Expansions);
+                busy--;
+            }
+            changed.notify_all();
+        }
+    });
+    return incumbent;
+}
@@ -0,0 +1,44 @@
+#ifndef SRC_PARALLELASTARPLANNER_H
+#define SRC_PARALLELASTARPLANNER_H
+
+#include "AStarPlanner.h"
+
+/**
+ * AStarPlanner with the search itself spread over several threads (PlannerConfig::searchThreads()), K-parallel best
+ * first: each thread pops the best vertex off the shared open list, expands it on its own and pushes the children
+ * back. The incumbent goal is shared too, and vertices that can't beat it are dropped.
+ * The search ends once the open list has nothing better than the incumbent and nobody is still expanding.
+ *
+ * The open list is just the usual heap behind a lock, which is fine because an expansion (collision checking the
+ * children) takes far longer than a push or pop. Unlike the single threaded planner the result depends on timing.
+ * Visualization writes to a single stream so it falls back to one thread.
+ */
+class ParallelAStarPlanner : public AStarPlanner {
+public:
+    ParallelAStarPlanner() = default;
+
+    ~ParallelAStarPlanner() override = default;
+
+    DubinsPlan plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
+                    const DubinsPlan& previousPlan, double timeRemaining) override;
+
+    /**
+     * @return how many vertices each thread expanded during the last plan() call
+     */
+    const std::vector<unsigned long>& threadExpansions() const;
+
+protected:
+    std::shared_ptr<Vertex> aStar(const DynamicObstaclesManager& obstacles) override;
+
+private:
+    std::unique_ptr<ThreadPool> m_SearchPool;
+    std::vector<unsigned long> m_ThreadExpansions;
+
+    /**
+     * @return how many threads to search with
+     */
+    int threads() const;
+};
+
+
+#endif //SRC_PARALLELASTARPLANNER_H
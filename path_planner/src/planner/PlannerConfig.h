@@ -1,9 +1,13 @@
 #ifndef SRC_PLANNERCONFIG_H
 #define SRC_PLANNERCONFIG_H
 
+#include <cmath>
 #include <functional>
 #include <assert.h>
 #include "utilities/Visualizer.h"
+#include "utilities/StateGenerator.h"
+#include "utilities/Budget.h"
+#include "utilities/ThreadPool.h"
 
 /**
  * Class that holds all the configurations for the planner. These need to get passed around periodically so it was
@@ -22,6 +26,194 @@ public:
         m_BranchingFactor = branchingFactor;
     }
 
+    /**
+     * @return how many threads to compute the true costs of a vertex's children on (1 to do it on the planner thread)
+     */
+    int expansionThreads() const {
+        return m_ExpansionThreads;
+    }
+
+    void setExpansionThreads(int expansionThreads) {
+        m_ExpansionThreads = expansionThreads;
+    }
+
+    /**
+     * @return the pool to compute true costs on when there's more than one expansion thread, or null for the planner
+     * to keep one of its own with expansionThreads() threads. Copies of the config share it, so one pool can serve
+     * every vessel in a fleet, in which case it's the pool's size that counts.
+     */
+    const std::shared_ptr<ThreadPool>& expansionPool() const {
+        return m_ExpansionPool;
+    }
+
+    void setExpansionPool(std::shared_ptr<ThreadPool> expansionPool) {
+        m_ExpansionPool = std::move(expansionPool);
+    }
+
+    /**
+     * @return how many threads ParallelAStarPlanner searches with
+     */
+    int searchThreads() const {
+        return m_SearchThreads;
+    }
+
+    void setSearchThreads(int searchThreads) {
+        m_SearchThreads = searchThreads;
+    }
+
+    /**
+     * @return how many searches PortfolioPlanner runs at once
+     */
+    int portfolioSize() const {
+        return m_PortfolioSize;
+    }
+
+    void setPortfolioSize(int portfolioSize) {
+        m_PortfolioSize = portfolioSize;
+    }
+
+    /**
+     * @return whether AStarPlanner keeps the edges it has made between iterations of a plan() call, so adding samples
+     * only costs the edges to the new ones
+     */
+    bool incrementalSearch() const {
+        return m_IncrementalSearch;
+    }
+
+    void setIncrementalSearch(bool incrementalSearch) {
+        m_IncrementalSearch = incrementalSearch;
+    }
+
+    /**
+     * @return how AStarPlanner draws its samples
+     */
+    StateGenerator::Strategy samplingStrategy() const {
+        return m_SamplingStrategy;
+    }
+
+    void setSamplingStrategy(StateGenerator::Strategy samplingStrategy) {
+        m_SamplingStrategy = samplingStrategy;
+    }
+
+    /**
+     * @return whether the search drops vertices which reach the same sample, with the same ribbons left, around the
+     * same time as a cheaper one
+     */
+    bool duplicateDetection() const {
+        return m_DuplicateDetection;
+    }
+
+    void setDuplicateDetection(bool duplicateDetection) {
+        m_DuplicateDetection = duplicateDetection;
+    }
+
+    /**
+     * @return what AStarPlanner starts off inflating the heuristic by (weighted A*). Each iteration that finishes
+     * brings it closer to 1, so early plans come fast and later ones get better (like ARA*). 1 is plain A*.
+     */
+    double heuristicWeight() const {
+        return m_HeuristicWeight;
+    }
+
+    void setHeuristicWeight(double heuristicWeight) {
+        m_HeuristicWeight = heuristicWeight;
+    }
+
+    /**
+     * @return seconds into plan() after which AStarPlanner stops unless the iteration it just finished still made the
+     * plan noticeably cheaper (see extensionImprovement()). Infinity to always use all the time it's given
+     */
+    double softTimeLimit() const {
+        return m_SoftTimeLimit;
+    }
+
+    void setSoftTimeLimit(double softTimeLimit) {
+        m_SoftTimeLimit = softTimeLimit;
+    }
+
+    /**
+     * @return how much cheaper, as a fraction of its cost, the plan has to have got over the last iteration for
+     * AStarPlanner to keep going past the soft time limit
+     */
+    double extensionImprovement() const {
+        return m_ExtensionImprovement;
+    }
+
+    void setExtensionImprovement(double extensionImprovement) {
+        m_ExtensionImprovement = extensionImprovement;
+    }
+
+    /**
+     * @return what plan()'s time remaining is measured in (see Budget). The clock by default; Work makes planning
+     * repeatable for benchmarks and tests
+     */
+    Budget::Mode budgetMode() const {
+        return m_BudgetMode;
+    }
+
+    void setBudgetMode(Budget::Mode budgetMode) {
+        m_BudgetMode = budgetMode;
+    }
+
+    /**
+     * @return with a work budget, how many edge evaluations and expansions a second of planning time buys
+     */
+    double workPerSecond() const {
+        return m_WorkPerSecond;
+    }
+
+    void setWorkPerSecond(double workPerSecond) {
+        m_WorkPerSecond = workPerSecond;
+    }
+
+    /**
+     * @return with a clock budget, how many times the search checks it between reads of the clock. The executive reads
+     * ROS time through a std::function, so it only looks every few pops
+     */
+    int clockCheckInterval() const {
+        return m_ClockCheckInterval;
+    }
+
+    void setClockCheckInterval(int clockCheckInterval) {
+        m_ClockCheckInterval = clockCheckInterval;
+    }
+
+    /**
+     * @return whether an expansion's children are collision checked all together as one EdgeBatch, instead of one
+     * edge at a time (in ParallelAStarPlanner, each thread batches the expansions it does)
+     */
+    bool batchedTrueCosts() const {
+        return m_BatchedTrueCosts;
+    }
+
+    void setBatchedTrueCosts(bool batchedTrueCosts) {
+        m_BatchedTrueCosts = batchedTrueCosts;
+    }
+
+    /**
+     * @return whether AStarPlanner searches a state lattice of motion primitives (see MotionPrimitives) instead of
+     * random samples
+     */
+    bool latticeSearch() const {
+        return m_LatticeSearch;
+    }
+
+    void setLatticeSearch(bool latticeSearch) {
+        m_LatticeSearch = latticeSearch;
+    }
+
+    /**
+     * @return how many edges AStarPlanner keeps the Dubins paths and map results of during a plan() call (see
+     * EdgeGeometryCache), 0 to not keep any
+     */
+    size_t geometryCacheCapacity() const {
+        return m_GeometryCacheCapacity;
+    }
+
+    void setGeometryCacheCapacity(size_t geometryCacheCapacity) {
+        m_GeometryCacheCapacity = geometryCacheCapacity;
+    }
+
     double maxSpeed() const {
         return m_MaxSpeed;
     }
@@ -62,6 +254,18 @@ public:
         m_Visualizations = visualizations;
     }
 
+    /**
+     * @return whether visualizations are on in the text format, which only one thread can write at a time
+     */
+    bool visualizationsSingleThreaded() const {
+        return m_Visualizations && (*m_Visualizer)->format() == Visualizer::Text;
+    }
+
+    Visualizer& visualizer() const {
+        assert(m_Visualizations && "Visualizer accessed when visualizations are disabled");
+        return **m_Visualizer;
+    }
+
     std::ostream& visualizationStream() const {
         assert(m_Visualizations && "Visualization stream accessed when visualizations are disabled");
 //        assert(m_VisualizationStream && *m_VisualizationStream && "Visualization stream accessed but does not exist");
@@ -85,11 +289,19 @@ public:
     }
 
     const DynamicObstaclesManager& obstacles() const {
-        return m_Obstacles;
+        return *m_Obstacles;
     }
 
     void setObstacles(const DynamicObstaclesManager& obstacles) {
-        m_Obstacles = obstacles;
+        m_Obstacles = std::make_shared<const DynamicObstaclesManager>(obstacles);
+    }
+
+    /**
+     * Use obstacles nobody's going to change. Copies of the config share them, index and all, instead of copying.
+     * @param obstacles
+     */
+    void setObstacles(std::shared_ptr<const DynamicObstaclesManager> obstacles) {
+        m_Obstacles = std::move(obstacles);
     }
 
     std::ostream* output() const {
@@ -116,12 +328,29 @@ public:
 
 private:
     int m_BranchingFactor = 9;
+    int m_ExpansionThreads = 1;
+    std::shared_ptr<ThreadPool> m_ExpansionPool;
+    int m_SearchThreads = 1;
+    int m_PortfolioSize = 1;
+    bool m_IncrementalSearch = true;
+    bool m_DuplicateDetection = true;
+    double m_HeuristicWeight = 1;
+    double m_SoftTimeLimit = INFINITY, m_ExtensionImprovement = 0.01;
+    Budget::Mode m_BudgetMode = Budget::Clock;
+    // roughly what one search thread gets through on benchmark_planner's simpler scenarios in a release build
+    double m_WorkPerSecond = 20000;
+    // every check, so a stepped clock (as in the tests) moves on with every pop like it always has
+    int m_ClockCheckInterval = 1;
+    bool m_BatchedTrueCosts = false;
+    bool m_LatticeSearch = false;
+    size_t m_GeometryCacheCapacity = 1 << 16;
+    StateGenerator::Strategy m_SamplingStrategy = StateGenerator::Informed;
     double m_MaxSpeed = 2.5, m_TurningRadius = 8, m_CoverageTurningRadius = 16;
     bool m_Visualizations = false;
     Visualizer::UniquePtr* m_Visualizer;
     std::ostream** m_VisualizationStream = nullptr; // pointer to a pointer so we can change streams across copies
     Map::SharedPtr m_Map;
-    DynamicObstaclesManager m_Obstacles;
+    std::shared_ptr<const DynamicObstaclesManager> m_Obstacles = std::make_shared<const DynamicObstaclesManager>();
     std::ostream* m_Output;
     std::function<double()> m_NowFunction;
     double m_StartStateTime;
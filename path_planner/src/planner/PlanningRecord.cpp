@@ -0,0 +1,255 @@
+#include "PlanningRecord.h"
+#include <fstream>
+#include <stdexcept>
+
+constexpr uint32_t PlanningRecord::c_Version;
+
+namespace {
+
+template <class T>
+void put(std::ostream& stream, const T& value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+T get(std::istream& stream) {
+    T value;
+    if (!stream.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Planning record ended early");
+    }
+    return value;
+}
+
+void putString(std::ostream& stream, const std::string& s) {
+    put<uint32_t>(stream, s.size());
+    stream.write(s.data(), s.size());
+}
+
+std::string getString(std::istream& stream) {
+    std::string s(get<uint32_t>(stream), '\0');
+    if (!stream.read(&s[0], s.size())) throw std::runtime_error("Planning record ended early");
+    return s;
+}
+
+void putState(std::ostream& stream, const State& s) {
+    put(stream, s.x()); put(stream, s.y()); put(stream, s.heading()); put(stream, s.speed()); put(stream, s.time());
+}
+
+State getState(std::istream& stream) {
+    State s;
+    s.x() = get<double>(stream);
+    s.y() = get<double>(stream);
+    s.heading() = get<double>(stream);
+    s.speed() = get<double>(stream);
+    s.time() = get<double>(stream);
+    return s;
+}
+
+void putStates(std::ostream& stream, const std::vector<State>& states) {
+    put<uint32_t>(stream, states.size());
+    for (const auto& s : states) putState(stream, s);
+}
+
+std::vector<State> getStates(std::istream& stream) {
+    std::vector<State> states(get<uint32_t>(stream));
+    for (auto& s : states) s = getState(stream);
+    return states;
+}
+
+void putObstacles(std::ostream& stream, const DynamicObstaclesManager& obstacles) {
+    put<uint32_t>(stream, obstacles.ignored().size());
+    for (auto mmsi : obstacles.ignored()) put(stream, mmsi);
+    uint32_t count = 0;
+    obstacles.forEachObstacle([&] (uint32_t, const DynamicObstacle&) { count++; });
+    put(stream, count);
+    obstacles.forEachObstacle([&] (uint32_t mmsi, const DynamicObstacle& obstacle) {
+        put(stream, mmsi);
+        put(stream, obstacle.length());
+        put(stream, obstacle.width());
+        put<uint32_t>(stream, obstacle.distributions().size());
+        for (const auto& d : obstacle.distributions()) {
+            double xx, xy, yy;
+            d.covariance(xx, xy, yy);
+            put(stream, d.mean()[0]); put(stream, d.mean()[1]);
+            put(stream, xx); put(stream, xy); put(stream, yy);
+            put(stream, d.heading()); put(stream, d.time());
+        }
+    });
+}
+
+DynamicObstaclesManager getObstacles(std::istream& stream) {
+    DynamicObstaclesManager obstacles;
+    std::vector<uint32_t> ignored(get<uint32_t>(stream));
+    for (auto& mmsi : ignored) mmsi = get<uint32_t>(stream);
+    auto count = get<uint32_t>(stream);
+    for (uint32_t i = 0; i < count; i++) {
+        auto mmsi = get<uint32_t>(stream);
+        auto length = get<double>(stream), width = get<double>(stream);
+        std::vector<Distribution> distributions;
+        auto distributionCount = get<uint32_t>(stream);
+        for (uint32_t j = 0; j < distributionCount; j++) {
+            double mean[2], covariance[2][2];
+            mean[0] = get<double>(stream); mean[1] = get<double>(stream);
+            covariance[0][0] = get<double>(stream);
+            covariance[0][1] = covariance[1][0] = get<double>(stream);
+            covariance[1][1] = get<double>(stream);
+            auto heading = get<double>(stream), time = get<double>(stream);
+            distributions.emplace_back(mean, covariance, heading, time);
+        }
+        obstacles.add(mmsi, distributions, width, length);
+    }
+    // after adding them, or they'd have been left out
+    for (auto mmsi : ignored) obstacles.addIgnore(mmsi);
+    return obstacles;
+}
+
+void putPlan(std::ostream& stream, const DubinsPlan& plan) {
+    put<uint32_t>(stream, plan.get().size());
+    for (const auto& d : plan.get()) {
+        const auto& path = d.unwrap();
+        for (auto q : path.qi) put(stream, q);
+        for (auto p : path.param) put(stream, p);
+        put(stream, path.rho);
+        put<int32_t>(stream, path.type);
+        put(stream, d.getSpeed());
+        put(stream, d.getOriginalStartTime());
+        put(stream, d.getStartTime());
+        put(stream, d.getEndTime());
+    }
+}
+
+DubinsPlan getPlan(std::istream& stream) {
+    DubinsPlan plan;
+    auto count = get<uint32_t>(stream);
+    for (uint32_t i = 0; i < count; i++) {
+        DubinsPath path{};
+        for (auto& q : path.qi) q = get<double>(stream);
+        for (auto& p : path.param) p = get<double>(stream);
+        path.rho = get<double>(stream);
+        path.type = (DubinsPathType)get<int32_t>(stream);
+        auto speed = get<double>(stream), originalStartTime = get<double>(stream), startTime = get<double>(stream),
+            endTime = get<double>(stream);
+        DubinsWrapper wrapper;
+        wrapper.fill(path, speed, originalStartTime);
+        wrapper.updateEndTime(endTime);
+        wrapper.updateStartTime(startTime);
+        plan.append(wrapper);
+    }
+    return plan;
+}
+
+}
+
+PlanningRecord::PlanningRecord(PlannerConfig config) : Config(std::move(config)), RibbonWidth(Ribbon::RibbonWidth) {}
+
+void PlanningRecord::write(std::ostream& stream) const {
+    // ribbons, as what's left of them
+    put<int32_t>(stream, Ribbons.heuristic());
+    put(stream, Ribbons.turningRadius());
+    put<int32_t>(stream, Ribbons.k());
+    put<int32_t>(stream, Ribbons.coverageModel());
+    put(stream, RibbonWidth);
+    auto ribbons = Ribbons.get();
+    put<uint32_t>(stream, ribbons.size());
+    for (const auto& r : ribbons) {
+        put(stream, r.start().first); put(stream, r.start().second);
+        put(stream, r.end().first); put(stream, r.end().second);
+    }
+    putState(stream, Start);
+    // the config
+    put<int32_t>(stream, Config.branchingFactor());
+    put<int32_t>(stream, Config.expansionThreads());
+    put<int32_t>(stream, Config.searchThreads());
+    put<int32_t>(stream, Config.portfolioSize());
+    put<uint8_t>(stream, Config.incrementalSearch());
+    put<uint8_t>(stream, Config.duplicateDetection());
+    put(stream, Config.heuristicWeight());
+    put<int32_t>(stream, Config.samplingStrategy());
+    put(stream, Config.softTimeLimit());
+    put(stream, Config.extensionImprovement());
+    put<int32_t>(stream, Config.budgetMode());
+    put(stream, Config.workPerSecond());
+    put<int32_t>(stream, Config.clockCheckInterval());
+    put<uint8_t>(stream, Config.batchedTrueCosts());
+    put<uint8_t>(stream, Config.latticeSearch());
+    put<uint64_t>(stream, Config.geometryCacheCapacity());
+    put(stream, Config.maxSpeed());
+    put(stream, Config.turningRadius());
+    put(stream, Config.coverageTurningRadius());
+    putObstacles(stream, Config.obstacles());
+    putPlan(stream, PreviousPlan);
+    putStates(stream, WarmStart);
+    put(stream, TimeRemaining);
+    putString(stream, MapPath);
+    put(stream, MapLatitude);
+    put(stream, MapLongitude);
+}
+
+PlanningRecord PlanningRecord::read(std::istream& stream, std::ostream* output) {
+    PlanningRecord record((PlannerConfig(output)));
+    auto heuristic = (RibbonManager::Heuristic)get<int32_t>(stream);
+    auto turningRadius = get<double>(stream);
+    auto k = get<int32_t>(stream);
+    record.RibbonWidth = get<double>(stream);
+    record.Ribbons = RibbonManager(heuristic, turningRadius, k);
+    record.Ribbons.setCoverageModel((RibbonManager::CoverageModel)get<int32_t>(stream));
+    auto ribbonCount = get<uint32_t>(stream);
+    for (uint32_t i = 0; i < ribbonCount; i++) {
+        auto x1 = get<double>(stream), y1 = get<double>(stream), x2 = get<double>(stream), y2 = get<double>(stream);
+        record.Ribbons.add(x1, y1, x2, y2);
+    }
+    record.Start = getState(stream);
+    auto& config = record.Config;
+    config.setBranchingFactor(get<int32_t>(stream));
+    config.setExpansionThreads(get<int32_t>(stream));
+    config.setSearchThreads(get<int32_t>(stream));
+    config.setPortfolioSize(get<int32_t>(stream));
+    config.setIncrementalSearch(get<uint8_t>(stream) != 0);
+    config.setDuplicateDetection(get<uint8_t>(stream) != 0);
+    config.setHeuristicWeight(get<double>(stream));
+    config.setSamplingStrategy((StateGenerator::Strategy)get<int32_t>(stream));
+    config.setSoftTimeLimit(get<double>(stream));
+    config.setExtensionImprovement(get<double>(stream));
+    config.setBudgetMode((Budget::Mode)get<int32_t>(stream));
+    config.setWorkPerSecond(get<double>(stream));
+    config.setClockCheckInterval(get<int32_t>(stream));
+    config.setBatchedTrueCosts(get<uint8_t>(stream) != 0);
+    config.setLatticeSearch(get<uint8_t>(stream) != 0);
+    config.setGeometryCacheCapacity(get<uint64_t>(stream));
+    config.setMaxSpeed(get<double>(stream));
+    config.setTurningRadius(get<double>(stream));
+    config.setCoverageTurningRadius(get<double>(stream));
+    config.setObstacles(std::make_shared<const DynamicObstaclesManager>(getObstacles(stream)));
+    record.PreviousPlan = getPlan(stream);
+    record.WarmStart = getStates(stream);
+    record.TimeRemaining = get<double>(stream);
+    record.MapPath = getString(stream);
+    record.MapLatitude = get<double>(stream);
+    record.MapLongitude = get<double>(stream);
+    return record;
+}
+
+void PlanningRecord::save(const std::string& path, const std::vector<PlanningRecord>& records) {
+    std::ofstream stream(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!stream) throw std::runtime_error("Could not open " + path + " to save planning records");
+    stream.write("PPRC", 4);
+    put(stream, c_Version);
+    put<uint32_t>(stream, records.size());
+    for (const auto& r : records) r.write(stream);
+    if (!stream) throw std::runtime_error("Could not write planning records to " + path);
+}
+
+std::vector<PlanningRecord> PlanningRecord::load(const std::string& path, std::ostream* output) {
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    if (!stream) throw std::runtime_error("Could not open planning records at " + path);
+    char magic[4];
+    if (!stream.read(magic, 4) || std::string(magic, 4) != "PPRC") {
+        throw std::runtime_error(path + " isn't a planning record file");
+    }
+    if (get<uint32_t>(stream) != c_Version) throw std::runtime_error("Unsupported planning record version in " + path);
+    auto count = get<uint32_t>(stream);
+    std::vector<PlanningRecord> records;
+    records.reserve(count);
+    for (uint32_t i = 0; i < count; i++) records.push_back(read(stream, output));
+    return records;
+}
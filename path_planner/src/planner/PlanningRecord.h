@@ -0,0 +1,59 @@
+#ifndef SRC_PLANNINGRECORD_H
+#define SRC_PLANNINGRECORD_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <path_planner_common/DubinsPlan.h>
+#include "../common/map/Map.h"
+#include "../common/dynamic_obstacles/DynamicObstaclesManager.h"
+#include "PlannerConfig.h"
+#include "utilities/RibbonManager.h"
+
+/**
+ * Everything one planning cycle gave the planner, so the cycle can be planned again offline exactly as it was (given
+ * a clock that doesn't depend on how fast the machine is; see replay_planner). The executive keeps the last few of
+ * these when it's recording, and writes them out together as a mission.
+ *
+ * The map isn't saved, just the path it was loaded from (and its origin). Neither is the clock, the output or visualization, or the
+ * planner's seed (always the default).
+ *
+ * The file format is binary in native byte order: the four bytes "PPRC", a uint32 version, a uint32 record count, then
+ * the records. Reading anything else throws a runtime error.
+ */
+struct PlanningRecord {
+    explicit PlanningRecord(PlannerConfig config);
+
+    RibbonManager Ribbons;
+    State Start;
+    PlannerConfig Config; // including the obstacles
+    DubinsPlan PreviousPlan;
+    std::vector<State> WarmStart; // what the planner's warm start had in it
+    double TimeRemaining = 0;
+    double RibbonWidth;
+    std::string MapPath; // empty if there wasn't one
+    double MapLatitude = 0, MapLongitude = 0; // the map's origin
+
+    void write(std::ostream& stream) const;
+
+    /**
+     * @param stream
+     * @param output where the config's planner output goes
+     * @return
+     */
+    static PlanningRecord read(std::istream& stream, std::ostream* output);
+
+    /**
+     * Write a mission's worth of records.
+     * @param path
+     * @param records
+     */
+    static void save(const std::string& path, const std::vector<PlanningRecord>& records);
+
+    static std::vector<PlanningRecord> load(const std::string& path, std::ostream* output);
+
+    static constexpr uint32_t c_Version = 5;
+};
+
+
+#endif //SRC_PLANNINGRECORD_H
@@ -0,0 +1,89 @@
+#include <cfloat>
+#include <map>
+#include "PortfolioPlanner.h"
+
+DubinsPlan PortfolioPlanner::plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
+                                  const DubinsPlan& previousPlan, double timeRemaining) {
+    m_Config = std::move(config);
+    auto members = m_Members.empty() ?
+            defaultMembers(std::max(1, m_Config.portfolioSize()), m_Config.branchingFactor(), ribbonManager.heuristic())
+            : m_Members;
+    // members with the same heuristic can prune against each other
+    std::map<RibbonManager::Heuristic, SharedIncumbent::SharedPtr> incumbents;
+    for (const auto& m : members) {
+        if (!incumbents[m.Heuristic]) incumbents[m.Heuristic] = std::make_shared<SharedIncumbent>();
+    }
+
+    std::vector<std::unique_ptr<AStarPlanner>> planners;
+    std::vector<DubinsPlan> plans(members.size());
+    for (const auto& m : members) {
+        planners.emplace_back(new AStarPlanner);
+        planners.back()->setSeed(m.Seed);
+        planners.back()->setSharedIncumbent(incumbents[m.Heuristic]);
+    }
+    if (!m_Pool || m_Pool->size() != members.size()) m_Pool.reset(new ThreadPool(members.size()));
+    m_Pool->run(members.size(), [&](size_t i) {
+        auto config = m_Config;
+        config.setBranchingFactor(members[i].BranchingFactor);
+        // everyone else would write to the same stream at once (binary records can all go in together)
+        if (i > 0 && config.visualizationsSingleThreaded()) config.setVisualizations(false);
+        auto ribbons = ribbonManager;
+        ribbons.setHeuristic(members[i].Heuristic);
+        plans[i] = planners[i]->plan(ribbons, start, config, previousPlan, timeRemaining);
+    });
+
+    m_LastWinner = -1;
+    double bestCost = DBL_MAX;
+    for (size_t i = 0; i < members.size(); i++) {
+        const auto& v = planners[i]->bestVertex();
+        if (plans[i].empty() || !v) continue;
+        // judge everyone with the same heuristic
+        auto ribbons = v->ribbonManager();
+        ribbons.setHeuristic(ribbonManager.heuristic());
+        ribbons.changeHeuristicIfTooManyRibbons();
+        auto toGo = ribbons.approximateDistanceUntilDone(v->state().x(), v->state().y(), v->state().heading()) /
+                v->state().speed() * Edge::timePenaltyFactor();
+        auto cost = v->currentCost() + toGo;
+        if (cost < bestCost) {
+            bestCost = cost;
+            m_LastWinner = i;
+        }
+    }
+    if (m_LastWinner < 0) {
+        *m_Config.output() << "No plan from any of the " << members.size() << " portfolio planners" << std::endl;
+        return DubinsPlan();
+    }
+    const auto& winner = members[m_LastWinner];
+    *m_Config.output() << "Portfolio planner " << m_LastWinner << " (seed " << winner.Seed << ", k " <<
+        winner.BranchingFactor << ", heuristic " << winner.Heuristic << ") won with cost " << bestCost << std::endl;
+    return plans[m_LastWinner];
+}
+
+void PortfolioPlanner::setMembers(std::vector<PortfolioPlanner::Member> members) {
+    m_Members = std::move(members);
+}
+
+std::vector<PortfolioPlanner::Member> PortfolioPlanner::defaultMembers(int n, int branchingFactor,
+                                                                       RibbonManager::Heuristic heuristic) {
+    static const double branchingScales[] = {1, 0.5, 1.5, 2};
+    // the Dubins TSP heuristics are too slow to be worth running as extras
+    static const RibbonManager::Heuristic alternatives[] = {RibbonManager::MaxDistance,
+                                                            RibbonManager::TspPointRobotNoSplitKRibbons};
+    std::vector<Member> members;
+    for (int i = 0; i < n; i++) {
+        Member m{};
+        m.Seed = 7 + 7919 * i; // the first is the usual lucky seed
+        m.BranchingFactor = std::max(1, (int)std::lround(branchingFactor * branchingScales[i % 4]));
+        m.Heuristic = heuristic;
+        if (i % 2) {
+            m.Heuristic = alternatives[(i / 2) % 2];
+            if (m.Heuristic == heuristic) m.Heuristic = alternatives[(i / 2 + 1) % 2];
+        }
+        members.push_back(m);
+    }
+    return members;
+}
+
+int PortfolioPlanner::lastWinner() const {
+    return m_LastWinner;
+}
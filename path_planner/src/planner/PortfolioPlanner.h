@@ -0,0 +1,60 @@
+#ifndef SRC_PORTFOLIOPLANNER_H
+#define SRC_PORTFOLIOPLANNER_H
+
+#include "AStarPlanner.h"
+
+/**
+ * Runs several AStarPlanners at once, one per thread, each with its own seed, branching factor and heuristic, and
+ * returns the best of their plans when the time's up. How well a single search does varies a lot with all three, so
+ * this turns spare cores into more consistent plans in the same planning window.
+ *
+ * Members with the same heuristic share their incumbent cost for pruning. Their f values are only comparable with each
+ * other, so plans are compared on their cost so far plus the configured heuristic at the end of the plan.
+ */
+class PortfolioPlanner : public Planner {
+public:
+    /**
+     * One search in the portfolio.
+     */
+    struct Member {
+        unsigned long Seed;
+        int BranchingFactor;
+        RibbonManager::Heuristic Heuristic;
+    };
+
+    PortfolioPlanner() = default;
+
+    ~PortfolioPlanner() override = default;
+
+    DubinsPlan plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
+                    const DubinsPlan& previousPlan, double timeRemaining) override;
+
+    /**
+     * Use these searches instead of the default ones (see defaultMembers()).
+     * @param members
+     */
+    void setMembers(std::vector<Member> members);
+
+    /**
+     * The default portfolio: the usual planner, then other seeds with the branching factor scaled up and down, and
+     * alternating with the cheaper heuristics.
+     * @param n how many
+     * @param branchingFactor
+     * @param heuristic
+     * @return
+     */
+    static std::vector<Member> defaultMembers(int n, int branchingFactor, RibbonManager::Heuristic heuristic);
+
+    /**
+     * @return which member's plan was returned last time (-1 if none)
+     */
+    int lastWinner() const;
+
+private:
+    std::vector<Member> m_Members;
+    int m_LastWinner = -1;
+    std::unique_ptr<ThreadPool> m_Pool;
+};
+
+
+#endif //SRC_PORTFOLIOPLANNER_H
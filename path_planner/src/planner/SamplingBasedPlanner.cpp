@@ -1,41 +1,47 @@
 #include "SamplingBasedPlanner.h"
+#include "utilities/DubinsTable.h"
+#include "utilities/Instrumentation.h"
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <utility>
 
 SamplingBasedPlanner::SamplingBasedPlanner() {}
 
+constexpr double SamplingBasedPlanner::c_DominanceTimeBucket;
+constexpr double SamplingBasedPlanner::c_LatticeSpacing;
+
 void SamplingBasedPlanner::pushVertexQueue(Vertex::SharedPtr vertex) {
+    Instrumentation::ScopedTimer timer(Instrumentation::PushTime);
+    Instrumentation::count(Instrumentation::Offers);
     if (!vertex->isRoot() && vertex->parentEdge()->infeasible()) return;
     vertex->approxToGo(); // make sure it is calculated
     // prune vertices worse than the incumbent solution
     if (m_BestVertex && m_BestVertex->f() < vertex->f()) return; // assumes heuristic is admissible
+    if (m_SharedIncumbent && m_SharedIncumbent->cost() < vertex->f()) return;
     // make sure this isn't a goal with equal f to the incumbent
     if (m_BestVertex && m_BestVertex->f() == vertex->f() && goalCondition(vertex)) return;
-    m_VertexQueue.push_back(vertex);
-    std::push_heap(m_VertexQueue.begin(), m_VertexQueue.end(), getVertexComparator());
+    // drop it if something's been to the same state cheaper
+    if (m_Config.duplicateDetection() && !vertex->isRoot() &&
+        !m_Dominance.offer(dominanceKey(*vertex), vertex->currentCost())) {
+        m_DuplicatesPruned++;
+        return;
+    }
+    m_VertexQueue.push(vertex, openListKey(vertex));
+    Instrumentation::count(Instrumentation::Pushes);
 //    std::cerr << "Pushing to vertex queue: " << vertex->toString() << std::endl;
-    visualizeVertex(vertex, "vertex");
+    visualizeVertex(vertex, Visualizer::VertexTag);
 }
 
 std::shared_ptr<Vertex> SamplingBasedPlanner::popVertexQueue() {
     if (m_VertexQueue.empty()) throw std::out_of_range("Trying to pop an empty vertex queue");
-    std::pop_heap(m_VertexQueue.begin(), m_VertexQueue.end(), getVertexComparator());
-    auto ret = m_VertexQueue.back();
-    m_VertexQueue.pop_back();
-    return ret;
-}
-
-std::function<bool(std::shared_ptr<Vertex> v1,
-                   std::shared_ptr<Vertex> v2)> SamplingBasedPlanner::getVertexComparator() {
-    return [](const std::shared_ptr<Vertex>& v1, const std::shared_ptr<Vertex>& v2){
-        return v1->getDepth() < v2->getDepth();
-    };
+    Instrumentation::ScopedTimer timer(Instrumentation::PopTime);
+    Instrumentation::count(Instrumentation::Pops);
+    return m_VertexQueue.pop();
 }
 
-std::function<bool(const State& s1, const State& s2)> SamplingBasedPlanner::getStateComparator(const State& origin) {
-    return [&](const State& s1, const State& s2) {
-        return s1.distanceTo(origin) > s2.distanceTo(origin);
-    };
+double SamplingBasedPlanner::openListKey(const Vertex::SharedPtr& vertex) {
+    return -vertex->getDepth();
 }
 
 bool SamplingBasedPlanner::goalCondition(const std::shared_ptr<Vertex>& vertex) {
@@ -44,96 +50,242 @@ bool SamplingBasedPlanner::goalCondition(const std::shared_ptr<Vertex>& vertex)
 }
 
 void SamplingBasedPlanner::expand(const std::shared_ptr<Vertex>& sourceVertex, const DynamicObstaclesManager& obstacles) {
-    
 //    std::cerr << "Expanding vertex " << sourceVertex->toString() << std::endl;
+    // children in the order they go onto the open list
+    std::vector<Vertex::SharedPtr> children;
+    selectChildren(sourceVertex, children);
+    computeTrueCostsAndPush(children);
+    m_ExpandedCount++;
+    m_Budget.addWork();
+    Instrumentation::count(Instrumentation::Expansions);
+}
+
+void SamplingBasedPlanner::selectChildren(const Vertex::SharedPtr& sourceVertex,
+                                          std::vector<Vertex::SharedPtr>& children) const {
+    Instrumentation::ScopedTimer timer(Instrumentation::NearestTime);
     // add nearest point to cover
     if (!sourceVertex->done()) {
         auto s = sourceVertex->getNearestPointAsState();
         if (sourceVertex->state().distanceTo(s) > Edge::collisionCheckingIncrement()) {
             s.speed() = m_Config.maxSpeed();
             // TODO! -- what heading for points?
-            auto destinationVertex = Vertex::connect(sourceVertex, s, m_Config.turningRadius(), false);
-            destinationVertex->parentEdge()->computeTrueCost(m_Config);
-            pushVertexQueue(destinationVertex);
+            children.push_back(connect(sourceVertex, s, m_Config.turningRadius(), false));
             // add again for coverage (may not be necessary, as we're unlikely to be covering stuff on the way to the nearest endpoint)
-            destinationVertex = Vertex::connect(sourceVertex, s, m_Config.coverageTurningRadius(), true);
-            destinationVertex->parentEdge()->computeTrueCost(m_Config);
-            pushVertexQueue(destinationVertex);
+            children.push_back(connect(sourceVertex, s, m_Config.coverageTurningRadius(), true));
         }
     }
-    auto comp = getStateComparator(sourceVertex->state());
-    auto dubinsComp = getDubinsComparator(sourceVertex->state());
-    // heapify first by Euclidean distance
-    std::make_heap(m_Samples.begin(), m_Samples.end(), comp);
-    // Use another heap to sort by Dubins distance, skipping the samples which are farther away this time.
-    // Making all the vertices adds some allocation overhead but it lets us cache the dubins paths
-    std::vector<std::shared_ptr<Vertex>> bestSamples, bestCoverageSamples;
+    if (m_Config.latticeSearch()) {
+        selectLatticeChildren(sourceVertex, children);
+        return;
+    }
+    const auto& origin = sourceVertex->state();
+    // how many of each to keep, as a size to compare the heaps to
+    auto branching = (size_t)std::max(0, k());
+    // walk the samples by Euclidean distance
+    SampleGrid::Nearest nearest(m_Samples, origin.x(), origin.y());
+    // Use a (max) heap of approximate costs and sample indices to sort by Dubins distance, skipping the samples which
+    // are farther away this time. The lengths come from the lookup table, so only the vertices that make it get made.
+    typedef std::pair<double, size_t> Candidate;
+    std::vector<Candidate> bestSamples, bestCoverageSamples;
+    auto approxCost = [&] (const State& sample, double turningRadius) {
+        return DubinsTable::length(origin.x(), origin.y(), origin.yaw(), sample.x(), sample.y(), sample.yaw(),
+                                   turningRadius) / sample.speed() * Edge::timePenaltyFactor();
+    };
+    auto offer = [&] (std::vector<Candidate>& best, const State& sample, size_t index, double turningRadius) {
+        // throw out the ones that can't make it before looking anything up
+        if (best.size() >= branching &&
+            DubinsTable::lowerBound(origin.x(), origin.y(), origin.yaw(), sample.x(), sample.y(), sample.yaw(),
+                                    turningRadius) / sample.speed() * Edge::timePenaltyFactor() >= best.front().first) {
+            return;
+        }
+        best.emplace_back(approxCost(sample, turningRadius), index);
+        std::push_heap(best.begin(), best.end());
+        if (best.size() > branching) {
+            std::pop_heap(best.begin(), best.end());
+            best.pop_back();
+        }
+    };
     bool regularDone = false, coverageDone = false;
     if (m_Config.coverageTurningRadius() <= 0) coverageDone = true;
-    for (uint64_t i = 0; i < m_Samples.size() && (!regularDone || !coverageDone); i++) {
-        auto sample = m_Samples.front();
-        std::pop_heap(m_Samples.begin(), m_Samples.end() - i, comp);
-        if (!regularDone && (bestSamples.size() < k() ||
-            bestSamples.front()->parentEdge()->approxCost() > sample.distanceTo(sourceVertex->state()))) {
-            if (sourceVertex->state().distanceTo(sample) > Edge::collisionCheckingIncrement()) {
-                // don't force speed to be anything in particular, allowing samples to come with unique speeds
-                bestSamples.push_back(Vertex::connect(sourceVertex, sample, m_Config.turningRadius(), false));
-                bestSamples.back()->parentEdge()->computeApproxCost();
-                std::push_heap(bestSamples.begin(), bestSamples.end(), dubinsComp);
-                if (bestSamples.size() > k()) {
-                    std::pop_heap(bestSamples.begin(), bestSamples.end(), dubinsComp);
-                    bestSamples.pop_back();
-                }
-            }
+    size_t index;
+    double distance;
+    uint64_t candidates = 0;
+    while ((!regularDone || !coverageDone) && nearest.next(index, distance)) {
+        candidates++;
+        const auto& sample = m_Samples[index];
+        if (!regularDone && (bestSamples.size() < branching || bestSamples.front().first > distance)) {
+            // don't force speed to be anything in particular, allowing samples to come with unique speeds
+            if (distance > Edge::collisionCheckingIncrement()) offer(bestSamples, sample, index, m_Config.turningRadius());
         } else {
             regularDone = true;
         }
-        if (!coverageDone && (bestCoverageSamples.size() < k() ||
-            bestCoverageSamples.front()->parentEdge()->approxCost() > sample.distanceTo(sourceVertex->state()))) {
-            if (sourceVertex->state().distanceTo(sample) > Edge::collisionCheckingIncrement()) {
-                bestCoverageSamples.push_back(Vertex::connect(sourceVertex, sample, m_Config.coverageTurningRadius(), true));
-                bestCoverageSamples.back()->parentEdge()->computeApproxCost();
-                std::push_heap(bestCoverageSamples.begin(), bestCoverageSamples.end(), dubinsComp);
-                if (bestCoverageSamples.size() > k()) {
-                    std::pop_heap(bestCoverageSamples.begin(), bestCoverageSamples.end(), dubinsComp);
-                    bestCoverageSamples.pop_back();
-                }
+        if (!coverageDone && (bestCoverageSamples.size() < branching || bestCoverageSamples.front().first > distance)) {
+            if (distance > Edge::collisionCheckingIncrement()) {
+                offer(bestCoverageSamples, sample, index, m_Config.coverageTurningRadius());
             }
         } else {
             coverageDone = true;
         }
     }
-    // Push the closest K onto the open list
-    for (int i = 0; i < k(); i++) {
-        if (i >= bestSamples.size()) break;
-        auto destinationVertex = bestSamples.front();
-        std::pop_heap(bestSamples.begin(), bestSamples.end() - i, dubinsComp);
-        destinationVertex->parentEdge()->computeTrueCost(m_Config);
-        pushVertexQueue(destinationVertex);
-    }
+    Instrumentation::count(Instrumentation::NearestCandidates, candidates);
+    // Push the closest K onto the open list (farthest first, as they come off the heap)
+    auto take = [&] (std::vector<Candidate>& best, double turningRadius, bool coverageAllowed) {
+        std::sort_heap(best.begin(), best.end());
+        for (auto it = best.rbegin(); it != best.rend(); ++it) {
+            children.push_back(connect(sourceVertex, m_Samples[it->second], turningRadius, coverageAllowed));
+            // edges kept from earlier (incremental search) already have theirs, and recomputing it would undo the
+            // truncation done by computeTrueCost
+            if (!children.back()->parentEdge()->hasTrueCost()) children.back()->parentEdge()->computeApproxCost();
+        }
+    };
+    take(bestSamples, m_Config.turningRadius(), false);
     // and again for coverage edges
-    for (int i = 0; i < k(); i++) {
-        if (i >= bestCoverageSamples.size()) break;
-        auto destinationVertex = bestCoverageSamples.front();
-        std::pop_heap(bestCoverageSamples.begin(), bestCoverageSamples.end() - i, dubinsComp);
-        destinationVertex->parentEdge()->computeTrueCost(m_Config);
-        pushVertexQueue(destinationVertex);
+    take(bestCoverageSamples, m_Config.coverageTurningRadius(), true);
+}
+
+void SamplingBasedPlanner::selectLatticeChildren(const Vertex::SharedPtr& sourceVertex,
+                                                 std::vector<Vertex::SharedPtr>& children) const {
+    const auto& origin = sourceVertex->state();
+    auto speed = m_Config.maxSpeed();
+    auto take = [&] (const MotionPrimitives::SharedPtr& primitives, bool coverageAllowed) {
+        if (!primitives) return;
+        long ix, iy;
+        int heading;
+        if (origin.speed() == speed && primitives->locate(m_LatticeX, m_LatticeY, origin, ix, iy, heading)) {
+            for (const auto& p : primitives->from(heading)) {
+                auto s = primitives->node(m_LatticeX, m_LatticeY, ix + p.DX, iy + p.DY, p.EndHeading, speed);
+                children.push_back(connect(sourceVertex, s, primitives->turningRadius(), coverageAllowed, &p));
+            }
+        } else {
+            // off the lattice (the root, say), so go to where the nearest lattice state's primitives would
+            primitives->nearest(m_LatticeX, m_LatticeY, origin, ix, iy, heading);
+            for (const auto& p : primitives->from(heading)) {
+                auto s = primitives->node(m_LatticeX, m_LatticeY, ix + p.DX, iy + p.DY, p.EndHeading, speed);
+                if (origin.distanceTo(s) <= Edge::collisionCheckingIncrement()) continue;
+                children.push_back(connect(sourceVertex, s, primitives->turningRadius(), coverageAllowed));
+                if (!children.back()->parentEdge()->hasTrueCost()) children.back()->parentEdge()->computeApproxCost();
+            }
+        }
+    };
+    take(m_Primitives, false);
+    take(m_CoveragePrimitives, true);
+}
+
+void SamplingBasedPlanner::prepareLattice(const State& start) {
+    if (!m_Config.latticeSearch()) return;
+    auto spacing = m_Config.turningRadius() * c_LatticeSpacing;
+    auto make = [&] (MotionPrimitives::SharedPtr& primitives, double turningRadius) {
+        if (turningRadius <= 0) {
+            primitives = nullptr;
+        } else if (!primitives || primitives->spacing() != spacing || primitives->turningRadius() != turningRadius) {
+            primitives = std::make_shared<const MotionPrimitives>(spacing, turningRadius,
+                                                                  Edge::collisionCheckingIncrement());
+        }
+    };
+    make(m_Primitives, m_Config.turningRadius());
+    make(m_CoveragePrimitives, m_Config.coverageTurningRadius());
+    m_LatticeX = start.x();
+    m_LatticeY = start.y();
+}
+
+void SamplingBasedPlanner::computeTrueCostsAndPush(const std::vector<Vertex::SharedPtr>& vertices) {
+    uint64_t evaluations = 0;
+    for (const auto& v : vertices) if (!v->parentEdge()->hasTrueCost()) evaluations++;
+    m_Budget.addWork(evaluations);
+    auto threads = m_Config.visualizationsSingleThreaded() ? 1 : std::max(1, m_Config.expansionThreads());
+    if (m_Config.batchedTrueCosts()) {
+        // all of the collision checking in one go, then everything else an edge at a time
+        m_EdgeBatch.clear();
+        std::vector<size_t> indices(vertices.size(), SIZE_MAX);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            auto& edge = *vertices[i]->parentEdge();
+            if (!edge.hasTrueCost()) indices[i] = edge.addToBatch(m_Config, m_EdgeBatch);
+        }
+        m_EdgeBatch.evaluate(*m_Config.map(), m_Config.obstacles(), Edge::collisionCheckingIncrement());
+        auto finish = [&] (size_t i) {
+            if (indices[i] != SIZE_MAX) vertices[i]->parentEdge()->computeTrueCost(m_Config, m_EdgeBatch, indices[i]);
+        };
+        if (threads > 1 && vertices.size() > 1) {
+            for (const auto& v : vertices) v->parent()->approxToGo();
+            expansionPool(threads).run(vertices.size(), finish);
+        } else {
+            for (size_t i = 0; i < vertices.size(); i++) finish(i);
+        }
+    } else if (threads > 1 && vertices.size() > 1) {
+        // the parents' heuristics are computed on first use, so get that done before several threads ask at once
+        for (const auto& v : vertices) v->parent()->approxToGo();
+        expansionPool(threads).run(vertices.size(), [&](size_t i) {
+            if (!vertices[i]->parentEdge()->hasTrueCost()) vertices[i]->parentEdge()->computeTrueCost(m_Config);
+        });
+    } else {
+        for (const auto& v : vertices) {
+            if (!v->parentEdge()->hasTrueCost()) v->parentEdge()->computeTrueCost(m_Config);
+        }
     }
-    m_ExpandedCount++;
+    for (const auto& v : vertices) pushVertexQueue(v);
+}
+
+ThreadPool& SamplingBasedPlanner::expansionPool(int threads) {
+    if (m_Config.expansionPool()) return *m_Config.expansionPool();
+    if (!m_ThreadPool || m_ThreadPool->size() != (unsigned)threads) m_ThreadPool.reset(new ThreadPool(threads));
+    return *m_ThreadPool;
+}
+
+Vertex::SharedPtr SamplingBasedPlanner::connect(const Vertex::SharedPtr& source, const State& state,
+                                                double turningRadius, bool coverageAllowed,
+                                                const MotionPrimitives::Primitive* primitive) const {
+    auto make = [&] {
+        auto v = Vertex::connect(source, state, turningRadius, coverageAllowed);
+        if (primitive) v->parentEdge()->setPrimitive(*primitive);
+        return v;
+    };
+    if (!m_Config.incrementalSearch()) return make();
+    EdgeKey key{source.get(), state.x(), state.y(), state.yaw(), state.speed(), turningRadius, coverageAllowed};
+    {
+        std::lock_guard<std::mutex> lock(m_EdgeCacheMutex);
+        auto it = m_EdgeCache.find(key);
+        if (it != m_EdgeCache.end()) return it->second;
+    }
+    auto v = make();
+    std::lock_guard<std::mutex> lock(m_EdgeCacheMutex);
+    // if someone else beat us to it use theirs
+    return m_EdgeCache.emplace(key, v).first->second;
+}
+
+void SamplingBasedPlanner::rememberSearch() {
+    if (!m_WarmStart) return;
+    std::vector<State> planStates;
+    for (auto v = m_BestVertex; v && !v->isRoot(); v = v->parent()) planStates.push_back(v->state());
+    std::reverse(planStates.begin(), planStates.end());
+    m_WarmStart->remember(planStates);
+}
+
+void SamplingBasedPlanner::clearEdgeCache() {
+    std::lock_guard<std::mutex> lock(m_EdgeCacheMutex);
+    m_EdgeCache.clear();
 }
 
 int SamplingBasedPlanner::k() const {
     return m_Config.branchingFactor();
 }
 
+void SamplingBasedPlanner::setSharedIncumbent(SharedIncumbent::SharedPtr incumbent) {
+    m_SharedIncumbent = std::move(incumbent);
+}
+
+void SamplingBasedPlanner::setWarmStart(WarmStart::SharedPtr warmStart) {
+    m_WarmStart = std::move(warmStart);
+}
+
+const Vertex::SharedPtr& SamplingBasedPlanner::bestVertex() const {
+    return m_BestVertex;
+}
+
 void SamplingBasedPlanner::addSamples(StateGenerator& generator, int n) {
     for (int i = 0; i < n; i++) {
         const auto s = generator.generate();
-        m_Samples.push_back(s);
-        if (m_Config.visualizations()) {
-            m_Config.visualizationStream() << "State: (" << s.toStringRad() << "), f: " << 0 << ", g: " << 0 << ", h: " <<
-                                         0 << " sample" << std::endl;
-        }
+        m_Samples.add(s);
+        if (m_Config.visualizations()) m_Config.visualizer().record(s, 0, 0, Visualizer::SampleTag);
     }
 }
 
@@ -143,14 +295,31 @@ void SamplingBasedPlanner::addSamples(StateGenerator& generator) {
 
 void SamplingBasedPlanner::clearVertexQueue() {
     m_VertexQueue.clear();
+    m_Dominance.clear();
 }
 
-std::function<bool(const std::shared_ptr<Vertex>& v1, const std::shared_ptr<Vertex>& v2)> SamplingBasedPlanner::getDubinsComparator(
-        const State& origin) {
-    return [&] (const std::shared_ptr<Vertex>& v1, const std::shared_ptr<Vertex>& v2) {
-        // backwards from other state comparator because we want a max heap not a min heap
-        return v1->parentEdge()->approxCost() < v2->parentEdge()->approxCost();
-    };
+bool SamplingBasedPlanner::superseded(const Vertex::SharedPtr& vertex) {
+    if (!m_Config.duplicateDetection() || vertex->isRoot()) return false;
+    if (!m_Dominance.beaten(dominanceKey(*vertex), vertex->currentCost())) return false;
+    m_DuplicatesPruned++;
+    return true;
+}
+
+uint64_t SamplingBasedPlanner::dominanceKey(const Vertex& vertex) {
+    const auto& s = vertex.state();
+    double values[] = {s.x(), s.y(), s.heading(), s.speed(), floor(s.time() / c_DominanceTimeBucket)};
+    auto h = vertex.ribbonManager().fingerprint();
+    for (auto d : values) {
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        h = (h ^ bits) * 1099511628211ull;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+void SamplingBasedPlanner::pruneVertexQueue(double bound) {
+    m_VertexQueue.removeWorseThan(bound);
 }
 
 DubinsPlan SamplingBasedPlanner::plan(const RibbonManager&, const State& start, PlannerConfig config,
@@ -170,17 +339,15 @@ DubinsPlan SamplingBasedPlanner::plan(const RibbonManager&, const State& start,
     StateGenerator generator = StateGenerator(minX, maxX, minY, maxY, minSpeed, maxSpeed, 7, m_RibbonManager); // lucky seed
     addSamples(generator, 1000);
     std::shared_ptr<Vertex> vertex;
-    for (vertex = Vertex::makeRoot(start, m_RibbonManager);
+    for (vertex = Vertex::makeRoot(start, m_RibbonManager, std::make_shared<SearchArena>());
          !goalCondition(vertex); vertex = popVertexQueue()) {
         expand(vertex, m_Config.obstacles());
     }
     return tracePlan(vertex, false, m_Config.obstacles());
 }
 
-void SamplingBasedPlanner::visualizeVertex(Vertex::SharedPtr v, const std::string& tag) {
-    if (m_Config.visualizations()) {
-        m_Config.visualizationStream() << v->toString() << " " << tag << std::endl;
-    }
+void SamplingBasedPlanner::visualizeVertex(Vertex::SharedPtr v, Visualizer::Tag tag) {
+    if (m_Config.visualizations()) m_Config.visualizer().record(v->state(), v->currentCost(), v->approxToGo(), tag);
 }
 
 bool SamplingBasedPlanner::vertexQueueEmpty() const {
@@ -189,7 +356,11 @@ bool SamplingBasedPlanner::vertexQueueEmpty() const {
 
 void SamplingBasedPlanner::visualizeRibbons(const RibbonManager& ribbonManager) {
     if (m_Config.visualizations()) {
-        m_Config.visualizationStream() << ribbonManager.dumpRibbons() << "\nEnd Ribbons" << std::endl;
+        std::vector<std::array<double, 4>> ribbons;
+        for (const auto& r : ribbonManager.get()) {
+            ribbons.push_back({{r.start().first, r.start().second, r.end().first, r.end().second}});
+        }
+        m_Config.visualizer().recordRibbons(ribbons);
     }
 }
 
@@ -3,7 +3,18 @@
 
 #include "Planner.h"
 #include "utilities/StateGenerator.h"
+#include "utilities/ThreadPool.h"
+#include "utilities/SharedIncumbent.h"
+#include "utilities/SampleGrid.h"
+#include "utilities/WarmStart.h"
+#include "utilities/MotionPrimitives.h"
+#include "search/OpenList.h"
+#include "search/DominanceTable.h"
+#include "search/EdgeBatch.h"
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 /**
  * Class initially designed to represent a uniform cost search planner. That implementation didn't get updated when we
@@ -35,6 +46,12 @@ public:
      */
     void clearVertexQueue();
 
+    /**
+     * Drop vertices from the open list whose keys are worse than the bound.
+     * @param bound
+     */
+    void pruneVertexQueue(double bound);
+
     /**
      * Expand a vertex, pushing its children onto the open list.
      * @param sourceVertex
@@ -42,6 +59,36 @@ public:
      */
     virtual void expand(const std::shared_ptr<Vertex>& sourceVertex, const DynamicObstaclesManager& obstacles);
 
+    /**
+     * Prune against plans found by other planners too. Only makes sense when their costs are comparable, i.e. they
+     * have the same start, ribbons and heuristic.
+     * @param incumbent null to stop sharing
+     */
+    void setSharedIncumbent(SharedIncumbent::SharedPtr incumbent);
+
+    /**
+     * Carry samples over from one plan() call to the next (see WarmStart; only AStarPlanner uses it so far).
+     * @param warmStart null to start from scratch every time
+     */
+    void setWarmStart(WarmStart::SharedPtr warmStart);
+
+    /**
+     * @return the goal vertex of the best plan found by the last plan() call (null if none)
+     */
+    const Vertex::SharedPtr& bestVertex() const;
+
+    /**
+     * @return how many samples and expansions the last plan() call used, and how many duplicates it threw out
+     */
+    size_t sampleCount() const { return m_Samples.size(); }
+    int expandedCount() const { return m_ExpandedCount; }
+    int duplicatesPruned() const { return m_DuplicatesPruned; }
+
+    /**
+     * @return the edge evaluations and expansions the last plan() call did (what a work budget counts)
+     */
+    uint64_t work() const { return m_Budget.work(); }
+
     /**
      * Increase the number of samples.
      * @param generator
@@ -51,18 +98,24 @@ public:
 
 protected:
     double m_StartStateTime;
-    std::vector<State> m_Samples;
+    SampleGrid m_Samples;
     int m_ExpandedCount = 0;
+    // what's left of the plan() call's time; expansions and edge evaluations count towards it
+    Budget m_Budget;
 
     Vertex::SharedPtr m_BestVertex;
+    SharedIncumbent::SharedPtr m_SharedIncumbent;
+    WarmStart::SharedPtr m_WarmStart;
 
     RibbonManager m_RibbonManager;
 
     /**
-     * Retrieve a function that compares vertices. This orders the open list. Probably over-complicated but very general.
+     * Key a vertex is ordered by on the open list (lowest first). Only called when it's pushed; the open list keeps it.
+     * This one is deepest first.
+     * @param vertex
      * @return
      */
-    virtual std::function<bool(std::shared_ptr<Vertex> v1, std::shared_ptr<Vertex> v2)> getVertexComparator();
+    virtual double openListKey(const Vertex::SharedPtr& vertex);
 
     /**
      * Goal condition on which to stop search.
@@ -82,7 +135,7 @@ protected:
      * @param v
      * @param tag
      */
-    void visualizeVertex(Vertex::SharedPtr v, const std::string& tag);
+    void visualizeVertex(Vertex::SharedPtr v, Visualizer::Tag tag);
 
     /**
      * Visualize a ribbon manager.
@@ -96,23 +149,134 @@ protected:
      */
     bool vertexQueueEmpty() const;
 
-private:
-    std::vector<std::shared_ptr<Vertex>> m_VertexQueue;
+    /**
+     * Compute the true costs of the edges into some new vertices and push them onto the open list, in order. The
+     * edges are independent (each child has its own ribbon manager), so with PlannerConfig::expansionThreads() above
+     * one they're computed concurrently, but the pushes stay in order so the search doesn't depend on the timing.
+     * Visualization writes to a single stream so it forces them onto this thread.
+     * @param vertices
+     */
+    void computeTrueCostsAndPush(const std::vector<Vertex::SharedPtr>& vertices);
 
     /**
-     * State comparison to order samples for Dubins path computation.
-     * @param origin
+     * @param threads how many threads the config asks for
+     * @return the config's expansion pool if it has one, otherwise our own, made to size
+     */
+    ThreadPool& expansionPool(int threads);
+
+    /**
+     * Pick the children of a vertex: the nearest point to cover, then the k() nearest samples by Dubins distance for
+     * each turning radius. Only makes the vertices (and their approximate costs), in the order they should be pushed.
+     * Doesn't change anything, so it's safe to call from several threads at once.
+     * @param sourceVertex
+     * @param children appended to
+     */
+    void selectChildren(const Vertex::SharedPtr& sourceVertex, std::vector<Vertex::SharedPtr>& children) const;
+
+    /**
+     * Connect a vertex to a state like Vertex::connect. With PlannerConfig::incrementalSearch() on, asking for the same
+     * edge again (say, from the same vertex in a later iteration) hands back the same vertex, with its costs already
+     * computed, so the search only pays for edges it hasn't made before. Safe to call from several threads at once.
+     * @param source
+     * @param state
+     * @param turningRadius
+     * @param coverageAllowed
+     * @param primitive the motion primitive from source to state, if it's a lattice edge (see Edge::setPrimitive)
      * @return
      */
-    std::function<bool(const State& s1, const State& s2)> getStateComparator(const State& origin);
+    Vertex::SharedPtr connect(const Vertex::SharedPtr& source, const State& state, double turningRadius,
+                              bool coverageAllowed, const MotionPrimitives::Primitive* primitive = nullptr) const;
 
     /**
-     * Vertex comparison which uses Dubins distance to order expansion.
-     * @param origin
+     * With PlannerConfig::latticeSearch() on, get the motion primitives ready for the config's turning radii (they're
+     * only made again if those have changed) and put the lattice's origin at the start.
+     * @param start
+     */
+    void prepareLattice(const State& start);
+
+    /**
+     * Forget the edges kept for incremental search, letting their tree go.
+     */
+    void clearEdgeCache();
+
+    /**
+     * Hand the warm start (if there is one) the best plan's states.
+     */
+    void rememberSearch();
+
+    /**
+     * With PlannerConfig::duplicateDetection() on, whether a cheaper way to this vertex's state has been pushed since
+     * it was, meaning it can be skipped when it comes off the open list.
+     * @param vertex
+     * @return
+     */
+    bool superseded(const Vertex::SharedPtr& vertex);
+
+    /**
+     * Vertices dropped because another got to the same state cheaper, during the last plan() call.
+     */
+    int m_DuplicatesPruned = 0;
+
+    // for lattice search, one set of primitives per turning radius (no coverage ones without a coverage radius), all
+    // on the same grid
+    MotionPrimitives::SharedPtr m_Primitives, m_CoveragePrimitives;
+    double m_LatticeX = 0, m_LatticeY = 0;
+
+private:
+    OpenList m_VertexQueue;
+    DominanceTable m_Dominance;
+
+    // only made when we're using more than one thread and the config has no pool to share
+    std::unique_ptr<ThreadPool> m_ThreadPool;
+    // reused between expansions with batched true costs
+    EdgeBatch m_EdgeBatch;
+
+    /**
+     * Identifies an edge for incremental search.
+     */
+    struct EdgeKey {
+        const Vertex* Source;
+        double X, Y, Yaw, Speed, TurningRadius;
+        bool CoverageAllowed;
+        bool operator==(const EdgeKey& other) const {
+            return Source == other.Source && X == other.X && Y == other.Y && Yaw == other.Yaw &&
+                   Speed == other.Speed && TurningRadius == other.TurningRadius &&
+                   CoverageAllowed == other.CoverageAllowed;
+        }
+    };
+
+    struct EdgeKeyHash {
+        size_t operator()(const EdgeKey& key) const {
+            size_t h = std::hash<const Vertex*>()(key.Source);
+            for (auto v : {key.X, key.Y, key.Yaw, key.Speed, key.TurningRadius}) h = h * 31 + std::hash<double>()(v);
+            return h * 2 + key.CoverageAllowed;
+        }
+    };
+
+    // the end vertices of the edges made so far this plan() call
+    mutable std::mutex m_EdgeCacheMutex;
+    mutable std::unordered_map<EdgeKey, Vertex::SharedPtr, EdgeKeyHash> m_EdgeCache;
+
+    /**
+     * The lattice search version of the sample part of selectChildren: a lattice vertex gets every primitive from its
+     * state, for each turning radius, and anything else joins the lattice with ordinary Dubins edges to where the
+     * primitives from the nearest lattice state go.
+     * @param sourceVertex
+     * @param children appended to
+     */
+    void selectLatticeChildren(const Vertex::SharedPtr& sourceVertex, std::vector<Vertex::SharedPtr>& children) const;
+
+    /**
+     * What counts as the same search state for duplicate detection: the same sample (position, heading and speed),
+     * the same ribbons left and arriving in the same c_DominanceTimeBucket.
+     * @param vertex
      * @return
      */
-    std::function<bool(const std::shared_ptr<Vertex>&, const std::shared_ptr<Vertex>&)> getDubinsComparator(
-            const State& origin);
+    static uint64_t dominanceKey(const Vertex& vertex);
+
+    static constexpr double c_DominanceTimeBucket = 1;
+    // lattice grid spacing, in (non-coverage) turning radii
+    static constexpr double c_LatticeSpacing = 0.5;
 };
 
 
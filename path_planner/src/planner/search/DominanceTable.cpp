@@ -0,0 +1,45 @@
+#include "DominanceTable.h"
+
+constexpr size_t DominanceTable::c_InitialCapacity;
+
+DominanceTable::DominanceTable() : m_Slots(c_InitialCapacity, Slot{0, 0}) {}
+
+bool DominanceTable::offer(uint64_t key, double g) {
+    if (key == 0) key = 1; // 0 marks empty slots
+    auto i = find(key);
+    if (m_Slots[i].Key == key) {
+        if (m_Slots[i].G <= g) return false;
+        m_Slots[i].G = g;
+        return true;
+    }
+    m_Slots[i] = Slot{key, g};
+    if (++m_Size * 2 > m_Slots.size()) grow();
+    return true;
+}
+
+bool DominanceTable::beaten(uint64_t key, double g) const {
+    if (key == 0) key = 1;
+    const auto& slot = m_Slots[find(key)];
+    return slot.Key == key && slot.G < g;
+}
+
+void DominanceTable::clear() {
+    if (m_Size == 0) return;
+    // don't hang on to a huge table after a big search
+    m_Slots.assign(c_InitialCapacity, Slot{0, 0});
+    m_Size = 0;
+}
+
+size_t DominanceTable::find(uint64_t key) const {
+    auto mask = m_Slots.size() - 1;
+    // the keys are hashes already, but mix the high bits in for the mask
+    auto i = (key ^ (key >> 32)) & mask;
+    while (m_Slots[i].Key != 0 && m_Slots[i].Key != key) i = (i + 1) & mask;
+    return i;
+}
+
+void DominanceTable::grow() {
+    std::vector<Slot> old(m_Slots.size() * 2, Slot{0, 0});
+    old.swap(m_Slots);
+    for (const auto& s : old) if (s.Key != 0) m_Slots[find(s.Key)] = s;
+}
@@ -0,0 +1,55 @@
+#ifndef SRC_DOMINANCETABLE_H
+#define SRC_DOMINANCETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Best cost-so-far seen for each search state, for throwing out duplicates: a vertex that gets to the same state as
+ * one that got there cheaper has nothing to add. What a "state" is is up to the caller, who hashes it down to a 64 bit
+ * key (see SamplingBasedPlanner::dominanceKey).
+ *
+ * An open addressing (linear probing) table of (key, g) pairs in one contiguous array, kept under half full.
+ */
+class DominanceTable {
+public:
+    DominanceTable();
+
+    /**
+     * Record a cost for a state, unless there's already one at least as good.
+     * @param key
+     * @param g
+     * @return false if the state's dominated (there's already a cost <= g), true if g is the best so far
+     */
+    bool offer(uint64_t key, double g);
+
+    /**
+     * @param key
+     * @param g
+     * @return whether something strictly cheaper than g has been recorded for the state since
+     */
+    bool beaten(uint64_t key, double g) const;
+
+    void clear();
+
+    size_t size() const { return m_Size; }
+
+private:
+    struct Slot {
+        uint64_t Key; // 0 for empty
+        double G;
+    };
+
+    std::vector<Slot> m_Slots;
+    size_t m_Size = 0;
+
+    static constexpr size_t c_InitialCapacity = 1024; // a power of two
+
+    size_t find(uint64_t key) const;
+
+    void grow();
+};
+
+
+#endif //SRC_DOMINANCETABLE_H
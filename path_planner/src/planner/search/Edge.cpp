@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <memory>
 #include "Edge.h"
+#include "../utilities/Instrumentation.h"
 #include <cfloat>
 
 Edge::Edge(std::shared_ptr<Vertex> start) {
@@ -12,7 +13,18 @@ double Edge::computeApproxCost(double maxSpeed, double turningRadius) {
     if (start()->state().isCoLocated(end()->state())) {
         m_ApproxCost = 0;
     } else {
-        m_DubinsWrapper.set(start()->state(), end()->state(), turningRadius);
+        const auto& from = start()->state();
+        auto cache = start()->geometryCache();
+        EdgeGeometryCache::Entry entry;
+        if (cache && cache->find(from, end()->state(), turningRadius, entry)) {
+            m_DubinsWrapper.fill(entry.Path, from.speed(), from.time());
+        } else {
+            m_DubinsWrapper.set(from, end()->state(), turningRadius);
+            if (cache) {
+                entry.Path = m_DubinsWrapper.unwrap();
+                cache->store(from, end()->state(), turningRadius, entry);
+            }
+        }
 
         m_ApproxCost = m_DubinsWrapper.length() / maxSpeed * Edge::timePenaltyFactor();
     }
@@ -29,12 +41,12 @@ DubinsWrapper Edge::getPlan(const PlannerConfig& config) {
 }
 
 std::shared_ptr<Vertex> Edge::setEnd(const State &state) {
-    auto ptr = std::make_shared<Vertex>(state, std::shared_ptr<Edge>(this));
+    auto ptr = SearchArena::makeShared<Vertex>(m_Start->arena(), state, shared_from_this());
     m_End = ptr;
     return ptr;
 }
 
-std::shared_ptr<Vertex> Edge::start() const {
+const std::shared_ptr<Vertex>& Edge::start() const {
     return m_Start;
 }
 
@@ -61,11 +73,15 @@ bool Edge::infeasible() const {
     return m_Infeasible;
 }
 
+bool Edge::hasTrueCost() const {
+    return m_TrueCost != -1;
+}
+
 double Edge::computeApproxCost() {
     return computeApproxCost(end()->state().speed(), end()->turningRadius());
 }
 
-double Edge::computeTrueCost(const PlannerConfig& config) {
+double Edge::prepareTrueCost(const PlannerConfig& config) {
     if (start()->state().isCoLocated(end()->state())) {
         std::cerr << "Computing cost of edge between two co-located states is likely an error" << std::endl;
     }
@@ -76,23 +92,12 @@ double Edge::computeTrueCost(const PlannerConfig& config) {
     }
     if (m_ApproxCost == -1) computeApproxCost(speed, turningRadius);
     if (m_ApproxCost <= 0) throw std::runtime_error("Could not compute approximate cost");
-    double collisionPenalty = 0;
-    std::vector<std::pair<double, double>> result;
-    State intermediate(start()->state());
     double length = m_DubinsWrapper.length();
     // truncate longer edges than 30 seconds
     auto endTime = fmin(DubinsPlan::timeHorizon() + 1 + config.startStateTime(), length / speed + start()->state().time());
-
-    double dynamicDistance = 0, toCoverDistance = 0;
-    std::vector<std::pair<double, double>> newlyCovered;
-    double lastHeading = start()->state().heading();
-    int visCount = int(1.0 / Edge::collisionCheckingIncrement()); // counter to reduce visualization frequency
-
-    auto startG = start()->currentCost();
-    auto startH = start()->approxToGo();
-
-    if (intermediate.time() >= endTime) {
-        if (intermediate.time() > endTime) std::cerr << "Negative length edge" << std::endl;
+    auto startTime = start()->state().time();
+    if (startTime >= endTime) {
+        if (startTime > endTime) std::cerr << "Negative length edge" << std::endl;
         else {
             std::cerr << "Zero length edge: " << std::endl;
             std::cerr << "\t" << start()->state().toString() << std::endl;
@@ -100,60 +105,210 @@ double Edge::computeTrueCost(const PlannerConfig& config) {
         }
         m_Infeasible = true;
     }
-    // collision check along the curve (and watch out for newly covered points, too)
-    while (intermediate.time() < endTime) {
-        m_DubinsWrapper.sample(intermediate);
-        // visualize
-        if (config.visualizations() && visCount-- <= 0) {
-            visCount = int(1.0 / Edge::collisionCheckingIncrement());
-            auto timeSoFar = intermediate.time() - start()->state().time();
-            auto gSoFar = startG + timeSoFar + collisionPenalty;
-            // should really put visualizeVertex somewhere accessible
-            // use start H because it isn't worth it to calculate current H
-            config.visualizationStream() << "State: (" << intermediate.toStringRad() << "), f: " << gSoFar + startH <<
-                ", g: " << gSoFar << ", h: " << startH << " trajectory" << std::endl;
-        }
-        if (config.map()->getUnblockedDistance(intermediate.x(), intermediate.y()) <= Edge::collisionCheckingIncrement()) {
-            collisionPenalty += Edge::collisionPenaltyFactor();
-            std::cerr << "Infeasible edge discovered" << std::endl;
-            m_Infeasible = true;
-            break;
+    return endTime;
+}
+
+double Edge::computeTrueCost(const PlannerConfig& config) {
+    Instrumentation::ScopedTimer timer(Instrumentation::TrueCostTime);
+    // the queries below are timed into these and added up once at the end
+    uint64_t mapNanoseconds = 0, obstacleNanoseconds = 0, mapQueries = 0, obstacleQueries = 0;
+    auto endTime = prepareTrueCost(config);
+    double speed = config.maxSpeed();
+    // sample the whole curve in one go, reusing the buffer between edges
+    static thread_local DubinsWrapper::Samples samples;
+    sample(Edge::collisionCheckingIncrement() / speed, endTime, samples);
+    // Sphere tracing against the map: the path is never further from where we last looked than the arc length since,
+    // so we only need to look again once we've used up the clearance (less a cell, since the distances are per cell)
+    auto step = Edge::collisionCheckingIncrement() / speed * m_DubinsWrapper.getSpeed();
+    auto cellDiagonal = config.map()->cellDiagonal();
+    double staticClearance = -1, dynamicDistance = 0, collisionPenalty = 0;
+    size_t blocked = samples.size();
+    // the map part doesn't depend on time, so it might be known from another edge just like this one
+    size_t knownBlocked;
+    auto mapKnown = findBlocked(samples.size(), knownBlocked);
+    // points near dynamic obstacles, whose densities are evaluated together at the end
+    static thread_local std::vector<double> dynamicXs, dynamicYs, dynamicTimes, densities;
+    dynamicXs.clear(); dynamicYs.clear(); dynamicTimes.clear();
+    // collision check along the curve (coverage is done afterwards, up to where this stops)
+    State intermediate;
+    for (size_t i = 0; i < samples.size(); i++) {
+        intermediate.time() = samples.Times[i];
+        intermediate.x() = samples.Xs[i];
+        intermediate.y() = samples.Ys[i];
+        intermediate.setYaw(samples.Yaws[i]);
+        intermediate.speed() = m_DubinsWrapper.getSpeed();
+        if (mapKnown) {
+            if (i == knownBlocked) {
+                blocked = i;
+                break;
+            }
+        } else if (staticClearance > 0) {
+            staticClearance -= step;
+        } else {
+            auto queryStart = Instrumentation::now();
+            auto unblockedDistance = config.map()->getUnblockedDistance(intermediate.x(), intermediate.y());
+            mapNanoseconds += Instrumentation::now() - queryStart;
+            mapQueries++;
+            if (unblockedDistance <= Edge::collisionCheckingIncrement()) {
+                blocked = i;
+                break;
+            }
+            staticClearance = unblockedDistance - Edge::collisionCheckingIncrement() - cellDiagonal - step;
         }
         if (dynamicDistance > Edge::collisionCheckingIncrement()) {
             dynamicDistance -= Edge::collisionCheckingIncrement();
         } else {
+            auto queryStart = Instrumentation::now();
             dynamicDistance = config.obstacles().distanceToNearestPossibleCollision(intermediate);
+            obstacleNanoseconds += Instrumentation::now() - queryStart;
+            obstacleQueries++;
             if (dynamicDistance <= Edge::collisionCheckingIncrement()) {
-                assert(std::isfinite(speed));
-                assert(std::isfinite(config.obstacles().collisionExists(intermediate)));
-                collisionPenalty += config.obstacles().collisionExists(intermediate) * Edge::collisionPenaltyFactor();
+                dynamicXs.push_back(intermediate.x());
+                dynamicYs.push_back(intermediate.y());
+                dynamicTimes.push_back(intermediate.time());
                 dynamicDistance = 0;
             }
         }
+    }
+    if (!dynamicXs.empty()) {
+        auto queryStart = Instrumentation::now();
+        config.obstacles().collisionExists(dynamicXs, dynamicYs, dynamicTimes, densities);
+        obstacleNanoseconds += Instrumentation::now() - queryStart;
+        obstacleQueries++;
+        for (auto d : densities) {
+            assert(std::isfinite(d));
+            collisionPenalty += d * Edge::collisionPenaltyFactor();
+        }
+    }
+    if (!mapKnown) rememberBlocked(blocked < samples.size() ? blocked + 1 : samples.size(), blocked);
+    Instrumentation::count(Instrumentation::MapQueries, mapQueries);
+    Instrumentation::count(Instrumentation::ObstacleQueries, obstacleQueries);
+    Instrumentation::time(Instrumentation::MapTime, mapNanoseconds);
+    Instrumentation::time(Instrumentation::ObstacleTime, obstacleNanoseconds);
+    return finishTrueCost(config, samples, 0, samples.size(), blocked, collisionPenalty, endTime);
+}
+
+size_t Edge::addToBatch(const PlannerConfig& config, EdgeBatch& batch) {
+    auto endTime = prepareTrueCost(config);
+    auto timeInterval = Edge::collisionCheckingIncrement() / config.maxSpeed();
+    static thread_local DubinsWrapper::Samples samples;
+    sample(timeInterval, endTime, samples);
+    size_t knownBlocked;
+    if (!findBlocked(samples.size(), knownBlocked)) knownBlocked = EdgeBatch::c_Unknown;
+    return batch.add(samples, timeInterval * m_DubinsWrapper.getSpeed(), endTime, knownBlocked);
+}
+
+bool Edge::findBlocked(size_t samples, size_t& firstBlocked) const {
+    auto cache = start()->geometryCache();
+    return cache && cache->findBlocked(start()->state(), end()->state(), m_DubinsWrapper.getRho(), samples,
+                                       firstBlocked);
+}
+
+void Edge::rememberBlocked(size_t checked, size_t firstBlocked) const {
+    auto cache = start()->geometryCache();
+    if (!cache) return;
+    EdgeGeometryCache::Entry entry;
+    entry.Path = m_DubinsWrapper.unwrap();
+    entry.Checked = checked;
+    entry.FirstBlocked = firstBlocked;
+    cache->store(start()->state(), end()->state(), m_DubinsWrapper.getRho(), entry);
+}
+
+void Edge::sample(double timeInterval, double endTime, DubinsWrapper::Samples& samples) const {
+    const auto& s = start()->state();
+    if (m_Primitive && fabs(timeInterval * m_DubinsWrapper.getSpeed() - m_Primitive->SampleSpacing) < 1e-9) {
+        m_Primitive->sample(s.x(), s.y(), s.time(), timeInterval, endTime, samples);
+    } else {
+        m_DubinsWrapper.sampleMany(s.time(), timeInterval, endTime, samples);
+    }
+}
+
+void Edge::setPrimitive(const MotionPrimitives::Primitive& primitive) {
+    const auto& s = start()->state();
+    m_Primitive = &primitive;
+    m_DubinsWrapper.fill(primitive.placed(s.x(), s.y()), s.speed(), s.time());
+    m_ApproxCost = primitive.Length / s.speed() * Edge::timePenaltyFactor();
+}
+
+double Edge::computeTrueCost(const PlannerConfig& config, const EdgeBatch& batch, size_t index) {
+    Instrumentation::ScopedTimer timer(Instrumentation::TrueCostTime);
+    auto collisionPenalty = batch.density(index) * Edge::collisionPenaltyFactor();
+    assert(std::isfinite(collisionPenalty));
+    auto samples = batch.end(index) - batch.begin(index), blocked = batch.firstBlocked(index) - batch.begin(index);
+    rememberBlocked(blocked < samples ? blocked + 1 : samples, blocked);
+    return finishTrueCost(config, batch.samples(), batch.begin(index), batch.end(index), batch.firstBlocked(index),
+                          collisionPenalty, batch.endTime(index));
+}
+
+double Edge::finishTrueCost(const PlannerConfig& config, const DubinsWrapper::Samples& samples, size_t first,
+                            size_t last, size_t blocked, double collisionPenalty, double endTime) {
+    uint64_t coverNanoseconds = 0, coverQueries = 0;
+    if (blocked < last) {
+        collisionPenalty += Edge::collisionPenaltyFactor();
+        std::cerr << "Infeasible edge discovered" << std::endl;
+        m_Infeasible = true;
+    }
+    double toCoverDistance = 0;
+    double lastHeading = start()->state().heading();
+    int visCount = int(1.0 / Edge::collisionCheckingIncrement()); // counter to reduce visualization frequency
+    auto startG = start()->currentCost();
+    auto startH = start()->approxToGo();
+    State intermediate;
+    // watch out for newly covered points along the curve, up to where it's blocked (if it is)
+    for (size_t i = first; i < last; i++) {
+        intermediate.time() = samples.Times[i];
+        intermediate.x() = samples.Xs[i];
+        intermediate.y() = samples.Ys[i];
+        intermediate.setYaw(samples.Yaws[i]);
+        intermediate.speed() = m_DubinsWrapper.getSpeed();
+        // visualize
+        if (config.visualizations() && visCount-- <= 0) {
+            visCount = int(1.0 / Edge::collisionCheckingIncrement());
+            auto timeSoFar = intermediate.time() - start()->state().time();
+            auto gSoFar = startG + timeSoFar;
+            // use start H because it isn't worth it to calculate current H
+            config.visualizer().record(intermediate, gSoFar, startH, Visualizer::TrajectoryTag);
+        }
+        if (i == blocked) break;
         if (toCoverDistance > Edge::collisionCheckingIncrement()) {
             toCoverDistance -= Edge::collisionCheckingIncrement();
         } else {
             // do this first because cover splits ribbons so you'd never get one that "contains" the point so it
             // could be a bit more work
+            auto queryStart = Instrumentation::now();
             toCoverDistance = end()->ribbonManager().minDistanceFrom(intermediate.x(), intermediate.y());
             if (end()->coverageAllowed() || lastHeading == intermediate.heading()) {
                 end()->ribbonManager().cover(intermediate.x(), intermediate.y());
             }
-
+            coverNanoseconds += Instrumentation::now() - queryStart;
+            coverQueries++;
         }
-        intermediate.time() += Edge::collisionCheckingIncrement() / speed;
         lastHeading = intermediate.heading();
     }
     // set to the end of the edge (potentially truncated)
+    auto planned = end()->state();
+    auto whole = endTime >= m_DubinsWrapper.getEndTime();
     end()->state().time() = endTime;
     m_DubinsWrapper.sample(end()->state());
     m_DubinsWrapper.updateEndTime(end()->state().time()); // should just be truncating the path
+    if (whole) {
+        // exactly on the state it was made to, not wherever rounding put the end of the path, so edges from two
+        // vertices on the same sample (or lattice state) start from the same pose and duplicates match
+        end()->state().x() = planned.x();
+        end()->state().y() = planned.y();
+        end()->state().heading() = planned.heading();
+    }
 
     assert(std::isfinite(netTime()));
     assert(std::isfinite(collisionPenalty));
     m_CollisionPenalty = collisionPenalty;
     m_TrueCost = netTime() * Edge::timePenaltyFactor() + collisionPenalty;
 
+    Instrumentation::count(Instrumentation::TrueCosts);
+    if (m_Infeasible) Instrumentation::count(Instrumentation::InfeasibleEdges);
+    Instrumentation::count(Instrumentation::CoverQueries, coverQueries);
+    Instrumentation::time(Instrumentation::CoverTime, coverNanoseconds);
+
     end()->setCurrentCost();
 
     return m_TrueCost;
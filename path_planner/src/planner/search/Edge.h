@@ -8,6 +8,8 @@
 #include <path_planner_common/DubinsPlan.h>
 #include "../PlannerConfig.h"
 #include "../utilities/Ribbon.h"
+#include "../utilities/MotionPrimitives.h"
+#include "EdgeBatch.h"
 
 extern "C" {
 #include "dubins.h"
@@ -28,7 +30,7 @@ class Vertex;
  *
  * See the Vertex header for resource management of edges and vertices.
  */
-class Edge {
+class Edge : public std::enable_shared_from_this<Edge> {
 public:
     typedef std::shared_ptr<Edge> SharedPtr;
 
@@ -61,14 +63,42 @@ public:
      */
     std::shared_ptr<Vertex> setEnd(const DubinsWrapper& path);
 
+    /**
+     * Make this edge a motion primitive from its start vertex, which has to be on the primitive's starting lattice
+     * state (see MotionPrimitives). The path and approximate cost come straight from the table instead of being solved
+     * for, and the true cost is computed from the primitive's samples.
+     * @param primitive kept by pointer, so the table has to outlive the search
+     */
+    void setPrimitive(const MotionPrimitives::Primitive& primitive);
+
     /**
      * Collision check the edge, computing the true cost. This also updates the ribbon manager associated with the
-     * ending vertex.
+     * ending vertex. Its state gets the edge's end time, and is moved to where the edge ends if it was truncated (if
+     * not it's left exactly as it was).
      * @param config
      * @return
      */
     double computeTrueCost(const PlannerConfig& config);
 
+    /**
+     * The first half of computeTrueCost for a batch of edges: sample this one into the batch. Once the batch has been
+     * evaluated, finish with the overload below.
+     * @param config
+     * @param batch
+     * @return the edge's index in the batch
+     */
+    size_t addToBatch(const PlannerConfig& config, EdgeBatch& batch);
+
+    /**
+     * The second half: pick up this edge's collision penalty from an evaluated batch, and do the rest (coverage, and
+     * truncating the edge) the same as computeTrueCost.
+     * @param config
+     * @param batch
+     * @param index what addToBatch returned
+     * @return
+     */
+    double computeTrueCost(const PlannerConfig& config, const EdgeBatch& batch, size_t index);
+
     /**
      * Retrieve the cached true cost, computing it if necessary.
      * @return
@@ -95,7 +125,7 @@ public:
     /**
      * @return the start vertex.
      */
-    std::shared_ptr<Vertex> start() const;
+    const std::shared_ptr<Vertex>& start() const;
 
     /**
      * @return the end vertex.
@@ -107,6 +137,11 @@ public:
      */
     bool infeasible() const;
 
+    /**
+     * @return whether computeTrueCost has been called
+     */
+    bool hasTrueCost() const;
+
     /**
      * @return the cached collision penalty. This is really just for debugging I think.
      */
@@ -145,12 +180,61 @@ private:
 
     double m_CollisionPenalty = 0;
 
+    // null unless it's a motion primitive
+    const MotionPrimitives::Primitive* m_Primitive = nullptr;
+
     /**
      * Find the net time of the edge.
      * @return
      */
     double netTime();
 
+    /**
+     * Get ready to compute the true cost: work out the approximate cost if it isn't yet, and see how far to go.
+     * @param config
+     * @return the time to sample the edge up to
+     */
+    double prepareTrueCost(const PlannerConfig& config);
+
+    /**
+     * Sample the edge like DubinsWrapper::sampleMany from its start time, reading the samples off the motion primitive
+     * if it is one (and the interval fits the primitive's sample spacing).
+     * @param timeInterval
+     * @param endTime
+     * @param samples
+     */
+    void sample(double timeInterval, double endTime, DubinsWrapper::Samples& samples) const;
+
+    /**
+     * Look up how far along the edge the map blocks it, from an edge just like it (see EdgeGeometryCache).
+     * @param samples how many samples it's being checked up to
+     * @param firstBlocked set to the first blocked one (samples if none are), if that's known
+     * @return whether it's known
+     */
+    bool findBlocked(size_t samples, size_t& firstBlocked) const;
+
+    /**
+     * Save what's been found out about the edge against the map, for edges just like it.
+     * @param checked how many samples from the start were checked
+     * @param firstBlocked the first blocked one (checked if none were)
+     */
+    void rememberBlocked(size_t checked, size_t firstBlocked) const;
+
+    /**
+     * The rest of computing the true cost once the collision checking's done: cover what the edge covers (up to the
+     * sample that's blocked, if one is), truncate it, and add up the cost.
+     * @param config
+     * @param samples
+     * @param first this edge's samples are [first, last)
+     * @param last
+     * @param blocked the first sample too close to something in the map (last if none is)
+     * @param collisionPenalty from the dynamic obstacles
+     * @param endTime what the edge was sampled up to
+     * @return the true cost
+     */
+    double finishTrueCost(const PlannerConfig& config, const DubinsWrapper::Samples& samples, size_t first, size_t last,
+                          size_t blocked, double collisionPenalty, double endTime);
+
     static constexpr double c_CollisionPenaltyFactor = 10; // no idea how to set this but this is probably too low (try 600)
     static constexpr double c_CollisionCheckingIncrement = 1;
     static constexpr double c_TimePenaltyFactor = 1;
@@ -0,0 +1,85 @@
+#include "EdgeBatch.h"
+#include "../utilities/Instrumentation.h"
+
+constexpr size_t EdgeBatch::c_Unknown;
+
+void EdgeBatch::clear() {
+    m_Samples.clear();
+    m_Offsets.assign(1, 0);
+    m_EndTimes.clear();
+    m_Steps.clear();
+    m_FirstBlocked.clear();
+    m_Density.clear();
+}
+
+size_t EdgeBatch::add(const DubinsWrapper& path, double startTime, double timeInterval, double endTime) {
+    if (startTime < endTime) path.sampleMany(startTime, timeInterval, endTime, m_EdgeSamples);
+    else m_EdgeSamples.clear();
+    return add(m_EdgeSamples, timeInterval * path.getSpeed(), endTime);
+}
+
+size_t EdgeBatch::add(const DubinsWrapper::Samples& samples, double step, double endTime, size_t firstBlocked) {
+    auto append = [] (std::vector<double>& to, const std::vector<double>& from) {
+        to.insert(to.end(), from.begin(), from.end());
+    };
+    append(m_Samples.Times, samples.Times);
+    append(m_Samples.Xs, samples.Xs);
+    append(m_Samples.Ys, samples.Ys);
+    append(m_Samples.Yaws, samples.Yaws);
+    m_Offsets.push_back(m_Samples.size());
+    m_EndTimes.push_back(endTime);
+    m_Steps.push_back(step);
+    m_FirstBlocked.push_back(firstBlocked);
+    return m_EndTimes.size() - 1;
+}
+
+void EdgeBatch::evaluate(const Map& map, const DynamicObstaclesManager& obstacles, double clearance) {
+    // sphere tracing against the map, like the one edge version: the path is never further from where we last
+    // looked than the arc length since, so we only need to look again once we've used up the clearance
+    auto queryStart = Instrumentation::now();
+    uint64_t mapQueries = 0;
+    auto cellDiagonal = map.cellDiagonal();
+    for (size_t i = 0; i < size(); i++) {
+        if (m_FirstBlocked[i] != c_Unknown) {
+            m_FirstBlocked[i] += begin(i);
+            continue;
+        }
+        auto blocked = end(i);
+        double staticClearance = -1;
+        for (auto j = begin(i); j < end(i); j++) {
+            if (staticClearance > 0) {
+                staticClearance -= m_Steps[i];
+                continue;
+            }
+            auto unblockedDistance = map.getUnblockedDistance(m_Samples.Xs[j], m_Samples.Ys[j]);
+            mapQueries++;
+            if (unblockedDistance <= clearance) {
+                blocked = j;
+                break;
+            }
+            staticClearance = unblockedDistance - clearance - cellDiagonal - m_Steps[i];
+        }
+        m_FirstBlocked[i] = blocked;
+    }
+    Instrumentation::time(Instrumentation::MapTime, Instrumentation::now() - queryStart);
+    Instrumentation::count(Instrumentation::MapQueries, mapQueries);
+    m_Xs.clear(); m_Ys.clear(); m_Times.clear(); m_Owners.clear();
+    for (size_t i = 0; i < size(); i++) {
+        auto blocked = m_FirstBlocked[i];
+        // past a blocked sample nothing counts, just as the one edge version stops there
+        for (auto j = begin(i); j < blocked; j++) {
+            m_Xs.push_back(m_Samples.Xs[j]);
+            m_Ys.push_back(m_Samples.Ys[j]);
+            m_Times.push_back(m_Samples.Times[j]);
+            m_Owners.push_back(i);
+        }
+    }
+    // and everything that's left against the obstacles at once
+    m_Density.assign(size(), 0);
+    if (m_Xs.empty()) return;
+    queryStart = Instrumentation::now();
+    obstacles.collisionExists(m_Xs, m_Ys, m_Times, m_Densities);
+    Instrumentation::time(Instrumentation::ObstacleTime, Instrumentation::now() - queryStart);
+    Instrumentation::count(Instrumentation::ObstacleQueries);
+    for (size_t j = 0; j < m_Densities.size(); j++) m_Density[m_Owners[j]] += m_Densities[j];
+}
@@ -0,0 +1,109 @@
+#ifndef SRC_EDGEBATCH_H
+#define SRC_EDGEBATCH_H
+
+#include <cstdint>
+#include <path_planner_common/DubinsWrapper.h>
+#include "../../common/map/Map.h"
+#include "../../common/dynamic_obstacles/DynamicObstaclesManager.h"
+
+/**
+ * The collision checking half of computing true costs, for a batch of edges at once (the children of an expansion,
+ * say). Each edge's samples are appended to one set of arrays, then evaluate() checks them against the map and asks
+ * the obstacles about all the ones that matter in one call, and afterwards each edge picks up its own penalty and
+ * does its coverage bookkeeping as usual (see Edge::computeTrueCost).
+ *
+ * That's the shape of work a GPU wants: upload flat arrays of points, run one kernel over them, read back a number
+ * per edge. evaluate() is where a device backend would go; this is the CPU one, which sphere traces each edge against
+ * the map just like the one edge version, and only batches the obstacle query.
+ */
+class EdgeBatch {
+public:
+    /**
+     * Empty the batch, keeping its buffers.
+     */
+    void clear();
+
+    /**
+     * Add an edge's samples.
+     * @param path
+     * @param startTime
+     * @param timeInterval between samples
+     * @param endTime
+     * @return the edge's index in the batch
+     */
+    size_t add(const DubinsWrapper& path, double startTime, double timeInterval, double endTime);
+
+    /**
+     * Add an edge's samples, already worked out.
+     * @param samples
+     * @param step distance between them
+     * @param endTime
+     * @param firstBlocked the first of the samples the map blocks (samples.size() if none), if that's already known,
+     * so evaluate() doesn't need to check them against the map
+     * @return the edge's index in the batch
+     */
+    size_t add(const DubinsWrapper::Samples& samples, double step, double endTime, size_t firstBlocked = c_Unknown);
+
+    /**
+     * Check every edge's samples against the map and obstacles.
+     * @param map
+     * @param obstacles
+     * @param clearance how far from a blocked cell a sample has to be
+     */
+    void evaluate(const Map& map, const DynamicObstaclesManager& obstacles, double clearance);
+
+    /**
+     * @return how many edges there are
+     */
+    size_t size() const { return m_EndTimes.size(); }
+
+    /**
+     * @param i
+     * @return the time the edge was sampled up to
+     */
+    double endTime(size_t i) const { return m_EndTimes[i]; }
+
+    /**
+     * The edge's samples are [begin(i), end(i)) of samples().
+     * @param i
+     * @return
+     */
+    size_t begin(size_t i) const { return m_Offsets[i]; }
+    size_t end(size_t i) const { return m_Offsets[i + 1]; }
+
+    const DubinsWrapper::Samples& samples() const { return m_Samples; }
+
+    /**
+     * After evaluate().
+     * @param i
+     * @return the first of the edge's samples too close to something in the map, or end(i) if none are
+     */
+    size_t firstBlocked(size_t i) const { return m_FirstBlocked[i]; }
+
+    /**
+     * After evaluate().
+     * @param i
+     * @return the edge's collision density, summed over its samples before firstBlocked(i)
+     */
+    double density(size_t i) const { return m_Density[i]; }
+
+    // for an edge whose map result isn't known yet
+    static constexpr size_t c_Unknown = SIZE_MAX;
+
+private:
+    DubinsWrapper::Samples m_Samples;
+    std::vector<size_t> m_Offsets{0};
+    std::vector<double> m_EndTimes;
+    // distance between an edge's samples, for sphere tracing
+    std::vector<double> m_Steps;
+    // known ones filled in by add() (relative to the edge's first sample until evaluate())
+    std::vector<size_t> m_FirstBlocked;
+    std::vector<double> m_Density;
+    // scratch for evaluate() (and add())
+    DubinsWrapper::Samples m_EdgeSamples;
+    std::vector<double> m_Xs, m_Ys, m_Times, m_Densities;
+    std::vector<size_t> m_Owners;
+};
+
+
+#endif //SRC_EDGEBATCH_H
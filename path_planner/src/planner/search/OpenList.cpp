@@ -0,0 +1,104 @@
+#include <stdexcept>
+#include "OpenList.h"
+
+constexpr size_t OpenList::c_Arity;
+
+OpenList::~OpenList() {
+    clear();
+}
+
+void OpenList::push(const Vertex::SharedPtr& vertex, double key) {
+    if (contains(*vertex)) {
+        decreaseKey(*vertex, key);
+        return;
+    }
+    m_Entries.push_back(Entry{key, m_Sequence++, vertex});
+    vertex->m_OpenListIndex = m_Entries.size() - 1;
+    siftUp(m_Entries.size() - 1);
+}
+
+Vertex::SharedPtr OpenList::pop() {
+    if (m_Entries.empty()) throw std::out_of_range("Trying to pop an empty open list");
+    auto result = std::move(m_Entries.front().Node);
+    result->m_OpenListIndex = Vertex::c_NotOnOpenList;
+    auto last = std::move(m_Entries.back());
+    m_Entries.pop_back();
+    if (!m_Entries.empty()) {
+        place(0, std::move(last));
+        siftDown(0);
+    }
+    return result;
+}
+
+double OpenList::topKey() const {
+    if (m_Entries.empty()) throw std::out_of_range("Trying to look at an empty open list");
+    return m_Entries.front().Key;
+}
+
+void OpenList::decreaseKey(const Vertex& vertex, double key) {
+    if (!contains(vertex)) throw std::logic_error("Decreasing the key of a vertex that isn't on the open list");
+    auto i = vertex.m_OpenListIndex;
+    if (key >= m_Entries[i].Key) return;
+    m_Entries[i].Key = key;
+    siftUp(i);
+}
+
+bool OpenList::contains(const Vertex& vertex) const {
+    auto i = vertex.m_OpenListIndex;
+    return i < m_Entries.size() && m_Entries[i].Node.get() == &vertex;
+}
+
+size_t OpenList::removeWorseThan(double bound) {
+    size_t kept = 0;
+    for (auto& e : m_Entries) {
+        if (e.Key > bound) e.Node->m_OpenListIndex = Vertex::c_NotOnOpenList;
+        else m_Entries[kept++] = std::move(e);
+    }
+    auto removed = m_Entries.size() - kept;
+    if (removed == 0) return 0;
+    m_Entries.resize(kept);
+    // rebuild bottom up
+    for (size_t i = 0; i < kept; i++) m_Entries[i].Node->m_OpenListIndex = i;
+    if (kept > 1) {
+        for (size_t i = (kept - 2) / c_Arity + 1; i-- > 0;) siftDown(i);
+    }
+    return removed;
+}
+
+void OpenList::clear() {
+    for (auto& e : m_Entries) e.Node->m_OpenListIndex = Vertex::c_NotOnOpenList;
+    m_Entries.clear();
+}
+
+void OpenList::place(size_t i, Entry&& entry) {
+    m_Entries[i] = std::move(entry);
+    m_Entries[i].Node->m_OpenListIndex = i;
+}
+
+void OpenList::siftUp(size_t i) {
+    if (i == 0) return;
+    auto entry = std::move(m_Entries[i]);
+    while (i > 0) {
+        auto parent = (i - 1) / c_Arity;
+        if (!(entry < m_Entries[parent])) break;
+        place(i, std::move(m_Entries[parent]));
+        i = parent;
+    }
+    place(i, std::move(entry));
+}
+
+void OpenList::siftDown(size_t i) {
+    auto n = m_Entries.size();
+    auto entry = std::move(m_Entries[i]);
+    while (true) {
+        auto first = i * c_Arity + 1;
+        if (first >= n) break;
+        auto best = first;
+        auto end = first + c_Arity < n ? first + c_Arity : n;
+        for (auto c = first + 1; c < end; c++) if (m_Entries[c] < m_Entries[best]) best = c;
+        if (!(m_Entries[best] < entry)) break;
+        place(i, std::move(m_Entries[best]));
+        i = best;
+    }
+    place(i, std::move(entry));
+}
@@ -0,0 +1,95 @@
+#ifndef SRC_OPENLIST_H
+#define SRC_OPENLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+
+/**
+ * The open list: a 4-ary min heap of vertices on a key (f, for A*) which is worked out once when the vertex is pushed
+ * and kept with it, so ordering is just comparing doubles next to each other in memory. Ties go to whichever was
+ * pushed first.
+ *
+ * It's intrusive: each vertex knows where it is in the heap, so pushing one that's already on there just lowers its
+ * key if that helps (decrease-key) rather than adding it twice. That also means a vertex can only be on one open list
+ * at a time, which is fine as each planner has its own tree.
+ */
+class OpenList {
+public:
+    OpenList() = default;
+
+    OpenList(const OpenList&) = delete;
+    OpenList& operator=(const OpenList&) = delete;
+
+    ~OpenList();
+
+    /**
+     * Push a vertex, or lower its key if it's already here.
+     * @param vertex
+     * @param key
+     */
+    void push(const Vertex::SharedPtr& vertex, double key);
+
+    /**
+     * Remove and return the vertex with the lowest key.
+     * @return
+     */
+    Vertex::SharedPtr pop();
+
+    /**
+     * @return the lowest key
+     */
+    double topKey() const;
+
+    /**
+     * Lower the key of a vertex already on the list (nothing happens if it's not lower).
+     * @param vertex
+     * @param key
+     */
+    void decreaseKey(const Vertex& vertex, double key);
+
+    /**
+     * @param vertex
+     * @return whether the vertex is on this list
+     */
+    bool contains(const Vertex& vertex) const;
+
+    /**
+     * Drop everything with a key above the bound (vertices that can't beat an incumbent), in linear time.
+     * @param bound
+     * @return how many went
+     */
+    size_t removeWorseThan(double bound);
+
+    bool empty() const { return m_Entries.empty(); }
+
+    size_t size() const { return m_Entries.size(); }
+
+    void clear();
+
+private:
+    struct Entry {
+        double Key;
+        uint64_t Sequence;
+        Vertex::SharedPtr Node;
+
+        bool operator<(const Entry& other) const {
+            return Key < other.Key || (Key == other.Key && Sequence < other.Sequence);
+        }
+    };
+
+    std::vector<Entry> m_Entries;
+    uint64_t m_Sequence = 0;
+
+    static constexpr size_t c_Arity = 4;
+
+    void place(size_t i, Entry&& entry);
+
+    void siftUp(size_t i);
+
+    void siftDown(size_t i);
+};
+
+
+#endif //SRC_OPENLIST_H
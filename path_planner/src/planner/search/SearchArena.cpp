@@ -0,0 +1,21 @@
+#include <cstdint>
+#include "SearchArena.h"
+
+void* SearchArena::allocate(size_t size, size_t alignment) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto padding = (alignment - reinterpret_cast<uintptr_t>(m_Next) % alignment) % alignment;
+    if (!m_Next || padding + size > m_Remaining) {
+        // start a new block (a big enough one, in case someone asks for something huge)
+        size_t blockSize = c_BlockSize;
+        if (size + alignment > blockSize) blockSize = size + alignment;
+        m_Blocks.emplace_back(new char[blockSize]);
+        m_Next = m_Blocks.back().get();
+        m_Remaining = blockSize;
+        padding = (alignment - reinterpret_cast<uintptr_t>(m_Next) % alignment) % alignment;
+    }
+    auto result = m_Next + padding;
+    m_Next += padding + size;
+    m_Remaining -= padding + size;
+    m_BytesAllocated += size;
+    return result;
+}
@@ -0,0 +1,98 @@
+#ifndef SRC_SEARCHARENA_H
+#define SRC_SEARCHARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Monotonic memory arena for the vertices and edges of one search tree. Objects allocated from it are bumped off the
+ * end of big blocks, freeing them does nothing, and the blocks all go back to the heap at once when the arena is
+ * destroyed. Each object allocated through ArenaAllocator keeps the arena alive, so that happens when the last vertex
+ * or edge (or whoever else was holding on to one) lets go.
+ *
+ * A plan() call makes one of these for its tree. Allocation takes a lock so the tree can be grown from several threads
+ * (see ParallelAStarPlanner); it's uncontended in the usual single threaded search.
+ */
+class SearchArena : public std::enable_shared_from_this<SearchArena> {
+public:
+    SearchArena() = default;
+
+    SearchArena(const SearchArena&) = delete;
+    SearchArena& operator=(const SearchArena&) = delete;
+
+    /**
+     * Get some memory.
+     * @param size number of bytes
+     * @param alignment
+     * @return
+     */
+    void* allocate(size_t size, size_t alignment);
+
+    /**
+     * @return the number of bytes handed out so far
+     */
+    size_t bytesAllocated() const { return m_BytesAllocated; }
+
+    /**
+     * Make a shared pointer to a T, allocated from arena, or from the heap if arena is null.
+     * @tparam T
+     * @tparam Args
+     * @param arena
+     * @param args constructor arguments
+     * @return
+     */
+    template <class T, class... Args>
+    static std::shared_ptr<T> makeShared(SearchArena* arena, Args&&... args);
+
+private:
+    std::mutex m_Mutex;
+    std::vector<std::unique_ptr<char[]>> m_Blocks;
+    char* m_Next = nullptr;
+    size_t m_Remaining = 0;
+    size_t m_BytesAllocated = 0;
+
+    // 256 vertex/edge pairs or so per block
+    static constexpr size_t c_BlockSize = 1 << 17;
+};
+
+/**
+ * Standard library allocator handing out memory from a SearchArena. Meant for std::allocate_shared, which stores a
+ * copy of the allocator (and so a reference to the arena) with the object.
+ * @tparam T
+ */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(std::shared_ptr<SearchArena> arena) : m_Arena(std::move(arena)) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_Arena(other.arena()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(m_Arena->allocate(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T*, size_t) {} // the arena gets it all back at once
+
+    const std::shared_ptr<SearchArena>& arena() const { return m_Arena; }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_Arena == other.arena(); }
+
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return m_Arena != other.arena(); }
+
+private:
+    std::shared_ptr<SearchArena> m_Arena;
+};
+
+template <class T, class... Args>
+std::shared_ptr<T> SearchArena::makeShared(SearchArena* arena, Args&&... args) {
+    if (!arena) return std::make_shared<T>(std::forward<Args>(args)...);
+    return std::allocate_shared<T>(ArenaAllocator<T>(arena->shared_from_this()), std::forward<Args>(args)...);
+}
+
+
+#endif //SRC_SEARCHARENA_H
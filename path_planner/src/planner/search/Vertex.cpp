@@ -1,5 +1,6 @@
 #include <sstream>
 #include "Vertex.h"
+#include "../utilities/Instrumentation.h"
 
 Vertex::Vertex(State state) {
     this->m_State = state;
@@ -7,6 +8,9 @@ Vertex::Vertex(State state) {
 
 Vertex::Vertex(State state, const std::shared_ptr<Edge>& parent) : Vertex(state) {
     this->m_ParentEdge = parent;
+    this->m_Arena = parent->start()->m_Arena;
+    this->m_HeuristicCache = parent->start()->m_HeuristicCache;
+    this->m_GeometryCache = parent->start()->m_GeometryCache;
 }
 
 std::shared_ptr<Vertex> Vertex::parent() const {
@@ -19,23 +23,32 @@ bool Vertex::isRoot() const {
 }
 
 std::shared_ptr<Vertex> Vertex::connect(const std::shared_ptr<Vertex> &start, const State &next) {
-    auto e = new Edge(start);
+    auto e = SearchArena::makeShared<Edge>(start->m_Arena, start);
     auto v = e->setEnd(next);
     v->m_RibbonManager = start->m_RibbonManager;
     return v;
 }
 
 Vertex::SharedPtr Vertex::connect(const Vertex::SharedPtr& start, const DubinsWrapper& wrapper) {
-    auto e = new Edge(start);
+    auto e = SearchArena::makeShared<Edge>(start->m_Arena, start);
     auto v = e->setEnd(wrapper);
     v->m_RibbonManager = start->m_RibbonManager;
     return v;
 }
 
 Vertex::SharedPtr Vertex::makeRoot(const State& start, const RibbonManager& ribbons) {
-    auto v = std::shared_ptr<Vertex>(new Vertex(start));
+    return makeRoot(start, ribbons, nullptr);
+}
+
+Vertex::SharedPtr Vertex::makeRoot(const State& start, const RibbonManager& ribbons,
+                                   const std::shared_ptr<SearchArena>& arena, HeuristicCache* heuristicCache,
+                                   EdgeGeometryCache* geometryCache) {
+    auto v = SearchArena::makeShared<Vertex>(arena.get(), start);
     v->m_CurrentCost = 0;
     v->m_RibbonManager = ribbons;
+    v->m_Arena = arena.get();
+    v->m_HeuristicCache = heuristicCache;
+    v->m_GeometryCache = geometryCache;
     return v;
 }
 
@@ -44,10 +57,16 @@ double Vertex::estimateApproxToGo(const State &destination) {
 }
 
 double Vertex::computeApproxToGo() {
+    Instrumentation::ScopedTimer timer(Instrumentation::ApproxToGoTime);
+    Instrumentation::count(Instrumentation::ApproxToGos);
     // NOTE: using the current speed for computing time penalty by distance. With just one speed it works.
     // TODO -- pass planner config to retrieve max speed instead of this assumption
     double max;
-    max = m_RibbonManager.approximateDistanceUntilDone(state().x(), state().y(), state().heading());
+    if (m_HeuristicCache) {
+        max = m_HeuristicCache->approximateDistanceUntilDone(m_RibbonManager, state().x(), state().y(), state().heading());
+    } else {
+        max = m_RibbonManager.approximateDistanceUntilDone(state().x(), state().y(), state().heading());
+    }
     m_ApproxToGo = max / state().speed() * Edge::timePenaltyFactor();
 
     return m_ApproxToGo;
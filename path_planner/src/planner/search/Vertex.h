@@ -1,11 +1,15 @@
 #ifndef SRC_VERTEX_H
 #define SRC_VERTEX_H
 
+#include <cstdint>
 #include <memory>
 #include <path_planner_common/State.h>
 #include "Edge.h"
+#include "SearchArena.h"
 //#include "../utilities/Path.h"
 #include "../utilities/RibbonManager.h"
+#include "../utilities/HeuristicCache.h"
+#include "../utilities/EdgeGeometryCache.h"
 #include "path_planner_common/DubinsWrapper.h"
 
 // forward declaration to resolve circular dependency
@@ -22,6 +26,9 @@ class Edge;
  * Pointer ownership structure:
  * A vertex owns the pointer to its parent edge. The root vertex owns nothing. Edges own pointers to their parent vertex
  * but hold only a weak pointer to their child vertex.
+ *
+ * If the root is made with an arena, every vertex and edge connected below it is allocated from that arena too. The
+ * same goes for the heuristic and edge geometry caches.
  */
 class Vertex {
 public:
@@ -61,6 +68,21 @@ public:
      */
     static Vertex::SharedPtr makeRoot(const State& start, const RibbonManager& ribbons);
 
+    /**
+     * Construct a root vertex whose tree is allocated from an arena, and optionally uses a heuristic cache and an edge
+     * geometry cache.
+     * @param start
+     * @param ribbons
+     * @param arena
+     * @param heuristicCache must outlive the heuristic computations in the tree
+     * @param geometryCache must outlive the edge cost computations in the tree
+     * @return
+     */
+    static Vertex::SharedPtr makeRoot(const State& start, const RibbonManager& ribbons,
+                                      const std::shared_ptr<SearchArena>& arena,
+                                      HeuristicCache* heuristicCache = nullptr,
+                                      EdgeGeometryCache* geometryCache = nullptr);
+
     ~Vertex();
 
     /**
@@ -168,7 +190,20 @@ public:
      */
     bool coverageAllowed() const;
 
+    /**
+     * @return the arena this vertex's tree is allocated from (null for the heap)
+     */
+    SearchArena* arena() const { return m_Arena; }
+
+    /**
+     * @return the cache this vertex's edges get their paths and map results from (null for none)
+     */
+    EdgeGeometryCache* geometryCache() const { return m_GeometryCache; }
+
 private:
+    friend class OpenList;
+
+    static constexpr size_t c_NotOnOpenList = SIZE_MAX;
 
     State m_State;
     std::shared_ptr<Edge> m_ParentEdge; // vertex owns its parent edge
@@ -178,6 +213,11 @@ private:
     double m_ApproxToGo = -1;
     double m_TurningRadius;
     bool m_CoverageIsAllowed = false;
+    // kept alive by the allocator stored with this vertex
+    SearchArena* m_Arena = nullptr;
+    HeuristicCache* m_HeuristicCache = nullptr;
+    EdgeGeometryCache* m_GeometryCache = nullptr;
+    size_t m_OpenListIndex = c_NotOnOpenList; // where this is on the open list, if it is
 };
 
 
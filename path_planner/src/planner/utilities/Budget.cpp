@@ -0,0 +1,33 @@
+#include "Budget.h"
+#include <algorithm>
+#include <cmath>
+
+void Budget::start(Mode mode, std::function<double()> now, double seconds, double workPerSecond,
+                   int checkInterval) {
+    m_Mode = mode;
+    m_Now = std::move(now);
+    m_WorkPerSecond = workPerSecond;
+    m_CheckInterval = std::max(1, checkInterval);
+    m_ChecksSinceRead = 0;
+    m_Spent = false;
+    m_Work = 0;
+    if (m_Mode == Work) {
+        auto limit = fmax(0, seconds) * workPerSecond;
+        m_WorkLimit = limit >= (double)UINT64_MAX ? UINT64_MAX : (uint64_t)limit;
+    } else {
+        m_Start = m_Now();
+        m_End = m_Start + seconds;
+    }
+}
+
+bool Budget::spentNow() {
+    if (m_Mode == Work) return work() >= m_WorkLimit;
+    m_ChecksSinceRead = 0;
+    if (!m_Spent) m_Spent = m_Now() >= m_End;
+    return m_Spent;
+}
+
+double Budget::elapsed() const {
+    if (m_Mode == Work) return work() / m_WorkPerSecond;
+    return m_Now() - m_Start;
+}
@@ -0,0 +1,82 @@
+#ifndef SRC_BUDGET_H
+#define SRC_BUDGET_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+/**
+ * How long a plan() call has left. The planner checks whether it's been spent all through the search, so checking it
+ * has to be cheap.
+ *
+ * With a clock budget it's time on whatever clock the config's now function reads (wall or ROS time in the node, or a
+ * simulated clock in tests), read only every few checks. With a work budget it's counted in edge evaluations and
+ * expansions instead, at a fixed rate per second of budget, and the clock isn't read at all, so the same call does the
+ * same search however fast or busy the machine is. That's for benchmarks and tests; the vehicle needs plans on time, so
+ * the node uses the clock.
+ *
+ * Work can be added from any number of threads at once, but only one thread at a time should check.
+ */
+class Budget {
+public:
+    enum Mode {
+        Clock,
+        Work,
+    };
+
+    /**
+     * Start spending a new budget.
+     * @param mode
+     * @param now the clock (only read in Clock mode)
+     * @param seconds how much there is to spend
+     * @param workPerSecond how many units of work a second of budget buys (Work mode)
+     * @param checkInterval how many checks go by between reads of the clock (Clock mode)
+     */
+    void start(Mode mode, std::function<double()> now, double seconds, double workPerSecond, int checkInterval);
+
+    /**
+     * Cheap enough to call on every pop. In Clock mode it only reads the clock every checkInterval calls, so it can
+     * be a few calls late noticing.
+     * @return whether the budget's gone
+     */
+    bool spent() {
+        if (m_Mode == Work) return work() >= m_WorkLimit;
+        if (m_Spent) return true;
+        if (++m_ChecksSinceRead < m_CheckInterval) return false;
+        return spentNow();
+    }
+
+    /**
+     * Like spent() but reads the clock right away. Once it's gone it stays gone, even for spent().
+     * @return
+     */
+    bool spentNow();
+
+    /**
+     * @return seconds spent so far (reads the clock in Clock mode, so not as cheap as spent())
+     */
+    double elapsed() const;
+
+    /**
+     * Count work done. Safe from any thread; Clock mode budgets count it too but don't care.
+     * @param units an edge evaluation or expansion each
+     */
+    void addWork(uint64_t units = 1) { m_Work.fetch_add(units, std::memory_order_relaxed); }
+
+    uint64_t work() const { return m_Work.load(std::memory_order_relaxed); }
+
+    Mode mode() const { return m_Mode; }
+
+private:
+    Mode m_Mode = Clock;
+    std::function<double()> m_Now;
+    double m_Start = 0, m_End = 0;
+    double m_WorkPerSecond = 1;
+    uint64_t m_WorkLimit = 0;
+    std::atomic<uint64_t> m_Work{0};
+    int m_CheckInterval = 1, m_ChecksSinceRead = 0;
+    bool m_Spent = false;
+};
+
+
+#endif //SRC_BUDGET_H
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include "CoverageBitmap.h"
+
+constexpr double CoverageBitmap::c_BinsPerWidth;
+
+CoverageBitmap::CoverageBitmap(const Ribbon& line)
+    : m_Line(line), m_Length(line.length()), m_Resolution(Ribbon::RibbonWidth / c_BinsPerWidth) {
+    m_Bins = std::max<size_t>(1, (size_t)ceil(m_Length / m_Resolution));
+    m_Bits.assign((m_Bins + 63) / 64, 0);
+    update();
+}
+
+bool CoverageBitmap::range(double x, double y, size_t& first, size_t& last) const {
+    auto projected = m_Line.getProjection(x, y);
+    if (!m_Line.contains(x, y, projected)) return false;
+    auto s = fmax(0, fmin(m_Length, hypot(projected.first - m_Line.start().first,
+                                          projected.second - m_Line.start().second)));
+    // the bins whose centers are within a ribbon width of the projection
+    auto from = ceil((s - Ribbon::RibbonWidth) / m_Resolution - 0.5);
+    auto to = floor((s + Ribbon::RibbonWidth) / m_Resolution - 0.5) + 1;
+    first = (size_t)fmax(0, from);
+    last = (size_t)fmax(0, fmin((double)m_Bins, to));
+    return true;
+}
+
+bool CoverageBitmap::wouldCover(double x, double y) const {
+    size_t first, last;
+    if (!range(x, y, first, last)) return false;
+    for (auto i = first; i < last; i++) if (!test(i)) return true;
+    return false;
+}
+
+bool CoverageBitmap::cover(double x, double y) {
+    size_t first, last;
+    if (!range(x, y, first, last)) return false;
+    bool changed = false;
+    for (auto i = first; i < last; i++) {
+        if (test(i)) continue;
+        set(i);
+        changed = true;
+    }
+    if (changed) update();
+    return changed;
+}
+
+void CoverageBitmap::update() {
+    m_Uncovered.clear();
+    auto start = m_Line.start(), end = m_Line.end();
+    auto dx = m_Length > 0 ? (end.first - start.first) / m_Length : 0;
+    auto dy = m_Length > 0 ? (end.second - start.second) / m_Length : 0;
+    size_t i = 0;
+    while (i < m_Bins) {
+        // skip whole words of covered bins
+        if ((i & 63) == 0 && m_Bits[i >> 6] == ~uint64_t(0)) {
+            i += 64;
+            continue;
+        }
+        if (test(i)) {
+            i++;
+            continue;
+        }
+        auto runStart = i;
+        while (i < m_Bins && !test(i)) i++;
+        auto from = runStart * m_Resolution, to = fmin(i * m_Resolution, m_Length);
+        Ribbon r(start.first + dx * from, start.second + dy * from, start.first + dx * to, start.second + dy * to);
+        if (r.covered()) {
+            // too short to count, so it's done
+            for (auto j = runStart; j < i; j++) set(j);
+        } else {
+            m_Uncovered.push_back(r);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef SRC_COVERAGEBITMAP_H
+#define SRC_COVERAGEBITMAP_H
+
+#include <cstdint>
+#include <vector>
+#include "Ribbon.h"
+
+/**
+ * What's been covered of one survey line, as a bitmap of fixed length bins along it. This is the alternative to
+ * splitting ribbons: the line itself never changes, covering a point just sets the bins within a ribbon width of its
+ * projection, and what's left to do is the runs of unset bins.
+ *
+ * Runs shorter than Ribbon::minLength() don't count, same as a ribbon that short counts as covered, so their bins get
+ * set as soon as they show up. That way a cover that sets no bins changes nothing.
+ */
+class CoverageBitmap {
+public:
+    /**
+     * Start with none of the line covered.
+     * @param line
+     */
+    explicit CoverageBitmap(const Ribbon& line);
+
+    /**
+     * Cover (x, y), if it's within the line's ribbon.
+     * @param x
+     * @param y
+     * @return whether anything that was left got covered
+     */
+    bool cover(double x, double y);
+
+    /**
+     * @param x
+     * @param y
+     * @return whether cover(x, y) would change anything, without changing it
+     */
+    bool wouldCover(double x, double y) const;
+
+    /**
+     * @return what's left of the line, as ribbons, from its start to its end
+     */
+    const std::vector<Ribbon>& uncovered() const { return m_Uncovered; }
+
+    /**
+     * @return the whole line
+     */
+    const Ribbon& line() const { return m_Line; }
+
+    /**
+     * @return the bin length
+     */
+    double resolution() const { return m_Resolution; }
+
+private:
+    Ribbon m_Line;
+    double m_Length, m_Resolution;
+    size_t m_Bins;
+    std::vector<uint64_t> m_Bits;
+    std::vector<Ribbon> m_Uncovered;
+
+    // bins per (one sided) ribbon width
+    static constexpr double c_BinsPerWidth = 4;
+
+    bool test(size_t i) const { return (m_Bits[i >> 6] >> (i & 63)) & 1; }
+
+    void set(size_t i) { m_Bits[i >> 6] |= uint64_t(1) << (i & 63); }
+
+    /**
+     * Find the bins a cover at (x, y) would set.
+     * @param x
+     * @param y
+     * @param first
+     * @param last one past the end
+     * @return false if (x, y) isn't in the ribbon at all
+     */
+    bool range(double x, double y, size_t& first, size_t& last) const;
+
+    /**
+     * Rebuild m_Uncovered from the bits (setting the bins of any runs too short to count).
+     */
+    void update();
+};
+
+
+#endif //SRC_COVERAGEBITMAP_H
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cmath>
+extern "C" {
+#include <dubins.h>
+}
+#include "DubinsTable.h"
+
+constexpr double DubinsTable::c_Extent;
+constexpr double DubinsTable::c_PositionStep;
+constexpr int DubinsTable::c_PositionNodes;
+constexpr int DubinsTable::c_HeadingNodes;
+
+DubinsTable::DubinsTable() {
+    m_Lengths.resize((size_t)c_PositionNodes * c_PositionNodes * c_HeadingNodes);
+    double q1[] = {0, 0, 0};
+    DubinsPath path;
+    for (int i = 0; i < c_PositionNodes; i++) {
+        for (int j = 0; j < c_PositionNodes; j++) {
+            for (int k = 0; k < c_HeadingNodes; k++) {
+                double q2[] = {-c_Extent + i * c_PositionStep, -c_Extent + j * c_PositionStep,
+                               k * 2 * M_PI / c_HeadingNodes};
+                dubins_shortest_path(&path, q1, q2, 1);
+                m_Lengths[(i * c_PositionNodes + j) * c_HeadingNodes + k] = (float)dubins_path_length(&path);
+            }
+        }
+    }
+}
+
+const DubinsTable& DubinsTable::instance() {
+    static const DubinsTable table;
+    return table;
+}
+
+double DubinsTable::lookup(double x, double y, double theta) const {
+    auto fi = (x + c_Extent) / c_PositionStep, fj = (y + c_Extent) / c_PositionStep;
+    auto fk = theta / (2 * M_PI) * c_HeadingNodes;
+    int i = std::min((int)fi, c_PositionNodes - 2), j = std::min((int)fj, c_PositionNodes - 2);
+    int k = std::min((int)fk, c_HeadingNodes - 1);
+    auto u = fi - i, v = fj - j, w = fk - k;
+    int k1 = (k + 1) % c_HeadingNodes; // heading wraps around
+    auto lerp = [] (double a, double b, double t) { return a + (b - a) * t; };
+    auto c00 = lerp(at(i, j, k), at(i, j, k1), w), c01 = lerp(at(i, j + 1, k), at(i, j + 1, k1), w);
+    auto c10 = lerp(at(i + 1, j, k), at(i + 1, j, k1), w), c11 = lerp(at(i + 1, j + 1, k), at(i + 1, j + 1, k1), w);
+    return lerp(lerp(c00, c01, v), lerp(c10, c11, v), u);
+}
+
+double DubinsTable::length(double x1, double y1, double yaw1, double x2, double y2, double yaw2,
+                           double turningRadius) {
+    // target in the start's frame, in turning radii
+    auto dx = (x2 - x1) / turningRadius, dy = (y2 - y1) / turningRadius;
+    auto c = cos(yaw1), s = sin(yaw1);
+    auto x = c * dx + s * dy, y = -s * dx + c * dy;
+    if (!(fabs(x) < c_Extent && fabs(y) < c_Extent)) return exactLength(x1, y1, yaw1, x2, y2, yaw2, turningRadius);
+    auto theta = fmod(yaw2 - yaw1, 2 * M_PI);
+    if (theta < 0) theta += 2 * M_PI;
+    return instance().lookup(x, y, theta) * turningRadius;
+}
+
+double DubinsTable::exactLength(double x1, double y1, double yaw1, double x2, double y2, double yaw2,
+                                double turningRadius) {
+    DubinsPath path;
+    double q1[] = {x1, y1, yaw1}, q2[] = {x2, y2, yaw2};
+    dubins_shortest_path(&path, q1, q2, turningRadius);
+    return dubins_path_length(&path);
+}
@@ -0,0 +1,82 @@
+#ifndef SRC_DUBINSTABLE_H
+#define SRC_DUBINSTABLE_H
+
+#include <cmath>
+#include <vector>
+
+/**
+ * Precomputed Dubins path lengths, for when all we need is a length (heuristics, ranking candidate edges) and not the
+ * path itself.
+ *
+ * The length only depends on where the target is relative to the start, and scales with the turning radius, so one
+ * table of lengths for unit turning radius works for every radius. It covers targets within c_Extent turning radii of
+ * the start (in the start's frame) and interpolates trilinearly between grid points; anything further away than that
+ * is computed exactly. The table is built the first time it's used, which takes a few hundred thousand Dubins
+ * solutions, and shared after that.
+ *
+ * Interpolating across the places where the shortest path switches type can be off by a fair bit, so don't use this
+ * for anything that has to be exact.
+ */
+class DubinsTable {
+public:
+    /**
+     * Approximate Dubins distance from (x1, y1, yaw1) to (x2, y2, yaw2). Yaws are radians north of east, like the
+     * dubins library takes them.
+     * @param x1
+     * @param y1
+     * @param yaw1
+     * @param x2
+     * @param y2
+     * @param yaw2
+     * @param turningRadius
+     * @return
+     */
+    static double length(double x1, double y1, double yaw1, double x2, double y2, double yaw2, double turningRadius);
+
+    /**
+     * The same thing straight from the dubins library.
+     */
+    static double exactLength(double x1, double y1, double yaw1, double x2, double y2, double yaw2,
+                              double turningRadius);
+
+    /**
+     * A lower bound on the Dubins distance which is cheaper than even the table: the path is at least as long as the
+     * straight line, and as the arc it takes to turn through the difference in heading.
+     */
+    static double lowerBound(double x1, double y1, double yaw1, double x2, double y2, double yaw2,
+                             double turningRadius) {
+        auto turn = fabs(fmod(yaw2 - yaw1, 2 * M_PI));
+        if (turn > M_PI) turn = 2 * M_PI - turn;
+        return fmax(sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)), turn * turningRadius);
+    }
+
+    /**
+     * How far out the table goes, in turning radii.
+     */
+    static constexpr double c_Extent = 8;
+
+private:
+    DubinsTable();
+
+    static const DubinsTable& instance();
+
+    /**
+     * Interpolate the unit turning radius table.
+     * @param x target position in the start's frame, in turning radii, within c_Extent
+     * @param y
+     * @param theta target heading relative to the start's, in [0, 2pi)
+     * @return
+     */
+    double lookup(double x, double y, double theta) const;
+
+    float at(int i, int j, int k) const { return m_Lengths[(i * c_PositionNodes + j) * c_HeadingNodes + k]; }
+
+    static constexpr double c_PositionStep = 0.25;
+    static constexpr int c_PositionNodes = 2 * (int)(c_Extent / c_PositionStep) + 1;
+    static constexpr int c_HeadingNodes = 72;
+
+    std::vector<float> m_Lengths;
+};
+
+
+#endif //SRC_DUBINSTABLE_H
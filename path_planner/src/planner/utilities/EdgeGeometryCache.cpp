@@ -0,0 +1,107 @@
+#include <sstream>
+#include "EdgeGeometryCache.h"
+
+constexpr size_t EdgeGeometryCache::c_DefaultCapacity;
+
+bool EdgeGeometryCache::Entry::blocked(size_t samples, size_t& firstBlocked) const {
+    if (FirstBlocked < Checked) {
+        firstBlocked = FirstBlocked < samples ? FirstBlocked : samples;
+        return true;
+    }
+    if (Checked < samples) return false;
+    firstBlocked = samples;
+    return true;
+}
+
+EdgeGeometryCache::EdgeGeometryCache(size_t capacity) : m_Capacity(capacity) {}
+
+bool EdgeGeometryCache::Key::operator==(const Key& other) const {
+    for (int i = 0; i < 8; i++) if (Values[i] != other.Values[i]) return false;
+    return true;
+}
+
+size_t EdgeGeometryCache::KeyHash::operator()(const Key& key) const {
+    size_t h = 0;
+    for (auto v : key.Values) h = h * 31 + std::hash<double>()(v);
+    return h;
+}
+
+EdgeGeometryCache::Key EdgeGeometryCache::key(const State& from, const State& to, double turningRadius) {
+    return Key{{from.x(), from.y(), from.heading(), from.speed(), to.x(), to.y(), to.heading(), turningRadius}};
+}
+
+bool EdgeGeometryCache::find(const State& from, const State& to, double turningRadius, Entry& entry) {
+    auto k = key(from, to, turningRadius);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_PathLookups++;
+    auto it = m_Index.find(k);
+    if (it == m_Index.end()) return false;
+    m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+    entry = it->second->second;
+    m_PathHits++;
+    return true;
+}
+
+bool EdgeGeometryCache::findBlocked(const State& from, const State& to, double turningRadius, size_t samples,
+                                    size_t& firstBlocked) {
+    auto k = key(from, to, turningRadius);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MapLookups++;
+    auto it = m_Index.find(k);
+    if (it == m_Index.end() || !it->second->second.blocked(samples, firstBlocked)) return false;
+    m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+    m_MapHits++;
+    return true;
+}
+
+void EdgeGeometryCache::store(const State& from, const State& to, double turningRadius, const Entry& entry) {
+    if (m_Capacity == 0) return;
+    auto k = key(from, to, turningRadius);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Index.find(k);
+    if (it != m_Index.end()) {
+        auto& existing = it->second->second;
+        // something blocked is as much as there is to know, otherwise further along knows more
+        if (existing.FirstBlocked == existing.Checked && entry.Checked > existing.Checked) {
+            existing.Checked = entry.Checked;
+            existing.FirstBlocked = entry.FirstBlocked;
+        }
+        m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+        return;
+    }
+    if (m_Entries.size() >= m_Capacity) {
+        m_Index.erase(m_Entries.back().first);
+        m_Entries.pop_back();
+    }
+    m_Entries.emplace_front(k, entry);
+    m_Index.emplace(k, m_Entries.begin());
+}
+
+void EdgeGeometryCache::clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+    m_Index.clear();
+    m_PathLookups = m_PathHits = m_MapLookups = m_MapHits = 0;
+}
+
+void EdgeGeometryCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Capacity = capacity;
+    while (m_Entries.size() > m_Capacity) {
+        m_Index.erase(m_Entries.back().first);
+        m_Entries.pop_back();
+    }
+}
+
+size_t EdgeGeometryCache::size() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Entries.size();
+}
+
+std::string EdgeGeometryCache::summary() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::stringstream stream;
+    stream << m_PathHits << "/" << m_PathLookups << " edge path and " << m_MapHits << "/" << m_MapLookups
+           << " map result cache hits";
+    return stream.str();
+}
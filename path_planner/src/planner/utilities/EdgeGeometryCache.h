@@ -0,0 +1,131 @@
+#ifndef SRC_EDGEGEOMETRYCACHE_H
+#define SRC_EDGEGEOMETRYCACHE_H
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <path_planner_common/State.h>
+#include <path_planner_common/DubinsWrapper.h>
+
+/**
+ * Cache of the parts of edges which don't depend on time, for one plan() call: the Dubins path between two poses, and
+ * how far along it the static map blocks it. Every iteration starts the open list over, and vertices on the same
+ * sample get connected to the same samples again, so the same Dubins problems come up over and over with different
+ * parents (and, without incremental search, the same parents). Dynamic obstacles and coverage depend on when the edge
+ * is taken and which ribbons are left, so those are still done every time.
+ *
+ * Keys are the exact poses, turning radius and speed (the speed sets where the samples go), so a hit is the same edge.
+ * It holds at most capacity() entries, dropping the least recently used. Lookups can come from several threads at once
+ * (see ParallelAStarPlanner), so it's locked. Read the stats once the search is done.
+ */
+class EdgeGeometryCache {
+public:
+    /**
+     * What's known about an edge.
+     */
+    struct Entry {
+        DubinsPath Path;
+        // how many samples from the start have been checked against the map, and the first of them that's blocked
+        // (Checked if none are)
+        size_t Checked = 0, FirstBlocked = 0;
+
+        /**
+         * @param samples how many samples the edge is being checked up to
+         * @param firstBlocked set to the first of them that's blocked (samples if none are), if that's known
+         * @return whether the map result for that many samples is known
+         */
+        bool blocked(size_t samples, size_t& firstBlocked) const;
+    };
+
+    explicit EdgeGeometryCache(size_t capacity = c_DefaultCapacity);
+
+    /**
+     * Look an edge's path up.
+     * @param from
+     * @param to
+     * @param turningRadius
+     * @param entry set to what's known, if it's there
+     * @return whether it's there
+     */
+    bool find(const State& from, const State& to, double turningRadius, Entry& entry);
+
+    /**
+     * Look up whether an edge is blocked by the map.
+     * @param from
+     * @param to
+     * @param turningRadius
+     * @param samples how many samples the edge is being checked up to
+     * @param firstBlocked set to the first of them that's blocked (samples if none are), if that's known
+     * @return whether it's known
+     */
+    bool findBlocked(const State& from, const State& to, double turningRadius, size_t samples, size_t& firstBlocked);
+
+    /**
+     * Remember an edge. If it's there already, the map result only gets replaced if this one knows more.
+     * @param from
+     * @param to
+     * @param turningRadius
+     * @param entry
+     */
+    void store(const State& from, const State& to, double turningRadius, const Entry& entry);
+
+    /**
+     * Forget everything, including the stats.
+     */
+    void clear();
+
+    size_t size() const;
+
+    size_t capacity() const { return m_Capacity; }
+
+    /**
+     * Change how many entries it holds, dropping the least recently used ones if there are too many now.
+     * @param capacity
+     */
+    void setCapacity(size_t capacity);
+
+    /**
+     * @return how many path lookups there were, and how many found it
+     */
+    unsigned long pathLookups() const { return m_PathLookups; }
+    unsigned long pathHits() const { return m_PathHits; }
+
+    /**
+     * @return how many map lookups there were, and how many had the answer
+     */
+    unsigned long mapLookups() const { return m_MapLookups; }
+    unsigned long mapHits() const { return m_MapHits; }
+
+    /**
+     * @return a short summary of the stats, for the end of plan output
+     */
+    std::string summary() const;
+
+    static constexpr size_t c_DefaultCapacity = 1 << 16;
+
+private:
+    struct Key {
+        double Values[8];
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    typedef std::list<std::pair<Key, Entry>> List;
+
+    mutable std::mutex m_Mutex;
+    // most recently used first
+    List m_Entries;
+    std::unordered_map<Key, List::iterator, KeyHash> m_Index;
+    size_t m_Capacity;
+    unsigned long m_PathLookups = 0, m_PathHits = 0, m_MapLookups = 0, m_MapHits = 0;
+
+    static Key key(const State& from, const State& to, double turningRadius);
+};
+
+
+#endif //SRC_EDGEGEOMETRYCACHE_H
@@ -0,0 +1,62 @@
+#include <cfloat>
+#include <stdexcept>
+#include "HeldKarpTable.h"
+
+HeldKarpTable::HeldKarpTable(const std::vector<Ribbon>& ribbons, const DistanceFunction& distance)
+    : m_Count(ribbons.size()) {
+    if (m_Count > MaxRibbons) throw std::logic_error("Too many ribbons for a Held-Karp table");
+    const int endpoints = 2 * m_Count;
+    for (const auto& r : ribbons) {
+        m_TotalLength += r.length();
+        auto start = r.startAsState(), end = r.endAsState();
+        // forwards (start to end)
+        m_Entries.push_back(start);
+        m_Exits.push_back(end);
+        m_Exits.back().heading() = start.heading();
+        // backwards (end to start)
+        m_Entries.push_back(end);
+        m_Exits.push_back(start);
+        m_Exits.back().heading() = end.heading();
+    }
+
+    // transitions[a * endpoints + b] is the distance from leaving at a to starting at b
+    std::vector<double> transitions(endpoints * endpoints, 0);
+    for (int a = 0; a < endpoints; a++) {
+        for (int b = 0; b < endpoints; b++) {
+            if (a / 2 != b / 2) transitions[a * endpoints + b] = distance(m_Exits[a], m_Entries[b]);
+        }
+    }
+
+    // Masks only ever reference smaller masks so we can just go in order
+    const unsigned long masks = 1ul << m_Count;
+    m_Table.assign(masks * endpoints, DBL_MAX);
+    for (int a = 0; a < endpoints; a++) m_Table[a] = 0;
+    for (unsigned long mask = 1; mask < masks; mask++) {
+        auto row = &m_Table[mask * endpoints];
+        for (int a = 0; a < endpoints; a++) {
+            if (mask & (1ul << (a / 2))) continue; // we can't have just left a ribbon we still have to do
+            auto best = DBL_MAX;
+            for (int j = 0; j < m_Count; j++) {
+                if (!(mask & (1ul << j))) continue;
+                auto rest = &m_Table[(mask & ~(1ul << j)) * endpoints];
+                for (int b = 2 * j; b < 2 * j + 2; b++) {
+                    auto c = transitions[a * endpoints + b] + rest[b];
+                    if (c < best) best = c;
+                }
+            }
+            row[a] = best;
+        }
+    }
+}
+
+double HeldKarpTable::cost(const std::function<double(const State& to)>& firstLeg) const {
+    if (m_Count == 0) return 0;
+    const int endpoints = 2 * m_Count;
+    const unsigned long all = (1ul << m_Count) - 1;
+    auto best = DBL_MAX;
+    for (int b = 0; b < endpoints; b++) {
+        auto c = firstLeg(m_Entries[b]) + m_Table[(all & ~(1ul << (b / 2))) * endpoints + b];
+        if (c < best) best = c;
+    }
+    return best + m_TotalLength;
+}
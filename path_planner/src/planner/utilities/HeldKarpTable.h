@@ -0,0 +1,58 @@
+#ifndef SRC_HELDKARPTABLE_H
+#define SRC_HELDKARPTABLE_H
+
+#include <functional>
+#include <vector>
+#include <path_planner_common/State.h>
+#include "Ribbon.h"
+
+/**
+ * Held-Karp dynamic programming table for the "cover every ribbon, no splitting" TSP heuristics.
+ *
+ * Each ribbon can be driven in either direction. The table holds, for every set of ribbons still to go and every
+ * ribbon and direction we just finished, the cheapest way to get through the rest of the set. None of that depends on
+ * where the boat is, so a table is built once for a set of ribbons and every query after that is just trying each
+ * ribbon (and direction) first, which is linear in the number of ribbons.
+ *
+ * Building is O(2^n n^2) time and O(2^n n) memory, so keep n down to a dozen or so.
+ */
+class HeldKarpTable {
+public:
+    typedef std::function<double(const State& from, const State& to)> DistanceFunction;
+
+    /**
+     * Build the table.
+     * @param ribbons
+     * @param distance distance between the end of one ribbon and the start of the next. The states have their heading
+     * set to the direction of travel along the ribbon.
+     */
+    HeldKarpTable(const std::vector<Ribbon>& ribbons, const DistanceFunction& distance);
+
+    /**
+     * Find the cost to cover all the ribbons.
+     * @param firstLeg distance to get to the start of the first ribbon from wherever we are
+     * @return
+     */
+    double cost(const std::function<double(const State& to)>& firstLeg) const;
+
+    /**
+     * @return the number of ribbons in the table
+     */
+    int size() const { return m_Count; }
+
+    /**
+     * The largest number of ribbons a table can be built for.
+     */
+    static constexpr int MaxRibbons = 16;
+
+private:
+    int m_Count;
+    double m_TotalLength = 0;
+    // m_Entries[2i + d] is where you start ribbon i going in direction d, m_Exits[2i + d] where you leave it
+    std::vector<State> m_Entries, m_Exits;
+    // m_Table[mask * 2n + 2i + d] is the cheapest way to cover the ribbons in mask after leaving ribbon i in direction d
+    std::vector<double> m_Table;
+};
+
+
+#endif //SRC_HELDKARPTABLE_H
@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include "HeuristicCache.h"
+
+double HeuristicCache::approximateDistanceUntilDone(const RibbonManager& ribbonManager, double x, double y,
+                                                    double yaw) {
+    bool lipschitz = ribbonManager.heuristic() == RibbonManager::MaxDistance ||
+                     ribbonManager.heuristic() == RibbonManager::TspPointRobotNoSplitAllRibbons ||
+                     ribbonManager.heuristic() == RibbonManager::MstLowerBound;
+    Key key{ribbonManager.version(), (int64_t)floor(x / c_PositionResolution), (int64_t)floor(y / c_PositionResolution),
+            lipschitz ? 0 : (int64_t)floor(yaw / c_YawResolution)};
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Entries.find(key);
+        if (it != m_Entries.end()) {
+            const auto& e = it->second;
+            if (e.X == x && e.Y == y && e.Yaw == yaw) {
+                m_Hits++;
+                return e.Value;
+            }
+            if (lipschitz) {
+                // the value can't have changed by more than the distance from where it was computed
+                m_Hits++;
+                return fmax(0, e.Value - sqrt((e.X - x) * (e.X - x) + (e.Y - y) * (e.Y - y)));
+            }
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto value = ribbonManager.heuristic() == m_Heuristic ? m_Function(ribbonManager, x, y, yaw)
+                                                          : ribbonManager.approximateDistanceUntilDone(x, y, yaw);
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MissSeconds += seconds;
+    m_Misses++;
+    m_Entries[key] = Entry{x, y, yaw, value};
+    return value;
+}
+
+void HeuristicCache::clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+    m_Hits = m_Misses = 0;
+    m_MissSeconds = 0;
+}
+
+void HeuristicCache::setHeuristic(RibbonManager::Heuristic heuristic) {
+    m_Heuristic = heuristic;
+    m_Function = RibbonManager::heuristicFunction(heuristic);
+}
+
+double HeuristicCache::secondsSaved() const {
+    if (m_Misses == 0) return 0;
+    return m_Hits * m_MissSeconds / m_Misses;
+}
+
+std::string HeuristicCache::summary() const {
+    std::stringstream stream;
+    stream << m_Hits << "/" << lookups() << " heuristic cache hits";
+    if (lookups() > 0) stream << " (" << (int)(100.0 * m_Hits / lookups()) << "%)";
+    stream << ", ~" << secondsSaved() * 1000 << "ms saved";
+    return stream.str();
+}
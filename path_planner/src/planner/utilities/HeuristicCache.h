@@ -0,0 +1,104 @@
+#ifndef SRC_HEURISTICCACHE_H
+#define SRC_HEURISTICCACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "RibbonManager.h"
+
+/**
+ * Cache of ribbon heuristic values for one plan() call.
+ *
+ * Most edges don't cover anything, so lots of vertices have the same ribbons left, and since vertices sit on samples
+ * lots of them have the same pose too. Values are keyed on the ribbon manager's version plus the pose rounded to a
+ * grid. The max distance, spanning tree and all ribbons point robot TSP heuristics change by no more than the distance
+ * moved, so for those we hand back the cached value minus the rounding error, which keeps it a lower bound. The others
+ * don't behave that nicely so they only get a hit on exactly the same pose.
+ *
+ * Lookups can come from several threads at once (see ParallelAStarPlanner): the table is locked, but misses are computed
+ * outside the lock. Read the stats once the search is done.
+ */
+class HeuristicCache {
+public:
+    HeuristicCache() = default;
+
+    /**
+     * Get the heuristic value (RibbonManager::approximateDistanceUntilDone), from the cache if possible.
+     * @param ribbonManager
+     * @param x
+     * @param y
+     * @param yaw
+     * @return
+     */
+    double approximateDistanceUntilDone(const RibbonManager& ribbonManager, double x, double y, double yaw);
+
+    /**
+     * Forget everything, including the stats.
+     */
+    void clear();
+
+    /**
+     * Bind the heuristic the search will be using (see RibbonManager::heuristicFunction), so misses can call it
+     * without switching on the heuristic each time. Anything using a different one still works, the slow way. Call
+     * it before the search starts, not during.
+     * @param heuristic
+     */
+    void setHeuristic(RibbonManager::Heuristic heuristic);
+
+    /**
+     * @return how many lookups were answered from the cache
+     */
+    unsigned long hits() const { return m_Hits; }
+
+    /**
+     * @return how many lookups in total
+     */
+    unsigned long lookups() const { return m_Hits + m_Misses; }
+
+    /**
+     * @return a guess at the time saved, using the average time taken by misses
+     */
+    double secondsSaved() const;
+
+    /**
+     * @return a short summary of the stats, for the end of plan output
+     */
+    std::string summary() const;
+
+private:
+    struct Key {
+        uint64_t Version;
+        int64_t X, Y, Yaw;
+        bool operator==(const Key& other) const {
+            return Version == other.Version && X == other.X && Y == other.Y && Yaw == other.Yaw;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t h = std::hash<uint64_t>()(key.Version);
+            h = h * 31 + std::hash<int64_t>()(key.X);
+            h = h * 31 + std::hash<int64_t>()(key.Y);
+            return h * 31 + std::hash<int64_t>()(key.Yaw);
+        }
+    };
+
+    struct Entry {
+        double X, Y, Yaw;
+        double Value;
+    };
+
+    std::mutex m_Mutex;
+    std::unordered_map<Key, Entry, KeyHash> m_Entries;
+    RibbonManager::Heuristic m_Heuristic = RibbonManager::MaxDistance;
+    RibbonManager::HeuristicFunction m_Function = RibbonManager::heuristicFunction(RibbonManager::MaxDistance);
+    unsigned long m_Hits = 0, m_Misses = 0;
+    double m_MissSeconds = 0;
+
+    static constexpr double c_PositionResolution = 0.1;
+    static constexpr double c_YawResolution = 0.01;
+};
+
+
+#endif //SRC_HEURISTICCACHE_H
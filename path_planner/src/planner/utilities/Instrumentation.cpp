@@ -0,0 +1,74 @@
+#include "Instrumentation.h"
+#include <atomic>
+#include <chrono>
+#include <sstream>
+
+const char* Instrumentation::Report::name(Counter counter) {
+    switch (counter) {
+        case TrueCosts: return "true_costs";
+        case InfeasibleEdges: return "infeasible_edges";
+        case MapQueries: return "map_queries";
+        case ObstacleQueries: return "obstacle_queries";
+        case CoverQueries: return "cover_queries";
+        case ApproxToGos: return "approx_to_gos";
+        case Expansions: return "expansions";
+        case NearestCandidates: return "nearest_candidates";
+        case Offers: return "offers";
+        case Pushes: return "pushes";
+        case Pops: return "pops";
+        default: return "unknown";
+    }
+}
+
+const char* Instrumentation::Report::name(Timer timer) {
+    switch (timer) {
+        case TrueCostTime: return "true_cost_seconds";
+        case MapTime: return "map_seconds";
+        case ObstacleTime: return "obstacle_seconds";
+        case CoverTime: return "cover_seconds";
+        case ApproxToGoTime: return "approx_to_go_seconds";
+        case NearestTime: return "nearest_seconds";
+        case PushTime: return "push_seconds";
+        case PopTime: return "pop_seconds";
+        default: return "unknown";
+    }
+}
+
+std::string Instrumentation::Report::toString() const {
+    std::stringstream stream;
+    for (int i = 0; i < CounterCount; i++) stream << name((Counter)i) << ": " << Counts[i] << "\n";
+    for (int i = 0; i < TimerCount; i++) stream << name((Timer)i) << ": " << Seconds[i] << "\n";
+    return stream.str();
+}
+
+#ifdef PATH_PLANNER_INSTRUMENTATION
+
+namespace {
+// relaxed adds from whichever threads are planning; nothing else is ordered by them
+std::atomic<uint64_t> g_Counts[Instrumentation::CounterCount];
+std::atomic<uint64_t> g_Nanoseconds[Instrumentation::TimerCount];
+}
+
+void Instrumentation::count(Counter counter, uint64_t n) {
+    g_Counts[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void Instrumentation::time(Timer timer, uint64_t nanoseconds) {
+    g_Nanoseconds[timer].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+uint64_t Instrumentation::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Instrumentation::Report Instrumentation::take() {
+    Report report;
+    for (int i = 0; i < CounterCount; i++) report.Counts[i] = g_Counts[i].exchange(0, std::memory_order_relaxed);
+    for (int i = 0; i < TimerCount; i++) {
+        report.Seconds[i] = g_Nanoseconds[i].exchange(0, std::memory_order_relaxed) * 1e-9;
+    }
+    return report;
+}
+
+#endif
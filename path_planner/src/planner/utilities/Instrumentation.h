@@ -0,0 +1,104 @@
+#ifndef SRC_INSTRUMENTATION_H
+#define SRC_INSTRUMENTATION_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Counters and timers for where the planner's time goes. Everything is summed over all the threads doing planning and
+ * handed out a planning cycle at a time by take().
+ *
+ * It's only compiled in with PATH_PLANNER_INSTRUMENTATION (the INSTRUMENTATION CMake option). Otherwise all of this is
+ * empty inline functions, so the hot paths cost exactly what they did before. Timing the individual map, obstacle and
+ * coverage queries costs a couple of clock reads each, so with it on the timings come out somewhat inflated.
+ */
+class Instrumentation {
+public:
+    enum Counter {
+        TrueCosts, // edges collision checked
+        InfeasibleEdges,
+        MapQueries,
+        ObstacleQueries, // distance bounds and batched densities
+        CoverQueries,
+        ApproxToGos,
+        Expansions,
+        NearestCandidates, // samples looked at while choosing children
+        Offers, // vertices offered to the open list; the ones that weren't pushed were infeasible, dominated or no
+                // better than the incumbent
+        Pushes,
+        Pops,
+        CounterCount
+    };
+
+    enum Timer {
+        TrueCostTime, // the whole of computeTrueCost, including the three below
+        MapTime,
+        ObstacleTime,
+        CoverTime,
+        ApproxToGoTime,
+        NearestTime, // choosing children
+        PushTime, // offers, including the ones that weren't pushed
+        PopTime,
+        TimerCount
+    };
+
+    /**
+     * What's been counted since the last take().
+     */
+    struct Report {
+        uint64_t Counts[CounterCount] = {};
+        double Seconds[TimerCount] = {};
+
+        static const char* name(Counter counter);
+        static const char* name(Timer timer);
+
+        /**
+         * @return one "name: value" per line
+         */
+        std::string toString() const;
+    };
+
+    /**
+     * Times the scope it's in.
+     */
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Timer timer) : m_Timer(timer), m_Start(Instrumentation::now()) {}
+        ~ScopedTimer() { Instrumentation::time(m_Timer, Instrumentation::now() - m_Start); }
+    private:
+        Timer m_Timer;
+        uint64_t m_Start;
+    };
+
+#ifdef PATH_PLANNER_INSTRUMENTATION
+    static constexpr bool enabled() { return true; }
+
+    static void count(Counter counter, uint64_t n = 1);
+
+    /**
+     * @param timer
+     * @param nanoseconds
+     */
+    static void time(Timer timer, uint64_t nanoseconds);
+
+    /**
+     * @return a monotonic time in nanoseconds
+     */
+    static uint64_t now();
+
+    /**
+     * Everything counted since last time, starting again from zero.
+     * @return
+     */
+    static Report take();
+#else
+    static constexpr bool enabled() { return false; }
+    static void count(Counter, uint64_t = 1) {}
+    static void time(Timer, uint64_t) {}
+    static uint64_t now() { return 0; }
+    static Report take() { return Report(); }
+#endif
+};
+
+
+#endif //SRC_INSTRUMENTATION_H
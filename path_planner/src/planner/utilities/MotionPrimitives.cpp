@@ -0,0 +1,114 @@
+#include <cmath>
+#include <stdexcept>
+#include "MotionPrimitives.h"
+
+constexpr int MotionPrimitives::c_Headings;
+constexpr double MotionPrimitives::c_Reach;
+constexpr double MotionPrimitives::c_MaxBearing;
+constexpr double MotionPrimitives::c_MaxDetour;
+constexpr double MotionPrimitives::c_Tolerance;
+
+namespace {
+
+// difference between two angles, in [-pi, pi)
+double angleBetween(double from, double to) {
+    auto d = fmod(to - from + M_PI, 2 * M_PI);
+    if (d < 0) d += 2 * M_PI;
+    return d - M_PI;
+}
+
+int wrap(int heading) {
+    return ((heading % MotionPrimitives::c_Headings) + MotionPrimitives::c_Headings) % MotionPrimitives::c_Headings;
+}
+
+}
+
+MotionPrimitives::MotionPrimitives(double spacing, double turningRadius, double sampleSpacing)
+    : m_Spacing(spacing), m_TurningRadius(turningRadius), m_SampleSpacing(sampleSpacing) {
+    if (spacing <= 0 || turningRadius <= 0 || sampleSpacing <= 0) {
+        throw std::invalid_argument("Motion primitives need a positive spacing, turning radius and sample spacing");
+    }
+    auto reach = c_Reach * turningRadius;
+    // one ring of grid points, at least a cell thick so there's always something on it
+    auto inner = fmax(0, reach - spacing);
+    auto cells = (int)ceil(reach / spacing);
+    for (int h = 0; h < c_Headings; h++) {
+        auto startYaw = yaw(h);
+        for (int dx = -cells; dx <= cells; dx++) {
+            for (int dy = -cells; dy <= cells; dy++) {
+                auto x = dx * spacing, y = dy * spacing;
+                auto distance = sqrt(x * x + y * y);
+                if (distance <= inner || distance > reach) continue;
+                auto bearing = atan2(y, x);
+                if (fabs(angleBetween(startYaw, bearing)) > c_MaxBearing) continue;
+                auto pointing = (int)lround(bearing / (2 * M_PI) * c_Headings);
+                for (int e = pointing - 1; e <= pointing + 1; e++) {
+                    Primitive p;
+                    p.DX = dx;
+                    p.DY = dy;
+                    p.EndHeading = wrap(e);
+                    double q0[3] = {0, 0, startYaw}, q1[3] = {x, y, yaw(p.EndHeading)};
+                    if (dubins_shortest_path(&p.Path, q0, q1, turningRadius) != 0) continue;
+                    p.Length = dubins_path_length(&p.Path);
+                    if (p.Length > c_MaxDetour * distance) continue;
+                    p.SampleSpacing = sampleSpacing;
+                    for (double d = 0; d < p.Length; d += sampleSpacing) p.Yaws.push_back(d);
+                    p.Xs.resize(p.Yaws.size());
+                    p.Ys.resize(p.Yaws.size());
+                    DubinsWrapper::evaluate(p.Path, p.Yaws.data(), p.Yaws.size(), p.Xs.data(), p.Ys.data(),
+                                            p.Yaws.data());
+                    m_Primitives[h].push_back(std::move(p));
+                }
+            }
+        }
+    }
+}
+
+size_t MotionPrimitives::size() const {
+    size_t n = 0;
+    for (const auto& primitives : m_Primitives) n += primitives.size();
+    return n;
+}
+
+void MotionPrimitives::nearest(double originX, double originY, const State& s, long& ix, long& iy,
+                               int& heading) const {
+    ix = lround((s.x() - originX) / m_Spacing);
+    iy = lround((s.y() - originY) / m_Spacing);
+    heading = wrap((int)lround(s.yaw() / (2 * M_PI) * c_Headings));
+}
+
+bool MotionPrimitives::locate(double originX, double originY, const State& s, long& ix, long& iy,
+                              int& heading) const {
+    nearest(originX, originY, s, ix, iy, heading);
+    return fabs(originX + ix * m_Spacing - s.x()) < c_Tolerance && fabs(originY + iy * m_Spacing - s.y()) < c_Tolerance &&
+           fabs(angleBetween(yaw(heading), s.yaw())) < c_Tolerance;
+}
+
+State MotionPrimitives::node(double originX, double originY, long ix, long iy, int heading, double speed) const {
+    State s;
+    s.x() = originX + ix * m_Spacing;
+    s.y() = originY + iy * m_Spacing;
+    s.setYaw(yaw(heading));
+    s.speed() = speed;
+    return s;
+}
+
+void MotionPrimitives::Primitive::sample(double x, double y, double startTime, double timeInterval, double endTime,
+                                         DubinsWrapper::Samples& samples) const {
+    samples.clear();
+    // times accumulated like sampleMany's, with the positions read off the table
+    size_t i = 0;
+    for (auto time = startTime; time < endTime && i < Xs.size(); time += timeInterval, i++) {
+        samples.Times.push_back(time);
+        samples.Xs.push_back(x + Xs[i]);
+        samples.Ys.push_back(y + Ys[i]);
+        samples.Yaws.push_back(Yaws[i]);
+    }
+}
+
+DubinsPath MotionPrimitives::Primitive::placed(double x, double y) const {
+    auto path = Path;
+    path.qi[0] += x;
+    path.qi[1] += y;
+    return path;
+}
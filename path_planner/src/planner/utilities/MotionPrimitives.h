@@ -0,0 +1,138 @@
+#ifndef SRC_MOTIONPRIMITIVES_H
+#define SRC_MOTIONPRIMITIVES_H
+
+#include <memory>
+#include <vector>
+#include <path_planner_common/State.h>
+#include <path_planner_common/DubinsWrapper.h>
+
+/**
+ * A state lattice of Dubins motion primitives for one turning radius, as the alternative to connecting random samples.
+ * Lattice states are on a square grid of positions with c_Headings evenly spaced headings. Every primitive starts at a
+ * lattice state and ends on another, so it can be reused anywhere on the grid just by moving it, and two ways to the
+ * same lattice state end up with exactly the same coordinates (which is what duplicate detection needs).
+ *
+ * From each heading there's a primitive to each grid point about c_Reach turning radii ahead (within c_MaxBearing
+ * either side), ending pointing at it or a heading either side of that, as long as the Dubins path there isn't more
+ * than c_MaxDetour times the straight line. Each comes with its samples, relative to its start, at the spacing edges
+ * are collision checked at, so expanding a lattice vertex is table lookups and the collision checking is just map
+ * queries at the samples moved over.
+ *
+ * All of it is made up front in the constructor; planners keep one around for as long as the turning radius doesn't
+ * change.
+ */
+class MotionPrimitives {
+public:
+    typedef std::shared_ptr<const MotionPrimitives> SharedPtr;
+
+    struct Primitive {
+        // from the origin, at the start heading
+        DubinsPath Path;
+        double Length;
+        // where it ends, in grid cells from the start, and which heading
+        int DX, DY, EndHeading;
+        // samples every SampleSpacing along it (up to but not including the end), relative to the start
+        double SampleSpacing;
+        std::vector<double> Xs, Ys, Yaws;
+
+        /**
+         * Sample the primitive moved to start at (x, y), the same way as DubinsWrapper::sampleMany: at a constant time
+         * interval, from startTime up to but not including endTime. The interval has to be SampleSpacing at the speed
+         * the edge is going.
+         * @param x
+         * @param y
+         * @param startTime
+         * @param timeInterval
+         * @param endTime
+         * @param samples cleared and then filled
+         */
+        void sample(double x, double y, double startTime, double timeInterval, double endTime,
+                    DubinsWrapper::Samples& samples) const;
+
+        /**
+         * @param x
+         * @param y
+         * @return the path moved to start at (x, y)
+         */
+        DubinsPath placed(double x, double y) const;
+    };
+
+    /**
+     * Make the primitives.
+     * @param spacing distance between grid points
+     * @param turningRadius
+     * @param sampleSpacing distance between samples along them
+     */
+    MotionPrimitives(double spacing, double turningRadius, double sampleSpacing);
+
+    /**
+     * @param heading
+     * @return the primitives starting with the given heading
+     */
+    const std::vector<Primitive>& from(int heading) const { return m_Primitives[heading]; }
+
+    /**
+     * @return how many primitives there are, over all the headings
+     */
+    size_t size() const;
+
+    double spacing() const { return m_Spacing; }
+
+    double turningRadius() const { return m_TurningRadius; }
+
+    double sampleSpacing() const { return m_SampleSpacing; }
+
+    /**
+     * Find which lattice state a state is, if it's one.
+     * @param originX where the grid point (0, 0) is
+     * @param originY
+     * @param s
+     * @param ix set to the grid point, if it's on one
+     * @param iy
+     * @param heading set to the heading, if it's one of them
+     * @return whether it's a lattice state (to within c_Tolerance)
+     */
+    bool locate(double originX, double originY, const State& s, long& ix, long& iy, int& heading) const;
+
+    /**
+     * The nearest grid point and heading to a state, lattice state or not.
+     */
+    void nearest(double originX, double originY, const State& s, long& ix, long& iy, int& heading) const;
+
+    /**
+     * Make a lattice state. The coordinates are worked out the same way every time so the same lattice state always
+     * comes out exactly the same.
+     * @param originX
+     * @param originY
+     * @param ix
+     * @param iy
+     * @param heading
+     * @param speed
+     * @return
+     */
+    State node(double originX, double originY, long ix, long iy, int heading, double speed) const;
+
+    /**
+     * @param heading
+     * @return the heading's yaw, in [0, 2pi)
+     */
+    static double yaw(int heading) { return 2 * M_PI * heading / c_Headings; }
+
+    static constexpr int c_Headings = 16;
+
+private:
+    double m_Spacing, m_TurningRadius, m_SampleSpacing;
+    std::vector<Primitive> m_Primitives[c_Headings];
+
+    // how far ahead a primitive goes, in turning radii
+    static constexpr double c_Reach = 2;
+    // how far to the side of the start heading the end can be
+    static constexpr double c_MaxBearing = M_PI / 4;
+    // how much longer than the straight line a primitive can be before it's too loopy to keep
+    static constexpr double c_MaxDetour = 1.3;
+    // how far off a lattice state can be and still count, allowing for rounding
+    static constexpr double c_Tolerance = 1e-6;
+};
+
+
+#endif //SRC_MOTIONPRIMITIVES_H
@@ -0,0 +1,80 @@
+#ifndef SRC_MPSCRING_H
+#define SRC_MPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Lock free bounded queue from any number of producer threads to one consumer thread. Like SpscRing, but producers
+ * claim a slot by bumping the tail with a compare and swap, and each slot has its own sequence number saying whether
+ * it's waiting to be written, waiting to be read, or (for a producer that's lapped the consumer) still full. Nobody
+ * ever waits on anybody else; when it's full push() just says so.
+ * @tparam T copyable
+ * @tparam Capacity a power of two
+ */
+template <class T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Ring capacity must be a power of two");
+public:
+    MpscRing() : m_Tail(0) {
+        for (size_t i = 0; i < Capacity; i++) m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * Add an item to the back. Any thread.
+     * @param item
+     * @return false (and nothing added) if it's full
+     */
+    bool push(const T& item) {
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &m_Cells[tail & (Capacity - 1)];
+            auto sequence = cell->Sequence.load(std::memory_order_acquire);
+            auto difference = (intptr_t)sequence - (intptr_t)tail;
+            if (difference == 0) {
+                // free, if nobody else gets it first (on failure tail is reloaded)
+                if (m_Tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) break;
+            } else if (difference < 0) {
+                // still holding what was pushed a lap ago
+                return false;
+            } else {
+                tail = m_Tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->Item = item;
+        cell->Sequence.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the item at the front. Consumer only.
+     * @param item set if there was one
+     * @return false if it's empty (or the producer that has the front slot hasn't finished writing it)
+     */
+    bool pop(T& item) {
+        auto& cell = m_Cells[m_Head & (Capacity - 1)];
+        if (cell.Sequence.load(std::memory_order_acquire) != m_Head + 1) return false;
+        item = cell.Item;
+        // free for the producers' next lap
+        cell.Sequence.store(m_Head + Capacity, std::memory_order_release);
+        m_Head++;
+        return true;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> Sequence;
+        T Item;
+    };
+    Cell m_Cells[Capacity];
+    std::atomic<size_t> m_Tail;
+    // only touched by the consumer
+    size_t m_Head = 0;
+};
+
+
+#endif //SRC_MPSCRING_H
@@ -94,6 +94,12 @@ bool Ribbon::containsProjection(const std::pair<double, double>& projected) cons
               (projected.second - m_StartY > c_Tolerance && projected.second - m_EndY > c_Tolerance)));
 }
 
-
-
-
+double Ribbon::segmentDistance(double x, double y) const {
+    auto squaredL = squaredLength();
+    double t = 0;
+    if (squaredL > 0) t = ((x - m_StartX) * (m_EndX - m_StartX) + (y - m_StartY) * (m_EndY - m_StartY)) / squaredL;
+    t = fmax(0, fmin(1, t));
+    auto dx = m_StartX + t * (m_EndX - m_StartX) - x;
+    auto dy = m_StartY + t * (m_EndY - m_StartY) - y;
+    return sqrt(dx * dx + dy * dy);
+}
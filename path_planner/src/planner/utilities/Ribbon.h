@@ -120,6 +120,9 @@ public:
                sqrt(squaredLength());
     }
 
+    // distance to the nearest point on the segment from (startX, startY) to (endX, endY)
+    double segmentDistance(double x, double y) const;
+
 private:
     double m_StartX, m_StartY, m_EndX, m_EndY;
 
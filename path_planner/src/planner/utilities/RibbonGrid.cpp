@@ -0,0 +1,43 @@
+#include "RibbonGrid.h"
+
+RibbonGrid::RibbonGrid(double cellSize) : m_CellSize(cellSize) {}
+
+void RibbonGrid::build(const std::vector<Ribbon>& ribbons) {
+    m_Cells.clear();
+    m_Count = ribbons.size();
+    m_Padding = Ribbon::RibbonWidth;
+    m_MinCellX = m_MinCellY = INT32_MAX;
+    m_MaxCellX = m_MaxCellY = INT32_MIN;
+    for (int id = 0; id < (int)ribbons.size(); id++) insert(ribbons[id], id);
+}
+
+void RibbonGrid::insert(const Ribbon& ribbon, int id) {
+    auto start = ribbon.start(), end = ribbon.end();
+    int minX = cellCoordinate(fmin(start.first, end.first) - m_Padding);
+    int maxX = cellCoordinate(fmax(start.first, end.first) + m_Padding);
+    int minY = cellCoordinate(fmin(start.second, end.second) - m_Padding);
+    int maxY = cellCoordinate(fmax(start.second, end.second) + m_Padding);
+    m_MinCellX = std::min(m_MinCellX, minX); m_MaxCellX = std::max(m_MaxCellX, maxX);
+    m_MinCellY = std::min(m_MinCellY, minY); m_MaxCellY = std::max(m_MaxCellY, maxY);
+
+    // a cell is close enough if its center is within the padding plus half a diagonal of the segment (plus a bit for
+    // the tolerance Ribbon::contains uses)
+    auto reach = m_Padding + m_CellSize * M_SQRT1_2 + c_Tolerance;
+    auto dx = end.first - start.first, dy = end.second - start.second;
+    auto squaredLength = dx * dx + dy * dy;
+    for (int i = minX; i <= maxX; i++) {
+        for (int j = minY; j <= maxY; j++) {
+            auto x = (i + 0.5) * m_CellSize, y = (j + 0.5) * m_CellSize;
+            double t = 0;
+            if (squaredLength > 0) t = fmax(0, fmin(1, ((x - start.first) * dx + (y - start.second) * dy) / squaredLength));
+            auto px = start.first + t * dx - x, py = start.second + t * dy - y;
+            if (px * px + py * py <= reach * reach) m_Cells[key(i, j)].push_back(id);
+        }
+    }
+}
+
+void RibbonGrid::candidates(double x, double y, std::vector<int>& out) const {
+    auto cell = m_Cells.find(key(cellCoordinate(x), cellCoordinate(y)));
+    if (cell == m_Cells.end()) return;
+    out.insert(out.end(), cell->second.begin(), cell->second.end());
+}
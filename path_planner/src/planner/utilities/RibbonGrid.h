@@ -0,0 +1,128 @@
+#ifndef SRC_RIBBONGRID_H
+#define SRC_RIBBONGRID_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+#include "Ribbon.h"
+
+/**
+ * Uniform grid over a fixed set of ribbons (survey lines) so the ribbon manager can look at nearby ribbons instead of
+ * all of them.
+ *
+ * Each ribbon is put in every cell within RibbonWidth of its segment, and referred to by its index in the vector the
+ * grid was built from. Ribbons only ever shrink along their own line when they're split, so a grid built from the
+ * original ribbons still finds every piece of them; it's up to the caller to skip ribbons it has since replaced.
+ */
+class RibbonGrid {
+public:
+    /**
+     * Construct an empty grid.
+     * @param cellSize side length of the (square) cells
+     */
+    explicit RibbonGrid(double cellSize);
+
+    /**
+     * Drop everything and index all the given ribbons.
+     * @param ribbons
+     */
+    void build(const std::vector<Ribbon>& ribbons);
+
+    /**
+     * @return whether the grid has been built with anything in it
+     */
+    bool active() const { return m_Count > 0; }
+
+    /**
+     * @return the padding (ribbon width) the grid was built with
+     */
+    double padding() const { return m_Padding; }
+
+    /**
+     * Collect the indices of the ribbons which could contain (x, y). The result may include ribbons which don't.
+     * @param x
+     * @param y
+     * @param out
+     */
+    void candidates(double x, double y, std::vector<int>& out) const;
+
+    /**
+     * Find the ribbon minimizing the given distance function, searching outwards from (x, y) ring by ring.
+     *
+     * The distance function must never be smaller than the Euclidean distance from (x, y) to the nearest point on the
+     * ribbon's segment (nearest endpoint or nearest point on the segment both work), which is what lets the search stop
+     * early. It can return DBL_MAX for ribbons that should be skipped. If the rings get too big compared to the number
+     * of ribbons it just checks every ribbon.
+     *
+     * @param x
+     * @param y
+     * @param distance function of a ribbon index giving its distance from (x, y)
+     * @param best set to the smallest distance found (DBL_MAX if there are no ribbons)
+     * @return the index of the nearest ribbon, or -1 if there isn't one
+     */
+    template <class Distance>
+    int nearest(double x, double y, Distance distance, double& best) const {
+        best = DBL_MAX;
+        int result = -1;
+        if (m_Count == 0) return result;
+        auto consider = [&] (int id) {
+            auto d = distance(id);
+            // ties go to the lower index, same as a linear scan
+            if (d < best || (d == best && d != DBL_MAX && id < result)) {
+                best = d;
+                result = id;
+            }
+        };
+        int cx = cellCoordinate(x), cy = cellCoordinate(y);
+        int maxRing = std::max(std::max(std::abs(cx - m_MinCellX), std::abs(cx - m_MaxCellX)),
+                               std::max(std::abs(cy - m_MinCellY), std::abs(cy - m_MaxCellY)));
+        size_t cellsVisited = 0;
+        for (int ring = 0; ring <= maxRing; ring++) {
+            // everything in this ring or further out is at least (ring - 1) cells away
+            if (best <= (ring - 1) * m_CellSize) break;
+            cellsVisited += ring == 0 ? 1 : 8 * ring;
+            if (cellsVisited > c_LinearScanFactor * m_Count + c_LinearScanSlack) {
+                // the rings are too sparse to be worth it, just look at everyone
+                for (int id = 0; id < (int)m_Count; id++) consider(id);
+                return result;
+            }
+            for (int i = cx - ring; i <= cx + ring; i++) {
+                int step = (i == cx - ring || i == cx + ring) ? 1 : 2 * ring;
+                for (int j = cy - ring; j <= cy + ring; j += step) {
+                    auto cell = m_Cells.find(key(i, j));
+                    if (cell == m_Cells.end()) continue;
+                    for (auto id : cell->second) consider(id);
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    double m_CellSize;
+    double m_Padding = 0;
+
+    std::unordered_map<int64_t, std::vector<int>> m_Cells;
+    size_t m_Count = 0;
+    int m_MinCellX = 0, m_MaxCellX = 0, m_MinCellY = 0, m_MaxCellY = 0;
+
+    // visit at most this many cells per ribbon (plus the slack) before falling back to a linear scan
+    static constexpr size_t c_LinearScanFactor = 4;
+    static constexpr size_t c_LinearScanSlack = 64;
+    static constexpr double c_Tolerance = 1e-3;
+
+    int cellCoordinate(double v) const { return (int)floor(v / m_CellSize); }
+
+    static int64_t key(int i, int j) {
+        return (int64_t)(((uint64_t)(uint32_t)i << 32) | (uint32_t)j);
+    }
+
+    void insert(const Ribbon& ribbon, int id);
+};
+
+
+#endif //SRC_RIBBONGRID_H
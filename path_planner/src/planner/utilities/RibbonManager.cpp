@@ -1,208 +1,409 @@
+#include <atomic>
 #include <cfloat>
+#include <cstring>
 #include <algorithm>
 #include <sstream>
 #include <vector>
 #include "RibbonManager.h"
 
 void RibbonManager::add(double x1, double y1, double x2, double y2) {
-    if (m_Ribbons.size() > c_RibbonCountDangerThreshold)
+    if (m_Heuristic != MaxDistance && size() > tspRibbonLimit())
         std::cerr << "Warning: adding more ribbons than can be used for TSP heuristics" << std::endl;
     Ribbon r(x1, y1, x2, y2);
-    add(r, m_Ribbons.end());
+    if (!r.covered()) m_SpanningTree.reset(); // the new line needs to be in the tree
+    if (m_CoverageModel == Bitmap) {
+        if (r.covered()) return;
+        // lines are only added while setting up, so just make a new base with it on the end
+        std::vector<Ribbon> lines;
+        if (m_Base) lines = m_Base->Ribbons;
+        lines.push_back(r);
+        m_Base = std::make_shared<const Snapshot>(std::move(lines));
+        m_Lines.push_back(std::make_shared<const CoverageBitmap>(r));
+        m_UncoveredCount += m_Lines.back()->uncovered().size();
+        changed();
+        return;
+    }
+    add(r, m_Local.end());
+    flattenIfTooManyChanges();
 }
 
 void RibbonManager::cover(double x, double y) {
-    auto i = m_Ribbons.begin();
-    while (i != m_Ribbons.end()) {
-        auto r = i->split(x, y);
-        add(r, i);
-        if (i->covered()) i = m_Ribbons.erase(i);
-        else ++i;
+    if (m_CoverageModel == Bitmap) {
+        if (baseSize() == 0) return;
+        if (m_Base->Index.active() && !indexed()) flatten();
+        if (indexed()) {
+            std::vector<int> nearby;
+            m_Base->Index.candidates(x, y, nearby);
+            for (auto id : nearby) coverLine(x, y, id);
+        } else {
+            for (int id = 0; id < (int)baseSize(); id++) coverLine(x, y, id);
+        }
+        return;
     }
+    std::vector<Ribbon> finished;
+    auto i = m_Local.begin();
+    while (i != m_Local.end()) i = cover(x, y, i, finished);
+    if (baseSize() > 0) {
+        if (m_Base->Index.active() && !indexed()) flatten(); // ribbon width changed since the index was built
+        auto coverBase = [&] (int id) {
+            const auto& r = m_Base->Ribbons[id];
+            if (retired(id) || !r.contains(x, y, r.getProjection(x, y))) return;
+            // this is the only point where we need our own copy of the ribbon
+            m_Retired.insert(std::upper_bound(m_Retired.begin(), m_Retired.end(), id), id);
+            cover(x, y, m_Local.insert(m_Local.end(), r), finished);
+        };
+        if (indexed()) {
+            std::vector<int> nearby;
+            m_Base->Index.candidates(x, y, nearby);
+            for (auto id : nearby) coverBase(id);
+        } else {
+            for (int id = 0; id < (int)baseSize(); id++) coverBase(id);
+        }
+    }
+    // only once everything's been covered, so what's left is what's really left
+    for (const auto& r : finished) finishInSpanningTree(r);
+    flattenIfTooManyChanges();
 }
 
-bool RibbonManager::done() const {
-    return m_Ribbons.empty();
+std::list<Ribbon>::iterator RibbonManager::cover(double x, double y, std::list<Ribbon>::iterator i,
+                                                 std::vector<Ribbon>& finished) {
+    if (!i->contains(x, y, i->getProjection(x, y))) return ++i;
+    changed();
+    auto before = *i;
+    auto r = i->split(x, y);
+    add(r, i);
+    if (i->covered()) {
+        if (m_SpanningTree) finished.push_back(before);
+        return m_Local.erase(i);
+    }
+    return ++i;
 }
 
-double RibbonManager::approximateDistanceUntilDone(double x, double y, double yaw) const {
-   if (done()) return 0;
-    // if we're above the danger threshold just give max distance
-//    if (m_Ribbons.size() > c_RibbonCountDangerThreshold) return maxDistance(x, y);
-    switch (m_Heuristic) {
-        // Modified max distance heuristic
-        case MaxDistance: {
-            return maxDistance(x, y);
+void RibbonManager::finishInSpanningTree(const Ribbon& finished) {
+    auto on = [] (const Ribbon& site, const Ribbon& r) {
+        return site.segmentDistance(r.start().first, r.start().second) < c_SiteTolerance &&
+               site.segmentDistance(r.end().first, r.end().second) < c_SiteTolerance;
+    };
+    // this only happens when a ribbon is finished, so it can afford to look through everything
+    auto tree = m_SpanningTree;
+    for (int id = 0; id < (int)tree->siteCount(); id++) {
+        if (!tree->contains(id) || !on(tree->site(id), finished)) continue;
+        bool left = false;
+        forEach([&] (const Ribbon& r) { left = left || on(tree->site(id), r); });
+        if (!left) tree = tree->without(id);
+    }
+    m_SpanningTree = std::move(tree);
+}
+
+void RibbonManager::coverLine(double x, double y, int id) {
+    // most points are on lines that are already covered there, which shouldn't cost a copy
+    if (!m_Lines[id]->wouldCover(x, y)) return;
+    auto line = std::make_shared<CoverageBitmap>(*m_Lines[id]);
+    line->cover(x, y);
+    m_UncoveredCount -= m_Lines[id]->uncovered().size();
+    m_UncoveredCount += line->uncovered().size();
+    m_Lines[id] = std::move(line);
+    // the tree's sites are the lines
+    if (m_SpanningTree && m_Lines[id]->uncovered().empty()) m_SpanningTree = m_SpanningTree->without(id);
+    changed();
+}
+
+void RibbonManager::setCoverageModel(CoverageModel model) {
+    if (model == m_CoverageModel) return;
+    std::vector<Ribbon> ribbons;
+    ribbons.reserve(size());
+    forEach([&] (const Ribbon& r) { ribbons.push_back(r); });
+    m_CoverageModel = model;
+    m_Retired.clear();
+    m_Local.clear();
+    m_Lines.clear();
+    m_UncoveredCount = 0;
+    if (model == Bitmap) {
+        for (const auto& r : ribbons) {
+            m_Lines.push_back(std::make_shared<const CoverageBitmap>(r));
+            m_UncoveredCount += m_Lines.back()->uncovered().size();
         }
-        case TspPointRobotNoSplitAllRibbons: {
-            return tspPointRobotNoSplitAllRibbons(m_Ribbons, 0, std::make_pair(x, y));
+    }
+    m_Base = std::make_shared<const Snapshot>(std::move(ribbons));
+    m_SpanningTree.reset(); // the sites would be different
+    changed();
+}
+
+void RibbonManager::flatten() {
+    if (m_CoverageModel == Bitmap) {
+        // the lines never change, so this is only ever to rebuild the index
+        std::vector<Ribbon> lines;
+        lines.reserve(m_Lines.size());
+        for (const auto& line : m_Lines) lines.push_back(line->line());
+        m_Base = std::make_shared<const Snapshot>(std::move(lines));
+        return;
+    }
+    std::vector<Ribbon> ribbons;
+    ribbons.reserve(size());
+    forEach([&] (const Ribbon& r) { ribbons.push_back(r); });
+    m_Base = std::make_shared<const Snapshot>(std::move(ribbons));
+    m_Retired.clear();
+    m_Local.clear();
+}
+
+void RibbonManager::flattenIfTooManyChanges() {
+    if (m_Retired.size() + m_Local.size() > c_MaxChanges + baseSize() / c_BaseRibbonsPerChange) flatten();
+}
+
+RibbonManager::Snapshot::Snapshot(std::vector<Ribbon> ribbons)
+    : Ribbons(std::move(ribbons)), Index(c_SpatialIndexCellSize) {
+    if (Ribbons.size() >= c_SpatialIndexThreshold) Index.build(Ribbons);
+}
+
+uint64_t RibbonManager::fingerprint() const {
+    if (m_FingerprintVersion == m_Version) return m_Fingerprint;
+    // sum of the ribbons' hashes, so the order they're stored in doesn't matter
+    uint64_t sum = 0;
+    forEach([&] (const Ribbon& r) {
+        uint64_t h = 1469598103934665603ull; // FNV-1a over the endpoints
+        double endpoints[] = {r.start().first, r.start().second, r.end().first, r.end().second};
+        for (auto d : endpoints) {
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            h = (h ^ bits) * 1099511628211ull;
         }
-        case TspDubinsNoSplitAllRibbons: {
-            return tspDubinsNoSplitAllRibbons(m_Ribbons, 0, x, y, yaw);
+        sum += h ^ (h >> 29);
+    });
+    m_Fingerprint = sum;
+    m_FingerprintVersion = m_Version;
+    return sum;
+}
+
+void RibbonManager::changed() {
+    m_TspTable.reset(); // the table's out of date
+    m_Endpoints.reset(); // and so are the endpoints
+    m_Version = nextVersion();
+}
+
+uint64_t RibbonManager::nextVersion() {
+    static std::atomic<uint64_t> s_Version(0);
+    return ++s_Version;
+}
+
+bool RibbonManager::done() const {
+    return size() == 0;
+}
+
+RibbonManager::Endpoints::Endpoints(const RibbonManager& ribbonManager) {
+    ribbonManager.forEach([&] (const Ribbon& r) {
+        StartX.push_back(r.start().first); StartY.push_back(r.start().second);
+        StartYaw.push_back(r.startAsState().yaw());
+        EndX.push_back(r.end().first); EndY.push_back(r.end().second);
+        EndYaw.push_back(r.endAsState().yaw());
+        Length.push_back(r.length());
+        TotalLength += Length.back();
+    });
+}
+
+struct RibbonManager::MaxDistancePolicy {
+    static double evaluate(const RibbonManager& ribbonManager, double x, double y, double) {
+        // max represents the distance to the farthest endpoint.
+        // min represents the distance to the nearest endpoint plus the sum of the lengths of all ribbons.
+        // Whichever is larger is returned.
+        // Both are technically inadmissible due to the "done" action but that's not implemented yet anywhere
+        const auto& e = ribbonManager.endpoints();
+        double min, max;
+        nearestAndFarthest(e, x, y, min, max);
+        return fmax(e.TotalLength + min, max);
+    }
+
+    static void nearestAndFarthest(const Endpoints& e, double x, double y, double& min, double& max) {
+        min = DBL_MAX;
+        max = 0;
+        for (size_t i = 0; i < e.size(); i++) {
+            auto dStart = distance(e.StartX[i], e.StartY[i], x, y);
+            auto dEnd = distance(e.EndX[i], e.EndY[i], x, y);
+            min = fmin(fmin(min, dEnd), dStart);
+            max = fmax(fmax(max, dEnd), dStart);
         }
-        case TspPointRobotNoSplitKRibbons: {
-            return tspPointRobotNoSplitKRibbons(m_Ribbons, 0, std::make_pair(x, y));
+    }
+};
+
+struct RibbonManager::SpanningTreePolicy {
+    static double evaluate(const RibbonManager& ribbonManager, double x, double y, double) {
+        // max distance's min, plus the tree for the legs between ribbons after the first. The tree doesn't depend on
+        // where the boat is, so this is as cheap as max distance once it's been built.
+        const auto& e = ribbonManager.endpoints();
+        double min, max;
+        MaxDistancePolicy::nearestAndFarthest(e, x, y, min, max);
+        return fmax(e.TotalLength + ribbonManager.spanningTree().weight() + min, max);
+    }
+};
+
+struct RibbonManager::HeldKarpPolicy {
+    static double evaluate(const RibbonManager& ribbonManager, double x, double y, double yaw) {
+        return ribbonManager.heldKarp(x, y, yaw);
+    }
+};
+
+/**
+ * The K ribbons TSP heuristics: brute force over orders of the ribbons, going on from each step to only the K
+ * ribbons furthest from where it is (nearest endpoint, Euclidean or Dubins), either way along each.
+ *
+ * Ribbons are indices into the endpoints, and each step sorts its own copy of the ones left into a buffer shared by
+ * the whole search (and keeps the distances to them in another), so nothing is allocated once the buffers are big
+ * enough. Results are the same as the recursive list
+ * version this replaced, including its quirks: the order is descending (it was meant for make_heap), and the Dubins
+ * version never counted how many it had tried, so it tries them all.
+ */
+template <bool PointRobot>
+struct RibbonManager::KRibbonsPolicy {
+    static double evaluate(const RibbonManager& ribbonManager, double x, double y, double yaw) {
+        const auto& e = ribbonManager.endpoints();
+        int n = (int)e.size();
+        // each level of the search uses 2 * (ribbons left) - 1, so n^2 covers the lot
+        // and each level keeps the distances to the start and end of each ribbon, by index
+        static thread_local std::vector<int> buffer;
+        static thread_local std::vector<double> distances;
+        if ((int)buffer.size() < n * n + n) buffer.resize(n * n + n);
+        if ((int)distances.size() < 3 * n * n) distances.resize(3 * n * n);
+        int* all = buffer.data() + n * n;
+        for (int i = 0; i < n; i++) all[i] = i;
+        return search(ribbonManager, e, all, n, buffer.data(), distances.data(), 0, x, y, yaw);
+    }
+
+    static double search(const RibbonManager& ribbonManager, const Endpoints& e, const int* left, int count,
+                         int* buffer, double* distances, double distanceSoFar, double x, double y, double yaw) {
+        if (count == 0) return distanceSoFar;
+        int n = (int)e.size();
+        double* toStart = distances, *toEnd = distances + n, *keys = distances + 2 * n;
+        int* sorted = buffer;
+        for (int i = 0; i < count; i++) {
+            auto r = left[i];
+            sorted[i] = r;
+            if (PointRobot) {
+                toStart[r] = distance(x, y, e.StartX[r], e.StartY[r]);
+                toEnd[r] = distance(x, y, e.EndX[r], e.EndY[r]);
+            } else {
+                toStart[r] = ribbonManager.dubinsDistance(x, y, yaw, e.StartX[r], e.StartY[r], e.StartYaw[r]);
+                toEnd[r] = ribbonManager.dubinsDistance(x, y, yaw, e.EndX[r], e.EndY[r], e.EndYaw[r]);
+            }
+            keys[r] = fmin(toStart[r], toEnd[r]);
         }
-        case TspDubinsNoSplitKRibbons: {
-            return tspDubinsNoSplitKRibbons(m_Ribbons, 0, x, y, yaw);
+        std::stable_sort(sorted, sorted + count, [&] (int r1, int r2) { return keys[r1] > keys[r2]; });
+        int* rest = buffer + count;
+        int tries = ribbonManager.m_K <= 0 ? 0 : PointRobot ? std::min(count, ribbonManager.m_K) : count;
+        auto min = DBL_MAX;
+        for (int i = 0; i < tries; i++) {
+            auto r = sorted[i];
+            std::copy(sorted, sorted + i, rest);
+            std::copy(sorted + i + 1, sorted + count, rest + i);
+            auto* next = rest + count - 1;
+            auto* nextDistances = distances + 3 * n;
+            min = fmin(min, search(ribbonManager, e, rest, count - 1, next, nextDistances,
+                                   distanceSoFar + e.Length[r] + toStart[r], e.EndX[r], e.EndY[r], e.EndYaw[r]));
+            min = fmin(min, search(ribbonManager, e, rest, count - 1, next, nextDistances,
+                                   distanceSoFar + e.Length[r] + toEnd[r], e.StartX[r], e.StartY[r], e.StartYaw[r]));
         }
-        default: return 0;
+        return min;
     }
+};
+
+double RibbonManager::approximateDistanceUntilDone(double x, double y, double yaw) const {
+    return heuristicFunction(m_Heuristic)(*this, x, y, yaw);
 }
 
-double RibbonManager::tspPointRobotNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, std::pair<double, double> point) {
-    // Depth-first TSP solution
-    if (ribbonsLeft.empty()) return distanceSoFar;
-    auto min = DBL_MAX;
-    for (auto it = ribbonsLeft.begin(); it != ribbonsLeft.end(); it++) {
-        const Ribbon r = *it;
-        it = ribbonsLeft.erase(it);
-        min = fmin(min, tspPointRobotNoSplitAllRibbons(ribbonsLeft, distanceSoFar + r.length() +
-                   distance(point, r.start()), r.end()));
-        min = fmin(min, tspPointRobotNoSplitAllRibbons(ribbonsLeft, distanceSoFar + r.length() +
-                   distance(point, r.end()), r.start()));
-        it = ribbonsLeft.insert(it, r);
+RibbonManager::HeuristicFunction RibbonManager::heuristicFunction(Heuristic heuristic) {
+    switch (heuristic) {
+        case MaxDistance: return &evaluate<MaxDistancePolicy>;
+        case TspPointRobotNoSplitAllRibbons:
+        case TspDubinsNoSplitAllRibbons: return &evaluate<HeldKarpPolicy>;
+        case TspPointRobotNoSplitKRibbons: return &evaluate<KRibbonsPolicy<true>>;
+        case TspDubinsNoSplitKRibbons: return &evaluate<KRibbonsPolicy<false>>;
+        case MstLowerBound: return &evaluate<SpanningTreePolicy>;
+        default: return [] (const RibbonManager&, double, double, double) { return 0.0; };
     }
-    return min;
 }
 
-double RibbonManager::tspPointRobotNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar,
-                                                   std::pair<double, double> point) const {
-    if (ribbonsLeft.empty()) return distanceSoFar;
-    auto min = DBL_MAX;
-    auto comp = [&] (const Ribbon& r1, const Ribbon& r2) {
-        double min1 = fmin(distance(point, r1.start()), distance(point, r1.end()));
-        double min2 = fmin(distance(point, r2.start()), distance(point, r2.end()));
-        return min1 > min2; // should be lt except that make_heap makes a max heap
-    };
-    // Just sort the list because it's easier than trying to make it a heap.
-    // I'm not even sure it would be advantageous to use a heap because we need the constant time insert/delete,
-    // of which the heap-supporting containers are incapable, so we'd need to make a copy
-    ribbonsLeft.sort(comp);
-    int i = 0;
-    for (auto it = ribbonsLeft.begin(); it != ribbonsLeft.end(); it++) {
-        if (i++ >= m_K) break;
-        // TODO! -- this one and the other K-based one don't work because pop_back()
-        const Ribbon r = *it;
-        it = ribbonsLeft.erase(it);
-        min = fmin(min, tspPointRobotNoSplitKRibbons(ribbonsLeft, distanceSoFar + r.length() +
-                                                                    distance(point, r.start()), r.end()));
-        min = fmin(min, tspPointRobotNoSplitKRibbons(ribbonsLeft, distanceSoFar + r.length() +
-                                                                    distance(point, r.end()), r.start()));
-        it = ribbonsLeft.insert(it, r);
-    }
-    return min;
-}
-
-
-double RibbonManager::tspDubinsNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x,
-                                                 double y, double yaw) const{
-    // Depth-first TSP solution
-    if (ribbonsLeft.empty()) return distanceSoFar;
-    auto min = DBL_MAX;
-    for (auto it = ribbonsLeft.begin(); it != ribbonsLeft.end(); it++) {
-        const auto r = *it;
-        it = ribbonsLeft.erase(it);
-        auto start = r.startAsState();
-        auto end = r.endAsState();
-        min  = fmin(min, tspDubinsNoSplitAllRibbons(ribbonsLeft, distanceSoFar + r.length() +
-            dubinsDistance(x, y, yaw, start), end.x(), end.y(), end.yaw()));
-        min  = fmin(min, tspDubinsNoSplitAllRibbons(ribbonsLeft, distanceSoFar + r.length() +
-            dubinsDistance(x, y, yaw, end), start.x(), start.y(), start.yaw()));
-        it = ribbonsLeft.insert(it, r);
+const RibbonSpanningTree& RibbonManager::spanningTree() const {
+    if (m_SpanningTree) return *m_SpanningTree;
+    if (m_CoverageModel == Bitmap) {
+        // the sites are the lines, finished or not, so coverLine can take them out by id
+        std::vector<bool> alive;
+        for (const auto& line : m_Lines) alive.push_back(!line->uncovered().empty());
+        m_SpanningTree = std::make_shared<const RibbonSpanningTree>(m_Base ? m_Base->Ribbons : std::vector<Ribbon>(),
+                                                                    alive);
+    } else {
+        std::vector<Ribbon> ribbons;
+        forEach([&] (const Ribbon& r) { ribbons.push_back(r); });
+        m_SpanningTree = std::make_shared<const RibbonSpanningTree>(std::move(ribbons));
     }
-    return min;
+    return *m_SpanningTree;
 }
 
-double RibbonManager::tspDubinsNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x, double y,
-                                               double yaw) const {
-    if (ribbonsLeft.empty()) return distanceSoFar;
-    auto min = DBL_MAX;
-    auto comp = [&] (const Ribbon& r1, const Ribbon& r2) {
-        double min1 = fmin(dubinsDistance(x, y, yaw, r1.startAsState()), dubinsDistance(x, y, yaw, r1.endAsState()));
-        double min2 = fmin(dubinsDistance(x, y, yaw, r1.startAsState()), dubinsDistance(x, y, yaw, r1.endAsState()));
-        return min1 > min2;
-    };
-    int i = 0;
-    ribbonsLeft.sort(comp);
-    for (auto it = ribbonsLeft.begin(); it != ribbonsLeft.end(); it++) {
-        if (i >= m_K) break;
-        const auto r = *it;
-        it = ribbonsLeft.erase(it);
-        auto start = r.startAsState();
-        auto end = r.endAsState();
-        min  = fmin(min, tspDubinsNoSplitKRibbons(ribbonsLeft, distanceSoFar + r.length() +
-                                                                 dubinsDistance(x, y, yaw, start), end.x(), end.y(), end.yaw()));
-        min  = fmin(min, tspDubinsNoSplitKRibbons(ribbonsLeft, distanceSoFar + r.length() +
-                                                                 dubinsDistance(x, y, yaw, end), start.x(), start.y(), start.yaw()));
-        it = ribbonsLeft.insert(it, r);
+double RibbonManager::heldKarp(double x, double y, double yaw) const {
+    // the table can't handle too many ribbons, so anyone who didn't call changeHeuristicIfTooManyRibbons gets this
+    if (size() > HeldKarpTable::MaxRibbons) return maxDistance(x, y);
+    bool pointRobot = m_Heuristic == TspPointRobotNoSplitAllRibbons;
+    if (!m_TspTable || m_TspTableHeuristic != m_Heuristic) {
+        std::vector<Ribbon> ribbons;
+        forEach([&] (const Ribbon& r) { ribbons.push_back(r); });
+        if (pointRobot) {
+            m_TspTable = std::make_shared<const HeldKarpTable>(ribbons, [] (const State& from, const State& to) {
+                return from.distanceTo(to);
+            });
+        } else {
+            m_TspTable = std::make_shared<const HeldKarpTable>(ribbons, [this] (const State& from, const State& to) {
+                return dubinsDistance(from.x(), from.y(), from.yaw(), to);
+            });
+        }
+        m_TspTableHeuristic = m_Heuristic;
     }
-    return min;
+    if (pointRobot) return m_TspTable->cost([&] (const State& to) { return distance(x, y, to.x(), to.y()); });
+    return m_TspTable->cost([&] (const State& to) { return dubinsDistance(x, y, yaw, to); });
 }
 
 double RibbonManager::minDistanceFrom(double x, double y) const {
-    if (m_Ribbons.empty()) return 0;
-    auto min = DBL_MAX;
-    for (const auto& r : m_Ribbons) {
-        if (r.contains(x, y, r.getProjection(x, y))) return 0;
-        auto dStart = distance(r.start(), x, y);
-        auto dEnd = distance(r.end(), x, y);
-        min = fmin(fmin(min, dEnd), dStart);
-    }
-    return min;
+    if (done()) return 0;
+    bool inside = false;
+    forEachNear(x, y, [&] (const Ribbon& r) {
+        if (r.contains(x, y, r.getProjection(x, y))) inside = true;
+    });
+    if (inside) return 0;
+    auto r = nearest(x, y, [&] (const Ribbon& ribbon) {
+        return fmin(distance(ribbon.start(), x, y), distance(ribbon.end(), x, y));
+    });
+    return fmin(distance(r->start(), x, y), distance(r->end(), x, y));
 }
 
 void RibbonManager::add(const Ribbon& r, std::list<Ribbon>::iterator i) {
     if (r.covered()) return;
+    changed();
     // TODO! -- issue warning about large numbers of ribbons
     // TODO! -- determine whether to split any of the prior ribbons based on this new one
-    m_Ribbons.insert(i, r);
+    m_Local.insert(i, r);
 }
 
 State RibbonManager::getNearestEndpointAsState(const State& state) const {
     if (done()) throw std::logic_error("Attempting to get nearest endpoint when there are no ribbons");
-    auto min = DBL_MAX;
-    State ret;
-    for (const auto& r : m_Ribbons) {
-        auto s = r.startAsState();
-        auto d = state.distanceTo(s);
-        if (d < min) {
-            if (d < Ribbon::minLength()){ // && r.contains(state.x(), state.y(), r.getProjection(state.x(), state.y))) {
-                // we actually want the state at the other end of the ribbon
-                ret = r.endAsState();
-                ret.heading() = s.heading();
-            } else {
-                ret = s;
-            }
-            min = d;
-        }
-        s = r.endAsState();
-        d = state.distanceTo(s);
-        if (d < min) {
-            if (d < Ribbon::minLength()){ // && r.contains(state.x(), state.y(), r.getProjection(state.x(), state.y))) {
-                // we actually want the state at the other end of the ribbon
-                ret = r.startAsState();
-                ret.heading() = s.heading();
-            } else {
-                ret = s;
-            }
-            min = d;
-        }
+    auto r = nearest(state.x(), state.y(), [&] (const Ribbon& ribbon) {
+        return fmin(distance(ribbon.start(), state.x(), state.y()), distance(ribbon.end(), state.x(), state.y()));
+    });
+    auto start = r->startAsState(), end = r->endAsState();
+    State nearer = start, farther = end;
+    if (state.distanceTo(end) < state.distanceTo(start)) std::swap(nearer, farther);
+    if (state.distanceTo(nearer) < Ribbon::minLength()) { // && r.contains(state.x(), state.y(), r.getProjection(state.x(), state.y))) {
+        // we actually want the state at the other end of the ribbon
+        farther.heading() = nearer.heading();
+        return farther;
     }
-    return ret;
+    return nearer;
 }
 
 RibbonManager::RibbonManager(RibbonManager::Heuristic heuristic) : m_Heuristic(heuristic) {}
 
 RibbonManager::RibbonManager() : RibbonManager(MaxDistance) {}
 
-//}
-
 std::string RibbonManager::dumpRibbons() const {
     std::stringstream stream;
     stream << "Ribbons: \n";
-    if (m_Ribbons.empty()) stream << "None\n";
-    else for (const auto& r : m_Ribbons) stream << r.toString() << "\n";
+    if (done()) stream << "None\n";
+    else forEach([&] (const Ribbon& r) { stream << r.toString() << "\n"; });
     return stream.str();
 }
 
@@ -216,42 +417,26 @@ RibbonManager::RibbonManager(RibbonManager::Heuristic heuristic, double turningR
 }
 
 void RibbonManager::projectOntoNearestRibbon(State& state) const {
-    if (m_Ribbons.empty()) return;
-    auto min = DBL_MAX;
-    auto ribbon = Ribbon::empty();
-    for (const auto& r : m_Ribbons) {
-        auto d = r.distance(state.x(), state.y());
-        if (d < min) {
-            min = d;
-            ribbon = r;
-        }
-    }
-    state = ribbon.getProjectionAsState(state.x(), state.y());
+    if (done()) return;
+    auto r = nearest(state.x(), state.y(), [&] (const Ribbon& ribbon) {
+        return ribbon.segmentDistance(state.x(), state.y());
+    });
+    state = r->getProjectionAsState(state.x(), state.y());
 }
 
 double RibbonManager::maxDistance(double x, double y) const {
-    // max represents the distance to the farthest endpoint.
-    // min represents the distance to the nearest endpoint plus the sum of the lengths of all ribbons.
-    // Whichever is larger is returned.
-    // Both are technically inadmissible due to the "done" action but that's not implemented yet anywhere
-    double sumLength = 0, min = DBL_MAX, max = 0;
-    for (const auto& r : m_Ribbons) {
-        sumLength += r.length();
-        auto dStart = distance(r.start(), x, y);
-        auto dEnd = distance(r.end(), x, y);
-        min = fmin(fmin(min, dEnd), dStart);
-        max = fmax(fmax(max, dEnd), dStart);
-    }
-    return fmax(sumLength + min, max);
+    return MaxDistancePolicy::evaluate(*this, x, y, 0);
 }
 
-const std::list<Ribbon>& RibbonManager::get() const {
-    return m_Ribbons;
+std::list<Ribbon> RibbonManager::get() const {
+    std::list<Ribbon> ribbons;
+    forEach([&] (const Ribbon& r) { ribbons.push_back(r); });
+    return ribbons;
 }
 
 std::vector<State> RibbonManager::findStatesOnRibbonsOnCircle(const State& center, double radius) const {
     std::vector<State> states;
-    for (const auto& r : m_Ribbons) {
+    forEach([&] (const Ribbon& r) {
         // circle line intersection from mathworld.wolfram.com
         auto dx = r.end().first - r.start().first;
         auto dy = r.end().second - r.start().second;
@@ -259,7 +444,7 @@ std::vector<State> RibbonManager::findStatesOnRibbonsOnCircle(const State& cente
         auto d = r.start().first*r.end().second - r.end().first*r.start().second;
         auto i1 = dr*dr;
         auto discriminant = radius*radius*i1 - d*d;
-        if (discriminant < 0) continue; // no intersection
+        if (discriminant < 0) return; // no intersection
         auto i2 = sqrt(discriminant);
         double sgn = dy < 0? -1 : 1;
         auto i3 = sgn * dx * i2;
@@ -287,7 +472,7 @@ std::vector<State> RibbonManager::findStatesOnRibbonsOnCircle(const State& cente
                 states.emplace_back(x2, y2, end.heading(), end.speed(), 0);
             }
         }
-    }
+    });
     return states;
 }
 
@@ -301,7 +486,7 @@ std::vector<State> RibbonManager::findNearStatesOnRibbons(const State& start, do
     auto y1 = start.y() + sin(h) * radius;
     auto y2 = start.y() - sin(h) * radius;
 
-    for (const Ribbon& r : m_Ribbons) {
+    forEach([&] (const Ribbon& r) {
 
         // check if ribbon is anywhere near current state (within 2*r)
         auto startProj = r.getProjection(start.x(), start.y());
@@ -313,7 +498,7 @@ std::vector<State> RibbonManager::findNearStatesOnRibbons(const State& start, do
                 d = fmin(start.distanceTo(r.start().first, r.start().second),
                          start.distanceTo(r.end().first, r.end().second));
             }
-            if (d > 2 * radius) continue;
+            if (d > 2 * radius) return;
         }
 
         // project points from before onto ribbon
@@ -373,18 +558,20 @@ std::vector<State> RibbonManager::findNearStatesOnRibbons(const State& start, do
 //            std::cerr << "Found Brown path to state " << states.back().toString() << " from " << start.toString() << std::endl;
 //            states.back().push(0.1); // push the state along the ribbon a tiny bit to fix rounding errors
         }
-    }
+    });
     return states;
 }
 
 void RibbonManager::changeHeuristicIfTooManyRibbons() {
-    if (m_Ribbons.size() > c_RibbonCountDangerThreshold) {
-        m_Heuristic = MaxDistance;
+    if (size() > tspRibbonLimit()) {
+        m_Heuristic = MstLowerBound;
+        m_Version = nextVersion();
     }
 }
 
 void RibbonManager::setHeuristic(Heuristic heuristic) {
     m_Heuristic = heuristic;
+    m_Version = nextVersion();
 }
 
 void RibbonManager::coverBetween(double x1, double y1, double x2, double y2) {
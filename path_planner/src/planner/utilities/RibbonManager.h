@@ -1,10 +1,18 @@
 #ifndef SRC_RIBBONMANAGER_H
 #define SRC_RIBBONMANAGER_H
 
+#include <algorithm>
+#include <cstdint>
 #include <list>
+#include <memory>
 #include <vector>
 #include <path_planner_common/State.h>
 #include "Ribbon.h"
+#include "RibbonGrid.h"
+#include "CoverageBitmap.h"
+#include "HeldKarpTable.h"
+#include "DubinsTable.h"
+#include "RibbonSpanningTree.h"
 extern "C" {
 #include <dubins.h>
 }
@@ -15,7 +23,9 @@ extern "C" {
 class RibbonManager {
 public:
     /**
-     * The different heuristics. None of them consider splitting survey lines at this time.
+     * The different heuristics. None of them consider splitting survey lines at this time. MstLowerBound is the one
+     * for lots of ribbons: max distance plus a minimum spanning tree over the survey lines (see RibbonSpanningTree),
+     * which covering keeps up to date instead of it being rebuilt.
      */
     enum Heuristic {
         MaxDistance,
@@ -23,6 +33,18 @@ public:
         TspPointRobotNoSplitKRibbons,
         TspDubinsNoSplitAllRibbons,
         TspDubinsNoSplitKRibbons,
+        MstLowerBound,
+    };
+
+    /**
+     * How covering works. Split is the original way: covering a point splits every ribbon containing it there, so the
+     * number of ribbons grows with the gaps left in them. Bitmap keeps each survey line as it was added with a
+     * CoverageBitmap of what's been covered along it, so covering only sets bits. Either way what's left is handed out
+     * as ribbons (for the bitmap, one per uncovered run), so the heuristics don't care which it is.
+     */
+    enum CoverageModel {
+        Split,
+        Bitmap,
     };
 
     /**
@@ -91,7 +113,22 @@ public:
     double approximateDistanceUntilDone(double x, double y, double yaw) const;
 
     /**
-     * If there are too many ribbons TSP solving is intractable so switch to max distance heuristic.
+     * A heuristic bound ahead of time, so it can be called without going through the switch on the heuristic.
+     */
+    typedef double (*HeuristicFunction)(const RibbonManager& ribbonManager, double x, double y, double yaw);
+
+    /**
+     * Look up a heuristic once (at the start of a search, say) and call it for every vertex after that. It gives the
+     * same values as approximateDistanceUntilDone on a manager using that heuristic.
+     * @param heuristic
+     * @return
+     */
+    static HeuristicFunction heuristicFunction(Heuristic heuristic);
+
+    /**
+     * If there are too many ribbons TSP solving is intractable so switch to the spanning tree heuristic, which can take
+     * any number of them. The all ribbons heuristics use a Held-Karp table so they can take more ribbons than the K
+     * ribbons ones.
      */
     void changeHeuristicIfTooManyRibbons();
 
@@ -111,8 +148,6 @@ public:
      */
     State getNearestEndpointAsState(const State& state) const;
 
-//    RibbonManager& operator=(const RibbonManager& other);
-
     /**
      * Get a string representation of the ribbons
      * @return
@@ -120,16 +155,16 @@ public:
     std::string dumpRibbons() const;
 
     /**
-     * Project the state onto the nearest ribbon to it.
+     * Project the state onto the nearest ribbon to it. Nearest is measured to the ribbon's segment, not the whole line.
      * @param state
      */
     void projectOntoNearestRibbon(State& state) const;
 
     /**
-     * Access the underlying list of ribbons
+     * Get a copy of the ribbons. Ribbons are shared between copies of a manager so there isn't one list to hand out.
      * @return
      */
-    const std::list<Ribbon>& get() const;
+    std::list<Ribbon> get() const;
 
     /**
      * Find states on nearby ribbons radius distance away from the state
@@ -153,6 +188,48 @@ public:
      */
     void setHeuristic(Heuristic heuristic);
 
+    /**
+     * @return the heuristic in use
+     */
+    Heuristic heuristic() const { return m_Heuristic; }
+
+    /**
+     * Change the coverage model. What's left of the ribbons carries over: switching to the bitmap makes each of them a
+     * line of its own, and switching back makes each uncovered run a ribbon.
+     * @param model
+     */
+    void setCoverageModel(CoverageModel model);
+
+    /**
+     * @return the coverage model in use
+     */
+    CoverageModel coverageModel() const { return m_CoverageModel; }
+
+    /**
+     * @return the turning radius the Dubins heuristics use (-1 if unset)
+     */
+    double turningRadius() const { return m_TurningRadius; }
+
+    /**
+     * @return how many of the nearest ribbons the K ribbons heuristics look at
+     */
+    int k() const { return m_K; }
+
+    /**
+     * Identifies the ribbons (and heuristic). Copies share a version until one of them changes its ribbons, and a
+     * version is never reused, so two managers with the same version have the same heuristic values.
+     * @return
+     */
+    uint64_t version() const { return m_Version; }
+
+    /**
+     * Hash of what's left to cover. Unlike version, two managers that got to the same ribbons by covering them in
+     * different orders (or on different branches of the search) have the same fingerprint. Cached until the ribbons
+     * change.
+     * @return
+     */
+    uint64_t fingerprint() const;
+
     /**
      * Change the ribbon width.
      * @param lineWidth
@@ -161,10 +238,106 @@ public:
 
 private:
     Heuristic m_Heuristic;
+    CoverageModel m_CoverageModel = Split;
+    uint64_t m_Version = nextVersion();
+    mutable uint64_t m_Fingerprint = 0, m_FingerprintVersion = 0;
     double m_TurningRadius = -1;
-    int m_K;
+    int m_K = 2;
+
+    /**
+     * Ribbons shared between a manager and the copies made from it (the vertices below it in the search tree). It's
+     * never changed once it's been made, so nobody needs to copy it.
+     */
+    class Snapshot {
+    public:
+        explicit Snapshot(std::vector<Ribbon> ribbons);
 
-    std::list<Ribbon> m_Ribbons;
+        std::vector<Ribbon> Ribbons;
+        // only built when there are enough ribbons for it to beat scanning them
+        RibbonGrid Index;
+    };
+
+    // Copy-on-write: a manager is the shared base, minus the base ribbons it has retired, plus its own local ribbons.
+    // Covering part of a base ribbon retires it and copies it into the local ribbons first, so copying a manager only
+    // copies what it has changed. Once that gets big it all gets squashed into a new base.
+    std::shared_ptr<const Snapshot> m_Base;
+    std::vector<int> m_Retired; // sorted
+    std::list<Ribbon> m_Local;
+
+    // With the bitmap coverage model the base ribbons are the survey lines, which never change, and this is what's been
+    // covered of each of them. Copy-on-write again, a line at a time. m_Retired and m_Local stay empty.
+    std::vector<std::shared_ptr<const CoverageBitmap>> m_Lines;
+    size_t m_UncoveredCount = 0;
+
+    /**
+     * The ribbons left, laid out flat for the heuristics: each one's endpoints, the yaws of the states at them (as in
+     * Ribbon::startAsState and endAsState) and its length.
+     */
+    struct Endpoints {
+        explicit Endpoints(const RibbonManager& ribbonManager);
+
+        std::vector<double> StartX, StartY, StartYaw, EndX, EndY, EndYaw, Length;
+        double TotalLength = 0;
+
+        size_t size() const { return Length.size(); }
+    };
+
+    // Endpoints of the current ribbons, shared with copies like the table below. Built lazily.
+    mutable std::shared_ptr<const Endpoints> m_Endpoints;
+
+    /**
+     * @return the endpoints of the current ribbons, building them first if they changed
+     */
+    const Endpoints& endpoints() const {
+        if (!m_Endpoints) m_Endpoints = std::make_shared<const Endpoints>(*this);
+        return *m_Endpoints;
+    }
+
+    // The heuristics, each a policy with a static evaluate(ribbonManager, x, y, yaw) (see RibbonManager.cpp)
+    struct MaxDistancePolicy;
+    struct HeldKarpPolicy;
+    template <bool PointRobot> struct KRibbonsPolicy;
+    struct SpanningTreePolicy;
+
+    template <class Policy>
+    static double evaluate(const RibbonManager& ribbonManager, double x, double y, double yaw) {
+        if (ribbonManager.done()) return 0;
+        return Policy::evaluate(ribbonManager, x, y, yaw);
+    }
+
+    // Held-Karp table for the current ribbons, shared with copies until one of them changes its ribbons. Built lazily.
+    mutable std::shared_ptr<const HeldKarpTable> m_TspTable;
+    mutable Heuristic m_TspTableHeuristic = MaxDistance;
+
+    // Spanning tree over the survey lines for MstLowerBound, shared with copies. Unlike the table it isn't thrown away
+    // when the ribbons change: covering takes lines out of it as they're finished. Built lazily.
+    mutable RibbonSpanningTree::SharedPtr m_SpanningTree;
+
+    /**
+     * @return the spanning tree, building it from the ribbons there are now if there isn't one
+     */
+    const RibbonSpanningTree& spanningTree() const;
+
+    /**
+     * Take the sites a finished ribbon was on out of the spanning tree, unless something's still left on them.
+     * @param finished the ribbon as it was before it was covered
+     */
+    void finishInSpanningTree(const Ribbon& finished);
+
+    /**
+     * @return whether the heuristic is one of the ones using a Held-Karp table
+     */
+    bool usesHeldKarp() const {
+        return m_Heuristic == TspPointRobotNoSplitAllRibbons || m_Heuristic == TspDubinsNoSplitAllRibbons;
+    }
+
+    /**
+     * @return how many ribbons the TSP heuristic in use can handle
+     */
+    size_t tspRibbonLimit() const {
+        if (m_Heuristic == MstLowerBound) return SIZE_MAX;
+        return usesHeldKarp() ? c_HeldKarpRibbonThreshold : c_RibbonCountDangerThreshold;
+    }
 
     /**
      * Calculate the Dubins distance between (x, y, h) and the state s.
@@ -175,60 +348,176 @@ private:
      * @return
      */
     double dubinsDistance(double x, double y, double h, const State& s) const {
+        return dubinsDistance(x, y, h, s.x(), s.y(), s.yaw());
+    }
+
+    double dubinsDistance(double x1, double y1, double h1, double x2, double y2, double h2) const {
         if (m_TurningRadius == -1) throw std::logic_error("Cannot compute ribbon dubins distance with unset turning radius");
-        DubinsPath dubinsPath;
-        double q1[] = {x, y, h}, q2[] = {s.x(), s.y(), s.yaw()};
-        dubins_shortest_path(&dubinsPath, q1, q2, m_TurningRadius);
-        return dubins_path_length(&dubinsPath);
+        // this goes into heuristic values, so it has to be exact: the table can overestimate, which would make them
+        // inadmissible (it's fine for ranking, like in RibbonOrdering)
+        return DubinsTable::exactLength(x1, y1, h1, x2, y2, h2, m_TurningRadius);
     }
 
     void add(const Ribbon& r, std::list<Ribbon>::iterator i);
 
     /**
-     * Calculate the max distance heuristic.
+     * Call whenever the ribbons change.
+     */
+    void changed();
+
+    static uint64_t nextVersion();
+
+    /**
+     * Cover (x, y) on the local ribbon at i.
      * @param x
      * @param y
-     * @return
+     * @param i
+     * @param finished if there's a spanning tree, gets what the ribbon was if this finishes it
+     * @return the iterator after i
      */
-    double maxDistance(double x, double y) const;
+    std::list<Ribbon>::iterator cover(double x, double y, std::list<Ribbon>::iterator i,
+                                      std::vector<Ribbon>& finished);
 
     /**
-     * Calculate the TSPDubinsNoSplitAllRibbons heuristic. As the name suggests, this uses Dubins distance between
-     * ribbons, does not split ribbons, and does not limit the branching factor in the TSP.
-     * @param ribbonsLeft
-     * @param distanceSoFar
+     * @return the number of ribbons left
+     */
+    size_t size() const {
+        return m_CoverageModel == Bitmap ? m_UncoveredCount : baseSize() - m_Retired.size() + m_Local.size();
+    }
+
+    size_t baseSize() const { return m_Base ? m_Base->Ribbons.size() : 0; }
+
+    bool retired(int id) const { return std::binary_search(m_Retired.begin(), m_Retired.end(), id); }
+
+    /**
+     * @return whether queries can use the index (it's ignored if the ribbon width changed since it was built)
+     */
+    bool indexed() const {
+        return m_Base && m_Base->Index.active() && m_Base->Index.padding() == Ribbon::RibbonWidth;
+    }
+
+    /**
+     * Squash the base and the changes to it into a new base.
+     */
+    void flatten();
+
+    /**
+     * Flatten if this manager's changes have grown too big to be cheap to copy.
+     */
+    void flattenIfTooManyChanges();
+
+    /**
+     * Cover (x, y) on line id, with the bitmap coverage model.
      * @param x
      * @param y
-     * @param yaw
-     * @return
+     * @param id
+     */
+    void coverLine(double x, double y, int id);
+
+    /**
+     * Visit every ribbon.
+     * @param f function taking a const Ribbon&
+     */
+    template <class F>
+    void forEach(F f) const {
+        if (m_CoverageModel == Bitmap) {
+            for (const auto& line : m_Lines) for (const auto& r : line->uncovered()) f(r);
+            return;
+        }
+        for (int id = 0; id < (int)baseSize(); id++) if (!retired(id)) f(m_Base->Ribbons[id]);
+        for (const auto& r : m_Local) f(r);
+    }
+
+    /**
+     * Visit at least every ribbon which could contain (x, y).
+     * @param x
+     * @param y
+     * @param f function taking a const Ribbon&
      */
-    double tspDubinsNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x,
-                                      double y, double yaw) const;
+    template <class F>
+    void forEachNear(double x, double y, F f) const {
+        if (!indexed()) return forEach(f);
+        std::vector<int> nearby;
+        m_Base->Index.candidates(x, y, nearby);
+        if (m_CoverageModel == Bitmap) {
+            for (auto id : nearby) for (const auto& r : m_Lines[id]->uncovered()) f(r);
+            return;
+        }
+        for (auto id : nearby) if (!retired(id)) f(m_Base->Ribbons[id]);
+        for (const auto& r : m_Local) f(r);
+    }
+
+    /**
+     * Find the ribbon minimizing a distance function, which must be no smaller than the distance to the ribbon's
+     * segment. Uses the index if it can, otherwise checks every ribbon.
+     * @param x
+     * @param y
+     * @param distance function taking a const Ribbon&
+     * @return the nearest ribbon, or nullptr if there are none
+     */
+    template <class Distance>
+    const Ribbon* nearest(double x, double y, Distance distance) const {
+        const Ribbon* result = nullptr;
+        double best = DBL_MAX;
+        auto consider = [&] (const Ribbon& r) {
+            auto d = distance(r);
+            if (d < best) {
+                best = d;
+                result = &r;
+            }
+        };
+        if (!indexed()) {
+            forEach(consider);
+            return result;
+        }
+        if (m_CoverageModel == Bitmap) {
+            // a line is as far away as the nearest of what's left of it, which is never nearer than the line itself
+            auto id = m_Base->Index.nearest(x, y, [&] (int i) {
+                double d = DBL_MAX;
+                for (const auto& r : m_Lines[i]->uncovered()) d = fmin(d, distance(r));
+                return d;
+            }, best);
+            best = DBL_MAX;
+            if (id != -1) for (const auto& r : m_Lines[id]->uncovered()) consider(r);
+            return result;
+        }
+        auto id = m_Base->Index.nearest(x, y, [&] (int i) {
+            return retired(i) ? DBL_MAX : distance(m_Base->Ribbons[i]);
+        }, best);
+        if (id != -1) result = &m_Base->Ribbons[id];
+        for (const auto& r : m_Local) consider(r);
+        return result;
+    }
 
     /**
-     * Calculate the TSPPointRobotNoSplitKRibbons heuristic. As the name suggests, this uses Euclidean distance between
-     * ribbons, does not split ribbons, and limits the TSP branching factor to K.
-     * @param ribbonsLeft
-     * @param distanceSoFar
-     * @param point
+     * Calculate the max distance heuristic.
+     * @param x
+     * @param y
      * @return
      */
-    double tspPointRobotNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, std::pair<double, double> point) const;
+    double maxDistance(double x, double y) const;
 
     /**
-     * Calculate the TSPDubinsNoSplitKRibbons heuristic. As the name suggests, this uses Dubins distance between
-     * ribbons, does not split ribbons, and limits the TSP branching factor to K.
-     * @param ribbonsLeft
-     * @param distanceSoFar
+     * Calculate the TspPointRobotNoSplitAllRibbons or TspDubinsNoSplitAllRibbons heuristic with a Held-Karp table,
+     * building the table first if the ribbons changed since the last one.
      * @param x
      * @param y
      * @param yaw
      * @return
      */
-    double tspDubinsNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x,
-                                    double y, double yaw) const;
+    double heldKarp(double x, double y, double yaw) const;
 
     static constexpr int c_RibbonCountDangerThreshold = 5;
+    // the all ribbons TSP heuristics use a Held-Karp table, which can take a few more
+    static constexpr int c_HeldKarpRibbonThreshold = 12;
+    // number of ribbons at which the spatial index is turned on, and the size of its cells
+    static constexpr size_t c_SpatialIndexThreshold = 32;
+    static constexpr double c_SpatialIndexCellSize = 20;
+    // how far off a site a ribbon can be and still be on it, allowing for rounding in splitting
+    static constexpr double c_SiteTolerance = 1e-6;
+    // changes a manager can make before flattening: this many plus one per c_BaseRibbonsPerChange base ribbons
+    static constexpr size_t c_MaxChanges = 16;
+    static constexpr size_t c_BaseRibbonsPerChange = 8;
     static double distance(std::pair<double, double> p1, std::pair<double, double> p2) {
         return distance(p1.first, p1.second, p2.first, p2.second);
     }
@@ -238,16 +527,6 @@ private:
     static double distance(double x1, double y1, double x2, double y2) {
         return sqrt((x1 - x2)*(x1 - x2) + (y1 - y2)*(y1 - y2));
     }
-
-    /**
-     * Calculate the TSPPointRobotNoSplitAllRibbons heuristic. As the name suggests, this uses Euclidean distance between
-     * ribbons, does not split ribbons, and does not limit the TSP branching factor.
-     * @param ribbonsLeft
-     * @param distanceSoFar
-     * @param point
-     * @return
-     */
-    static double tspPointRobotNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, std::pair<double, double> point);
 };
 
 
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cfloat>
+#include "RibbonOrdering.h"
+#include "DubinsTable.h"
+
+constexpr double RibbonOrdering::c_OnLegTolerance;
+constexpr double RibbonOrdering::c_IndexCellSize;
+constexpr int RibbonOrdering::c_MaxPasses;
+
+namespace {
+
+struct Point {
+    double X, Y, Yaw;
+};
+
+double straight(const Point& from, const Point& to) {
+    return sqrt((to.X - from.X) * (to.X - from.X) + (to.Y - from.Y) * (to.Y - from.Y));
+}
+
+Ribbon reversedRibbon(const Ribbon& r) {
+    return Ribbon(r.end().first, r.end().second, r.start().first, r.start().second);
+}
+
+}
+
+RibbonOrdering::RibbonOrdering(const std::vector<Ribbon>& ribbons, const State& start, double turningRadius,
+                               const RibbonOrdering* previous, const std::atomic<bool>* cancelled)
+    : m_Index(c_IndexCellSize) {
+    // a node is a ribbon going one way or the other: 2i is ribbon i forwards, 2i + 1 backwards
+    int n = (int)ribbons.size();
+    std::vector<Point> in(2 * n), out(2 * n);
+    for (int i = 0; i < n; i++) {
+        const auto& r = ribbons[i];
+        auto forwards = r.startAsState().yaw(), backwards = r.endAsState().yaw();
+        in[2 * i] = out[2 * i + 1] = {r.start().first, r.start().second, forwards};
+        out[2 * i] = in[2 * i + 1] = {r.end().first, r.end().second, forwards};
+        in[2 * i + 1].Yaw = out[2 * i + 1].Yaw = backwards;
+    }
+    Point startPoint{start.x(), start.y(), start.yaw()};
+    auto dubins = [&] (const Point& from, const Point& to) {
+        if (turningRadius <= 0) return straight(from, to);
+        return DubinsTable::length(from.X, from.Y, from.Yaw, to.X, to.Y, to.Yaw, turningRadius);
+    };
+    auto isCancelled = [&] { return cancelled && *cancelled; };
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<int> unplaced;
+    if (previous) {
+        // what's left of the previous order keeps its place
+        std::vector<std::pair<double, int>> ranked;
+        for (int i = 0; i < n; i++) {
+            bool reversed;
+            auto rank = previous->rank(ribbons[i], reversed);
+            if (rank < 0) unplaced.push_back(i);
+            else ranked.emplace_back(rank, 2 * i + reversed);
+        }
+        std::stable_sort(ranked.begin(), ranked.end(),
+                         [] (const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first < b.first; });
+        for (const auto& r : ranked) order.push_back(r.second);
+    } else {
+        // nearest neighbour
+        std::vector<bool> used(n, false);
+        auto at = startPoint;
+        for (int k = 0; k < n; k++) {
+            int best = -1;
+            auto bestDistance = DBL_MAX;
+            for (int node = 0; node < 2 * n; node++) {
+                if (used[node / 2]) continue;
+                auto d = straight(at, in[node]);
+                if (d < bestDistance) {
+                    bestDistance = d;
+                    best = node;
+                }
+            }
+            used[best / 2] = true;
+            order.push_back(best);
+            at = out[best];
+        }
+    }
+    // anything new goes where it adds the least
+    for (auto i : unplaced) {
+        int bestNode = 2 * i;
+        size_t bestPosition = order.size();
+        auto bestCost = DBL_MAX;
+        for (size_t p = 0; p <= order.size(); p++) {
+            const auto& before = p == 0 ? startPoint : out[order[p - 1]];
+            for (int node = 2 * i; node <= 2 * i + 1; node++) {
+                auto cost = straight(before, in[node]);
+                if (p < order.size()) cost += straight(out[node], in[order[p]]) - straight(before, in[order[p]]);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestNode = node;
+                    bestPosition = p;
+                }
+            }
+        }
+        order.insert(order.begin() + bestPosition, bestNode);
+    }
+
+    int m = (int)order.size();
+    auto outOf = [&] (int position) -> const Point& { return position < 0 ? startPoint : out[order[position]]; };
+    const double epsilon = 1e-9;
+
+    // 2-opt, with straight line transitions: turning a run of ribbons around doesn't change the distances between
+    // them, so only the two transitions at its ends change
+    for (int pass = 0; pass < c_MaxPasses && !isCancelled(); pass++) {
+        bool improved = false;
+        for (int i = 0; i < m; i++) {
+            for (int j = i; j < m; j++) {
+                const auto& before = outOf(i - 1);
+                auto current = straight(before, in[order[i]]);
+                auto reversed = straight(before, out[order[j]]);
+                if (j + 1 < m) {
+                    current += straight(out[order[j]], in[order[j + 1]]);
+                    reversed += straight(in[order[i]], in[order[j + 1]]);
+                }
+                if (reversed < current - epsilon) {
+                    std::reverse(order.begin() + i, order.begin() + j + 1);
+                    for (int k = i; k <= j; k++) order[k] ^= 1;
+                    improved = true;
+                }
+            }
+        }
+        if (!improved) break;
+    }
+
+    // or-opt, with Dubins transitions: take each ribbon out and put it back wherever (and whichever way) is cheapest
+    for (int pass = 0; pass < c_MaxPasses && !isCancelled(); pass++) {
+        bool improved = false;
+        for (int i = 0; i < m && !isCancelled(); i++) {
+            auto node = order[i];
+            const auto& before = outOf(i - 1);
+            auto saved = dubins(before, in[node]);
+            if (i + 1 < m) saved += dubins(out[node], in[order[i + 1]]) - dubins(before, in[order[i + 1]]);
+            order.erase(order.begin() + i);
+            auto bestCost = saved - epsilon;
+            int bestNode = node, bestPosition = i;
+            for (int p = 0; p < m; p++) {
+                const auto& previousOut = p == 0 ? startPoint : out[order[p - 1]];
+                auto existing = p < m - 1 ? dubins(previousOut, in[order[p]]) : 0;
+                for (auto candidate : {node & ~1, node | 1}) {
+                    auto cost = dubins(previousOut, in[candidate]);
+                    if (p < m - 1) cost += dubins(out[candidate], in[order[p]]) - existing;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestNode = candidate;
+                        bestPosition = p;
+                        improved = true;
+                    }
+                }
+            }
+            order.insert(order.begin() + bestPosition, bestNode);
+        }
+        if (!improved) break;
+    }
+
+    auto at = startPoint;
+    for (auto node : order) {
+        const auto& r = ribbons[node / 2];
+        m_Legs.push_back(node & 1 ? reversedRibbon(r) : r);
+        m_Cost += dubins(at, in[node]) + r.length();
+        at = out[node];
+    }
+    m_Index.build(m_Legs);
+}
+
+double RibbonOrdering::rank(const Ribbon& ribbon, bool& reversed) const {
+    auto start = ribbon.start(), end = ribbon.end();
+    auto x = (start.first + end.first) / 2, y = (start.second + end.second) / 2;
+    double best;
+    auto id = m_Index.nearest(x, y, [&] (int i) { return m_Legs[i].segmentDistance(x, y); }, best);
+    if (id == -1 || best > c_OnLegTolerance) return -1;
+    // the middle being on a leg isn't enough, it might be crossing it
+    const auto& leg = m_Legs[id];
+    if (leg.segmentDistance(start.first, start.second) > c_OnLegTolerance ||
+        leg.segmentDistance(end.first, end.second) > c_OnLegTolerance) {
+        return -1;
+    }
+    auto dx = leg.end().first - leg.start().first, dy = leg.end().second - leg.start().second;
+    reversed = (end.first - start.first) * dx + (end.second - start.second) * dy < 0;
+    auto squaredLength = dx * dx + dy * dy;
+    double t = 0;
+    if (squaredLength > 0) t = ((x - leg.start().first) * dx + (y - leg.start().second) * dy) / squaredLength;
+    return id + fmax(0, fmin(t, 1 - 1e-9));
+}
+
+std::vector<Ribbon> RibbonOrdering::arrange(const std::vector<Ribbon>& ribbons) const {
+    std::vector<std::pair<double, size_t>> ranked;
+    std::vector<Ribbon> oriented;
+    oriented.reserve(ribbons.size());
+    for (size_t i = 0; i < ribbons.size(); i++) {
+        bool reversed = false;
+        auto rank = this->rank(ribbons[i], reversed);
+        ranked.emplace_back(rank < 0 ? DBL_MAX : rank, i);
+        oriented.push_back(reversed ? reversedRibbon(ribbons[i]) : ribbons[i]);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [] (const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) { return a.first < b.first; });
+    std::vector<Ribbon> arranged;
+    arranged.reserve(ribbons.size());
+    for (const auto& r : ranked) arranged.push_back(oriented[r.second]);
+    return arranged;
+}
+
+RibbonManager RibbonOrdering::nextRibbons(const RibbonManager& ribbonManager, size_t count) const {
+    RibbonManager next(ribbonManager.heuristic(), ribbonManager.turningRadius(), ribbonManager.k());
+    next.setCoverageModel(ribbonManager.coverageModel());
+    auto ribbons = ribbonManager.get();
+    auto arranged = arrange({ribbons.begin(), ribbons.end()});
+    for (size_t i = 0; i < arranged.size() && i < count; i++) {
+        const auto& r = arranged[i];
+        next.add(r.start().first, r.start().second, r.end().first, r.end().second);
+    }
+    return next;
+}
@@ -0,0 +1,92 @@
+#ifndef SRC_RIBBONORDERING_H
+#define SRC_RIBBONORDERING_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <path_planner_common/State.h>
+#include "Ribbon.h"
+#include "RibbonGrid.h"
+#include "RibbonManager.h"
+
+/**
+ * An order to cover all the ribbons in, and which way to go along each, for the whole survey. The planner only looks
+ * DubinsPlan::timeHorizon() ahead, so with this it can be handed just the next few ribbons (see nextRibbons) and its
+ * cost per cycle doesn't grow with the survey.
+ *
+ * It's an open path TSP from where the vessel is, solved by local search: 2-opt (reversing a run of the order, which
+ * also turns around each ribbon in it) with straight line transitions, which makes that move cheap to check, then
+ * or-opt (moving one ribbon elsewhere, either way round) with Dubins transitions. Not LKH, but it gets parallel lines
+ * into a lawnmower pattern, which is what matters.
+ *
+ * Orders are meant to be repaired rather than made from scratch: given the previous one, what's left of each ribbon
+ * keeps its place (covering only ever shortens or splits ribbons along their own lines), anything new goes where it's
+ * cheapest, and the local search starts from there, which usually has very little left to do.
+ */
+class RibbonOrdering {
+public:
+    typedef std::shared_ptr<const RibbonOrdering> SharedPtr;
+
+    /**
+     * Order the ribbons.
+     * @param ribbons
+     * @param start where the vessel is
+     * @param turningRadius for the transitions between ribbons (0 for straight lines)
+     * @param previous an ordering to repair instead of starting from nearest neighbour (can be null)
+     * @param cancelled checked between improvement passes, to give up with whatever's been done so far
+     */
+    RibbonOrdering(const std::vector<Ribbon>& ribbons, const State& start, double turningRadius,
+                   const RibbonOrdering* previous = nullptr, const std::atomic<bool>* cancelled = nullptr);
+
+    /**
+     * @return the ribbons in order, each pointing the way it's to be covered
+     */
+    const std::vector<Ribbon>& legs() const { return m_Legs; }
+
+    size_t size() const { return m_Legs.size(); }
+
+    /**
+     * @return the length of the whole thing from the start: transitions (Dubins) plus the ribbons themselves
+     */
+    double cost() const { return m_Cost; }
+
+    /**
+     * Put ribbons in this order: each goes where the leg it's part of is, pointing the same way, and pieces of the same
+     * leg come in the order they're reached along it. Ribbons which aren't part of any leg go on the end, in the order
+     * they came in.
+     * @param ribbons
+     * @return
+     */
+    std::vector<Ribbon> arrange(const std::vector<Ribbon>& ribbons) const;
+
+    /**
+     * Make a ribbon manager with the same settings as the given one, but only its first count ribbons in this order.
+     * @param ribbonManager
+     * @param count
+     * @return
+     */
+    RibbonManager nextRibbons(const RibbonManager& ribbonManager, size_t count) const;
+
+private:
+    std::vector<Ribbon> m_Legs;
+    double m_Cost = 0;
+    // over the legs, to find which one a ribbon's part of
+    RibbonGrid m_Index;
+
+    // how far from a leg what's left of it can be, allowing for rounding
+    static constexpr double c_OnLegTolerance = 1e-3;
+    static constexpr double c_IndexCellSize = 20;
+    // improvement passes (of each kind) before giving up on converging
+    static constexpr int c_MaxPasses = 50;
+
+    /**
+     * Find where a ribbon goes in this order.
+     * @param ribbon
+     * @param reversed set to whether it points the other way from its leg
+     * @return the index of its leg plus how far along the leg its middle is (as a fraction), or -1 if it isn't on one
+     */
+    double rank(const Ribbon& ribbon, bool& reversed) const;
+};
+
+
+#endif //SRC_RIBBONORDERING_H
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+#include "RibbonSpanningTree.h"
+
+RibbonSpanningTree::Sites::Sites(std::vector<Ribbon> ribbons) : Ribbons(std::move(ribbons)) {
+    for (const auto& r : Ribbons) {
+        MiddleX.push_back((r.start().first + r.end().first) / 2);
+        MiddleY.push_back((r.start().second + r.end().second) / 2);
+        HalfLength.push_back(r.length() / 2);
+        LongestHalfLength = fmax(LongestHalfLength, HalfLength.back());
+    }
+    ByMiddleX.resize(Ribbons.size());
+    std::iota(ByMiddleX.begin(), ByMiddleX.end(), 0);
+    std::sort(ByMiddleX.begin(), ByMiddleX.end(), [&] (int a, int b) { return MiddleX[a] < MiddleX[b]; });
+}
+
+bool RibbonSpanningTree::Sites::nearerThan(int a, int b, double d) const {
+    auto dx = MiddleX[a] - MiddleX[b], dy = MiddleY[a] - MiddleY[b];
+    auto reach = HalfLength[a] + HalfLength[b] + d;
+    return dx * dx + dy * dy < reach * reach;
+}
+
+RibbonSpanningTree::RibbonSpanningTree(std::vector<Ribbon> sites, const std::vector<bool>& alive)
+    : m_Sites(std::make_shared<const Sites>(std::move(sites))) {
+    auto n = siteCount();
+    m_Alive = alive.empty() ? std::vector<bool>(n, true) : alive;
+    // Prim's, dense since every pair of sites is an edge, but only working out distances that could beat what's there
+    const auto& s = *m_Sites;
+    std::vector<int> left;
+    for (int id = 0; id < (int)n; id++) if (m_Alive[id]) left.push_back(id);
+    m_Size = left.size();
+    if (left.empty()) return;
+    std::vector<double> nearest(n, DBL_MAX);
+    std::vector<int> from(n, -1);
+    auto current = left.back();
+    left.pop_back();
+    while (!left.empty()) {
+        size_t best = 0;
+        for (size_t i = 0; i < left.size(); i++) {
+            auto id = left[i];
+            if (s.nearerThan(current, id, nearest[id])) {
+                auto d = distance(site(current), site(id));
+                if (d < nearest[id]) {
+                    nearest[id] = d;
+                    from[id] = current;
+                }
+            }
+            if (nearest[id] < nearest[left[best]]) best = i;
+        }
+        current = left[best];
+        left[best] = left.back();
+        left.pop_back();
+        m_Edges.push_back(Edge{from[current], current, nearest[current]});
+        m_Weight += nearest[current];
+    }
+}
+
+RibbonSpanningTree::SharedPtr RibbonSpanningTree::without(int id) const {
+    auto tree = std::make_shared<RibbonSpanningTree>(*this);
+    if (!contains(id)) return tree;
+    tree->m_Alive[id] = false;
+    tree->m_Size--;
+    tree->m_Edges.clear();
+    std::vector<int> neighbours;
+    for (const auto& e : m_Edges) {
+        if (e.A == id || e.B == id) {
+            neighbours.push_back(e.A == id ? e.B : e.A);
+            tree->m_Weight -= e.Length;
+        } else {
+            tree->m_Edges.push_back(e);
+        }
+    }
+    if (neighbours.size() < 2) return tree;
+
+    // The tree falls into a piece per neighbour. No edge within a piece that wasn't in the tree can be in the new one
+    // (it was the longest on a cycle that's still there), so the new tree is the pieces joined by the cheapest edges
+    // between them.
+    auto n = siteCount();
+    auto k = neighbours.size();
+    std::vector<int> degree(n + 1, 0), adjacent(2 * tree->m_Edges.size());
+    for (const auto& e : tree->m_Edges) {
+        degree[e.A + 1]++;
+        degree[e.B + 1]++;
+    }
+    std::partial_sum(degree.begin(), degree.end(), degree.begin());
+    std::vector<int> fill(degree.begin(), degree.end() - 1);
+    for (const auto& e : tree->m_Edges) {
+        adjacent[fill[e.A]++] = e.B;
+        adjacent[fill[e.B]++] = e.A;
+    }
+    std::vector<int> piece(n, -1), pieceSizes(k, 0), stack;
+    for (int p = 0; p < (int)k; p++) {
+        stack.push_back(neighbours[p]);
+        piece[neighbours[p]] = p;
+        while (!stack.empty()) {
+            auto u = stack.back();
+            stack.pop_back();
+            pieceSizes[p]++;
+            for (int i = degree[u]; i < degree[u + 1]; i++) {
+                if (piece[adjacent[i]] == -1) {
+                    piece[adjacent[i]] = p;
+                    stack.push_back(adjacent[i]);
+                }
+            }
+        }
+    }
+    // Every edge between pieces has an end outside the biggest one, so only those need looking at. The edges between
+    // the neighbours are a start on the cheapest between each pair, and anything no nearer than the longest of those
+    // can be skipped, which means only looking at sites whose middles are close enough in x.
+    auto largest = (int)(std::max_element(pieceSizes.begin(), pieceSizes.end()) - pieceSizes.begin());
+    std::vector<Edge> between(k * k);
+    double longest = 0;
+    for (size_t p = 0; p < k; p++) {
+        for (size_t q = p + 1; q < k; q++) {
+            between[p * k + q] = Edge{neighbours[p], neighbours[q], distance(site(neighbours[p]), site(neighbours[q]))};
+            longest = fmax(longest, between[p * k + q].Length);
+        }
+    }
+    const auto& s = *m_Sites;
+    for (int u = 0; u < (int)n; u++) {
+        if (piece[u] == -1 || piece[u] == largest) continue;
+        auto reach = s.HalfLength[u] + s.LongestHalfLength + longest;
+        auto first = std::lower_bound(s.ByMiddleX.begin(), s.ByMiddleX.end(), s.MiddleX[u] - reach,
+                                      [&] (int w, double x) { return s.MiddleX[w] < x; });
+        for (auto it = first; it != s.ByMiddleX.end() && s.MiddleX[*it] <= s.MiddleX[u] + reach; ++it) {
+            auto w = *it;
+            // pairs of small pieces get done from the one with the higher number
+            if (piece[w] == -1 || piece[w] == piece[u] || (piece[w] != largest && piece[w] > piece[u])) continue;
+            auto& e = between[std::min(piece[u], piece[w]) * k + std::max(piece[u], piece[w])];
+            if (!s.nearerThan(u, w, e.Length)) continue;
+            auto d = distance(site(u), site(w));
+            if (d < e.Length) e = Edge{u, w, d};
+        }
+    }
+    // Kruskal's over the pieces
+    std::vector<Edge> candidates;
+    for (size_t p = 0; p < k; p++) for (size_t q = p + 1; q < k; q++) candidates.push_back(between[p * k + q]);
+    std::sort(candidates.begin(), candidates.end(), [] (const Edge& e1, const Edge& e2) {
+        return e1.Length < e2.Length;
+    });
+    std::vector<int> parent(k);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto root = [&] (int p) {
+        while (parent[p] != p) p = parent[p] = parent[parent[p]];
+        return p;
+    };
+    for (const auto& e : candidates) {
+        auto a = root(piece[e.A]), b = root(piece[e.B]);
+        if (a == b) continue;
+        parent[a] = b;
+        tree->m_Edges.push_back(e);
+        tree->m_Weight += e.Length;
+    }
+    return tree;
+}
+
+double RibbonSpanningTree::distance(const Ribbon& a, const Ribbon& b) {
+    auto a1 = a.start(), a2 = a.end(), b1 = b.start(), b2 = b.end();
+    auto side = [] (std::pair<double, double> p, std::pair<double, double> q, std::pair<double, double> r) {
+        return (q.first - p.first) * (r.second - p.second) - (q.second - p.second) * (r.first - p.first);
+    };
+    // they cross if each one's ends are either side of the other
+    if (side(a1, a2, b1) * side(a1, a2, b2) < 0 && side(b1, b2, a1) * side(b1, b2, a2) < 0) return 0;
+    // otherwise the nearest points include an end of one of them
+    return fmin(fmin(a.segmentDistance(b1.first, b1.second), a.segmentDistance(b2.first, b2.second)),
+                fmin(b.segmentDistance(a1.first, a1.second), b.segmentDistance(a2.first, a2.second)));
+}
@@ -0,0 +1,99 @@
+#ifndef SRC_RIBBONSPANNINGTREE_H
+#define SRC_RIBBONSPANNINGTREE_H
+
+#include <memory>
+#include <vector>
+#include "Ribbon.h"
+
+/**
+ * Minimum spanning tree over a set of segments ("sites"), for the MstLowerBound heuristic. The distance between two
+ * sites is the shortest distance between any points on them.
+ *
+ * Covering the sites in any order means going from one to the next, and those legs make a path through all of them,
+ * which is no shorter than the minimum spanning tree. Covering only ever splits or shrinks ribbons along their own line,
+ * so pieces are never closer together than the sites they came from, and pieces of one site are 0 apart in the tree.
+ * That means a tree built once over the survey lines is still a lower bound however they get covered, as long as every
+ * site still has something left on it. When one doesn't, without() takes it out of the tree, which is exact and only
+ * needs distances from the smaller pieces the tree falls into (none at all for a leaf, the usual case).
+ *
+ * Trees are never changed once they're made, so managers share them the same way as their ribbons.
+ */
+class RibbonSpanningTree {
+public:
+    typedef std::shared_ptr<const RibbonSpanningTree> SharedPtr;
+
+    /**
+     * Build the tree. This is O(n^2) in the number of sites.
+     * @param sites
+     * @param alive which sites to include (all of them if empty)
+     */
+    explicit RibbonSpanningTree(std::vector<Ribbon> sites, const std::vector<bool>& alive = {});
+
+    /**
+     * @return the total length of the tree's edges
+     */
+    double weight() const { return m_Weight; }
+
+    /**
+     * @return how many sites are in the tree
+     */
+    size_t size() const { return m_Size; }
+
+    /**
+     * @return how many sites it was built with, in it or not
+     */
+    size_t siteCount() const { return m_Sites->Ribbons.size(); }
+
+    const Ribbon& site(int id) const { return m_Sites->Ribbons[id]; }
+
+    bool contains(int id) const { return m_Alive[id]; }
+
+    /**
+     * Make the minimum spanning tree of the sites left once one is taken out.
+     * @param id
+     * @return the new tree
+     */
+    SharedPtr without(int id) const;
+
+    /**
+     * Shortest distance between two segments.
+     * @param a
+     * @param b
+     * @return
+     */
+    static double distance(const Ribbon& a, const Ribbon& b);
+
+private:
+    struct Edge {
+        int A, B;
+        double Length;
+    };
+
+    struct Sites {
+        explicit Sites(std::vector<Ribbon> ribbons);
+
+        std::vector<Ribbon> Ribbons;
+        // middles and half lengths, for a quick bound on the distance between two sites
+        std::vector<double> MiddleX, MiddleY, HalfLength;
+        double LongestHalfLength = 0;
+        // ids sorted by the x of their middles
+        std::vector<int> ByMiddleX;
+
+        /**
+         * @return whether sites a and b could be nearer than d, going by their middles and half lengths
+         */
+        bool nearerThan(int a, int b, double d) const;
+    };
+
+    // shared between a tree and the ones made from it by without()
+    std::shared_ptr<const Sites> m_Sites;
+    std::vector<bool> m_Alive;
+    std::vector<Edge> m_Edges;
+    double m_Weight = 0;
+    size_t m_Size = 0;
+
+    RibbonSpanningTree() = default;
+};
+
+
+#endif //SRC_RIBBONSPANNINGTREE_H
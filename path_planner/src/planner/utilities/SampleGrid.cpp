@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include "SampleGrid.h"
+
+constexpr double SampleGrid::c_DefaultCellSize;
+
+SampleGrid::SampleGrid(double cellSize) : m_CellSize(cellSize) {}
+
+void SampleGrid::add(const State& state) {
+    int i = cellCoordinate(state.x()), j = cellCoordinate(state.y());
+    if (m_States.empty()) {
+        m_MinCellX = m_MaxCellX = i;
+        m_MinCellY = m_MaxCellY = j;
+    } else {
+        m_MinCellX = std::min(m_MinCellX, i); m_MaxCellX = std::max(m_MaxCellX, i);
+        m_MinCellY = std::min(m_MinCellY, j); m_MaxCellY = std::max(m_MaxCellY, j);
+    }
+    m_Cells[key(i, j)].push_back(m_States.size());
+    m_States.push_back(state);
+}
+
+void SampleGrid::clear() {
+    m_States.clear();
+    m_Cells.clear();
+}
+
+SampleGrid::Nearest::Nearest(const SampleGrid& grid, double x, double y)
+    : m_Grid(grid), m_X(x), m_Y(y), m_CellX(grid.cellCoordinate(x)), m_CellY(grid.cellCoordinate(y)) {}
+
+double SampleGrid::Nearest::unseenDistance() const {
+    if (m_Ring < 0) return -1;
+    auto maxRing = std::max(std::max(std::abs(m_CellX - m_Grid.m_MinCellX), std::abs(m_CellX - m_Grid.m_MaxCellX)),
+                            std::max(std::abs(m_CellY - m_Grid.m_MinCellY), std::abs(m_CellY - m_Grid.m_MaxCellY)));
+    if (m_Ring >= maxRing) return DBL_MAX; // seen every cell with anything in it
+    // distance to the edge of the block of cells we've looked at
+    auto size = m_Grid.m_CellSize;
+    auto dx = std::min(m_X - (m_CellX - m_Ring) * size, (m_CellX + m_Ring + 1) * size - m_X);
+    auto dy = std::min(m_Y - (m_CellY - m_Ring) * size, (m_CellY + m_Ring + 1) * size - m_Y);
+    return std::min(dx, dy);
+}
+
+bool SampleGrid::Nearest::next(size_t& index, double& distance) {
+    // min heap, ties to the lower index
+    auto comp = [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) { return a > b; };
+    if (m_Grid.empty()) return false;
+    while (true) {
+        auto unseen = unseenDistance();
+        if (!m_Heap.empty() && m_Heap.front().first <= unseen) {
+            std::pop_heap(m_Heap.begin(), m_Heap.end(), comp);
+            distance = m_Heap.back().first;
+            index = m_Heap.back().second;
+            m_Heap.pop_back();
+            return true;
+        }
+        if (unseen == DBL_MAX) return false;
+        // look at the next ring out
+        m_Ring++;
+        for (int i = m_CellX - m_Ring; i <= m_CellX + m_Ring; i++) {
+            int step = (i == m_CellX - m_Ring || i == m_CellX + m_Ring) ? 1 : 2 * m_Ring;
+            for (int j = m_CellY - m_Ring; j <= m_CellY + m_Ring; j += step) {
+                auto cell = m_Grid.m_Cells.find(key(i, j));
+                if (cell == m_Grid.m_Cells.end()) continue;
+                for (auto id : cell->second) {
+                    m_Heap.emplace_back(m_Grid.m_States[id].distanceTo(m_X, m_Y), id);
+                    std::push_heap(m_Heap.begin(), m_Heap.end(), comp);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef SRC_SAMPLEGRID_H
+#define SRC_SAMPLEGRID_H
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <path_planner_common/State.h>
+
+/**
+ * The planner's samples, bucketed into a uniform grid as they're added so expansion can walk them nearest first
+ * without sorting all of them every time.
+ *
+ * Samples are referred to by the order they were added in. Nearest walks outwards from a point ring by ring, keeping
+ * the samples it has seen in a heap, and hands one back once nothing in the rings it hasn't looked at yet could be
+ * closer. An expansion that stops after the first few dozen samples only looks at the cells around it.
+ */
+class SampleGrid {
+public:
+    /**
+     * @param cellSize side length of the (square) cells
+     */
+    explicit SampleGrid(double cellSize = c_DefaultCellSize);
+
+    /**
+     * Add a sample.
+     * @param state
+     */
+    void add(const State& state);
+
+    /**
+     * Forget all the samples.
+     */
+    void clear();
+
+    size_t size() const { return m_States.size(); }
+
+    bool empty() const { return m_States.empty(); }
+
+    const State& operator[](size_t i) const { return m_States[i]; }
+
+    /**
+     * Walks the samples in order of increasing Euclidean distance from a point (ties in the order they were added).
+     * Only valid as long as the grid isn't changed.
+     */
+    class Nearest {
+    public:
+        Nearest(const SampleGrid& grid, double x, double y);
+
+        /**
+         * Get the next nearest sample.
+         * @param index set to the sample's index
+         * @param distance set to its distance from the point
+         * @return false once there are no more
+         */
+        bool next(size_t& index, double& distance);
+
+    private:
+        const SampleGrid& m_Grid;
+        double m_X, m_Y;
+        int m_CellX, m_CellY;
+        int m_Ring = -1; // last ring looked at
+        std::vector<std::pair<double, size_t>> m_Heap; // seen but not handed out yet
+
+        /**
+         * @return a lower bound on the distance to anything in a ring we haven't looked at
+         */
+        double unseenDistance() const;
+    };
+
+    static constexpr double c_DefaultCellSize = 10; // meters
+
+private:
+    double m_CellSize;
+    std::vector<State> m_States;
+    std::unordered_map<int64_t, std::vector<size_t>> m_Cells;
+    int m_MinCellX = 0, m_MaxCellX = 0, m_MinCellY = 0, m_MaxCellY = 0;
+
+    int cellCoordinate(double v) const { return (int)floor(v / m_CellSize); }
+
+    static int64_t key(int i, int j) {
+        return (int64_t)(((uint64_t)(uint32_t)i << 32) | (uint32_t)j);
+    }
+};
+
+
+#endif //SRC_SAMPLEGRID_H
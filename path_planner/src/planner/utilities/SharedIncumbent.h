@@ -0,0 +1,37 @@
+#ifndef SRC_SHAREDINCUMBENT_H
+#define SRC_SHAREDINCUMBENT_H
+
+#include <atomic>
+#include <cfloat>
+#include <memory>
+
+/**
+ * The cost of the best plan found so far by any of a group of planners searching the same problem at once (see
+ * PortfolioPlanner), so each can prune against the others' plans as well as its own. Lock free.
+ */
+class SharedIncumbent {
+public:
+    typedef std::shared_ptr<SharedIncumbent> SharedPtr;
+
+    SharedIncumbent() : m_Cost(DBL_MAX) {}
+
+    /**
+     * @return the best cost so far (DBL_MAX if there isn't one)
+     */
+    double cost() const { return m_Cost.load(std::memory_order_relaxed); }
+
+    /**
+     * Record a plan's cost, if it's better than the best so far.
+     * @param cost
+     */
+    void offer(double cost) {
+        auto current = m_Cost.load(std::memory_order_relaxed);
+        while (cost < current && !m_Cost.compare_exchange_weak(current, cost, std::memory_order_relaxed)) {}
+    }
+
+private:
+    std::atomic<double> m_Cost;
+};
+
+
+#endif //SRC_SHAREDINCUMBENT_H
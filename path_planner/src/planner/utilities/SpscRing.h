@@ -0,0 +1,55 @@
+#ifndef SRC_SPSCRING_H
+#define SRC_SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Lock free bounded queue between one producer thread and one consumer thread (or several, if something else makes
+ * sure only one of them is using it at a time). Each side only writes its own index, so neither ever waits for the
+ * other; when it's full push() just says so.
+ * @tparam T copyable
+ * @tparam Capacity a power of two
+ */
+template <class T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Ring capacity must be a power of two");
+public:
+    SpscRing() : m_Head(0), m_Tail(0) {}
+
+    /**
+     * Add an item to the back. Producer only.
+     * @param item
+     * @return false (and nothing added) if it's full
+     */
+    bool push(const T& item) {
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_Head.load(std::memory_order_acquire) == Capacity) return false;
+        m_Items[tail & (Capacity - 1)] = item;
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the item at the front. Consumer only.
+     * @param item set if there was one
+     * @return false if it's empty
+     */
+    bool pop(T& item) {
+        auto head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_Tail.load(std::memory_order_acquire)) return false;
+        item = m_Items[head & (Capacity - 1)];
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    T m_Items[Capacity];
+    // counts of items ever pushed and popped (so they only wrap around after a very long time)
+    std::atomic<size_t> m_Head, m_Tail;
+};
+
+
+#endif //SRC_SPSCRING_H
@@ -1,18 +1,46 @@
 #include "StateGenerator.h"
 
+#include <algorithm>
 #include <utility>
 
+constexpr double StateGenerator::c_RibbonFraction;
+
 StateGenerator::StateGenerator(double minX, double maxX, double minY, double maxY, double minSpeed, double maxSpeed,
                                  unsigned long seed) {
     m_XDistribution = std::uniform_real_distribution<>(minX, maxX);
     m_YDistribution = std::uniform_real_distribution<>(minY, maxY);
     m_HeadingDistribution = std::uniform_real_distribution<>(0, 2 * M_PI);
     m_SpeedDistribution = std::uniform_real_distribution<>(minSpeed, maxSpeed);
+    m_CenterX = (minX + maxX) / 2;
+    m_CenterY = (minY + maxY) / 2;
+    m_MaxDistance = fmin(maxX - minX, maxY - minY) / 2;
 
     m_RandomEngine.seed(seed);
+    // a separate engine, so uniform sampling gives the same samples it always has
+    std::minstd_rand shiftEngine(seed);
+    std::uniform_real_distribution<> unit(0, 1);
+    for (auto& s : m_Shift) s = unit(shiftEngine);
 }
 
 State StateGenerator::generate() {
+    switch (m_Strategy) {
+        case Uniform: break;
+        case Halton: {
+            double u[4];
+            nextHalton(u);
+            return State(m_XDistribution.a() + u[0] * (m_XDistribution.b() - m_XDistribution.a()),
+                         m_YDistribution.a() + u[1] * (m_YDistribution.b() - m_YDistribution.a()),
+                         u[2] * 2 * M_PI,
+                         m_SpeedDistribution.a() + u[3] * (m_SpeedDistribution.b() - m_SpeedDistribution.a()),
+                         0);
+        }
+        case Informed: return generateInDisk();
+        case RibbonBiased: {
+            State s;
+            if (m_HeadingDistribution(m_RandomEngine) < 2 * M_PI * c_RibbonFraction && generateOnRibbon(s)) return s;
+            return generateInDisk();
+        }
+    }
 
     State s = State(m_XDistribution(m_RandomEngine),
                            m_YDistribution(m_RandomEngine),
@@ -35,4 +63,65 @@ StateGenerator::StateGenerator(double minX, double maxX, double minY, double max
                                : StateGenerator(minX, maxX, minY, maxY, minSpeed, maxSpeed, seed){
     m_RibbonManager = std::move(ribbonManager);
     m_SampleOnRibbons = true;
+    double total = 0;
+    for (const auto& r : m_RibbonManager.get()) {
+        // only the ribbons we could get to matter
+        if (r.segmentDistance(m_CenterX, m_CenterY) > m_MaxDistance) continue;
+        m_Ribbons.push_back(r);
+        total += r.length();
+        m_CumulativeLengths.push_back(total);
+    }
+}
+
+void StateGenerator::setMaxDistance(double maxDistance) {
+    double boxDistance = fmin(m_XDistribution.b() - m_XDistribution.a(), m_YDistribution.b() - m_YDistribution.a()) / 2;
+    m_MaxDistance = fmax(0, fmin(maxDistance, boxDistance));
+}
+
+double StateGenerator::halton(uint64_t i, unsigned base) {
+    double result = 0, f = 1.0 / base;
+    while (i > 0) {
+        result += f * (i % base);
+        i /= base;
+        f /= base;
+    }
+    return result;
+}
+
+void StateGenerator::nextHalton(double (&u)[4]) {
+    static constexpr unsigned bases[] = {2, 3, 5, 7};
+    for (int d = 0; d < 4; d++) {
+        u[d] = halton(m_HaltonIndex, bases[d]) + m_Shift[d];
+        if (u[d] >= 1) u[d] -= 1;
+    }
+    m_HaltonIndex++;
+}
+
+State StateGenerator::generateInDisk() {
+    double u[4];
+    nextHalton(u);
+    // area preserving, so the disk is covered evenly
+    auto r = m_MaxDistance * sqrt(u[0]), theta = u[1] * 2 * M_PI;
+    return State(m_CenterX + r * cos(theta), m_CenterY + r * sin(theta), u[2] * 2 * M_PI,
+                 m_SpeedDistribution.a() + u[3] * (m_SpeedDistribution.b() - m_SpeedDistribution.a()), 0);
+}
+
+bool StateGenerator::generateOnRibbon(State& s) {
+    if (m_Ribbons.empty()) return false;
+    std::uniform_real_distribution<> unit(0, 1);
+    auto along = unit(m_RandomEngine) * m_CumulativeLengths.back();
+    auto index = std::upper_bound(m_CumulativeLengths.begin(), m_CumulativeLengths.end(), along) -
+            m_CumulativeLengths.begin();
+    index = std::min(index, (long)m_Ribbons.size() - 1);
+    const auto& ribbon = m_Ribbons[index];
+    auto t = ribbon.length() > 0 ? (along - (m_CumulativeLengths[index] - ribbon.length())) / ribbon.length() : 0;
+    auto start = ribbon.start(), end = ribbon.end();
+    s = State(start.first + t * (end.first - start.first), start.second + t * (end.second - start.second), 0,
+              m_SpeedDistribution(m_RandomEngine), 0);
+    if ((s.x() - m_CenterX) * (s.x() - m_CenterX) + (s.y() - m_CenterY) * (s.y() - m_CenterY) >
+        m_MaxDistance * m_MaxDistance) return false;
+    auto yaw = atan2(end.second - start.second, end.first - start.first);
+    if (unit(m_RandomEngine) < 0.5) yaw += M_PI; // either way along the ribbon
+    s.setYaw(yaw < 0 ? yaw + 2 * M_PI : yaw);
+    return true;
 }
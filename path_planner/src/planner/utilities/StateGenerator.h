@@ -2,6 +2,7 @@
 #define SRC_STATEGENERATOR_H
 
 #include <random>
+#include <vector>
 #include <path_planner_common/State.h>
 #include "RibbonManager.h"
 
@@ -10,6 +11,18 @@
  */
 class StateGenerator {
 public:
+    /**
+     * How samples are drawn.
+     *
+     * Uniform is plain pseudo-random samples in the box (with the occasional one projected onto a ribbon), Halton is
+     * the same box covered with a (randomly shifted) Halton sequence instead, so there are no clumps or holes.
+     * Informed draws the Halton points in the disk the boat can actually reach, shrunk to whatever setMaxDistance says.
+     * RibbonBiased is Informed with a quarter of the samples put on ribbons, in proportion to how long they are.
+     */
+    enum Strategy {
+        Uniform, Halton, Informed, RibbonBiased
+    };
+
     StateGenerator(double minX, double maxX,
                     double minY, double maxY,
                     double minSpeed, double maxSpeed,
@@ -23,11 +36,49 @@ public:
 
     State generate();
 
+    void setStrategy(Strategy strategy) { m_Strategy = strategy; }
+
+    Strategy strategy() const { return m_Strategy; }
+
+    /**
+     * Only generate (Informed and RibbonBiased) samples at most this far from the center of the box. Samples further
+     * away than the incumbent's cost allows can't be on a better plan, so the planner shrinks this as it goes.
+     * @param maxDistance
+     */
+    void setMaxDistance(double maxDistance);
+
+    /**
+     * The i-th element of the Halton sequence in the given (prime) base. Exposed for testing.
+     * @param i
+     * @param base
+     * @return a number in [0, 1)
+     */
+    static double halton(uint64_t i, unsigned base);
+
 private:
     std::uniform_real_distribution<double> m_XDistribution, m_YDistribution, m_HeadingDistribution, m_SpeedDistribution;
     std::default_random_engine m_RandomEngine;
     RibbonManager m_RibbonManager;
     bool m_SampleOnRibbons = false;
+
+    Strategy m_Strategy = Uniform;
+    uint64_t m_HaltonIndex = 1; // skip 0, which is the corner
+    double m_Shift[4] = {0, 0, 0, 0}; // Cranley-Patterson rotation, so different seeds give different sequences
+    double m_CenterX, m_CenterY, m_MaxDistance;
+    // uncovered ribbons and their cumulative lengths, for RibbonBiased
+    std::vector<Ribbon> m_Ribbons;
+    std::vector<double> m_CumulativeLengths;
+
+    static constexpr double c_RibbonFraction = 0.25;
+
+    /**
+     * Next point of the shifted Halton sequence, one coordinate per dimension, in [0, 1).
+     */
+    void nextHalton(double (&u)[4]);
+
+    State generateInDisk();
+
+    bool generateOnRibbon(State& s);
 };
 
 
@@ -0,0 +1,81 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    for (unsigned i = 1; i < threads; i++) m_Workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WorkReady.notify_all();
+    for (auto& w : m_Workers) w.join();
+}
+
+unsigned ThreadPool::size() const {
+    return m_Workers.size() + 1;
+}
+
+void ThreadPool::run(size_t n, const std::function<void(size_t)>& task) {
+    if (n == 0) return;
+    if (m_Workers.empty() || n == 1) {
+        for (size_t i = 0; i < n; i++) task(i);
+        return;
+    }
+    Batch batch(task, n);
+    std::list<Batch*>::iterator queued;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        queued = m_Batches.insert(m_Batches.end(), &batch);
+    }
+    m_WorkReady.notify_all();
+    drain(batch);
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        // nobody new can pick it up once it's out of the queue, so just wait for whoever's still on it
+        m_Batches.erase(queued);
+        m_WorkDone.wait(lock, [&] { return batch.Busy == 0; });
+        std::swap(error, batch.Error);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void ThreadPool::work() {
+    while (true) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkReady.wait(lock, [&] {
+                if (m_Stop) return true;
+                for (auto b : m_Batches) {
+                    if (!b->allTaken()) {
+                        batch = b;
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (m_Stop) return;
+            batch->Busy++;
+        }
+        drain(*batch);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            // callers all wait on the same condition, so they all have to hear it
+            if (--batch->Busy == 0) m_WorkDone.notify_all();
+        }
+    }
+}
+
+void ThreadPool::drain(Batch& batch) {
+    for (size_t i = batch.Next++; i < batch.Count; i = batch.Next++) {
+        try {
+            batch.Task(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!batch.Error) batch.Error = std::current_exception();
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef SRC_THREADPOOL_H
+#define SRC_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <list>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads for running many small independent tasks, like computing the true costs of the edges
+ * out of a vertex. Starting threads for every expansion would cost more than the edges, so they're kept around and
+ * woken for each batch.
+ *
+ * The calling thread does tasks too, so a pool of size n has n - 1 workers. Several threads can run batches at once
+ * (the vessels of a Fleet share one pool): workers take tasks from the oldest batch with any left, and each caller
+ * keeps working through its own batch however busy the workers are, so nobody waits on anyone else's batch to start
+ * theirs. That also makes it fine for a task to run a batch of its own. It does mean the tasks of one batch might not
+ * all be going at the same time, so they mustn't wait on each other.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threads total threads to use, including the caller
+     */
+    explicit ThreadPool(unsigned threads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Call task(i) for i in [0, n) across the pool and wait for all of them. If any throw, the first exception is
+     * rethrown here once the rest have finished.
+     * @param n
+     * @param task
+     */
+    void run(size_t n, const std::function<void(size_t)>& task);
+
+    /**
+     * @return threads used by run(), including the caller
+     */
+    unsigned size() const;
+
+private:
+    struct Batch {
+        Batch(const std::function<void(size_t)>& task, size_t count) : Task(task), Count(count), Next(0) {}
+
+        const std::function<void(size_t)>& Task;
+        size_t Count;
+        std::atomic<size_t> Next;
+        size_t Busy = 0; // workers in the middle of its tasks
+        std::exception_ptr Error;
+
+        // whether every task has been taken
+        bool allTaken() const { return Next >= Count; }
+    };
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkReady, m_WorkDone;
+    bool m_Stop = false;
+    // batches whose callers haven't finished their own part yet, oldest first (they live on the callers' stacks)
+    std::list<Batch*> m_Batches;
+
+    void work();
+
+    /**
+     * Take tasks from a batch until there aren't any left to start.
+     * @param batch
+     */
+    void drain(Batch& batch);
+};
+
+
+#endif //SRC_THREADPOOL_H
@@ -0,0 +1,60 @@
+#ifndef SRC_TRIPLEBUFFER_H
+#define SRC_TRIPLEBUFFER_H
+
+#include <atomic>
+
+/**
+ * Lock free single slot mailbox between one writer thread and one reader thread: the reader always gets the latest
+ * value written, and neither ever waits for the other. There are three copies of the value, one being written, one
+ * being read and one in the middle holding the latest finished value; writing and reading just swap their copy with
+ * the middle one. Values that get written over before the reader looks are never seen.
+ *
+ * Only one thread may call back() and publish(), and only one (other) thread update() and front().
+ * @tparam T copyable
+ */
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : m_Middle(1) {}
+
+    /**
+     * The writer's copy, to fill in before publish(). Whatever was there before is left over from some earlier value.
+     * @return
+     */
+    T& back() { return m_Slots[m_Back]; }
+
+    /**
+     * Hand the writer's copy over to the reader.
+     */
+    void publish() {
+        m_Back = m_Middle.exchange(m_Back | c_Fresh, std::memory_order_acq_rel) & c_IndexMask;
+    }
+
+    /**
+     * Take the latest value, if there's been one since last time.
+     * @return whether front() has changed
+     */
+    bool update() {
+        if (!(m_Middle.load(std::memory_order_relaxed) & c_Fresh)) return false;
+        m_Front = m_Middle.exchange(m_Front, std::memory_order_acq_rel) & c_IndexMask;
+        return true;
+    }
+
+    /**
+     * The reader's copy: the latest value as of the last update() (default constructed before there's been one).
+     * @return
+     */
+    T& front() { return m_Slots[m_Front]; }
+
+private:
+    T m_Slots[3];
+    // only touched by the writer and the reader respectively
+    unsigned m_Back = 0, m_Front = 2;
+    // index of the middle copy, and whether it's been written since the reader last took it
+    std::atomic<unsigned> m_Middle;
+
+    static constexpr unsigned c_IndexMask = 3, c_Fresh = 4;
+};
+
+
+#endif //SRC_TRIPLEBUFFER_H
@@ -0,0 +1,108 @@
+#include "Visualizer.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+constexpr uint32_t Visualizer::c_Version;
+
+Visualizer::Visualizer(const std::string& path, Format format) : m_Format(format) {
+    if (m_Format == Text) {
+        m_Stream.open(path, std::ios::app | std::ios::out);
+        return;
+    }
+    m_Stream.open(path, std::ios::trunc | std::ios::out | std::ios::binary);
+    uint32_t header[] = {0, c_Version, sizeof(Record)};
+    std::memcpy(header, "PPVB", 4);
+    m_Stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+    m_Queue.reset(new MpscRing<Record, c_QueueCapacity>());
+    // start the writer last, once the queue's there
+    m_Writer = std::thread(&Visualizer::writeLoop, this);
+}
+
+Visualizer::~Visualizer() {
+    if (m_Writer.joinable()) {
+        m_Stop = true;
+        m_Writer.join();
+    }
+}
+
+std::ofstream& Visualizer::stream() {
+    if (m_Format != Text) throw std::logic_error("Visualizer text stream used with the binary format");
+    return m_Stream;
+}
+
+void Visualizer::record(const State& state, double g, double h, Tag tag) {
+    if (m_Format == Text) {
+        m_Stream << "State: (" << state.toStringRad() << "), f: " << g + h << ", g: " << g << ", h: " << h << " "
+            << tagName(tag) << std::endl;
+        return;
+    }
+    push(Record{state.x(), state.y(), state.heading(), state.speed(), state.time(), (float)g, (float)h, tag, 0});
+}
+
+void Visualizer::recordRibbons(const std::vector<std::array<double, 4>>& ribbons) {
+    if (m_Format == Text) {
+        // same as RibbonManager::dumpRibbons
+        m_Stream << "Ribbons: \n";
+        if (ribbons.empty()) m_Stream << "None\n";
+        for (const auto& r : ribbons) {
+            m_Stream << "(" << r[0] << ", " << r[1] << ") -> (" << r[2] << ", " << r[3] << ") with length "
+                << sqrt((r[2] - r[0]) * (r[2] - r[0]) + (r[3] - r[1]) * (r[3] - r[1])) << "\n";
+        }
+        m_Stream << "\nEnd Ribbons" << std::endl;
+        return;
+    }
+    push(Record{0, 0, 0, 0, 0, 0, 0, RibbonsTag, 0});
+    for (const auto& r : ribbons) {
+        push(Record{r[0], r[1], 0, 0, 0, 0, 0, RibbonStartTag, 0});
+        push(Record{r[2], r[3], 0, 0, 0, 0, 0, RibbonEndTag, 0});
+    }
+    push(Record{0, 0, 0, 0, 0, 0, 0, EndRibbonsTag, 0});
+}
+
+const char* Visualizer::tagName(Tag tag) {
+    switch (tag) {
+        case VertexTag: return "vertex";
+        case StartTag: return "start";
+        case GoalTag: return "goal";
+        case SampleTag: return "sample";
+        case TrajectoryTag: return "trajectory";
+        case PlanTag: return "plan";
+        case RibbonsTag: return "ribbons";
+        case RibbonStartTag: return "ribbon_start";
+        case RibbonEndTag: return "ribbon_end";
+        case EndRibbonsTag: return "end_ribbons";
+        default: return "unknown";
+    }
+}
+
+void Visualizer::push(const Record& record) {
+    if (!m_Queue->push(record)) m_Dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Visualizer::writeLoop() {
+    // written out in chunks, so the file sees a few big writes instead of lots of little ones
+    std::vector<Record> chunk;
+    chunk.reserve(1024);
+    while (true) {
+        // look before emptying the queue so nothing pushed before the destructor was called is left behind
+        bool stop = m_Stop;
+        Record record;
+        while (m_Queue->pop(record)) {
+            chunk.push_back(record);
+            if (chunk.size() == chunk.capacity()) {
+                m_Stream.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(Record));
+                chunk.clear();
+            }
+        }
+        if (!chunk.empty()) {
+            m_Stream.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(Record));
+            chunk.clear();
+        }
+        if (stop) break;
+        m_Stream.flush();
+        std::this_thread::sleep_for(std::chrono::microseconds((int)(c_WriterIdleSeconds * 1e6)));
+    }
+    m_Stream.flush();
+}
@@ -1,25 +1,126 @@
 #ifndef SRC_VISUALIZER_H
 #define SRC_VISUALIZER_H
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <path_planner_common/State.h>
+#include "MpscRing.h"
 
 /**
  * Encapsulate IO for visualization.
+ *
+ * There are two formats. Text is what there's always been, one line per record written straight to the file by
+ * whichever thread is planning (so it's slow, and only one thread at a time can use it). Binary records are fixed size
+ * structs that go in a lock free queue, and a thread of the visualizer's own writes them out, so recording one costs
+ * about as much as copying it. If the writer falls behind records get dropped rather than holding up the planner (see
+ * dropped()). src/visualization_reader.py reads the binary format, and visualizer.py takes either.
+ *
+ * A binary file starts with a header: the four bytes "PPVB", then the format version and the record size as uint32s,
+ * then every record as a Record in native byte order.
  */
 class Visualizer {
 public:
     typedef std::shared_ptr<Visualizer> SharedPtr;
     typedef std::unique_ptr<Visualizer> UniquePtr;
-    explicit Visualizer(const std::string& path) {
-        m_Stream.open(path, std::ios::app | std::ios::out);
-    }
 
-    std::ofstream& stream() {
-        return m_Stream;
-    }
+    enum Format {
+        Text,
+        Binary
+    };
+
+    /**
+     * What a record is. A set of ribbons is a Ribbons record, then a RibbonStart and a RibbonEnd per ribbon, then an
+     * EndRibbons record.
+     */
+    enum Tag : uint32_t {
+        VertexTag,
+        StartTag,
+        GoalTag,
+        SampleTag,
+        TrajectoryTag,
+        PlanTag,
+        RibbonsTag,
+        RibbonStartTag,
+        RibbonEndTag,
+        EndRibbonsTag,
+    };
+
+    struct Record {
+        double X, Y, Heading, Speed, Time;
+        float G, H;
+        uint32_t Tag;
+        uint32_t Reserved;
+    };
+    static_assert(sizeof(Record) == 56, "Visualization records should be packed");
+
+    static constexpr uint32_t c_Version = 1;
+
+    /**
+     * Text files are appended to, binary ones started over.
+     * @param path
+     * @param format
+     */
+    explicit Visualizer(const std::string& path, Format format = Text);
+
+    /**
+     * Writes out whatever binary records are still queued before returning.
+     */
+    ~Visualizer();
+
+    /**
+     * The text stream, for anything that isn't a record. Text format only.
+     * @return
+     */
+    std::ofstream& stream();
+
+    Format format() const { return m_Format; }
+
+    /**
+     * Record a state. Safe from any number of threads with the binary format, only one at a time with text.
+     * @param state
+     * @param g cost so far
+     * @param h heuristic
+     * @param tag
+     */
+    void record(const State& state, double g, double h, Tag tag);
+
+    /**
+     * Record a set of ribbons (as a list of start and end points). Same threading as record().
+     * @param ribbons each one's x1, y1, x2, y2
+     */
+    void recordRibbons(const std::vector<std::array<double, 4>>& ribbons);
+
+    /**
+     * @return how many binary records have been thrown away because the queue was full
+     */
+    uint64_t dropped() const { return m_Dropped; }
+
+    /**
+     * @return the name the text format uses for a tag
+     */
+    static const char* tagName(Tag tag);
 
 private:
+    Format m_Format;
     std::ofstream m_Stream;
+
+    // binary format only
+    static constexpr size_t c_QueueCapacity = 1 << 16;
+    // how long the writer sleeps when it's caught up
+    static constexpr double c_WriterIdleSeconds = 0.002;
+    std::unique_ptr<MpscRing<Record, c_QueueCapacity>> m_Queue;
+    std::atomic<uint64_t> m_Dropped{0};
+    std::atomic<bool> m_Stop{false};
+    std::thread m_Writer;
+
+    void push(const Record& record);
+
+    void writeLoop();
 };
 
 
@@ -0,0 +1,19 @@
+#include "WarmStart.h"
+
+void WarmStart::remember(const std::vector<State>& planStates) {
+    m_PlanStates = planStates;
+    // samples don't carry a time; the planner works it out when they're connected
+    for (auto& s : m_PlanStates) s.time() = 0;
+}
+
+std::vector<State> WarmStart::samplesWithin(double minX, double maxX, double minY, double maxY) const {
+    std::vector<State> result;
+    for (const auto& s : m_PlanStates) {
+        if (s.x() >= minX && s.x() <= maxX && s.y() >= minY && s.y() <= maxY) result.push_back(s);
+    }
+    return result;
+}
+
+void WarmStart::clear() {
+    m_PlanStates.clear();
+}
@@ -0,0 +1,53 @@
+#ifndef SRC_WARMSTART_H
+#define SRC_WARMSTART_H
+
+#include <memory>
+#include <vector>
+#include <path_planner_common/State.h>
+
+/**
+ * What one planning cycle leaves for the next: the states along its best plan. The executive keeps one of these for
+ * as long as it's planning, and the planner starts each search with the ones that still fall in its window as
+ * samples, so the last plan is there to build on from the first iteration instead of having to be found again by
+ * chance (the previous plan itself only covers up to where it ended).
+ *
+ * Only states are kept, not vertices or edges: everything about an edge (its times, the obstacles' predictions, the
+ * ribbons left) changes from one cycle to the next, so the costs would have to be worked out again anyway. I tried
+ * keeping the rest of the tree's samples too, but they're all bunched up around the old start, which made the first
+ * search wider and slower to finish.
+ */
+class WarmStart {
+public:
+    typedef std::shared_ptr<WarmStart> SharedPtr;
+
+    /**
+     * Replace what's kept with the states along a plan.
+     * @param planStates (may be empty)
+     */
+    void remember(const std::vector<State>& planStates);
+
+    /**
+     * The kept states inside a box, in plan order.
+     * @param minX
+     * @param maxX
+     * @param minY
+     * @param maxY
+     * @return
+     */
+    std::vector<State> samplesWithin(double minX, double maxX, double minY, double maxY) const;
+
+    /**
+     * @return all the kept states, in plan order
+     */
+    const std::vector<State>& planStates() const { return m_PlanStates; }
+
+    bool empty() const { return m_PlanStates.empty(); }
+
+    void clear();
+
+private:
+    std::vector<State> m_PlanStates;
+};
+
+
+#endif //SRC_WARMSTART_H
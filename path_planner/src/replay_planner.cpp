@@ -0,0 +1,80 @@
+#include <iostream>
+#include <string>
+#include "executive/executive.h"
+#include "planner/AStarPlanner.h"
+#include "planner/ParallelAStarPlanner.h"
+#include "planner/PortfolioPlanner.h"
+#include "planner/PlanningRecord.h"
+
+/**
+ * Plans the cycles in a recording (see Executive::setRecording) again, offline. Each cycle's time is counted in work
+ * instead of on the clock (see Budget), so a cycle plans the same way however fast the machine is, and replaying it
+ * again gives the same plan (with one search thread, anyway; more than one still race each other). That's what makes it
+ * useful for chasing down a bad plan from a mission: replay the cycle it came from under a debugger, or with
+ * visualizations on, as many times as it takes.
+ *
+ * Usage: "replay_planner recording [cycle] [work per second]", where cycle picks one cycle to replay (they all are
+ * without it, or with -1) and work per second is what a second of the cycle's time buys (PlannerConfig's default
+ * without it).
+ */
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 4) {
+        std::cerr << "Usage: replay_planner recording [cycle] [work per second]" << std::endl;
+        return 1;
+    }
+    int only = argc > 2 ? std::stoi(argv[2]) : -1;
+    double workPerSecond = argc > 3 ? std::stod(argv[3]) : PlannerConfig(nullptr).workPerSecond();
+
+    std::vector<PlanningRecord> records;
+    try {
+        records = PlanningRecord::load(argv[1], &std::cerr);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << records.size() << " cycles recorded" << std::endl;
+    std::atomic<bool> cancelled(false);
+    std::string mapPath;
+    Map::SharedPtr map = std::make_shared<Map>();
+    // each cycle starts with the warm start it had in the mission
+    auto warmStart = std::make_shared<WarmStart>();
+
+    for (int i = 0; i < (int)records.size(); i++) {
+        if (only >= 0 && i != only) continue;
+        auto& record = records[i];
+        if (record.MapPath != mapPath) {
+            mapPath = record.MapPath;
+            map = mapPath.empty() ? std::make_shared<Map>() :
+                Executive::loadMap(mapPath, record.MapLatitude, record.MapLongitude, cancelled);
+        }
+        auto config = record.Config;
+        config.setMap(map);
+        config.setBudgetMode(Budget::Work);
+        config.setWorkPerSecond(workPerSecond);
+        RibbonManager::setRibbonWidth(record.RibbonWidth);
+        warmStart->remember(record.WarmStart);
+
+        std::unique_ptr<Planner> planner;
+        if (config.portfolioSize() > 1) {
+            planner.reset(new PortfolioPlanner);
+        } else {
+            std::unique_ptr<AStarPlanner> single(config.searchThreads() > 1 ? new ParallelAStarPlanner : new AStarPlanner);
+            single->setWarmStart(warmStart);
+            planner = std::move(single);
+        }
+        double start = Executive::getCurrentTime();
+        auto plan = planner->plan(record.Ribbons, record.Start, config, record.PreviousPlan, record.TimeRemaining);
+
+        std::cout << "Cycle " << i << " from " << record.Start.toString() << ": ";
+        if (plan.empty()) {
+            std::cout << "no plan";
+        } else {
+            State end;
+            end.time() = plan.getEndTime();
+            plan.sample(end);
+            std::cout << plan.get().size() << " segments to " << end.toString();
+        }
+        std::cout << " in " << Executive::getCurrentTime() - start << "s" << std::endl;
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define SRC_TRAJECTORY_PUBLISHER_H
 
 #include "planner/utilities/RibbonManager.h"
+#include "planner/utilities/Instrumentation.h"
 #include <path_planner_common/DubinsPlan.h>
 
 /**
@@ -25,7 +26,7 @@ public:
      * @param trajectory
      * @param plannerTrajectory
      */
-    virtual void displayTrajectory(std::vector<State> trajectory, bool plannerTrajectory) = 0;
+    virtual void displayTrajectory(const std::vector<State>& trajectory, bool plannerTrajectory) = 0;
 
     /**
      * Alert the system that the planner has finished this iteration. This might deserve its own interface.
@@ -43,6 +44,12 @@ public:
      * @param ribbonManager
      */
     virtual void displayRibbons(const RibbonManager& ribbonManager) = 0;
+
+    /**
+     * Publish where the last planning cycle's time went. Only called when instrumentation is compiled in.
+     * @param report
+     */
+    virtual void publishStatistics(const Instrumentation::Report& /*report*/) {}
 };
 
 
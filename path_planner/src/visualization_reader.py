@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+
+# Reads the planner's binary visualization dumps (see Visualizer.h), and converts them to the text format.
+# Usage: "./visualization_reader.py binaryfile [textfile]" (writes to stdout without a text file)
+
+import struct
+import sys
+
+MAGIC = b"PPVB"
+VERSION = 1
+HEADER = struct.Struct("=4sII")
+RECORD = struct.Struct("=dddddffII")
+
+TAGS = ["vertex", "start", "goal", "sample", "trajectory", "plan", "ribbons", "ribbon_start", "ribbon_end",
+        "end_ribbons"]
+
+
+def is_binary(file_name):
+    with open(file_name, "rb") as f:
+        return f.read(len(MAGIC)) == MAGIC
+
+
+def read_records(file_name):
+    """Yields (x, y, heading, speed, time, g, h, tag) for each record, with the tag as its name."""
+    with open(file_name, "rb") as f:
+        magic, version, size = HEADER.unpack(f.read(HEADER.size))
+        if magic != MAGIC:
+            raise ValueError("Not a binary visualization file")
+        if version != VERSION or size != RECORD.size:
+            raise ValueError("Unsupported visualization format version %d (record size %d)" % (version, size))
+        while True:
+            data = f.read(RECORD.size)
+            if len(data) < RECORD.size:
+                break  # the planner may be in the middle of writing the last one
+            x, y, heading, speed, time, g, h, tag, _ = RECORD.unpack(data)
+            yield x, y, heading, speed, time, g, h, TAGS[tag] if tag < len(TAGS) else "unknown"
+
+
+def to_text_lines(file_name):
+    """The same lines the text format would have had."""
+    ribbon_start = None
+    for x, y, heading, speed, time, g, h, tag in read_records(file_name):
+        if tag == "ribbons":
+            yield "Ribbons: "
+        elif tag == "ribbon_start":
+            ribbon_start = (x, y)
+        elif tag == "ribbon_end":
+            length = ((x - ribbon_start[0]) ** 2 + (y - ribbon_start[1]) ** 2) ** 0.5
+            yield "(%g, %g) -> (%g, %g) with length %g" % (ribbon_start[0], ribbon_start[1], x, y, length)
+        elif tag == "end_ribbons":
+            yield ""
+            yield "End Ribbons"
+        else:
+            yield "State: (%f %f %f %f %f), f: %g, g: %g, h: %g %s" % (x, y, heading, speed, time, g + h, g, h, tag)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (2, 3):
+        print('Usage: "./visualization_reader.py binaryfile [textfile]"')
+        exit(0)
+    out = open(sys.argv[2], "w") if len(sys.argv) == 3 else sys.stdout
+    for line in to_text_lines(sys.argv[1]):
+        out.write(line + "\n")
+    if out is not sys.stdout:
+        out.close()
@@ -6,6 +6,7 @@ from pygame.locals import *
 import sys
 import math
 import numpy as np
+import visualization_reader
 
 Color_line = (0, 0, 0)
 Color_line_middle = (180, 180, 180)
@@ -368,8 +369,11 @@ class PLOT:
         return self.obs[n].cost
 
     def reset(self):
-        with open(self.input_file_name, "r") as input_file:
-            input_lines = input_file.readlines()
+        if visualization_reader.is_binary(self.input_file_name):
+            input_lines = list(visualization_reader.to_text_lines(self.input_file_name))
+        else:
+            with open(self.input_file_name, "r") as input_file:
+                input_lines = input_file.readlines()
         self.maxColor = -1000000
         self.minColor = 1000000
         self.index = 0
@@ -0,0 +1,422 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include "../../src/planner/AStarPlanner.h"
+#include "../../src/planner/search/Edge.h"
+#include "../../src/planner/utilities/Instrumentation.h"
+#include "../../src/common/map/GridWorldMap.h"
+
+/**
+ * Benchmarks for the planner's hot spots and for whole plans on the same scenarios as the receding horizon tests,
+ * written out as JSON so results can be compared from one version to the next. The layout follows Google Benchmark's
+ * (a "context" object and a "benchmarks" list with a real_time per iteration in ns, plus extra counters), so the tools
+ * for comparing those work on it too, but it doesn't depend on it.
+ *
+ * Usage: "benchmark_planner [--filter substring] [--min-time seconds] [--out file]". Results go to stdout without a
+ * file, and progress always goes to stderr.
+ *
+ * Each micro benchmark runs once untimed, then batches of doubling size until one takes at least the minimum time.
+ * Whole plans run once per scenario with a work budget (see Budget), so the plan's cost doesn't depend on how fast the
+ * machine is; the wall clock is only used for throughput (expansions and samples per second).
+ */
+
+namespace {
+
+volatile double g_Sink; // so results aren't optimized away
+
+struct Result {
+    std::string Name;
+    long Iterations = 0;
+    double Seconds = 0;
+    std::vector<std::pair<std::string, double>> Counters;
+};
+
+struct Options {
+    std::string Filter;
+    double MinTime = 0.5;
+    std::string Out;
+};
+
+double wallTime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Time an operation, op(i) doing the i'th iteration.
+ */
+template <class F>
+Result measure(const std::string& name, const Options& options, F op) {
+    Result result;
+    result.Name = name;
+    op(0); // anything built on first use (tables, caches) isn't counted
+    for (long batch = 1; ; batch *= 2) {
+        double start = wallTime();
+        for (long i = 0; i < batch; i++) op(i);
+        double seconds = wallTime() - start;
+        if (seconds >= options.MinTime || batch >= (1L << 30)) {
+            result.Iterations = batch;
+            result.Seconds = seconds;
+            return result;
+        }
+    }
+}
+
+std::vector<State> randomStates(size_t count, double minX, double maxX, double minY, double maxY, unsigned seed) {
+    StateGenerator generator(minX, maxX, minY, maxY, 2.5, 2.5, seed);
+    std::vector<State> states;
+    for (size_t i = 0; i < count; i++) states.push_back(generator.generate());
+    return states;
+}
+
+RibbonManager randomRibbons(RibbonManager::Heuristic heuristic, int count, double size, unsigned seed) {
+    RibbonManager ribbonManager(heuristic, 8, 2);
+    for (const auto& s : randomStates(count, -size, size, -size, size, seed)) {
+        // short lines scattered about, like a survey's leftovers
+        auto end = s.push(10 / s.speed());
+        ribbonManager.add(s.x(), s.y(), end.x(), end.y());
+    }
+    return ribbonManager;
+}
+
+DynamicObstaclesManager randomObstacles(int count, unsigned seed) {
+    DynamicObstaclesManager obstacles;
+    int i = 0;
+    for (const auto& s : randomStates(count, -200, 200, -200, 200, seed)) {
+        std::vector<Distribution> distributions;
+        double covariance[2][2] = {{1, 0}, {0, 1}};
+        for (int t = 0; t <= 30; t += 10) {
+            auto p = s.push(t);
+            double mean[2] = {p.x(), p.y()};
+            distributions.emplace_back(mean, covariance, p.heading(), p.time());
+        }
+        obstacles.add(i++, distributions, 5, 20);
+    }
+    return obstacles;
+}
+
+/**
+ * A gridworld with random obstacles, written to a file since that's how they're loaded.
+ */
+Map::SharedPtr randomMap(int size, double density, unsigned seed) {
+    std::string path = "/tmp/benchmark_planner.map";
+    {
+        std::ofstream out(path);
+        std::mt19937 engine(seed);
+        std::uniform_real_distribution<> unit(0, 1);
+        out << "1\n";
+        for (int row = 0; row < size; row++) {
+            for (int col = 0; col < size; col++) out << (unit(engine) < density ? '#' : '.');
+            out << "\n";
+        }
+    }
+    auto map = std::make_shared<GridWorldMap>(path);
+    std::remove(path.c_str());
+    return map;
+}
+
+const char* heuristicName(RibbonManager::Heuristic heuristic) {
+    switch (heuristic) {
+        case RibbonManager::MaxDistance: return "MaxDistance";
+        case RibbonManager::TspPointRobotNoSplitAllRibbons: return "TspPointRobotNoSplitAllRibbons";
+        case RibbonManager::TspPointRobotNoSplitKRibbons: return "TspPointRobotNoSplitKRibbons";
+        case RibbonManager::TspDubinsNoSplitAllRibbons: return "TspDubinsNoSplitAllRibbons";
+        case RibbonManager::TspDubinsNoSplitKRibbons: return "TspDubinsNoSplitKRibbons";
+        case RibbonManager::MstLowerBound: return "MstLowerBound";
+        default: return "Unknown";
+    }
+}
+
+struct Scenario {
+    std::string Name;
+    RibbonManager Ribbons;
+    State Start;
+};
+
+std::vector<Scenario> scenarios() {
+    // the same as RHRSAStarTest1Ribbons, ..., RHRSAStarTest5TspRibbons in test_planner
+    std::vector<Scenario> scenarios;
+    RibbonManager one;
+    one.add(0, 10, 0, 30);
+    scenarios.push_back({"1Ribbon", one, State(0, 0, 0, 2.5, 1)});
+    RibbonManager two;
+    two.add(0, 20, 20, 20);
+    two.add(0, 60, 30, 60);
+    scenarios.push_back({"2Ribbons", two, State(0, 0, 0, 2.5, 1)});
+    RibbonManager four, tsp(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    for (int y = 20; y <= 100; y += 20) {
+        four.add(0, y, 20, y);
+        tsp.add(0, y, 20, y);
+    }
+    scenarios.push_back({"4Ribbons", four, State(0, 0, 0, 2.5, 1)});
+    scenarios.push_back({"TspRibbons", tsp, State(0, 0, 0, 2.5, 1)});
+    return scenarios;
+}
+
+std::string escape(const std::string& s) {
+    std::string escaped;
+    for (auto c : s) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results) {
+    char date[64];
+    auto t = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&t));
+    out << "{\n  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "    \"instrumentation\": " << (Instrumentation::enabled() ? "true" : "false") << "\n";
+    out << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        out << (i ? "," : "") << "\n    {\n";
+        out << "      \"name\": \"" << escape(r.Name) << "\",\n";
+        out << "      \"iterations\": " << r.Iterations << ",\n";
+        out << "      \"real_time\": " << r.Seconds / r.Iterations * 1e9 << ",\n";
+        out << "      \"time_unit\": \"ns\"";
+        for (const auto& c : r.Counters) out << ",\n      \"" << escape(c.first) << "\": " << c.second;
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) options.Filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc) options.MinTime = std::stod(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) options.Out = argv[++i];
+        else {
+            std::cerr << "Usage: benchmark_planner [--filter substring] [--min-time seconds] [--out file]" << std::endl;
+            return 1;
+        }
+    }
+    std::vector<Result> results;
+    auto wanted = [&] (const std::string& name) { return name.find(options.Filter) != std::string::npos; };
+    auto add = [&] (Result result) {
+        std::cerr << result.Name << ": " << result.Seconds / result.Iterations * 1e9 << " ns" << std::endl;
+        results.push_back(std::move(result));
+    };
+
+    // fixed inputs, so runs are comparable
+    const size_t stateCount = 4096;
+    const auto states = randomStates(stateCount, -500, 500, -500, 500, 7);
+    auto map = randomMap(512, 0.05, 11);
+    auto obstacles = randomObstacles(20, 13);
+    PlannerConfig config(&std::cerr);
+    config.setMap(map);
+    config.setObstacles(obstacles);
+    config.setNowFunction(wallTime);
+
+    for (auto model : {RibbonManager::Split, RibbonManager::Bitmap}) {
+        auto suffix = model == RibbonManager::Bitmap ? "/bitmap" : "";
+        for (int ribbons : {10, 1000}) {
+            auto name = "RibbonManager::cover/" + std::to_string(ribbons) + suffix;
+            if (!wanted(name)) continue;
+            auto ribbonManager = randomRibbons(RibbonManager::TspPointRobotNoSplitAllRibbons, ribbons, 500, 3);
+            ribbonManager.setCoverageModel(model);
+            add(measure(name, options, [&] (long i) {
+                const auto& s = states[i % stateCount];
+                ribbonManager.cover(s.x(), s.y());
+            }));
+        }
+        // a survey part way through: parallel lines crossed here and there, so splitting has left lots of pieces
+        auto name = std::string("RibbonManager::approximateDistanceUntilDone/MaxDistance/gaps") + suffix;
+        if (!wanted(name)) continue;
+        RibbonManager ribbonManager(RibbonManager::MaxDistance);
+        ribbonManager.setCoverageModel(model);
+        for (int i = 0; i < 20; i++) ribbonManager.add(-100, i * 10, 100, i * 10);
+        for (const auto& s : randomStates(4000, -100, 100, 0, 190, 19)) ribbonManager.cover(s.x(), s.y());
+        auto queries = randomStates(1 << 16, -100, 100, -100, 100, 17);
+        auto result = measure(name, options, [&] (long i) {
+            const auto& s = queries[i % queries.size()];
+            g_Sink = ribbonManager.approximateDistanceUntilDone(s.x(), s.y(), s.yaw());
+        });
+        result.Counters.emplace_back("ribbons", (double)ribbonManager.get().size());
+        add(result);
+    }
+
+    for (auto heuristic : {RibbonManager::MaxDistance, RibbonManager::TspPointRobotNoSplitAllRibbons,
+                           RibbonManager::TspPointRobotNoSplitKRibbons, RibbonManager::TspDubinsNoSplitAllRibbons,
+                           RibbonManager::TspDubinsNoSplitKRibbons, RibbonManager::MstLowerBound}) {
+        auto name = std::string("RibbonManager::approximateDistanceUntilDone/") + heuristicName(heuristic) + "/4";
+        if (!wanted(name)) continue;
+        auto ribbonManager = randomRibbons(heuristic, 4, 100, 5);
+        // states the heuristic cache hasn't seen, so it's the heuristic itself being timed
+        auto queries = randomStates(1 << 16, -100, 100, -100, 100, 17);
+        add(measure(name, options, [&] (long i) {
+            const auto& s = queries[i % queries.size()];
+            g_Sink = ribbonManager.approximateDistanceUntilDone(s.x(), s.y(), s.yaw());
+        }));
+    }
+    // the spanning tree at survey scale, on vertices that have each just finished a line (so the tree is updated, and a
+    // copy's first query builds its endpoints)
+    for (auto model : {RibbonManager::Split, RibbonManager::Bitmap}) {
+        auto name = std::string("RibbonManager::approximateDistanceUntilDone/MstLowerBound/1000") +
+                (model == RibbonManager::Bitmap ? "/bitmap" : "");
+        if (!wanted(name)) continue;
+        auto ribbonManager = randomRibbons(RibbonManager::MstLowerBound, 1000, 500, 3);
+        ribbonManager.setCoverageModel(model);
+        g_Sink = ribbonManager.approximateDistanceUntilDone(0, 0, 0);
+        auto lines = ribbonManager.get();
+        std::vector<Ribbon> finish(lines.begin(), lines.end());
+        auto queries = randomStates(1 << 16, -500, 500, -500, 500, 17);
+        add(measure(name, options, [&] (long i) {
+            const auto& r = finish[i % finish.size()];
+            auto copy = ribbonManager;
+            copy.coverBetween(r.start().first, r.start().second, r.end().first, r.end().second);
+            const auto& s = queries[i % queries.size()];
+            g_Sink = copy.approximateDistanceUntilDone(s.x(), s.y(), s.yaw());
+        }));
+    }
+
+    if (wanted("Edge::computeTrueCost")) {
+        // edges about as long as the planner's, from a random start to a state a little way off
+        auto ribbonManager = randomRibbons(RibbonManager::TspPointRobotNoSplitAllRibbons, 20, 200, 19);
+        const size_t edgeCount = 256;
+        std::vector<std::pair<Vertex::SharedPtr, State>> edges;
+        auto ends = randomStates(edgeCount, -30, 30, -30, 30, 23);
+        for (size_t i = 0; i < edgeCount; i++) {
+            State start(states[i].x() / 2.5, states[i].y() / 2.5, states[i].heading(), 2.5, 1);
+            State end(start.x() + ends[i].x(), start.y() + ends[i].y(), ends[i].heading(), 2.5, 0);
+            edges.emplace_back(Vertex::makeRoot(start, ribbonManager), end);
+        }
+        // includes making the vertex, since an edge's cost is only worked out once
+        auto single = measure("Edge::computeTrueCost", options, [&] (long i) {
+            const auto& e = edges[i % edgeCount];
+            auto v = Vertex::connect(e.first, e.second);
+            g_Sink = v->parentEdge()->computeTrueCost(config);
+        });
+        single.Counters.emplace_back("edges_per_second", single.Iterations / single.Seconds);
+        add(single);
+        // an expansion's worth at a time (the ends around one start), one edge at a time and then as a batch
+        const size_t batchSize = 9;
+        EdgeBatch batch;
+        std::vector<Vertex::SharedPtr> vertices(batchSize);
+        for (bool batched : {false, true}) {
+            auto result = measure(batched ? "Edge::computeTrueCost/expansion/batched" : "Edge::computeTrueCost/expansion",
+                                  options, [&] (long i) {
+                const auto& root = edges[(i * batchSize) % edgeCount].first;
+                batch.clear();
+                for (size_t j = 0; j < batchSize; j++) {
+                    const auto& end = ends[(i * batchSize + j) % edgeCount];
+                    State s(root->state().x() + end.x(), root->state().y() + end.y(), end.heading(), 2.5, 0);
+                    vertices[j] = Vertex::connect(root, s);
+                    if (batched) vertices[j]->parentEdge()->addToBatch(config, batch);
+                    else g_Sink = vertices[j]->parentEdge()->computeTrueCost(config);
+                }
+                if (!batched) return;
+                batch.evaluate(*config.map(), config.obstacles(), Edge::collisionCheckingIncrement());
+                for (size_t j = 0; j < batchSize; j++) {
+                    g_Sink = vertices[j]->parentEdge()->computeTrueCost(config, batch, j);
+                }
+            });
+            result.Counters.emplace_back("edges_per_second", result.Iterations * batchSize / result.Seconds);
+            add(result);
+        }
+    }
+
+    if (wanted("Map::getUnblockedDistance")) {
+        add(measure("Map::getUnblockedDistance", options, [&] (long i) {
+            const auto& s = states[i % stateCount];
+            g_Sink = map->getUnblockedDistance(s.x() / 2 + 256, s.y() / 2 + 256);
+        }));
+    }
+    if (wanted("Map::getUnblockedDistances")) {
+        // an edge's worth at a time
+        const size_t batch = 64;
+        std::vector<double> xs, ys, distances;
+        for (const auto& s : states) {
+            xs.push_back(s.x() / 2 + 256);
+            ys.push_back(s.y() / 2 + 256);
+        }
+        std::vector<double> batchXs(batch), batchYs(batch);
+        auto result = measure("Map::getUnblockedDistances/64", options, [&] (long i) {
+            auto offset = (i * batch) % (stateCount - batch);
+            std::copy(xs.begin() + offset, xs.begin() + offset + batch, batchXs.begin());
+            std::copy(ys.begin() + offset, ys.begin() + offset + batch, batchYs.begin());
+            map->getUnblockedDistances(batchXs, batchYs, distances);
+            g_Sink = distances[0];
+        });
+        result.Counters.emplace_back("points_per_second", result.Iterations * batch / result.Seconds);
+        add(result);
+    }
+
+    if (wanted("DynamicObstaclesManager::collisionExists")) {
+        add(measure("DynamicObstaclesManager::collisionExists/20", options, [&] (long i) {
+            const auto& s = states[i % stateCount];
+            g_Sink = obstacles.collisionExists(s.x() / 2.5, s.y() / 2.5, 1 + i % 30);
+        }));
+    }
+
+    if (wanted("DubinsWrapper")) {
+        State start(0, 0, 0.3, 2.5, 1), end(60, -40, 2.5, 2.5, 0);
+        DubinsWrapper wrapper(start, end, 8);
+        if (wanted("DubinsWrapper::sample")) {
+            auto duration = wrapper.getEndTime() - wrapper.getStartTime();
+            add(measure("DubinsWrapper::sample", options, [&] (long i) {
+                State s;
+                s.time() = wrapper.getStartTime() + duration * (i % 1000) / 1000;
+                wrapper.sample(s);
+                g_Sink = s.x();
+            }));
+        }
+        if (wanted("DubinsWrapper::sampleMany")) {
+            DubinsWrapper::Samples samples;
+            wrapper.sampleMany(wrapper.getStartTime(), 0.05, wrapper.getEndTime(), samples);
+            auto batch = samples.size();
+            auto result = measure("DubinsWrapper::sampleMany", options, [&] (long) {
+                wrapper.sampleMany(wrapper.getStartTime(), 0.05, wrapper.getEndTime(), samples);
+                g_Sink = samples.Xs.back();
+            });
+            result.Counters.emplace_back("points_per_second", result.Iterations * batch / result.Seconds);
+            add(result);
+        }
+    }
+
+    // whole plans with a work budget, so every version gets the same amount of work to do
+    const double budget = 0.95;
+    for (auto& scenario : scenarios()) {
+        auto name = "AStarPlanner::plan/" + scenario.Name;
+        if (!wanted(name)) continue;
+        auto planConfig = config;
+        planConfig.setMap(std::make_shared<Map>());
+        planConfig.setObstacles(DynamicObstaclesManager());
+        planConfig.setBudgetMode(Budget::Work);
+        AStarPlanner planner;
+        double start = wallTime();
+        auto plan = planner.plan(scenario.Ribbons, scenario.Start, planConfig, DubinsPlan(), budget);
+        Result result;
+        result.Name = name;
+        result.Iterations = 1;
+        result.Seconds = wallTime() - start;
+        double cost = plan.empty() || !planner.bestVertex() ? INFINITY : planner.bestVertex()->f();
+        result.Counters.emplace_back("plan_cost", std::isfinite(cost) ? cost : -1);
+        result.Counters.emplace_back("expansions", planner.expandedCount());
+        result.Counters.emplace_back("samples", planner.sampleCount());
+        result.Counters.emplace_back("work", planner.work());
+        result.Counters.emplace_back("expansions_per_second", planner.expandedCount() / result.Seconds);
+        result.Counters.emplace_back("samples_per_second", planner.sampleCount() / result.Seconds);
+        add(result);
+    }
+
+    if (options.Out.empty()) {
+        writeJson(std::cout, results);
+    } else {
+        std::ofstream out(options.Out);
+        writeJson(out, results);
+    }
+    return 0;
+}
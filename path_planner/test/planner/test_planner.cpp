@@ -6,10 +6,35 @@
 #include "../../src/planner/search/Edge.h"
 #include "../../src/planner/SamplingBasedPlanner.h"
 #include "../../src/planner/AStarPlanner.h"
+#include "../../src/planner/ParallelAStarPlanner.h"
+#include "../../src/planner/PortfolioPlanner.h"
+#include "../../src/planner/utilities/ThreadPool.h"
+#include "../../src/planner/utilities/SampleGrid.h"
+#include "../../src/planner/search/OpenList.h"
+#include "../../src/planner/search/DominanceTable.h"
+#include "../../src/planner/utilities/DubinsTable.h"
+#include "../../src/planner/utilities/RibbonOrdering.h"
+#include "../../src/planner/utilities/MotionPrimitives.h"
+#include "../../src/planner/utilities/EdgeGeometryCache.h"
+#include "../../src/planner/utilities/RibbonSpanningTree.h"
+#include "../../src/planner/utilities/TripleBuffer.h"
+#include "../../src/planner/utilities/SpscRing.h"
+#include "../../src/planner/utilities/MpscRing.h"
+#include "../../src/planner/utilities/Instrumentation.h"
+#include "../../src/planner/PlanningRecord.h"
+#include "../../src/executive/executive.h"
+#include "../../src/executive/Fleet.h"
 #include "../../src/common/map/GeoTiffMap.h"
 #include "../../src/common/map/GridWorldMap.h"
+#include "../../src/common/map/DistanceTransform.h"
+#include "../../src/common/map/DistanceFieldCache.h"
+#include "../../src/common/map/TiledMap.h"
+#include "../../src/common/dynamic_obstacles/DensityKernel.h"
 #include <thread>
+#include <fstream>
+#include <set>
 #include <path_planner_common/Plan.h>
+#include <path_planner_common/PlanDelta.h>
 
 using std::vector;
 using std::pair;
@@ -126,6 +151,74 @@ TEST(UnitTests, PlanTransferTest1) {
     }
 }
 
+TEST(UnitTests, PlanDeltaTest) {
+    StateGenerator generator(-50, 50, -50, 50, 2.5, 2.5, 5);
+    auto makePlan = [&] (State s, int count, DubinsPlan plan) {
+        for (int i = 0; i < count; i++) {
+            auto next = generator.generate();
+            DubinsWrapper wrapper(s, next, 8);
+            plan.append(wrapper);
+            next.time() = wrapper.getEndTime();
+            s = next;
+        }
+        return plan;
+    };
+    auto expectSame = [] (const DubinsPlan& a, const DubinsPlan& b) {
+        ASSERT_EQ(a.get().size(), b.get().size());
+        for (size_t i = 0; i < a.get().size(); i++) {
+            EXPECT_EQ(a.get()[i].unwrap().type, b.get()[i].unwrap().type);
+            EXPECT_EQ(a.get()[i].unwrap().qi[0], b.get()[i].unwrap().qi[0]);
+            EXPECT_EQ(a.get()[i].getStartTime(), b.get()[i].getStartTime());
+            EXPECT_EQ(a.get()[i].getEndTime(), b.get()[i].getEndTime());
+        }
+    };
+    State start(0, 0, 0, 2.5, 1);
+    auto first = makePlan(start, 6, DubinsPlan());
+
+    PlanDeltaEncoder encoder;
+    PlanDeltaDecoder decoder;
+    auto delta = encoder.encode(first);
+    EXPECT_TRUE(delta.full());
+    EXPECT_EQ(6, delta.Segments.size());
+    ASSERT_TRUE(decoder.apply(delta));
+    EXPECT_TRUE(encoder.acknowledge(decoder.version()));
+
+    // the next plan starts partway through the second path and keeps the two after it, then goes somewhere else
+    auto time = first.get()[1].getStartTime() + 1;
+    DubinsPlan kept = first;
+    kept.changeIntoSuffix(time);
+    DubinsPlan prefix;
+    for (int i = 0; i < 3; i++) prefix.append(kept.get()[i]);
+    State end;
+    end.time() = prefix.getEndTime();
+    prefix.sample(end);
+    auto second = makePlan(end, 2, prefix);
+    delta = encoder.encode(second);
+    EXPECT_FALSE(delta.full());
+    EXPECT_EQ(time, delta.KeepFrom);
+    EXPECT_EQ(3, delta.KeepCount);
+    EXPECT_EQ(2, delta.Segments.size());
+    ASSERT_TRUE(decoder.apply(delta));
+    EXPECT_TRUE(encoder.acknowledge(decoder.version()));
+    expectSame(second, decoder.plan());
+
+    // a controller that restarted doesn't have the base, so it all goes again
+    PlanDeltaDecoder restarted;
+    auto third = second;
+    third.changeIntoSuffix(time + 2);
+    delta = encoder.encode(third);
+    EXPECT_FALSE(delta.full());
+    EXPECT_EQ(5, delta.KeepCount);
+    EXPECT_TRUE(delta.Segments.empty());
+    EXPECT_FALSE(restarted.apply(delta));
+    EXPECT_FALSE(encoder.acknowledge(restarted.version()));
+    delta = encoder.encode(third);
+    EXPECT_TRUE(delta.full());
+    ASSERT_TRUE(restarted.apply(delta));
+    EXPECT_TRUE(encoder.acknowledge(restarted.version()));
+    expectSame(third, restarted.plan());
+}
+
 //endregion
 
 TEST(UnitTests, GaussianDensityTest) {
@@ -190,6 +283,181 @@ TEST(UnitTests, DynamicObstacleTest1) {
     EXPECT_NEAR(p1, p, 0.00001);
 }
 
+TEST(UnitTests, DynamicObstaclesSnapshotTest) {
+    DynamicObstaclesManager obstaclesManager;
+    double sigma[2][2] = {{1, 0}, {0, 1}};
+    double mean[2] = {0, 0}, elsewhere[2] = {100, 100};
+    obstaclesManager.update(1, {Distribution(mean, sigma, 0, 2), Distribution(mean, sigma, 0, 3)});
+    obstaclesManager.update(2, {Distribution(elsewhere, sigma, 0, 2), Distribution(elsewhere, sigma, 0, 3)});
+    auto before = obstaclesManager.collisionExists(0.5, 0.5, 2.5);
+    EXPECT_LT(0, before);
+    // a snapshot doesn't see later updates
+    auto snapshot = std::make_shared<const DynamicObstaclesManager>(obstaclesManager);
+    obstaclesManager.update(1, {Distribution(elsewhere, sigma, 0, 2), Distribution(elsewhere, sigma, 0, 3)});
+    EXPECT_DOUBLE_EQ(0, obstaclesManager.collisionExists(0.5, 0.5, 2.5));
+    EXPECT_DOUBLE_EQ(before, snapshot->collisionExists(0.5, 0.5, 2.5));
+    // and copies of a config share it rather than copying it
+    auto config = plannerConfig;
+    config.setObstacles(snapshot);
+    auto copy = config;
+    EXPECT_EQ(snapshot.get(), &copy.obstacles());
+    config.setObstacles(obstaclesManager);
+    EXPECT_NE(&copy.obstacles(), &config.obstacles());
+    EXPECT_DOUBLE_EQ(0, config.obstacles().collisionExists(0.5, 0.5, 2.5));
+}
+
+TEST(UnitTests, DynamicObstacleDistanceToEdgeTest) {
+    double sigma1[2][2] = {{4, 0}, {0, 1}}, sigma2[2][2] = {{9, 2}, {2, 6}};
+    double mean1[2] = {0, 0}, mean2[2] = {60, 30};
+    std::vector<Distribution> distributions;
+    distributions.emplace_back(mean1, sigma1, 1.1, 0);
+    distributions.emplace_back(mean2, sigma2, 1.1, 20);
+    DynamicObstacle obstacle(distributions);
+    EXPECT_DOUBLE_EQ(0, obstacle.distanceToEdge(1, 1, 2.5, 0));
+    EXPECT_GT(obstacle.distanceToEdge(-200, 0, 2.5, 0), 50);
+    srand(5);
+    for (int i = 0; i < 500; i++) {
+        double x = rand() % 400 - 200.0, y = rand() % 400 - 200.0, t = (rand() % 250) / 10.0, speed = 2.5;
+        auto d = obstacle.distanceToEdge(x, y, speed, t);
+        ASSERT_GE(d, 0);
+        // wherever we go within that distance, there's nothing there when we get there
+        for (int j = 0; j < 20; j++) {
+            auto travelled = d * (rand() % 1000) / 1000.0, angle = (rand() % 628) / 100.0;
+            EXPECT_DOUBLE_EQ(0, obstacle.collisionDensityAt(x + travelled * cos(angle), y + travelled * sin(angle),
+                                                            t + travelled / speed));
+        }
+    }
+}
+
+// collisionDensityAt the long way round, with a Distribution
+double referenceCollisionDensity(const std::vector<Distribution>& distributions, double length, double width,
+                                 double x, double y, double time) {
+    unsigned long lower = 0;
+    while (lower + 2 < distributions.size() && distributions[lower + 1].time() <= time) lower++;
+    auto interpolated = distributions[lower].interpolate(distributions[lower + 1], time);
+    auto dx = x - interpolated.mean()[0], dy = y - interpolated.mean()[1];
+    auto d = sqrt(dx * dx + dy * dy);
+    double a, b, c;
+    interpolated.covariance(a, b, c);
+    auto reach = 2 * sqrt((a + c) / 2 + sqrt((a - c) * (a - c) / 4 + b * b)) + sqrt(length * length + width * width) / 2;
+    if (d > reach) return 0;
+    auto beta = atan2(dy, dx);
+    auto alpha = beta + interpolated.heading();
+    if (d * sin(alpha) < length / 2 && d * cos(alpha) < width / 2) return interpolated.density(interpolated.mean());
+    auto dInner = length / (2 * sin(alpha));
+    return interpolated.density(x - dInner * cos(beta), y - dInner * sin(beta));
+}
+
+TEST(UnitTests, DynamicObstacleCompiledDensityTest) {
+    double sigma1[2][2] = {{4, 1}, {1, 2}}, sigma2[2][2] = {{9, -2}, {-2, 6}}, sigma3[2][2] = {{3, 0}, {0, 3}};
+    double mean1[2] = {0, 0}, mean2[2] = {30, 15}, mean3[2] = {35, 40};
+    std::vector<Distribution> distributions;
+    distributions.emplace_back(mean1, sigma1, 0.2, 0);
+    distributions.emplace_back(mean2, sigma2, 0.9, 10);
+    distributions.emplace_back(mean3, sigma3, 1.6, 20);
+    DynamicObstacle obstacle(distributions, 6, 3);
+    srand(9);
+    int nonZero = 0;
+    for (int i = 0; i < 5000; i++) {
+        auto t = (rand() % 200) / 10.0; // extrapolating much further would make the covariance singular
+        auto segment = t < 10 ? 0 : 1;
+        auto centre = distributions[segment].interpolate(distributions[segment + 1], t);
+        auto x = centre.mean()[0] + (rand() % 200) / 10.0 - 10, y = centre.mean()[1] + (rand() % 200) / 10.0 - 10;
+        auto expected = referenceCollisionDensity(distributions, 6, 3, x, y, t);
+        if (expected > 0) nonZero++;
+        EXPECT_NEAR(expected, obstacle.collisionDensityAt(x, y, t), 1e-12);
+    }
+    EXPECT_GT(nonZero, 1000);
+}
+
+TEST(UnitTests, DynamicObstaclesIndexTest) {
+    DynamicObstaclesManager obstaclesManager;
+    std::vector<DynamicObstacle> obstacles;
+    srand(11);
+    for (uint32_t mmsi = 0; mmsi < 30; mmsi++) {
+        double sigma[2][2] = {{4, 1}, {1, 9}};
+        double mean1[2] = {rand() % 2000 - 1000.0, rand() % 2000 - 1000.0};
+        double mean2[2] = {mean1[0] + rand() % 100 - 50, mean1[1] + rand() % 100 - 50};
+        std::vector<Distribution> distributions;
+        distributions.emplace_back(mean1, sigma, 0.3, 0);
+        distributions.emplace_back(mean2, sigma, 0.7, 20);
+        obstaclesManager.update(mmsi, distributions);
+        obstacles.emplace_back(distributions);
+    }
+    auto copy = obstaclesManager;
+    int nonZero = 0;
+    for (int i = 0; i < 2000; i++) {
+        double x = rand() % 2000 - 1000.0, y = rand() % 2000 - 1000.0, t = (rand() % 300) / 10.0;
+        if (i % 2) {
+            // somewhere near an obstacle
+            double box[4];
+            obstacles[i % obstacles.size()].bounds(t, t, box);
+            x = (box[0] + box[2]) / 2 + (rand() % 100) / 10.0 - 5;
+            y = (box[1] + box[3]) / 2 + (rand() % 100) / 10.0 - 5;
+        }
+        double expected = 0;
+        for (const auto& o : obstacles) expected += o.collisionDensityAt(x, y, t);
+        if (expected > 0) nonZero++;
+        EXPECT_NEAR(expected, copy.collisionExists(x, y, t), 1e-12);
+    }
+    EXPECT_GT(nonZero, 100);
+    // away from everything we're told how far we can go before looking again
+    obstaclesManager.forget(0);
+    EXPECT_GT(obstaclesManager.distanceToNearestPossibleCollision(5050, 5050, 2, 1), 10);
+}
+
+TEST(UnitTests, DensityKernelTest) {
+    for (double x = -2; x <= 0; x += 1.0 / 1024) {
+        EXPECT_NEAR(exp(x), DensityKernel::exp(x), exp(x) * DensityKernel::ExpRelativeError);
+    }
+    // odd size to exercise the leftover lanes
+    const size_t n = 1001;
+    vector<double> dx(n), dy(n), a(n), b(n), c(n), expected(n), actual(n);
+    srand(13);
+    for (size_t i = 0; i < n; i++) {
+        dx[i] = (rand() % 200) / 20.0 - 5;
+        dy[i] = (rand() % 200) / 20.0 - 5;
+        a[i] = 1 + (rand() % 100) / 10.0;
+        c[i] = 1 + (rand() % 100) / 10.0;
+        b[i] = ((rand() % 100) / 100.0 - 0.5) * sqrt(a[i] * c[i]);
+    }
+    DensityKernel::evaluateReference(dx.data(), dy.data(), a.data(), b.data(), c.data(), expected.data(), n);
+    DensityKernel::evaluate(dx.data(), dy.data(), a.data(), b.data(), c.data(), actual.data(), n);
+    int nonZero = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (expected[i] > 0) nonZero++;
+        EXPECT_NEAR(expected[i], actual[i], 1e-12);
+    }
+    EXPECT_GT(nonZero, 100);
+
+    // a batch through the manager should match asking point by point
+    DynamicObstaclesManager obstaclesManager;
+    for (uint32_t mmsi = 0; mmsi < 12; mmsi++) {
+        double sigma1[2][2] = {{4, 1}, {1, 9}}, sigma2[2][2] = {{8, -1}, {-1, 12}};
+        double mean1[2] = {rand() % 200 - 100.0, rand() % 200 - 100.0};
+        double mean2[2] = {mean1[0] + rand() % 60 - 30, mean1[1] + rand() % 60 - 30};
+        std::vector<Distribution> distributions;
+        distributions.emplace_back(mean1, sigma1, 0.3, 0);
+        distributions.emplace_back(mean2, sigma2, 1.1, 20);
+        obstaclesManager.add(mmsi, distributions, 3, 6);
+    }
+    vector<double> xs, ys, times, densities;
+    for (int i = 0; i < 3000; i++) {
+        xs.push_back(rand() % 2000 / 10.0 - 100);
+        ys.push_back(rand() % 2000 / 10.0 - 100);
+        times.push_back(rand() % 200 / 10.0);
+    }
+    obstaclesManager.collisionExists(xs, ys, times, densities);
+    ASSERT_EQ(densities.size(), xs.size());
+    nonZero = 0;
+    for (size_t i = 0; i < xs.size(); i++) {
+        auto e = obstaclesManager.collisionExists(xs[i], ys[i], times[i]);
+        if (e > 0) nonZero++;
+        EXPECT_NEAR(e, densities[i], 1e-12);
+    }
+    EXPECT_GT(nonZero, 100);
+}
+
 TEST(UnitTests, DISABLED_GeoTiffMapTest1) {
     GeoTiffMap map("/home/abrown/Downloads/depth_map/US5NH02M.tiff", -70.71054174878898, 43.073397415457535);
 }
@@ -208,6 +476,286 @@ TEST(UnitTests, GridWorldMapTest1) {
     EXPECT_DOUBLE_EQ(10, map.getUnblockedDistance(495, 450));
 }
 
+TEST(UnitTests, DistanceFieldTest) {
+    DistanceField<float> floats(3, 2);
+    EXPECT_DOUBLE_EQ(DBL_MAX, floats.get(2, 1));
+    floats.set(2, 1, 0.1);
+    EXPECT_LE(floats.get(2, 1), 0.1);
+    EXPECT_NEAR(0.1, floats.get(2, 1), 1e-6);
+    EXPECT_DOUBLE_EQ(floats.get(2, 1), floats.lookup(2.9, 1.9));
+    EXPECT_DOUBLE_EQ(DBL_MAX, floats.lookup(-0.5, 0));
+    EXPECT_DOUBLE_EQ(-1, floats.lookup(-1, 0));
+    EXPECT_DOUBLE_EQ(-1, floats.lookup(3, 0));
+    EXPECT_DOUBLE_EQ(-1, floats.lookup(0, NAN));
+    EXPECT_EQ(6 * sizeof(float), floats.bytes());
+
+    DistanceField<uint16_t> quantized(2, 2);
+    EXPECT_DOUBLE_EQ(DBL_MAX, quantized.get(0, 0));
+    quantized.set(0, 0, -1);
+    quantized.set(1, 0, 12.34);
+    quantized.set(0, 1, 1e9);
+    EXPECT_NEAR(-1, quantized.get(0, 0), 1e-9);
+    EXPECT_LE(quantized.get(1, 0), 12.34);
+    EXPECT_NEAR(12.34, quantized.get(1, 0), 0.1);
+    EXPECT_GT(quantized.get(0, 1), 6000);
+    EXPECT_LT(quantized.get(0, 1), DBL_MAX);
+}
+
+TEST(UnitTests, GridWorldMapDistancesTest) {
+    auto path = "grid_world_map_distances_test.map";
+    {
+        std::ofstream out(path);
+        out << "1\n....\n.#..\n....\n";
+    }
+    GridWorldMap map(path);
+    std::remove(path);
+    // rows go bottom up so the obstacle is at (1, 1)
+    EXPECT_DOUBLE_EQ(-1, map.getUnblockedDistance(1.5, 1.5));
+    EXPECT_DOUBLE_EQ(0, map.getUnblockedDistance(1.5, 0.5));
+    EXPECT_NEAR(sqrt(2) - 1, map.getUnblockedDistance(0, 0), 1e-6);
+    EXPECT_NEAR(sqrt(2) - 1, map.getUnblockedDistance(-0.5, 2.5), 1e-6);
+    EXPECT_DOUBLE_EQ(1, map.getUnblockedDistance(3.5, 1.5));
+    EXPECT_DOUBLE_EQ(-1, map.getUnblockedDistance(4, 0));
+    EXPECT_DOUBLE_EQ(-1, map.getUnblockedDistance(0, -1));
+
+    std::vector<double> xs{1.5, 0, -0.5, 3.5, 4, 0}, ys{1.5, 0, 2.5, 1.5, 0, -1}, distances;
+    map.getUnblockedDistances(xs, ys, distances);
+    ASSERT_EQ(xs.size(), distances.size());
+    for (size_t i = 0; i < xs.size(); i++) EXPECT_DOUBLE_EQ(map.getUnblockedDistance(xs[i], ys[i]), distances[i]);
+}
+
+TEST(UnitTests, DubinsSampleManyTest) {
+    State start(0, 0, 0.3, 2, 1), end(40, -25, 2.5, 2, 0);
+    DubinsWrapper wrapper(start, end, 8);
+    DubinsWrapper::Samples samples;
+    auto dt = 0.1;
+    wrapper.sampleMany(1, dt, wrapper.getEndTime(), samples);
+    ASSERT_GT(samples.size(), 100);
+    State s(start);
+    for (size_t i = 0; i < samples.size(); i++) {
+        EXPECT_DOUBLE_EQ(s.time(), samples.Times[i]);
+        wrapper.sample(s);
+        EXPECT_NEAR(s.x(), samples.Xs[i], 1e-9);
+        EXPECT_NEAR(s.y(), samples.Ys[i], 1e-9);
+        EXPECT_NEAR(s.yaw(), samples.Yaws[i], 1e-9);
+        s.time() += dt;
+    }
+    EXPECT_GE(s.time(), wrapper.getEndTime());
+    EXPECT_THROW(wrapper.sampleMany(0.5, dt, 2, samples), std::runtime_error);
+}
+
+TEST(UnitTests, DubinsEvaluateTest) {
+    // every path type against the dubins library itself
+    double q0[3] = {1, -2, 0.3}, q1[3] = {6, 3, 2.5};
+    int types = 0;
+    for (int type = LSL; type <= LRL; type++) {
+        DubinsPath path;
+        if (dubins_path(&path, q0, q1, 4, (DubinsPathType)type) != EDUBOK) continue;
+        types++;
+        std::vector<double> distances, xs(200), ys(200), yaws(200);
+        for (int i = 0; i < 200; i++) distances.push_back(dubins_path_length(&path) * i / 199);
+        DubinsWrapper::evaluate(path, distances.data(), distances.size(), xs.data(), ys.data(), yaws.data());
+        for (int i = 0; i < 200; i++) {
+            double q[3];
+            // the library won't sample right at the end
+            ASSERT_EQ(EDUBOK, dubins_path_sample(&path, fmin(distances[i], dubins_path_length(&path) - 1e-9), q));
+            EXPECT_NEAR(q[0], xs[i], 1e-6);
+            EXPECT_NEAR(q[1], ys[i], 1e-6);
+            EXPECT_NEAR(q[2], yaws[i], 1e-6);
+        }
+    }
+    EXPECT_GE(types, 5);
+}
+
+TEST(UnitTests, DubinsPlanSamplingTest) {
+    StateGenerator generator(-50, 50, -50, 50, 2.5, 2.5, 11);
+    DubinsPlan plan;
+    auto s = generator.generate();
+    s.time() = 1;
+    for (int i = 0; i < 6; i++) {
+        auto next = generator.generate();
+        DubinsWrapper wrapper(s, next, 8);
+        plan.append(wrapper);
+        next.time() = wrapper.getEndTime();
+        s = next;
+    }
+    EXPECT_FALSE(plan.containsTime(0.5));
+    EXPECT_FALSE(plan.containsTime(plan.getEndTime() + 0.1));
+    EXPECT_THROW({ State out; out.time() = 0.5; plan.sample(out); }, std::runtime_error);
+    // same states as asking each path in turn
+    for (double t = plan.getStartTime(); t <= plan.getEndTime(); t += 0.37) {
+        State out, expected;
+        out.time() = expected.time() = t;
+        plan.sample(out);
+        for (const auto& p : plan.get()) if (p.containsTime(t)) { p.sample(expected); break; }
+        EXPECT_DOUBLE_EQ(expected.x(), out.x());
+        EXPECT_DOUBLE_EQ(expected.y(), out.y());
+    }
+    auto samples = plan.sampleUniform(0.5);
+    ASSERT_GT(samples.size(), 10);
+    for (size_t i = 0; i < samples.size(); i++) {
+        EXPECT_NEAR(plan.getStartTime() + 0.5 * i, samples[i].time(), 1e-9);
+        State expected(samples[i]);
+        plan.sample(expected);
+        EXPECT_NEAR(expected.x(), samples[i].x(), 1e-6);
+        EXPECT_NEAR(expected.y(), samples[i].y(), 1e-6);
+        EXPECT_NEAR(expected.yaw(), samples[i].yaw(), 1e-6);
+    }
+    EXPECT_LT(samples.back().time(), plan.getEndTime());
+    // into a buffer, which gets reused rather than grown again
+    std::vector<State> buffer(3);
+    plan.sampleUniform(0.5, buffer);
+    ASSERT_EQ(samples.size(), buffer.size());
+    for (size_t i = 0; i < samples.size(); i++) EXPECT_DOUBLE_EQ(samples[i].x(), buffer[i].x());
+    auto data = buffer.data();
+    plan.sampleUniform(0.5, buffer);
+    EXPECT_EQ(data, buffer.data());
+
+    // partway through the third path
+    auto time = (plan.get()[2].getStartTime() + plan.get()[2].getEndTime()) / 2;
+    State before;
+    before.time() = time + 1;
+    plan.sample(before);
+    auto suffix = plan;
+    suffix.changeIntoSuffix(time);
+    ASSERT_EQ(4, suffix.get().size());
+    EXPECT_DOUBLE_EQ(time, suffix.getStartTime());
+    EXPECT_DOUBLE_EQ(plan.getEndTime(), suffix.getEndTime());
+    EXPECT_FALSE(suffix.containsTime(time - 0.1));
+    State after;
+    after.time() = time + 1;
+    suffix.sample(after);
+    EXPECT_DOUBLE_EQ(before.x(), after.x());
+    EXPECT_DOUBLE_EQ(before.y(), after.y());
+    // once it's all done there's nothing left
+    suffix.changeIntoSuffix(plan.getEndTime());
+    EXPECT_TRUE(suffix.empty());
+}
+
+TEST(UnitTests, DistanceFieldCacheTest) {
+    std::string source = "distance_field_cache_test.tif";
+    {
+        std::ofstream out(source);
+        out << "not really a GeoTiff";
+    }
+    std::vector<bool> blocked(12 * 10);
+    blocked[37] = true;
+    auto field = DistanceTransform::compute(blocked, 12, 10, 1, 1);
+    DistanceFieldCache::Metadata metadata;
+    metadata.Longitude = -70.5, metadata.Latitude = 43.1, metadata.XOrigin = 12, metadata.YOrigin = 34;
+    metadata.InverseGeoTransform[1] = 0.5;
+    ASSERT_TRUE(DistanceFieldCache::save(source, metadata, field));
+
+    DistanceFieldCache::Metadata loadedMetadata;
+    loadedMetadata.Longitude = -70.5, loadedMetadata.Latitude = 43.1;
+    MapDistanceField loaded;
+    ASSERT_TRUE(DistanceFieldCache::load(source, loadedMetadata, loaded));
+    EXPECT_EQ(12, loaded.cols());
+    EXPECT_EQ(10, loaded.rows());
+    EXPECT_DOUBLE_EQ(34, loadedMetadata.YOrigin);
+    EXPECT_DOUBLE_EQ(0.5, loadedMetadata.InverseGeoTransform[1]);
+    for (int y = 0; y < 10; y++) {
+        for (int x = 0; x < 12; x++) EXPECT_DOUBLE_EQ(field.get(x, y), loaded.get(x, y));
+    }
+
+    // different origin
+    DistanceFieldCache::Metadata otherOrigin;
+    otherOrigin.Longitude = -70.6, otherOrigin.Latitude = 43.1;
+    EXPECT_FALSE(DistanceFieldCache::load(source, otherOrigin, loaded));
+    // changed source
+    {
+        std::ofstream out(source, std::ios::app);
+        out << "!";
+    }
+    EXPECT_FALSE(DistanceFieldCache::load(source, loadedMetadata, loaded));
+    // the mapping outlives the file
+    EXPECT_DOUBLE_EQ(field.get(3, 4), loaded.get(3, 4));
+
+    std::remove(source.c_str());
+    std::remove(DistanceFieldCache::cachePath(source).c_str());
+}
+
+class TestTiledMap : public TiledMap {
+public:
+    TestTiledMap(const std::vector<bool>& blocked, int cols, int rows)
+        : TiledMap(cols, rows, 1, 1, 16, 8, 4), m_Blocked(blocked), m_FullCols(cols) {}
+    mutable int Reads = 0;
+
+protected:
+    void toCell(double x, double y, double& col, double& row) const override { col = x; row = y; }
+    void readBlocked(int col, int row, int cols, int rows, std::vector<bool>& blocked) const override {
+        Reads++;
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < cols; c++) {
+                blocked[(size_t)r * cols + c] = m_Blocked[(size_t)(row + r) * m_FullCols + col + c];
+            }
+        }
+    }
+
+private:
+    std::vector<bool> m_Blocked;
+    int m_FullCols;
+};
+
+TEST(UnitTests, TiledMapTest) {
+    int cols = 70, rows = 50;
+    std::vector<bool> blocked((size_t)cols * rows);
+    srand(3);
+    for (int i = 0; i < 15; i++) blocked[(size_t)(rand() % rows) * cols + rand() % cols] = true;
+    auto whole = DistanceTransform::compute(blocked, cols, rows, 1, 1);
+    TestTiledMap map(blocked, cols, rows);
+    EXPECT_DOUBLE_EQ(8, map.saturationDistance());
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            EXPECT_NEAR(fmin(whole.get(x, y), 8), map.getUnblockedDistance(x + 0.5, y + 0.5), 1e-4);
+        }
+    }
+    EXPECT_EQ(4, map.tilesLoaded());
+    EXPECT_DOUBLE_EQ(-1, map.getUnblockedDistance(-1, 3));
+    EXPECT_DOUBLE_EQ(-1, map.getUnblockedDistance(3, 50));
+    std::vector<double> xs, ys, distances;
+    for (int i = -3; i < 80; i++) xs.push_back(i * 0.9), ys.push_back(i * 0.6);
+    map.getUnblockedDistances(xs, ys, distances);
+    for (size_t i = 0; i < xs.size(); i++) EXPECT_DOUBLE_EQ(map.getUnblockedDistance(xs[i], ys[i]), distances[i]);
+
+    TestTiledMap prefetched(blocked, cols, rows);
+    prefetched.prefetch(20, 20, 5);
+    EXPECT_EQ(4, prefetched.tilesLoaded());
+    auto reads = prefetched.Reads;
+    prefetched.getUnblockedDistance(17, 18);
+    EXPECT_EQ(reads, prefetched.Reads);
+}
+
+TEST(UnitTests, DistanceTransformTest) {
+    int cols = 300, rows = 250;
+    double xScale = 2, yScale = 3;
+    std::vector<bool> blocked((size_t)cols * rows);
+    std::vector<std::pair<int, int>> obstacles;
+    srand(7);
+    for (int i = 0; i < 40; i++) {
+        int x = rand() % cols, y = rand() % rows;
+        blocked[(size_t)y * cols + x] = true;
+        obstacles.emplace_back(x, y);
+    }
+    auto field = DistanceTransform::compute(blocked, cols, rows, xScale, yScale, 4);
+    for (int y = 0; y < rows; y += 7) {
+        for (int x = 0; x < cols; x += 5) {
+            if (blocked[(size_t)y * cols + x]) {
+                EXPECT_DOUBLE_EQ(-1, field.get(x, y));
+                continue;
+            }
+            auto best = DBL_MAX;
+            for (const auto& o : obstacles) {
+                best = fmin(best, sqrt((o.first - x) * xScale * (o.first - x) * xScale +
+                                       (o.second - y) * yScale * (o.second - y) * yScale));
+            }
+            EXPECT_NEAR(fmax(0, best - xScale), field.get(x, y), 1e-4);
+        }
+    }
+    auto empty = DistanceTransform::compute(std::vector<bool>(100), 10, 10, 1, 1);
+    EXPECT_DOUBLE_EQ(DBL_MAX, empty.get(3, 4));
+}
+
 void visualizePath(const State& s1, const State& s2, const State& s3, double turningRadius) {
     RibbonManager ribbonManager;
     ribbonManager.add(0, 0, 1000, 0);
@@ -447,6 +995,66 @@ TEST(UnitTests, RibbonTest7) {
     EXPECT_DOUBLE_EQ(ribbonManager.approximateDistanceUntilDone(100, 120, 0), 2020 + sqrt(2)*100);
 }
 
+TEST(UnitTests, RibbonManagerHeldKarpTest) {
+    // with K larger than the number of ribbons the K ribbons heuristic is the old brute force search
+    std::default_random_engine engine(5);
+    std::uniform_real_distribution<double> coordinate(-200, 200);
+    for (int trial = 0; trial < 5; trial++) {
+        RibbonManager heldKarp(RibbonManager::TspPointRobotNoSplitAllRibbons);
+        RibbonManager bruteForce(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 10);
+        for (int i = 0; i < 5; i++) {
+            auto x1 = coordinate(engine), y1 = coordinate(engine), x2 = coordinate(engine), y2 = coordinate(engine);
+            heldKarp.add(x1, y1, x2, y2);
+            bruteForce.add(x1, y1, x2, y2);
+        }
+        for (int i = 0; i < 5; i++) {
+            auto x = coordinate(engine), y = coordinate(engine);
+            EXPECT_NEAR(heldKarp.approximateDistanceUntilDone(x, y, 0),
+                        bruteForce.approximateDistanceUntilDone(x, y, 0), 1e-6);
+        }
+        // the copy shares the table until it covers something
+        auto copy = heldKarp;
+        copy.cover(heldKarp.get().front().start().first, heldKarp.get().front().start().second);
+        bruteForce.cover(heldKarp.get().front().start().first, heldKarp.get().front().start().second);
+        EXPECT_NEAR(copy.approximateDistanceUntilDone(0, 0, 0), bruteForce.approximateDistanceUntilDone(0, 0, 0), 1e-6);
+    }
+    RibbonManager twelve(RibbonManager::TspDubinsNoSplitAllRibbons, 8);
+    for (int i = 0; i < 12; i++) twelve.add(0, i * 20, 200, i * 20);
+    twelve.changeHeuristicIfTooManyRibbons();
+    EXPECT_GE(twelve.approximateDistanceUntilDone(-50, 0, 0), 12 * 200 + 11 * 20);
+}
+
+TEST(UnitTests, HeuristicCacheTest) {
+    HeuristicCache cache;
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitAllRibbons);
+    ribbonManager.add(0, 0, 100, 0);
+    ribbonManager.add(0, 20, 100, 20);
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(ribbonManager, -10.05, 0, 0), 230.05);
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(ribbonManager, -10.05, 0, 0), 230.05);
+    // nearby pose gets a slightly smaller (still admissible) value
+    auto h = cache.approximateDistanceUntilDone(ribbonManager, -10.02, 0, 1);
+    EXPECT_LE(h, ribbonManager.approximateDistanceUntilDone(-10.02, 0, 1));
+    EXPECT_NEAR(h, 230.02, 1e-9);
+    EXPECT_EQ(cache.hits(), 2);
+    // copies share a version until they change
+    auto copy = ribbonManager;
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(copy, -10.05, 0, 0), 230.05);
+    EXPECT_EQ(cache.hits(), 3);
+    copy.cover(1, 0);
+    EXPECT_NE(copy.version(), ribbonManager.version());
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(copy, -10.05, 0, 0),
+                     copy.approximateDistanceUntilDone(-10.05, 0, 0));
+    EXPECT_EQ(cache.hits(), 3);
+    EXPECT_EQ(cache.lookups(), 5);
+    // Dubins heuristics only hit on exactly the same pose
+    RibbonManager dubins(RibbonManager::TspDubinsNoSplitAllRibbons, 8);
+    dubins.add(0, 0, 100, 0);
+    cache.approximateDistanceUntilDone(dubins, -10.05, 0, 0.005);
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(dubins, -10.05, 0, 0.006),
+                     dubins.approximateDistanceUntilDone(-10.05, 0, 0.006));
+    EXPECT_EQ(cache.hits(), 3);
+}
+
 TEST(UnitTests, RibbonManagerGetNearestEndpointTest) {
     RibbonManager ribbonManager;
     ribbonManager.add(10, 10, 20, 10);
@@ -488,6 +1096,346 @@ TEST(UnitTests, RibbonManagerCoverBetweenTest) {
     ribbonManager.coverBetween(134.778, 62.1946, 133.708, 61.8953);
 }
 
+TEST(UnitTests, RibbonManagerSpatialIndexTest) {
+    // enough ribbons to turn the index on, checked against brute force and against one manager per ribbon
+    std::default_random_engine engine(3);
+    std::uniform_real_distribution<double> coordinate(-500, 500), length(5, 100), angle(-M_PI, M_PI);
+    RibbonManager ribbonManager;
+    vector<RibbonManager> separate;
+    for (int i = 0; i < 100; i++) {
+        auto x = coordinate(engine), y = coordinate(engine), l = length(engine), h = angle(engine);
+        ribbonManager.add(x, y, x + l * cos(h), y + l * sin(h));
+        separate.emplace_back();
+        separate.back().add(x, y, x + l * cos(h), y + l * sin(h));
+    }
+    auto bruteForceMinDistance = [] (const RibbonManager& manager, double x, double y) {
+        auto min = DBL_MAX;
+        for (const auto& r : manager.get()) {
+            if (r.contains(x, y, r.getProjection(x, y))) return 0.0;
+            min = fmin(min, fmin(State(x, y, 0, 0, 0).distanceTo(r.start().first, r.start().second),
+                                 State(x, y, 0, 0, 0).distanceTo(r.end().first, r.end().second)));
+        }
+        return min;
+    };
+    for (int i = 0; i < 200; i++) {
+        auto x = coordinate(engine), y = coordinate(engine);
+        EXPECT_DOUBLE_EQ(ribbonManager.minDistanceFrom(x, y), bruteForceMinDistance(ribbonManager, x, y));
+        ribbonManager.cover(x, y);
+        for (auto& m : separate) m.cover(x, y);
+    }
+    // a copy should behave the same as the original
+    auto copy = ribbonManager;
+    for (int i = 0; i < 200; i++) {
+        auto x = coordinate(engine) / 10, y = coordinate(engine) / 10;
+        copy.coverBetween(x, y, x + 50, y);
+        for (auto& m : separate) m.coverBetween(x, y, x + 50, y);
+        EXPECT_DOUBLE_EQ(copy.minDistanceFrom(x, y), bruteForceMinDistance(copy, x, y));
+    }
+    double total = 0, separateTotal = 0;
+    for (const auto& r : copy.get()) total += r.length();
+    for (const auto& m : separate) for (const auto& r : m.get()) separateTotal += r.length();
+    EXPECT_NEAR(total, separateTotal, 1e-6);
+    auto s = copy.getNearestEndpointAsState(State(0, 0, 0, 0, 0));
+    auto min = DBL_MAX;
+    for (const auto& r : copy.get()) {
+        min = fmin(min, fmin(State(0, 0, 0, 0, 0).distanceTo(r.start().first, r.start().second),
+                             State(0, 0, 0, 0, 0).distanceTo(r.end().first, r.end().second)));
+    }
+    if (min >= Ribbon::minLength()) EXPECT_DOUBLE_EQ(s.distanceTo(0, 0), min);
+}
+
+TEST(UnitTests, RibbonManagerCopyOnWriteTest) {
+    RibbonManager ribbonManager;
+    for (int i = 0; i < 50; i++) ribbonManager.add(0, i * 10, 100, i * 10);
+    auto copy1 = ribbonManager;
+    auto copy2 = copy1;
+    copy1.coverBetween(0, 0, 50, 0);
+    copy2.coverBetween(50, 100, 100, 100);
+    auto totalLength = [] (const RibbonManager& manager) {
+        double total = 0;
+        for (const auto& r : manager.get()) total += r.length();
+        return total;
+    };
+    EXPECT_DOUBLE_EQ(totalLength(ribbonManager), 5000);
+    EXPECT_NEAR(totalLength(copy1), 4950, 2 * Ribbon::RibbonWidth);
+    EXPECT_NEAR(totalLength(copy2), 4950, 2 * Ribbon::RibbonWidth);
+    EXPECT_DOUBLE_EQ(ribbonManager.minDistanceFrom(25, 0), 0);
+    EXPECT_GT(copy1.minDistanceFrom(25, 0), 0);
+    EXPECT_DOUBLE_EQ(copy1.minDistanceFrom(75, 100), 0);
+    EXPECT_GT(copy2.minDistanceFrom(75, 100), 0);
+}
+
+TEST(UnitTests, RibbonManagerBitmapCoverageTest) {
+    auto totalLength = [] (const RibbonManager& manager) {
+        double total = 0;
+        for (const auto& r : manager.get()) total += r.length();
+        return total;
+    };
+    RibbonManager ribbonManager;
+    ribbonManager.setCoverageModel(RibbonManager::Bitmap);
+    ribbonManager.add(0, 0, 100, 0);
+    EXPECT_DOUBLE_EQ(totalLength(ribbonManager), 100);
+    // crossing the line covers a ribbon width either side of where it crossed, and leaves the rest
+    auto version = ribbonManager.version();
+    ribbonManager.cover(50, 0.5);
+    EXPECT_NE(ribbonManager.version(), version);
+    EXPECT_EQ(ribbonManager.get().size(), 2);
+    EXPECT_NEAR(totalLength(ribbonManager), 100 - 2 * Ribbon::RibbonWidth, Ribbon::RibbonWidth / 2);
+    EXPECT_GT(ribbonManager.minDistanceFrom(50, 0), 0);
+    EXPECT_DOUBLE_EQ(ribbonManager.minDistanceFrom(25, 0), 0);
+    // covering it again changes nothing, and nor does covering somewhere off the line
+    version = ribbonManager.version();
+    ribbonManager.cover(50, 0);
+    ribbonManager.cover(50, 10);
+    EXPECT_EQ(ribbonManager.version(), version);
+    // copies don't see each other's coverage
+    auto copy = ribbonManager;
+    copy.coverBetween(0, 0, 100, 0);
+    EXPECT_TRUE(copy.done());
+    EXPECT_FALSE(ribbonManager.done());
+    EXPECT_EQ(ribbonManager.get().size(), 2);
+
+    // lots of lines crossed lots of times: the bitmap never leaves more than splitting does, and the index agrees with
+    // brute force
+    std::default_random_engine engine(5);
+    std::uniform_real_distribution<double> x(-100, 100), y(0, 390);
+    RibbonManager split, bitmap;
+    bitmap.setCoverageModel(RibbonManager::Bitmap);
+    for (int i = 0; i < 40; i++) {
+        split.add(-100, i * 10, 100, i * 10);
+        bitmap.add(-100, i * 10, 100, i * 10);
+    }
+    for (int i = 0; i < 2000; i++) {
+        auto px = x(engine), py = y(engine);
+        split.cover(px, py);
+        bitmap.cover(px, py);
+    }
+    EXPECT_LE(totalLength(bitmap), totalLength(split) + 1e-6);
+    EXPECT_GT(totalLength(bitmap), 0);
+    for (int i = 0; i < 200; i++) {
+        auto px = x(engine), py = y(engine);
+        auto min = DBL_MAX;
+        for (const auto& r : bitmap.get()) {
+            if (r.contains(px, py, r.getProjection(px, py))) min = 0;
+            min = fmin(min, fmin(State(px, py, 0, 0, 0).distanceTo(r.start().first, r.start().second),
+                                 State(px, py, 0, 0, 0).distanceTo(r.end().first, r.end().second)));
+        }
+        EXPECT_DOUBLE_EQ(bitmap.minDistanceFrom(px, py), min);
+    }
+
+    // switching models keeps what's left
+    auto before = totalLength(split);
+    split.setCoverageModel(RibbonManager::Bitmap);
+    EXPECT_NEAR(totalLength(split), before, 1e-6);
+    split.setCoverageModel(RibbonManager::Split);
+    EXPECT_NEAR(totalLength(split), before, 1e-6);
+}
+
+TEST(UnitTests, RibbonManagerHeuristicFunctionTest) {
+    // a bound heuristic gives what the manager does, before and after covering, and for copies
+    std::default_random_engine engine(11);
+    std::uniform_real_distribution<double> coordinate(-50, 50), angle(-M_PI, M_PI);
+    for (auto heuristic : {RibbonManager::MaxDistance, RibbonManager::TspPointRobotNoSplitAllRibbons,
+                           RibbonManager::TspPointRobotNoSplitKRibbons, RibbonManager::TspDubinsNoSplitAllRibbons,
+                           RibbonManager::TspDubinsNoSplitKRibbons, RibbonManager::MstLowerBound}) {
+        auto function = RibbonManager::heuristicFunction(heuristic);
+        RibbonManager ribbonManager(heuristic, 8, 2);
+        EXPECT_DOUBLE_EQ(function(ribbonManager, 0, 0, 0), 0);
+        for (int i = 0; i < 4; i++) {
+            ribbonManager.add(coordinate(engine), coordinate(engine), coordinate(engine), coordinate(engine));
+        }
+        for (int i = 0; i < 20; i++) {
+            auto x = coordinate(engine), y = coordinate(engine), yaw = angle(engine);
+            auto copy = ribbonManager;
+            EXPECT_DOUBLE_EQ(function(ribbonManager, x, y, yaw), ribbonManager.approximateDistanceUntilDone(x, y, yaw));
+            copy.coverBetween(x, y, coordinate(engine), coordinate(engine));
+            EXPECT_DOUBLE_EQ(function(copy, x, y, yaw), copy.approximateDistanceUntilDone(x, y, yaw));
+        }
+    }
+    // by hand: max distance from the middle of a 10m ribbon is its length plus the distance to an end
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 0, 10, 0);
+    EXPECT_DOUBLE_EQ(RibbonManager::heuristicFunction(RibbonManager::MaxDistance)(ribbonManager, 5, 0, 0), 15);
+    ribbonManager.add(0, 10, 10, 10);
+    EXPECT_DOUBLE_EQ(RibbonManager::heuristicFunction(RibbonManager::MaxDistance)(ribbonManager, 5, 0, 0), 25);
+    // values from the original recursive searches over lists, quirks and all: the point robot K ribbons one looks at
+    // the farthest k ribbons first, and the Dubins one never stops at k and leaves each ribbon facing back along it.
+    // The Held-Karp table carries on in the direction of travel instead, so its Dubins values are the best over every
+    // order and direction worked out that way (by brute force, with exact Dubins lengths).
+    std::vector<std::pair<RibbonManager::Heuristic, std::vector<double>>> expected = {
+        {RibbonManager::TspPointRobotNoSplitAllRibbons, {226.57808873187389, 219.55758082814944, 221.77394890462747}},
+        {RibbonManager::TspPointRobotNoSplitKRibbons, {242.36311005018817, 255.59430852792406, 245.40214541710961}},
+        {RibbonManager::TspDubinsNoSplitAllRibbons, {275.89033058867386, 280.94549922589442, 244.83655258166846}},
+        {RibbonManager::TspDubinsNoSplitKRibbons, {277.82086288541581, 297.11574723281416, 283.26634362797682}},
+    };
+    double queries[3][3] = {{5, 0, M_PI / 2}, {-10, 45, 0}, {25, 35, -M_PI / 4}};
+    for (const auto& e : expected) {
+        RibbonManager four(e.first, 8, 2);
+        four.add(0, 20, 20, 20);
+        four.add(0, 60, 30, 60);
+        four.add(-30, 40, -30, 10);
+        four.add(40, 0, 40, 30);
+        auto function = RibbonManager::heuristicFunction(e.first);
+        for (int i = 0; i < 3; i++) {
+            EXPECT_NEAR(e.second[i], function(four, queries[i][0], queries[i][1], queries[i][2]), 1e-9);
+        }
+    }
+    // the Dubins ones use exact Dubins distances, never the table (which can overestimate)
+    for (auto heuristic : {RibbonManager::TspDubinsNoSplitAllRibbons, RibbonManager::TspDubinsNoSplitKRibbons}) {
+        RibbonManager one(heuristic, 8, 2);
+        one.add(30, 17, 60, 17);
+        for (int i = 0; i < 20; i++) {
+            auto x = coordinate(engine), y = coordinate(engine), yaw = angle(engine);
+            auto toStart = DubinsTable::exactLength(x, y, yaw, 30, 17, 0, 8);
+            auto toEnd = DubinsTable::exactLength(x, y, yaw, 60, 17, M_PI, 8);
+            EXPECT_NEAR(one.approximateDistanceUntilDone(x, y, yaw), fmin(toStart, toEnd) + 30, 1e-6);
+        }
+    }
+}
+
+TEST(UnitTests, SpanningTreeHeuristicTest) {
+    // distances between segments by hand
+    EXPECT_DOUBLE_EQ(RibbonSpanningTree::distance(Ribbon(0, 0, 10, 0), Ribbon(0, 10, 10, 10)), 10);
+    EXPECT_DOUBLE_EQ(RibbonSpanningTree::distance(Ribbon(0, 0, 10, 10), Ribbon(0, 10, 10, 0)), 0);
+    EXPECT_DOUBLE_EQ(RibbonSpanningTree::distance(Ribbon(0, 0, 10, 0), Ribbon(5, 3, 5, 20)), 3);
+    EXPECT_DOUBLE_EQ(RibbonSpanningTree::distance(Ribbon(0, 0, 10, 0), Ribbon(13, 4, 20, 4)), 5);
+
+    // taking sites out, leaves or not, gives the same tree as starting again without them
+    std::default_random_engine engine(5);
+    std::uniform_real_distribution<double> coordinate(-100, 100);
+    std::vector<Ribbon> sites;
+    for (int i = 0; i < 40; i++) {
+        auto x = coordinate(engine), y = coordinate(engine);
+        sites.emplace_back(x, y, x + coordinate(engine) / 10, y + coordinate(engine) / 10);
+    }
+    auto tree = std::make_shared<const RibbonSpanningTree>(sites);
+    std::vector<bool> alive(sites.size(), true);
+    for (int i = 0; i < 30; i++) {
+        auto id = (i * 17) % (int)sites.size();
+        tree = tree->without(id);
+        alive[id] = false;
+        RibbonSpanningTree fresh(sites, alive);
+        EXPECT_EQ(tree->size(), fresh.size());
+        EXPECT_NEAR(tree->weight(), fresh.weight(), 1e-9);
+    }
+
+    // a lower bound, and no worse than max distance
+    for (int trial = 0; trial < 5; trial++) {
+        RibbonManager spanningTree(RibbonManager::MstLowerBound), heldKarp(RibbonManager::TspPointRobotNoSplitAllRibbons),
+                      maxDistance(RibbonManager::MaxDistance);
+        for (int i = 0; i < 8; i++) {
+            auto x1 = coordinate(engine), y1 = coordinate(engine), x2 = coordinate(engine), y2 = coordinate(engine);
+            for (auto* r : {&spanningTree, &heldKarp, &maxDistance}) r->add(x1, y1, x2, y2);
+        }
+        for (int i = 0; i < 10; i++) {
+            auto x = coordinate(engine), y = coordinate(engine);
+            auto h = spanningTree.approximateDistanceUntilDone(x, y, 0);
+            EXPECT_LE(h, heldKarp.approximateDistanceUntilDone(x, y, 0) + 1e-9);
+            EXPECT_GE(h, maxDistance.approximateDistanceUntilDone(x, y, 0));
+        }
+    }
+
+    // parallel lines 10 apart: their lengths, 10 between each, and the way to the nearest end. Finishing lines keeps
+    // it right, for either coverage model
+    auto width = Ribbon::RibbonWidth;
+    RibbonManager::setRibbonWidth(1.5);
+    for (auto model : {RibbonManager::Split, RibbonManager::Bitmap}) {
+        RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons);
+        ribbonManager.setCoverageModel(model);
+        for (int i = 0; i < 20; i++) ribbonManager.add(0, i * 10, 200, i * 10);
+        ribbonManager.changeHeuristicIfTooManyRibbons();
+        EXPECT_EQ(ribbonManager.heuristic(), RibbonManager::MstLowerBound);
+        EXPECT_DOUBLE_EQ(ribbonManager.approximateDistanceUntilDone(-50, 0, 0), 20 * 200 + 19 * 10 + 50);
+        auto copy = ribbonManager;
+        // an end one, then one from the middle, then half of another
+        copy.coverBetween(0, 0, 200, 0);
+        copy.coverBetween(0, 50, 200, 50);
+        copy.coverBetween(100, 100, 200, 100);
+        auto left = copy.get();
+        ASSERT_EQ(left.size(), 18);
+        double length = 0;
+        for (const auto& r : left) length += r.length();
+        EXPECT_NEAR(copy.approximateDistanceUntilDone(-50, 10, 0), length + 18 * 10 + 50, 1e-6);
+        // and the original still has all of them
+        EXPECT_DOUBLE_EQ(ribbonManager.approximateDistanceUntilDone(-50, 0, 0), 20 * 200 + 19 * 10 + 50);
+    }
+    RibbonManager::setRibbonWidth(width);
+}
+
+TEST(UnitTests, RibbonOrderingTest) {
+    // other tests change the width, and how covering splits ribbons depends on it
+    auto width = Ribbon::RibbonWidth;
+    RibbonManager::setRibbonWidth(1.5);
+    // parallel lines given in a jumbled order should come out going back and forth, at least as well as mowing the lawn
+    std::vector<Ribbon> ribbons;
+    for (int i = 0; i < 30; i++) ribbons.emplace_back(0, ((i * 7) % 30) * 10, 200, ((i * 7) % 30) * 10);
+    State start(-10, 0, M_PI_2, 2.5, 0);
+    RibbonOrdering ordering(ribbons, start, 8);
+    ASSERT_EQ(ordering.size(), 30);
+    const auto& legs = ordering.legs();
+    std::set<double> lines;
+    for (size_t i = 0; i < legs.size(); i++) {
+        lines.insert(legs[i].start().second);
+        if (i > 0) EXPECT_NEAR(legs[i].start().first, legs[i - 1].end().first, 1e-9);
+    }
+    EXPECT_EQ(lines.size(), 30);
+    double lawnmower = 0;
+    Ribbon previous(-10, 0, -10, 0);
+    for (int i = 0; i < 30; i++) {
+        auto leg = i % 2 == 0 ? Ribbon(0, i * 10, 200, i * 10) : Ribbon(200, i * 10, 0, i * 10);
+        auto from = i == 0 ? start : previous.startAsState();
+        if (i > 0) {
+            from.x() = previous.end().first;
+            from.y() = previous.end().second;
+        }
+        lawnmower += leg.length() + DubinsTable::length(from.x(), from.y(), from.yaw(), leg.start().first,
+                                                        leg.start().second, leg.startAsState().yaw(), 8);
+        previous = leg;
+    }
+    EXPECT_LE(ordering.cost(), lawnmower + 1e-6);
+
+    // what's left of the lines keeps its place, and so do pieces of one line
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    for (const auto& r : ribbons) ribbonManager.add(r.start().first, r.start().second, r.end().first, r.end().second);
+    auto y = legs.front().start().second, from = legs.front().start().first, to = legs.front().end().first;
+    ribbonManager.coverBetween(from, y, (from + to) / 2, y);
+    ribbonManager.cover(from + (to - from) * 0.75, y);
+    auto left = ribbonManager.get();
+    auto arranged = ordering.arrange({left.begin(), left.end()});
+    ASSERT_EQ(arranged.size(), left.size());
+    ASSERT_EQ(arranged.size(), 31);
+    EXPECT_NEAR(arranged[0].start().second, y, 1e-9);
+    EXPECT_NEAR(arranged[1].start().second, y, 1e-9);
+    EXPECT_LT(fabs(arranged[0].start().first - from), fabs(arranged[1].start().first - from));
+    EXPECT_NEAR(arranged[2].start().second, legs[1].start().second, 1e-9);
+    // repairing from where covering got to carries on along the same line
+    State there((from + to) / 2, y, 0, 2.5, 0);
+    there.setHeadingTowards(to, y);
+    RibbonOrdering repaired({left.begin(), left.end()}, there, 8, &ordering);
+    ASSERT_EQ(repaired.size(), 31);
+    EXPECT_NEAR(repaired.legs()[0].start().second, y, 1e-9);
+    EXPECT_NEAR(repaired.legs()[1].start().second, y, 1e-9);
+    // a new line goes in next to its neighbours
+    left.emplace_back(0, 145, 200, 145);
+    RibbonOrdering withNew({left.begin(), left.end()}, there, 8, &repaired);
+    ASSERT_EQ(withNew.size(), 32);
+    for (size_t i = 0; i < withNew.size(); i++) {
+        if (withNew.legs()[i].start().second != 145) continue;
+        auto nearest = DBL_MAX;
+        if (i > 0) nearest = fabs(withNew.legs()[i - 1].start().second - 145);
+        if (i + 1 < withNew.size()) nearest = fmin(nearest, fabs(withNew.legs()[i + 1].start().second - 145));
+        EXPECT_LE(nearest, 15);
+    }
+
+    // the planner gets the next few, with the same settings
+    auto next = ordering.nextRibbons(ribbonManager, 3);
+    EXPECT_EQ(next.get().size(), 3);
+    EXPECT_EQ(next.heuristic(), ribbonManager.heuristic());
+    EXPECT_EQ(next.k(), ribbonManager.k());
+    EXPECT_DOUBLE_EQ(next.minDistanceFrom(arranged[2].start().first, arranged[2].start().second), 0);
+    RibbonManager::setRibbonWidth(width);
+}
+
 TEST(Benchmarks, RibbonsTSPBenhcmark) {
     auto overallStart = std::chrono::system_clock::now();
     StateGenerator generator(-5000, -5000, 5000, 5000, 0, 0, 19);
@@ -544,6 +1492,42 @@ TEST(Benchmarks, RibbonsDubinsTSPBenchmark) {
     cerr << "Total time: " << (double)((end - overallStart).count()) / 1e9 << " seconds" << endl;
 }
 
+TEST(Benchmarks, RibbonsSpanningTreeBenchmark) {
+    // what a vertex costs at survey scale with the spanning tree heuristic: its copy of the manager finishing a line
+    // (which updates the tree), and then the heuristic there
+    StateGenerator generator(-5000, 5000, -5000, 5000, 1, 1, 19);
+    const int times = 1e3;
+    for (int i : {10, 100, 1000}) {
+        RibbonManager ribbonManager(RibbonManager::MstLowerBound);
+        for (int j = 1; j <= i; j++) {
+            // survey line sized
+            auto s1 = generator.generate();
+            auto s2 = s1.push(100);
+            ribbonManager.add(s1.x(), s1.y(), s2.x(), s2.y());
+        }
+        auto buildStart = std::chrono::system_clock::now();
+        ribbonManager.approximateDistanceUntilDone(0, 0, 0);
+        auto buildSeconds = (double)((std::chrono::system_clock::now() - buildStart).count()) / 1e9;
+        auto ribbons = ribbonManager.get();
+        std::vector<Ribbon> lines(ribbons.begin(), ribbons.end());
+        double coverSeconds = 0, heuristicSeconds = 0;
+        for (int t = 0; t < times; t++) {
+            auto copy = ribbonManager;
+            const auto& r = lines[t % lines.size()];
+            auto coverStart = std::chrono::system_clock::now();
+            copy.coverBetween(r.start().first, r.start().second, r.end().first, r.end().second);
+            auto heuristicStart = std::chrono::system_clock::now();
+            auto s = generator.generate();
+            copy.approximateDistanceUntilDone(s.x(), s.y(), s.heading());
+            auto heuristicEnd = std::chrono::system_clock::now();
+            coverSeconds += (double)((heuristicStart - coverStart).count()) / 1e9;
+            heuristicSeconds += (double)((heuristicEnd - heuristicStart).count()) / 1e9;
+        }
+        cerr << i << " ribbons: building the tree took " << buildSeconds << " seconds, then finishing a line "
+             << coverSeconds / times << " and the heuristic after it " << heuristicSeconds / times << " seconds" << endl;
+    }
+}
+
 TEST(Benchmarks, RibbonCoverBenchmark) {
     auto overallStart = std::chrono::system_clock::now();
     StateGenerator generator(-5000, -5000, 5000, 5000, 0, 0, 19);
@@ -602,6 +1586,66 @@ TEST(Benchmarks, RibbonCoverAlongItselfBenchmark) {
     cerr << "Total time: " << (double)((end - overallStart).count()) / 1e9 << " seconds" << endl;
 }
 
+TEST(Benchmarks, DensityKernelBenchmark) {
+    const size_t n = 1 << 20;
+    vector<double> dx(n), dy(n), a(n), b(n), c(n), out(n);
+    srand(17);
+    for (size_t i = 0; i < n; i++) {
+        dx[i] = (rand() % 200) / 20.0 - 5;
+        dy[i] = (rand() % 200) / 20.0 - 5;
+        a[i] = 1 + (rand() % 100) / 10.0;
+        c[i] = 1 + (rand() % 100) / 10.0;
+        b[i] = ((rand() % 100) / 100.0 - 0.5) * sqrt(a[i] * c[i]);
+    }
+    const int times = 20;
+    double checksum = 0;
+    auto startTime = std::chrono::system_clock::now();
+    for (int i = 0; i < times; i++) {
+        DensityKernel::evaluateReference(dx.data(), dy.data(), a.data(), b.data(), c.data(), out.data(), n);
+        checksum += out[i];
+    }
+    auto referenceSeconds = (double)((std::chrono::system_clock::now() - startTime).count()) / 1e9;
+    startTime = std::chrono::system_clock::now();
+    for (int i = 0; i < times; i++) {
+        DensityKernel::evaluate(dx.data(), dy.data(), a.data(), b.data(), c.data(), out.data(), n);
+        checksum -= out[i];
+    }
+    auto kernelSeconds = (double)((std::chrono::system_clock::now() - startTime).count()) / 1e9;
+    cerr << "Reference: " << referenceSeconds / times / n * 1e9 << " ns per density" << endl;
+    cerr << DensityKernel::implementation() << ": " << kernelSeconds / times / n * 1e9 << " ns per density ("
+         << referenceSeconds / kernelSeconds << "x)" << endl;
+    EXPECT_NEAR(checksum, 0, 1e-9);
+}
+
+TEST(Benchmarks, SamplingStrategyBenchmark) {
+    auto config = plannerConfig;
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    ribbonManager.add(-40, 0, -40, 50);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    const char* names[] = {"Uniform", "Halton", "Informed", "RibbonBiased"};
+    for (auto strategy : {StateGenerator::Uniform, StateGenerator::Halton, StateGenerator::Informed,
+                          StateGenerator::RibbonBiased}) {
+        config.setSamplingStrategy(strategy);
+        double total = 0;
+        size_t samples = 0;
+        int expanded = 0;
+        const int seeds = 5;
+        for (int seed = 0; seed < seeds; seed++) {
+            AStarPlanner planner;
+            planner.setSeed(seed + 1);
+            auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 1);
+            ASSERT_FALSE(plan.empty());
+            total += planner.bestVertex()->f();
+            samples += planner.sampleCount();
+            expanded += planner.expandedCount();
+        }
+        cerr << names[strategy] << ": mean f " << total / seeds << ", " << samples / seeds << " samples, "
+             << expanded / seeds << " expanded" << endl;
+    }
+}
+
 TEST(UnitTests, MakePlanTest) {
     State s1(0, 0, 0, 1, 1);
     State s2(0, 5, 0, 1, 6);
@@ -620,6 +1664,1017 @@ TEST(UnitTests, MakePlanTest) {
 //    EXPECT_GE(plan.getRef().back().y(), 4.5); // because of plan density
 }
 
+TEST(UnitTests, SearchArenaTest) {
+    std::weak_ptr<SearchArena> weakArena;
+    Vertex::SharedPtr leaf;
+    {
+        auto arena = make_shared<SearchArena>();
+        weakArena = arena;
+        auto root = Vertex::makeRoot(State(0, 0, 0, 1, 1), RibbonManager(), arena);
+        leaf = root;
+        for (int i = 1; i <= 1000; i++) leaf = Vertex::connect(leaf, State(0, i, 0, 1, i + 1));
+        EXPECT_EQ(leaf->arena(), arena.get());
+        EXPECT_GT(arena->bytesAllocated(), 1000 * sizeof(Vertex));
+    }
+    // the tree keeps its arena alive
+    EXPECT_FALSE(weakArena.expired());
+    EXPECT_EQ(leaf->getDepth(), 1000);
+    EXPECT_DOUBLE_EQ(leaf->parentEdge()->computeApproxCost(1, 2), 1);
+    leaf.reset();
+    EXPECT_TRUE(weakArena.expired());
+}
+
+TEST(UnitTests, ThreadPoolTest) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    for (int batch = 0; batch < 50; batch++) {
+        std::vector<int> done(batch, 0);
+        pool.run(done.size(), [&](size_t i) { done[i]++; });
+        for (auto d : done) EXPECT_EQ(d, 1);
+    }
+    EXPECT_THROW(pool.run(8, [](size_t i) { if (i == 5) throw std::runtime_error("task failed"); }),
+                 std::runtime_error);
+    // still usable afterwards
+    std::atomic<int> count(0);
+    pool.run(10, [&](size_t) { count++; });
+    EXPECT_EQ(count, 10);
+
+    // batches from several threads at once, and from inside tasks
+    count = 0;
+    std::vector<std::thread> callers;
+    for (int c = 0; c < 3; c++) {
+        callers.emplace_back([&] {
+            for (int batch = 0; batch < 50; batch++) {
+                pool.run(4, [&](size_t) { pool.run(5, [&](size_t) { count++; }); });
+            }
+        });
+    }
+    for (auto& c : callers) c.join();
+    EXPECT_EQ(count, 3 * 50 * 4 * 5);
+}
+
+TEST(UnitTests, ParallelExpansionTest) {
+    // step the clock on every call so both runs do exactly the same amount of search
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    DynamicObstaclesManager obstacles;
+    double mean1[2] = {10, 30}, mean2[2] = {-10, 50}, sigma[2][2] = {{4, 0}, {0, 4}};
+    std::vector<Distribution> distributions;
+    distributions.emplace_back(mean1, sigma, 0, 0);
+    distributions.emplace_back(mean2, sigma, 0, 20);
+    obstacles.add(1, distributions, 3, 6);
+    config.setObstacles(obstacles);
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    std::vector<DubinsPlan> plans;
+    for (int threads : {1, 4}) {
+        config.setExpansionThreads(threads);
+        clock = 0;
+        AStarPlanner planner;
+        plans.push_back(planner.plan(ribbonManager, start, config, DubinsPlan(), 0.3));
+        ASSERT_FALSE(plans.back().empty());
+    }
+    // and on a pool someone else is using at the same time, as in a fleet
+    config.setExpansionPool(std::make_shared<ThreadPool>(3));
+    std::atomic<bool> done(false);
+    std::thread other([&] {
+        while (!done) config.expansionPool()->run(16, [](size_t) { std::this_thread::yield(); });
+    });
+    clock = 0;
+    AStarPlanner planner;
+    plans.push_back(planner.plan(ribbonManager, start, config, DubinsPlan(), 0.3));
+    done = true;
+    other.join();
+    for (size_t p = 1; p < plans.size(); p++) {
+        ASSERT_EQ(plans[0].get().size(), plans[p].get().size());
+        for (size_t i = 0; i < plans[0].get().size(); i++) {
+            State s1, s2;
+            s1.time() = s2.time() = plans[0].get()[i].getEndTime();
+            EXPECT_DOUBLE_EQ(s1.time(), plans[p].get()[i].getEndTime());
+            plans[0].get()[i].sample(s1);
+            plans[p].get()[i].sample(s2);
+            EXPECT_DOUBLE_EQ(s1.x(), s2.x());
+            EXPECT_DOUBLE_EQ(s1.y(), s2.y());
+        }
+    }
+}
+
+TEST(UnitTests, IncrementalSearchTest) {
+    // reusing edges from earlier iterations shouldn't change the search at all, just make it cheaper
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    DynamicObstaclesManager obstacles;
+    double mean[2] = {10, 30}, sigma[2][2] = {{4, 0}, {0, 4}};
+    std::vector<Distribution> distributions;
+    distributions.emplace_back(mean, sigma, 0, 0);
+    obstacles.add(1, distributions, 3, 6);
+    config.setObstacles(obstacles);
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    std::vector<DubinsPlan> plans;
+    for (bool incremental : {false, true}) {
+        config.setIncrementalSearch(incremental);
+        clock = 0;
+        AStarPlanner planner;
+        plans.push_back(planner.plan(ribbonManager, start, config, DubinsPlan(), 0.3));
+        ASSERT_FALSE(plans.back().empty());
+    }
+    ASSERT_EQ(plans[0].get().size(), plans[1].get().size());
+    for (size_t i = 0; i < plans[0].get().size(); i++) {
+        State s1, s2;
+        s1.time() = s2.time() = plans[0].get()[i].getEndTime();
+        EXPECT_DOUBLE_EQ(s1.time(), plans[1].get()[i].getEndTime());
+        plans[0].get()[i].sample(s1);
+        plans[1].get()[i].sample(s2);
+        EXPECT_DOUBLE_EQ(s1.x(), s2.x());
+        EXPECT_DOUBLE_EQ(s1.y(), s2.y());
+    }
+}
+
+TEST(UnitTests, ParallelAStarPlannerTest) {
+    auto config = plannerConfig;
+    config.setSearchThreads(4);
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    ParallelAStarPlanner planner;
+    auto plan = planner.plan(ribbonManager, State(0, 0, M_PI / 2, 2.5, 1), config, DubinsPlan(), 0.5);
+    ASSERT_FALSE(plan.empty());
+    validatePlan(plan, config);
+    ASSERT_EQ(planner.threadExpansions().size(), 4);
+    int threadsUsed = 0;
+    for (auto n : planner.threadExpansions()) if (n > 0) threadsUsed++;
+    EXPECT_GT(threadsUsed, 1);
+}
+
+TEST(UnitTests, PortfolioPlannerTest) {
+    auto members = PortfolioPlanner::defaultMembers(4, 9, RibbonManager::TspPointRobotNoSplitKRibbons);
+    ASSERT_EQ(members.size(), 4);
+    // the first is the usual planner
+    EXPECT_EQ(members[0].Seed, 7);
+    EXPECT_EQ(members[0].BranchingFactor, 9);
+    EXPECT_EQ(members[0].Heuristic, RibbonManager::TspPointRobotNoSplitKRibbons);
+    EXPECT_NE(members[1].Seed, members[0].Seed);
+    EXPECT_NE(members[1].BranchingFactor, members[0].BranchingFactor);
+    EXPECT_NE(members[1].Heuristic, members[0].Heuristic);
+
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    PortfolioPlanner planner;
+    planner.setMembers(members);
+    auto plan = planner.plan(ribbonManager, State(0, 0, M_PI / 2, 2.5, 1), plannerConfig, DubinsPlan(), 0.5);
+    ASSERT_FALSE(plan.empty());
+    validatePlan(plan, plannerConfig);
+    EXPECT_GE(planner.lastWinner(), 0);
+    EXPECT_LT(planner.lastWinner(), 4);
+}
+
+TEST(UnitTests, SamplingStrategiesTest) {
+    EXPECT_DOUBLE_EQ(StateGenerator::halton(1, 2), 0.5);
+    EXPECT_DOUBLE_EQ(StateGenerator::halton(2, 2), 0.25);
+    EXPECT_DOUBLE_EQ(StateGenerator::halton(3, 2), 0.75);
+    EXPECT_DOUBLE_EQ(StateGenerator::halton(3, 3), 1.0 / 9);
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 20, 0, 60);
+    ribbonManager.add(300, 0, 300, 50); // out of reach
+    // Halton covers the box evenly: every cell of a 10x10 grid gets its share
+    StateGenerator halton(-50, 50, -50, 50, 2.5, 2.5, 3);
+    halton.setStrategy(StateGenerator::Halton);
+    std::vector<int> counts(100, 0);
+    for (int i = 0; i < 1000; i++) {
+        auto s = halton.generate();
+        ASSERT_TRUE(s.x() >= -50 && s.x() < 50 && s.y() >= -50 && s.y() < 50);
+        counts[(int)((s.x() + 50) / 10) * 10 + (int)((s.y() + 50) / 10)]++;
+    }
+    for (auto c : counts) EXPECT_TRUE(c >= 5 && c <= 15) << c;
+    // informed samples stay in the disk, which shrinks when asked
+    StateGenerator informed(-50, 50, -50, 50, 2.5, 2.5, 3, ribbonManager);
+    informed.setStrategy(StateGenerator::Informed);
+    informed.setMaxDistance(20);
+    for (int i = 0; i < 500; i++) {
+        auto s = informed.generate();
+        EXPECT_LE(sqrt(s.x() * s.x() + s.y() * s.y()), 20 + 1e-9);
+    }
+    informed.setMaxDistance(1000); // can't grow past the box
+    for (int i = 0; i < 500; i++) {
+        auto s = informed.generate();
+        EXPECT_LE(sqrt(s.x() * s.x() + s.y() * s.y()), 50 + 1e-9);
+    }
+    // ribbon biased puts some on the reachable ribbon, lined up with it, and none on the other one
+    StateGenerator biased(-50, 50, -50, 50, 2.5, 2.5, 3, ribbonManager);
+    biased.setStrategy(StateGenerator::RibbonBiased);
+    int onRibbon = 0;
+    for (int i = 0; i < 1000; i++) {
+        auto s = biased.generate();
+        EXPECT_LE(sqrt(s.x() * s.x() + s.y() * s.y()), 50 + 1e-9);
+        if (s.x() == 0 && s.y() >= 20 && s.y() <= 60) {
+            onRibbon++;
+            EXPECT_NEAR(fabs(cos(s.yaw())), 0, 1e-9);
+        }
+    }
+    EXPECT_GT(onRibbon, 150);
+    EXPECT_LT(onRibbon, 350);
+}
+
+TEST(UnitTests, DubinsTableTest) {
+    std::default_random_engine engine(5);
+    std::uniform_real_distribution<> position(-60, 60), angle(-M_PI, 3 * M_PI);
+    std::vector<double> errors;
+    for (int i = 0; i < 20000; i++) {
+        double x1 = position(engine), y1 = position(engine), yaw1 = angle(engine);
+        double x2 = position(engine), y2 = position(engine), yaw2 = angle(engine);
+        auto exact = DubinsTable::exactLength(x1, y1, yaw1, x2, y2, yaw2, 8);
+        auto approximate = DubinsTable::length(x1, y1, yaw1, x2, y2, yaw2, 8);
+        // past the table it's exact
+        if (sqrt(pow(x2 - x1, 2) + pow(y2 - y1, 2)) > DubinsTable::c_Extent * 8 * M_SQRT2) {
+            EXPECT_DOUBLE_EQ(exact, approximate);
+        }
+        errors.push_back(fabs(exact - approximate) / 8);
+        EXPECT_LE(DubinsTable::lowerBound(x1, y1, yaw1, x2, y2, yaw2, 8), exact + 1e-9);
+    }
+    std::sort(errors.begin(), errors.end());
+    // in turning radii. Most are close, a few near where the path type switches aren't
+    cerr << "Median error " << errors[errors.size() / 2] << ", 95th percentile " << errors[errors.size() * 95 / 100]
+         << ", max " << errors.back() << endl;
+    EXPECT_LT(errors[errors.size() / 2], 0.005);
+    EXPECT_LT(errors[errors.size() * 95 / 100], 0.05);
+    // scales with turning radius
+    EXPECT_NEAR(DubinsTable::length(0, 0, 0, 10, 5, 1, 4) * 2, DubinsTable::length(0, 0, 0, 20, 10, 1, 8), 1e-6);
+}
+
+TEST(UnitTests, OpenListTest) {
+    auto root = Vertex::makeRoot(State(0, 0, 0, 1, 0), RibbonManager());
+    std::vector<Vertex::SharedPtr> vertices;
+    std::vector<double> keys;
+    OpenList openList;
+    std::default_random_engine engine(3);
+    std::uniform_int_distribution<> key(0, 200); // lots of ties
+    for (int i = 0; i < 1000; i++) {
+        vertices.push_back(Vertex::connect(root, State(i, 1, 0, 1, 0)));
+        keys.push_back(key(engine));
+        openList.push(vertices.back(), keys.back());
+    }
+    // pushing again only ever lowers the key
+    for (int i = 0; i < 1000; i += 3) {
+        keys[i] -= 50;
+        openList.decreaseKey(*vertices[i], keys[i]);
+        openList.push(vertices[i], keys[i] + 100);
+    }
+    EXPECT_EQ(openList.size(), 1000);
+    EXPECT_EQ(openList.removeWorseThan(150), std::count_if(keys.begin(), keys.end(), [](double k) { return k > 150; }));
+    EXPECT_FALSE(openList.contains(*vertices[std::max_element(keys.begin(), keys.end()) - keys.begin()]));
+    double last = -DBL_MAX;
+    int lastX = -1;
+    size_t count = 0;
+    while (!openList.empty()) {
+        auto k = openList.topKey();
+        auto v = openList.pop();
+        auto x = (int)v->state().x();
+        EXPECT_FALSE(openList.contains(*v));
+        EXPECT_EQ(k, keys[x]);
+        EXPECT_GE(k, last);
+        // first come first served on ties (the decreased ones were pushed earlier still)
+        if (k == last && x % 3 != 0 && lastX % 3 != 0) EXPECT_GT(x, lastX);
+        last = k;
+        lastX = x;
+        count++;
+    }
+    EXPECT_EQ(count, std::count_if(keys.begin(), keys.end(), [](double k) { return k <= 150; }));
+    EXPECT_THROW(openList.pop(), std::out_of_range);
+}
+
+TEST(UnitTests, DominanceTableTest) {
+    DominanceTable table;
+    EXPECT_TRUE(table.offer(5, 10));
+    EXPECT_FALSE(table.offer(5, 10));
+    EXPECT_FALSE(table.offer(5, 11));
+    EXPECT_FALSE(table.beaten(5, 10));
+    EXPECT_TRUE(table.offer(5, 9));
+    EXPECT_TRUE(table.beaten(5, 10));
+    EXPECT_FALSE(table.beaten(6, 10));
+    // make it grow a few times, colliding in the low bits
+    for (uint64_t i = 0; i < 10000; i++) EXPECT_TRUE(table.offer(i << 20, (double)i));
+    EXPECT_EQ(table.size(), 10001);
+    for (uint64_t i = 0; i < 10000; i++) {
+        EXPECT_FALSE(table.offer(i << 20, (double)i + 1));
+        EXPECT_TRUE(table.beaten(i << 20, (double)i + 1));
+    }
+    table.clear();
+    EXPECT_EQ(table.size(), 0);
+    EXPECT_TRUE(table.offer(5, 11));
+}
+
+TEST(UnitTests, DuplicateDetectionTest) {
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 40, 20, 40);
+    ribbonManager.add(0, 60, 20, 60);
+    ribbonManager.add(-20, 0, -20, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    std::vector<double> fs;
+    for (bool detection : {false, true}) {
+        config.setDuplicateDetection(detection);
+        clock = 0;
+        AStarPlanner planner;
+        auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.2);
+        ASSERT_FALSE(plan.empty());
+        validatePlan(plan, config);
+        fs.push_back(planner.bestVertex()->f());
+        if (detection) EXPECT_GT(planner.duplicatesPruned(), 0);
+        else EXPECT_EQ(planner.duplicatesPruned(), 0);
+        cerr << (detection ? "With" : "Without") << " duplicate detection: f " << fs.back() << ", "
+             << planner.expandedCount() << " expanded, " << planner.duplicatesPruned() << " pruned" << endl;
+    }
+}
+
+TEST(UnitTests, MotionPrimitivesTest) {
+    MotionPrimitives primitives(4, 8, 1);
+    EXPECT_EQ(primitives.spacing(), 4);
+    EXPECT_EQ(primitives.turningRadius(), 8);
+    for (int h = 0; h < MotionPrimitives::c_Headings; h++) {
+        ASSERT_FALSE(primitives.from(h).empty());
+        for (const auto& p : primitives.from(h)) {
+            // every one ends on the lattice
+            double distance = p.Length, x, y, yaw;
+            DubinsWrapper::evaluate(p.Path, &distance, 1, &x, &y, &yaw);
+            EXPECT_NEAR(x, p.DX * 4, 1e-6);
+            EXPECT_NEAR(y, p.DY * 4, 1e-6);
+            EXPECT_NEAR(cos(yaw), cos(MotionPrimitives::yaw(p.EndHeading)), 1e-6);
+            EXPECT_NEAR(sin(yaw), sin(MotionPrimitives::yaw(p.EndHeading)), 1e-6);
+            // and its samples, moved, are the placed path's
+            DubinsWrapper wrapper;
+            wrapper.fill(p.placed(10, -20), 2.5, 5);
+            DubinsWrapper::Samples expected, actual;
+            wrapper.sampleMany(5, 1 / 2.5, wrapper.getEndTime(), expected);
+            p.sample(10, -20, 5, 1 / 2.5, wrapper.getEndTime(), actual);
+            ASSERT_GE(actual.size() + 1, expected.size());
+            ASSERT_LE(actual.size(), expected.size());
+            for (size_t i = 0; i < actual.size(); i++) {
+                EXPECT_DOUBLE_EQ(actual.Times[i], expected.Times[i]);
+                EXPECT_NEAR(actual.Xs[i], expected.Xs[i], 1e-6);
+                EXPECT_NEAR(actual.Ys[i], expected.Ys[i], 1e-6);
+            }
+        }
+    }
+    auto s = primitives.node(3.3, -1.7, 5, -2, 3, 2.5);
+    long ix, iy;
+    int heading;
+    ASSERT_TRUE(primitives.locate(3.3, -1.7, s, ix, iy, heading));
+    EXPECT_EQ(ix, 5);
+    EXPECT_EQ(iy, -2);
+    EXPECT_EQ(heading, 3);
+    s.x() += 0.01;
+    EXPECT_FALSE(primitives.locate(3.3, -1.7, s, ix, iy, heading));
+}
+
+TEST(UnitTests, LatticeSearchTest) {
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    config.setLatticeSearch(true);
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    AStarPlanner planner;
+    auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.2);
+    ASSERT_FALSE(plan.empty());
+    validatePlan(plan, config);
+    EXPECT_EQ(planner.sampleCount(), 0);
+    // lattice states reached more than one way are exactly the same, so some get thrown out
+    EXPECT_GT(planner.duplicatesPruned(), 0);
+    cerr << "Lattice search: f " << planner.bestVertex()->f() << ", " << planner.expandedCount() << " expanded, "
+         << planner.duplicatesPruned() << " pruned" << endl;
+}
+
+TEST(UnitTests, WeightedAStarTest) {
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    for (double weight : {1.0, 3.0}) {
+        config.setHeuristicWeight(weight);
+        clock = 0;
+        AStarPlanner planner;
+        auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.2);
+        ASSERT_FALSE(plan.empty());
+        validatePlan(plan, config);
+        // it should have got through a few iterations, bringing the weight (and bound) down
+        EXPECT_GE(planner.suboptimalityBound(), 1);
+        EXPECT_LT(planner.suboptimalityBound(), weight == 1 ? 1.0000001 : 2);
+    }
+}
+
+TEST(UnitTests, WarmStartTest) {
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    auto warmStart = std::make_shared<WarmStart>();
+    AStarPlanner first;
+    first.setWarmStart(warmStart);
+    auto plan = first.plan(ribbonManager, start, config, DubinsPlan(), 0.3);
+    ASSERT_FALSE(plan.empty());
+    EXPECT_FALSE(warmStart->empty());
+    // next cycle, a second along the plan
+    State next(start);
+    next.time() += 1;
+    plan.sample(next);
+    plan.changeIntoSuffix(next.time());
+    auto kept = warmStart->samplesWithin(next.x() - 75, next.x() + 75, next.y() - 75, next.y() + 75).size();
+    EXPECT_GT(kept, 0);
+    std::vector<double> firstPlanSeconds, costs;
+    for (bool warm : {false, true}) {
+        clock = 0;
+        AStarPlanner planner;
+        if (warm) planner.setWarmStart(warmStart);
+        auto p = planner.plan(ribbonManager, next, config, plan, 0.3);
+        ASSERT_FALSE(p.empty());
+        validatePlan(p, config);
+        firstPlanSeconds.push_back(planner.firstPlanSeconds());
+        costs.push_back(planner.bestVertex()->f());
+        cerr << (warm ? "Warm" : "Cold") << " start: first plan after " << firstPlanSeconds.back() << "s, f "
+             << costs.back() << endl;
+    }
+    // with the same budget, starting from the last plan's states shouldn't end up anywhere worse
+    EXPECT_LE(costs[1], costs[0] + 1e-9);
+}
+
+TEST(UnitTests, SoftTimeLimitTest) {
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    std::vector<double> seconds;
+    for (double softTimeLimit : {(double)INFINITY, 0.05}) {
+        clock = 0;
+        config.setSoftTimeLimit(softTimeLimit);
+        // nothing counts as getting better, so it stops as soon as it's past the limit with a plan
+        config.setExtensionImprovement(INFINITY);
+        AStarPlanner planner;
+        auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.3);
+        ASSERT_FALSE(plan.empty());
+        seconds.push_back(clock);
+    }
+    cerr << "Planned for " << seconds[0] << "s without a soft limit, " << seconds[1] << "s with one" << endl;
+    EXPECT_LT(seconds[1], seconds[0]);
+    EXPECT_LT(seconds[1], 0.3);
+}
+
+TEST(UnitTests, InstrumentationTest) {
+    auto config = plannerConfig;
+    double clock = 0;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    Instrumentation::take();
+    AStarPlanner planner;
+    ASSERT_FALSE(planner.plan(ribbonManager, start, config, DubinsPlan(), 0.2).empty());
+    auto report = Instrumentation::take();
+    if (!Instrumentation::enabled()) {
+        // compiled out, so nothing's counted
+        for (auto count : report.Counts) EXPECT_EQ(0, count);
+        return;
+    }
+    cerr << report.toString();
+    EXPECT_LT(0, report.Counts[Instrumentation::TrueCosts]);
+    EXPECT_LT(0, report.Counts[Instrumentation::Expansions]);
+    EXPECT_LT(0, report.Counts[Instrumentation::MapQueries]);
+    EXPECT_LE(report.Counts[Instrumentation::Pushes], report.Counts[Instrumentation::Offers]);
+    EXPECT_LE(report.Counts[Instrumentation::Pops], report.Counts[Instrumentation::Pushes]);
+    EXPECT_LE(report.Seconds[Instrumentation::MapTime] + report.Seconds[Instrumentation::ObstacleTime] +
+              report.Seconds[Instrumentation::CoverTime], report.Seconds[Instrumentation::TrueCostTime]);
+    // and it starts again from zero
+    EXPECT_EQ(0, Instrumentation::take().Counts[Instrumentation::TrueCosts]);
+}
+
+TEST(UnitTests, TripleBufferTest) {
+    TripleBuffer<int> buffer;
+    EXPECT_FALSE(buffer.update());
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+    // only the latest one comes out
+    EXPECT_TRUE(buffer.update());
+    EXPECT_EQ(2, buffer.front());
+    EXPECT_FALSE(buffer.update());
+    EXPECT_EQ(2, buffer.front());
+
+    // the reader sees the values go up, never a torn or old one, and ends on the last
+    TripleBuffer<std::vector<int>> vectors;
+    const int count = 100000;
+    std::thread writer([&] {
+        for (int i = 1; i <= count; i++) {
+            vectors.back().assign(8, i);
+            vectors.publish();
+        }
+    });
+    int last = 0;
+    bool consistent = true;
+    while (last < count) {
+        if (!vectors.update()) continue;
+        const auto& v = vectors.front();
+        for (auto x : v) consistent &= x == v.front();
+        EXPECT_GT(v.front(), last);
+        last = v.front();
+    }
+    writer.join();
+    EXPECT_TRUE(consistent);
+}
+
+/**
+ * Stands in for the node: the controller takes a while to answer, and always agrees to follow the plan.
+ */
+class SlowControllerStub : public TrajectoryPublisher {
+public:
+    State publishPlan(const DubinsPlan& plan) override {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            PublishTimes.push_back(getTime());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        State next;
+        next.time() = plan.getStartTime() + 1;
+        plan.sample(next);
+        return next;
+    }
+    void displayTrajectory(const std::vector<State>& trajectory, bool plannerTrajectory) override {}
+    void allDone() override { AllDone = true; }
+    double getTime() const override { return Executive::getCurrentTime(); }
+    void displayRibbons(const RibbonManager& ribbonManager) override {}
+    std::mutex Mutex;
+    std::vector<double> PublishTimes;
+    std::atomic<bool> AllDone{false};
+};
+
+TEST(UnitTests, PipelinedExecutiveTest) {
+    for (bool pipelined : {false, true}) {
+        SlowControllerStub stub;
+        auto executive = std::unique_ptr<Executive>(new Executive(&stub));
+        executive->setConfiguration(8, 16, 2.5, 2, 9, 2);
+        executive->setPipelinedPublishing(pipelined);
+        executive->addRibbon(0, 20, 0, 60);
+        executive->updateCovered(0, 0, 2.5, 0, Executive::getCurrentTime());
+        executive->startPlanner();
+        std::this_thread::sleep_for(std::chrono::milliseconds(4500));
+        executive->cancelPlanner();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        executive.reset();
+        std::lock_guard<std::mutex> lock(stub.Mutex);
+        ASSERT_GE(stub.PublishTimes.size(), 3);
+        auto interval = (stub.PublishTimes.back() - stub.PublishTimes.front()) / (stub.PublishTimes.size() - 1);
+        cerr << (pipelined ? "Pipelined" : "In step") << ": a plan every " << interval << "s" << endl;
+        // planning in step with a controller that takes 0.3s to answer only gets a plan out every 1.3s; pipelined, the
+        // planner doesn't wait for it
+        if (pipelined) EXPECT_LT(interval, 1.15);
+        else EXPECT_GT(interval, 1.15);
+    }
+}
+
+TEST(UnitTests, AdaptiveExecutiveTest) {
+    SlowControllerStub stub;
+    auto executive = std::unique_ptr<Executive>(new Executive(&stub));
+    executive->setConfiguration(8, 16, 2.5, 2, 9, 2);
+    executive->setAdaptivePlanning(true);
+    executive->addRibbon(0, 20, 0, 60);
+    executive->updateCovered(0, 0, 2.5, 0, Executive::getCurrentTime());
+    executive->startPlanner();
+    std::this_thread::sleep_for(std::chrono::milliseconds(4500));
+    executive->cancelPlanner();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    executive.reset();
+    std::lock_guard<std::mutex> lock(stub.Mutex);
+    ASSERT_GE(stub.PublishTimes.size(), 3);
+    auto interval = (stub.PublishTimes.back() - stub.PublishTimes.front()) / (stub.PublishTimes.size() - 1);
+    cerr << "Adaptive: a plan every " << interval << "s" << endl;
+    // a single ribbon's easy, so plans shouldn't have to wait out the second (plus the controller's 0.3s)
+    EXPECT_LT(interval, 1.15);
+}
+
+TEST(UnitTests, FleetTest) {
+    SlowControllerStub stub1, stub2;
+    Fleet fleet(3);
+    auto& first = fleet.addVessel(1, &stub1);
+    auto& second = fleet.addVessel(2, &stub2);
+    EXPECT_THROW(fleet.addVessel(2, &stub2), std::logic_error);
+    EXPECT_EQ(&second, &fleet.vessel(2));
+    // both vessels' true costs go on the fleet's pool
+    EXPECT_EQ(3u, fleet.expansionPool()->size());
+    EXPECT_EQ(3, fleet.expansionPool().use_count());
+    for (auto* executive : {&first, &second}) {
+        executive->setConfiguration(8, 16, 2.5, 2, 9, 2, 2);
+        executive->addRibbon(0, 20, 0, 60);
+    }
+    first.updateCovered(0, 0, 2.5, 0, Executive::getCurrentTime());
+    second.updateCovered(20, 0, 2.5, 0, Executive::getCurrentTime());
+    // a contact for everyone, and one that's really the second vessel, which its plans speak for
+    fleet.updateDynamicObstacle(99, State(100, 100, 0, 1, Executive::getCurrentTime()));
+    fleet.updateDynamicObstacle(2, State(-100, -100, 0, 1, Executive::getCurrentTime()));
+    fleet.startPlanners();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+
+    // both vessels' plans are in the one world, next to the contact
+    uint64_t version;
+    auto obstacles = fleet.world()->obstacles(version);
+    std::vector<uint32_t> ids;
+    obstacles->forEachObstacle([&] (uint32_t id, const DynamicObstacle& obstacle) {
+        ids.push_back(id);
+        if (id == 2) EXPECT_GT(obstacle.distributions().front().mean()[0], 0);
+    });
+    EXPECT_EQ((std::vector<uint32_t>{1, 2, 99}), ids);
+    {
+        std::lock_guard<std::mutex> lock1(stub1.Mutex), lock2(stub2.Mutex);
+        EXPECT_GE(stub1.PublishTimes.size(), 1);
+        EXPECT_GE(stub2.PublishTimes.size(), 1);
+    }
+
+    fleet.cancelPlanners();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    // stopped vessels' plans are gone
+    ids.clear();
+    fleet.world()->obstacles(version)->forEachObstacle([&] (uint32_t id, const DynamicObstacle&) { ids.push_back(id); });
+    EXPECT_EQ((std::vector<uint32_t>{99}), ids);
+
+    // the distributions follow the plan, spreading out further along it
+    DubinsPlan plan(State(0, 0, 0, 2.5, 1), State(30, 30, 0, 2.5, 0), 8);
+    auto distributions = Executive::planDistributions(plan);
+    ASSERT_GE(distributions.size(), 2);
+    EXPECT_DOUBLE_EQ(1, distributions.front().time());
+    EXPECT_DOUBLE_EQ(plan.getEndTime(), distributions.back().time());
+    double first0, second0, xy, yy;
+    distributions.front().covariance(first0, xy, yy);
+    distributions.back().covariance(second0, xy, yy);
+    EXPECT_LT(first0, second0);
+}
+
+TEST(UnitTests, SpscRingTest) {
+    SpscRing<int, 4> ring;
+    int item;
+    EXPECT_FALSE(ring.pop(item));
+    for (int i = 0; i < 4; i++) EXPECT_TRUE(ring.push(i));
+    EXPECT_FALSE(ring.push(4));
+    EXPECT_TRUE(ring.pop(item));
+    EXPECT_EQ(0, item);
+    EXPECT_TRUE(ring.push(4));
+    for (int i = 1; i <= 4; i++) {
+        EXPECT_TRUE(ring.pop(item));
+        EXPECT_EQ(i, item);
+    }
+    EXPECT_FALSE(ring.pop(item));
+
+    // everything comes out once, in order
+    SpscRing<int, 64> shared;
+    const int count = 200000;
+    std::thread producer([&] {
+        for (int i = 0; i < count; i++) while (!shared.push(i)) {}
+    });
+    int expected = 0;
+    bool inOrder = true;
+    while (expected < count) {
+        if (shared.pop(item)) inOrder &= item == expected++;
+    }
+    producer.join();
+    EXPECT_TRUE(inOrder);
+    EXPECT_FALSE(shared.pop(item));
+}
+
+TEST(UnitTests, MpscRingTest) {
+    MpscRing<int, 1024> ring;
+    int item;
+    EXPECT_FALSE(ring.pop(item));
+    for (int i = 0; i < 1024; i++) EXPECT_TRUE(ring.push(i));
+    EXPECT_FALSE(ring.push(1024));
+    for (int i = 0; i < 1024; i++) {
+        ASSERT_TRUE(ring.pop(item));
+        EXPECT_EQ(i, item);
+    }
+    // several producers at once, with the consumer going too; everything comes out once, each producer's in order
+    const int producers = 4, perProducer = 20000;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < perProducer; i++) while (!ring.push(p * perProducer + i)) std::this_thread::yield();
+        });
+    }
+    std::vector<int> last(producers, -1);
+    for (int received = 0; received < producers * perProducer;) {
+        if (!ring.pop(item)) continue;
+        auto p = item / perProducer;
+        EXPECT_EQ(last[p] + 1, item % perProducer);
+        last[p] = item % perProducer;
+        received++;
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_FALSE(ring.pop(item));
+}
+
+TEST(UnitTests, BinaryVisualizationTest) {
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    std::string textPath = "/tmp/planner_test_visualizations.txt", binaryPath = "/tmp/planner_test_visualizations.bin";
+    std::remove(textPath.c_str());
+    std::vector<size_t> counts;
+    for (auto format : {Visualizer::Text, Visualizer::Binary}) {
+        auto config = plannerConfig;
+        double clock = 0;
+        config.setNowFunction([&] { return clock += 1e-3; });
+        Visualizer::UniquePtr visualizer(new Visualizer(format == Visualizer::Text ? textPath : binaryPath, format));
+        config.setVisualizer(&visualizer);
+        config.setVisualizations(true);
+        AStarPlanner planner;
+        ASSERT_FALSE(planner.plan(ribbonManager, start, config, DubinsPlan(), 0.1).empty());
+        EXPECT_EQ(0, visualizer->dropped());
+        visualizer.reset(); // writes the rest out
+        if (format == Visualizer::Text) {
+            std::ifstream text(textPath);
+            std::string line;
+            size_t lines = 0;
+            while (std::getline(text, line)) lines++;
+            counts.push_back(lines);
+            continue;
+        }
+        std::ifstream binary(binaryPath, std::ios::binary);
+        char magic[4];
+        uint32_t version, size;
+        binary.read(magic, 4);
+        binary.read(reinterpret_cast<char*>(&version), 4);
+        binary.read(reinterpret_cast<char*>(&size), 4);
+        EXPECT_EQ("PPVB", std::string(magic, 4));
+        EXPECT_EQ(Visualizer::c_Version, version);
+        ASSERT_EQ(sizeof(Visualizer::Record), size);
+        Visualizer::Record record;
+        size_t records = 0, starts = 0;
+        while (binary.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            records++;
+            if (record.Tag == Visualizer::StartTag) {
+                starts++;
+                EXPECT_DOUBLE_EQ(start.x(), record.X);
+                EXPECT_DOUBLE_EQ(start.y(), record.Y);
+            }
+            EXPECT_LE(record.Tag, Visualizer::EndRibbonsTag);
+        }
+        EXPECT_LT(0, starts);
+        counts.push_back(records);
+    }
+    // the same search records the same things either way
+    EXPECT_LT(0, counts[0]);
+    EXPECT_EQ(counts[0], counts[1]);
+}
+
+TEST(UnitTests, PlanningRecordTest) {
+    auto same = [] (const State& s1, const State& s2) {
+        return s1.x() == s2.x() && s1.y() == s2.y() && s1.heading() == s2.heading() && s1.speed() == s2.speed() &&
+            s1.time() == s2.time();
+    };
+    double clock = 0;
+    auto config = plannerConfig;
+    config.setNowFunction([&] { return clock += 1e-3; });
+    config.setBranchingFactor(6);
+    config.setHeuristicWeight(1.5);
+    config.setLatticeSearch(true);
+    config.setGeometryCacheCapacity(0);
+    DynamicObstaclesManager obstacles;
+    double mean[2] = {10, 30};
+    double covariance[2][2] = {{1, 0.5}, {0.5, 2}};
+    obstacles.add(5, {Distribution(mean, covariance, 1.2, 3)}, 2, 4);
+    obstacles.addIgnore(7);
+    config.setObstacles(obstacles);
+
+    PlanningRecord record(config);
+    record.Ribbons = RibbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    record.Ribbons.add(0, 20, 20, 20);
+    record.Ribbons.add(0, 60, 30, 60);
+    record.Ribbons.coverBetween(0, 20, 8, 20);
+    // the last plan, from a little while ago
+    AStarPlanner planner;
+    record.PreviousPlan = planner.plan(record.Ribbons, State(0, 0, M_PI / 2, 2.5, 1), config, DubinsPlan(), 0.3);
+    ASSERT_FALSE(record.PreviousPlan.empty());
+    record.Start.time() = 3;
+    record.PreviousPlan.sample(record.Start);
+    record.PreviousPlan.changeIntoSuffix(record.Start.time());
+    record.WarmStart = {State(5, 10, 1, 2.5, 4), State(10, 20, 2, 2.5, 8)};
+    record.TimeRemaining = 0.3;
+    record.MapPath = "/tmp/some.map";
+    record.MapLatitude = 43;
+
+    PlanningRecord::save("/tmp/planning_record_test", {record, record});
+    auto loaded = PlanningRecord::load("/tmp/planning_record_test", &std::cerr);
+    ASSERT_EQ(2, loaded.size());
+    auto& copy = loaded[1];
+    EXPECT_EQ(record.Ribbons.dumpRibbons(), copy.Ribbons.dumpRibbons());
+    EXPECT_EQ(record.Ribbons.heuristic(), copy.Ribbons.heuristic());
+    EXPECT_TRUE(same(record.Start, copy.Start));
+    EXPECT_EQ(6, copy.Config.branchingFactor());
+    EXPECT_DOUBLE_EQ(1.5, copy.Config.heuristicWeight());
+    EXPECT_TRUE(copy.Config.latticeSearch());
+    EXPECT_EQ(0u, copy.Config.geometryCacheCapacity());
+    EXPECT_EQ(record.Config.obstacles().ignored(), copy.Config.obstacles().ignored());
+    EXPECT_EQ(record.Config.obstacles().collisionExists(10, 30, 3), copy.Config.obstacles().collisionExists(10, 30, 3));
+    EXPECT_LT(0, copy.Config.obstacles().collisionExists(10, 30, 3));
+    ASSERT_EQ(record.PreviousPlan.get().size(), copy.PreviousPlan.get().size());
+    EXPECT_EQ(record.PreviousPlan.getStartTime(), copy.PreviousPlan.getStartTime());
+    EXPECT_EQ(record.PreviousPlan.getEndTime(), copy.PreviousPlan.getEndTime());
+    State s1, s2;
+    s1.time() = s2.time() = 5;
+    record.PreviousPlan.sample(s1);
+    copy.PreviousPlan.sample(s2);
+    EXPECT_TRUE(same(s1, s2));
+    ASSERT_EQ(2, copy.WarmStart.size());
+    EXPECT_TRUE(same(record.WarmStart[1], copy.WarmStart[1]));
+    EXPECT_EQ(0.3, copy.TimeRemaining);
+    EXPECT_EQ("/tmp/some.map", copy.MapPath);
+    EXPECT_EQ(43, copy.MapLatitude);
+
+    // with the same clock, planning again from the loaded cycle matches planning from the original
+    std::vector<DubinsPlan> plans;
+    for (auto* r : {&record, &copy}) {
+        clock = r->Start.time();
+        auto c = r->Config;
+        c.setNowFunction([&] { return clock += 1e-3; });
+        c.setMap(make_shared<Map>());
+        AStarPlanner replanner;
+        plans.push_back(replanner.plan(r->Ribbons, r->Start, c, r->PreviousPlan, r->TimeRemaining));
+    }
+    ASSERT_FALSE(plans[0].empty());
+    ASSERT_EQ(plans[0].get().size(), plans[1].get().size());
+    EXPECT_EQ(plans[0].getEndTime(), plans[1].getEndTime());
+
+    std::ofstream("/tmp/planning_record_test") << "not a record";
+    EXPECT_THROW(PlanningRecord::load("/tmp/planning_record_test", &std::cerr), std::runtime_error);
+}
+
+TEST(UnitTests, BudgetTest) {
+    int reads = 0;
+    double clock = 0;
+    auto now = [&] { reads++; return clock; };
+    Budget budget;
+    budget.start(Budget::Clock, now, 1, 0, 8);
+    EXPECT_EQ(1, reads);
+    for (int i = 0; i < 7; i++) EXPECT_FALSE(budget.spent());
+    EXPECT_EQ(1, reads); // not read yet
+    clock = 2;
+    EXPECT_TRUE(budget.spent());
+    EXPECT_EQ(2, reads);
+    EXPECT_TRUE(budget.spent());
+    EXPECT_EQ(2, reads); // stays spent without looking again
+
+    reads = 0;
+    budget.start(Budget::Work, now, 0.5, 100, 8);
+    budget.addWork(49);
+    EXPECT_FALSE(budget.spentNow());
+    EXPECT_DOUBLE_EQ(0.49, budget.elapsed());
+    budget.addWork();
+    EXPECT_TRUE(budget.spent());
+    EXPECT_EQ(0, reads);
+
+    // a work budget plans the same way whatever the clock's doing, without reading it
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(0, 20, 20, 20);
+    ribbonManager.add(0, 60, 30, 60);
+    State start(0, 0, M_PI / 2, 2.5, 1);
+    auto config = plannerConfig;
+    config.setBudgetMode(Budget::Work);
+    config.setWorkPerSecond(10000);
+    std::vector<double> costs;
+    std::vector<uint64_t> work;
+    for (double step : {1e-6, 1.0}) {
+        reads = 0;
+        config.setNowFunction([&] { reads++; return clock += step; });
+        AStarPlanner planner;
+        ASSERT_FALSE(planner.plan(ribbonManager, start, config, DubinsPlan(), 0.2).empty());
+        EXPECT_EQ(0, reads);
+        costs.push_back(planner.bestVertex()->f());
+        work.push_back(planner.work());
+    }
+    EXPECT_EQ(costs[0], costs[1]);
+    EXPECT_EQ(work[0], work[1]);
+    // it stops about when the work's done (the expansion that spends it finishes first)
+    EXPECT_GE(work[0], 2000);
+    EXPECT_LT(work[0], 2200);
+}
+
+TEST(UnitTests, ExecutiveCoverageTest) {
+    SlowControllerStub stub;
+    auto executive = std::unique_ptr<Executive>(new Executive(&stub));
+    executive->setConfiguration(8, 16, 2.5, 2, 9, 2);
+    executive->addRibbon(0, 0, 0, 20);
+    executive->addRibbon(0, 40, 0, 60);
+    EXPECT_FALSE(executive->ribbonSnapshot());
+    // more points than the queue holds, with nothing taking them off it yet
+    auto now = Executive::getCurrentTime();
+    for (int i = 0; i < 2 * 4096; i++) executive->updateCovered(0, i % 21, 2.5, 0, now);
+    executive->startPlanner();
+    for (int y = 40; y <= 60; y++) executive->updateCovered(0, y, 2.5, 0, now);
+    for (int i = 0; i < 40 && !stub.AllDone; i++) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(stub.AllDone);
+    auto snapshot = executive->ribbonSnapshot();
+    ASSERT_TRUE(snapshot);
+    EXPECT_TRUE(snapshot->done());
+    executive->cancelPlanner();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+TEST(UnitTests, MapLoaderTest) {
+    std::atomic<int> loads(0);
+    MapLoader loader([&](const std::string& path, double, double, const std::atomic<bool>& cancelled) {
+        loads++;
+        if (path == "bad") throw std::runtime_error("bad map");
+        // the slow one only finishes when it's cancelled
+        while (path == "slow" && !cancelled) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return std::make_shared<Map>();
+    });
+    auto waitFor = [&](std::function<bool()> condition) {
+        for (int i = 0; i < 2000 && !condition(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return condition();
+    };
+    EXPECT_FALSE(loader.map());
+    loader.request("slow", 0, 0);
+    ASSERT_TRUE(waitFor([&] { return loader.progress().Loading; }));
+    EXPECT_EQ("slow", loader.progress().Path);
+    // asking for another drops the slow one, which never gets swapped in
+    loader.request("a", 0, 0);
+    ASSERT_TRUE(waitFor([&] { return loader.progress().Completed == 1; }));
+    auto map = loader.map();
+    ASSERT_TRUE(map);
+    auto progress = loader.progress();
+    EXPECT_EQ("a", progress.Path);
+    EXPECT_FALSE(progress.Loading);
+    EXPECT_EQ(1, progress.Cancelled);
+    EXPECT_EQ(0, progress.Failed);
+    EXPECT_EQ(2, loads);
+    // asking for the same one again does nothing
+    loader.request("a", 0, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(2, loads);
+    EXPECT_EQ(map, loader.map());
+    // and a failure leaves the last map in place
+    loader.request("bad", 0, 0);
+    ASSERT_TRUE(waitFor([&] { return loader.progress().Failed == 1; }));
+    EXPECT_EQ(map, loader.map());
+    EXPECT_EQ(1, loader.progress().Completed);
+    // so a load is still going at the end
+    loader.request("slow", 0, 0);
+}
+
+TEST(UnitTests, SampleGridTest) {
+    SampleGrid grid(5);
+    StateGenerator generator(-100, 100, -100, 100, 2.5, 2.5, 21);
+    for (int i = 0; i < 2000; i++) grid.add(generator.generate());
+    ASSERT_EQ(grid.size(), 2000);
+    for (int trial = 0; trial < 20; trial++) {
+        auto origin = generator.generate();
+        // everything comes out, nearest first, matching a sort
+        std::vector<std::pair<double, size_t>> expected;
+        for (size_t i = 0; i < grid.size(); i++) expected.emplace_back(grid[i].distanceTo(origin), i);
+        std::sort(expected.begin(), expected.end());
+        SampleGrid::Nearest nearest(grid, origin.x(), origin.y());
+        size_t index;
+        double distance;
+        for (const auto& e : expected) {
+            ASSERT_TRUE(nearest.next(index, distance));
+            EXPECT_EQ(e.second, index);
+            EXPECT_DOUBLE_EQ(e.first, distance);
+        }
+        EXPECT_FALSE(nearest.next(index, distance));
+    }
+    // and from outside the samples
+    SampleGrid::Nearest nearest(grid, 500, -300);
+    size_t index;
+    double distance, last = 0;
+    int count = 0;
+    while (nearest.next(index, distance)) {
+        EXPECT_GE(distance, last);
+        last = distance;
+        count++;
+    }
+    EXPECT_EQ(count, 2000);
+    grid.clear();
+    SampleGrid::Nearest none(grid, 0, 0);
+    EXPECT_FALSE(none.next(index, distance));
+}
+
 TEST(UnitTests, ComputeEdgeCostTest) {
     State s1(0, 0, 0, 1, 1);
     State s2(0, 5, 0, 1, 0);
@@ -636,6 +2691,165 @@ TEST(UnitTests, ComputeEdgeCostTest) {
     EXPECT_DOUBLE_EQ(c, a);
 }
 
+// obstacle everywhere past a wall at x = WallX
+class WallMap : public Map {
+public:
+    explicit WallMap(double wallX) : WallX(wallX) {}
+    double getUnblockedDistance(double x, double y) const override {
+        Lookups++;
+        return x < WallX ? WallX - x : -1;
+    }
+    double cellDiagonal() const override { return 1; }
+    double WallX;
+    mutable int Lookups = 0;
+};
+
+TEST(UnitTests, EdgeSphereTracingTest) {
+    auto config = plannerConfig;
+    auto farWall = make_shared<WallMap>(250);
+    config.setMap(farWall);
+    auto v1 = Vertex::makeRoot(State(0, 0, M_PI / 2, 2.5, 1), RibbonManager());
+    auto v2 = Vertex::connect(v1, State(50, 0, M_PI / 2, 2.5, 0));
+    v2->parentEdge()->computeTrueCost(config);
+    EXPECT_FALSE(v2->parentEdge()->infeasible());
+    // 50m of samples, but clearance for all but the first
+    EXPECT_GT(50 / Edge::collisionCheckingIncrement(), 10);
+    EXPECT_EQ(1, farWall->Lookups);
+
+    auto nearWall = make_shared<WallMap>(30);
+    config.setMap(nearWall);
+    auto v3 = Vertex::connect(v1, State(50, 0, M_PI / 2, 2.5, 0));
+    v3->parentEdge()->computeTrueCost(config);
+    EXPECT_TRUE(v3->parentEdge()->infeasible());
+    EXPECT_GT(nearWall->Lookups, 1);
+    EXPECT_LT(nearWall->Lookups, 30 / Edge::collisionCheckingIncrement() / 2);
+}
+
+TEST(UnitTests, EdgeBatchTest) {
+    // edges ending in front of and behind a wall, through a contact and over a ribbon, the same one at a time or batched
+    auto config = plannerConfig;
+    config.setMap(make_shared<WallMap>(30));
+    auto obstacles = make_shared<DynamicObstaclesManager>();
+    double mean[2] = {15, 20}, covariance[2][2] = {{4, 0}, {0, 4}};
+    obstacles->add(1, {Distribution(mean, covariance, 0, 1), Distribution(mean, covariance, 0, 30)}, 5, 20);
+    config.setObstacles(obstacles);
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 40);
+    StateGenerator generator(-20, 60, -20, 60, 2.5, 2.5, 17);
+    State start(0, 0, M_PI / 4, 2.5, 1);
+    auto single = Vertex::makeRoot(start, ribbonManager), batched = Vertex::makeRoot(start, ribbonManager);
+    std::vector<Vertex::SharedPtr> singles, batches;
+    EdgeBatch batch;
+    std::vector<size_t> indices;
+    for (int i = 0; i < 30; i++) {
+        auto end = generator.generate();
+        singles.push_back(Vertex::connect(single, end));
+        singles.back()->parentEdge()->computeTrueCost(config);
+        batches.push_back(Vertex::connect(batched, end));
+        indices.push_back(batches.back()->parentEdge()->addToBatch(config, batch));
+    }
+    batch.evaluate(*config.map(), config.obstacles(), Edge::collisionCheckingIncrement());
+    int infeasible = 0, penalized = 0;
+    for (int i = 0; i < 30; i++) {
+        auto cost = batches[i]->parentEdge()->computeTrueCost(config, batch, indices[i]);
+        auto s = singles[i]->parentEdge(), b = batches[i]->parentEdge();
+        EXPECT_NEAR(s->trueCost(), cost, 1e-9 * cost);
+        EXPECT_EQ(s->infeasible(), b->infeasible());
+        EXPECT_NEAR(s->getSavedCollisionPenalty(), b->getSavedCollisionPenalty(), 1e-9);
+        EXPECT_EQ(singles[i]->state().x(), batches[i]->state().x());
+        EXPECT_EQ(singles[i]->state().time(), batches[i]->state().time());
+        EXPECT_EQ(singles[i]->ribbonManager().dumpRibbons(), batches[i]->ribbonManager().dumpRibbons());
+        if (s->infeasible()) infeasible++;
+        else if (s->getSavedCollisionPenalty() > 0) penalized++;
+    }
+    EXPECT_GT(infeasible, 0);
+    EXPECT_GT(penalized, 0);
+
+    // and whole plans come out either way
+    config.setMap(make_shared<Map>());
+    config.setBatchedTrueCosts(true);
+    AStarPlanner planner;
+    auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+    EXPECT_FALSE(plan.empty());
+    // including from the parallel planner, each thread batching its own expansions
+    config.setSearchThreads(4);
+    ParallelAStarPlanner parallelPlanner;
+    plan = parallelPlanner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+    ASSERT_FALSE(plan.empty());
+    validatePlan(plan, config);
+}
+
+TEST(UnitTests, EdgeGeometryCacheTest) {
+    EdgeGeometryCache cache(2);
+    State a(0, 0, 0, 2.5, 1), b(10, 0, 0, 2.5, 0), c(0, 10, 0, 2.5, 0), d(-10, 0, 0, 2.5, 0);
+    EdgeGeometryCache::Entry entry;
+    entry.Checked = entry.FirstBlocked = 10;
+    cache.store(a, b, 8, entry);
+    size_t blocked;
+    ASSERT_TRUE(cache.findBlocked(a, b, 8, 8, blocked));
+    EXPECT_EQ(blocked, 8);
+    EXPECT_FALSE(cache.findBlocked(a, b, 8, 12, blocked));
+    EXPECT_FALSE(cache.findBlocked(a, b, 16, 8, blocked));
+    // knowing less doesn't replace anything, but finding something blocked does
+    entry.Checked = entry.FirstBlocked = 5;
+    cache.store(a, b, 8, entry);
+    EXPECT_TRUE(cache.findBlocked(a, b, 8, 8, blocked));
+    entry.Checked = 13;
+    entry.FirstBlocked = 12;
+    cache.store(a, b, 8, entry);
+    ASSERT_TRUE(cache.findBlocked(a, b, 8, 20, blocked));
+    EXPECT_EQ(blocked, 12);
+    ASSERT_TRUE(cache.findBlocked(a, b, 8, 8, blocked));
+    EXPECT_EQ(blocked, 8);
+    // least recently used goes first
+    cache.store(a, c, 8, entry);
+    EXPECT_TRUE(cache.find(a, b, 8, entry));
+    cache.store(a, d, 8, entry);
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_TRUE(cache.find(a, b, 8, entry));
+    EXPECT_FALSE(cache.find(a, c, 8, entry));
+    EXPECT_TRUE(cache.find(a, d, 8, entry));
+
+    // edges from another vertex at the same pose get the same costs without asking the map again
+    auto config = plannerConfig;
+    auto wall = make_shared<WallMap>(30);
+    config.setMap(wall);
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 40);
+    EdgeGeometryCache edges;
+    State start(0, 0, M_PI / 4, 2.5, 1);
+    auto first = Vertex::makeRoot(start, ribbonManager, nullptr, nullptr, &edges);
+    auto second = Vertex::makeRoot(start, ribbonManager, nullptr, nullptr, &edges);
+    StateGenerator generator(-20, 60, -20, 60, 2.5, 2.5, 17);
+    std::vector<State> ends;
+    for (int i = 0; i < 30; i++) ends.push_back(generator.generate());
+    std::vector<double> costs;
+    int infeasible = 0;
+    for (const auto& end : ends) {
+        auto v = Vertex::connect(first, end);
+        costs.push_back(v->parentEdge()->computeTrueCost(config));
+        if (v->parentEdge()->infeasible()) infeasible++;
+    }
+    EXPECT_GT(infeasible, 0);
+    auto lookups = wall->Lookups;
+    EdgeBatch batch;
+    std::vector<Vertex::SharedPtr> batched;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < ends.size(); i++) {
+        auto v = Vertex::connect(second, ends[i]);
+        EXPECT_NEAR(v->parentEdge()->computeTrueCost(config), costs[i], 1e-9 * costs[i]);
+        batched.push_back(Vertex::connect(second, ends[i]));
+        indices.push_back(batched.back()->parentEdge()->addToBatch(config, batch));
+    }
+    batch.evaluate(*config.map(), config.obstacles(), Edge::collisionCheckingIncrement());
+    for (size_t i = 0; i < ends.size(); i++) {
+        EXPECT_NEAR(batched[i]->parentEdge()->computeTrueCost(config, batch, indices[i]), costs[i], 1e-9 * costs[i]);
+    }
+    EXPECT_EQ(wall->Lookups, lookups);
+    EXPECT_EQ(edges.pathHits(), 60);
+    EXPECT_EQ(edges.mapHits(), 60);
+}
+
 TEST(UnitTests, RunStateGenerationTest) {
     double minX, maxX, minY, maxY, minSpeed = 2.5, maxSpeed = 2.5;
     double magnitude = 2.5 * DubinsPlan::timeHorizon();
@@ -1208,4 +3422,4 @@ int main(int argc, char **argv){
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
-#pragma clang diagnostic pop
\ No newline at end of file
+#pragma clang diagnostic pop
@@ -10,7 +10,9 @@
  * query the total time of the plan. Some important constants are housed here as well. Maybe they shouldn't be here but
  * this is pretty self-contained, and everything that uses them also uses this. Maybe they should be constructor parameters?
  *
- * The paths are meant to be continuous in time, and in order, but that is not currently enforced.
+ * The paths are meant to be continuous in time, and in order, but that is not currently enforced. While they are in
+ * order, finding the path for a time is a binary search over their end times; otherwise it falls back to looking at
+ * each of them.
  */
 class DubinsPlan {
 public:
@@ -45,6 +47,23 @@ public:
      */
     void sample(State& s) const;
 
+    /**
+     * Sample the whole plan at a constant time interval, starting at the start time and up to but not including the
+     * end time. Walks the paths once, sampling each in one go, so it's a lot cheaper than calling sample() for every
+     * time. Times that fall in a gap between paths are skipped.
+     * @param timeInterval
+     * @return
+     */
+    std::vector<State> sampleUniform(double timeInterval) const;
+
+    /**
+     * Same as above but into a buffer the caller keeps, so doing it over and over (say, to display every plan) doesn't
+     * have to allocate once the buffer's big enough.
+     * @param timeInterval
+     * @param result cleared and then filled
+     */
+    void sampleUniform(double timeInterval, std::vector<State>& result) const;
+
     /**
      * @return whether the plan is empty
      */
@@ -73,16 +92,19 @@ public:
     bool containsTime(double time) const;
 
     /**
-     * Truncate this plan to start at the given time. Hey this doesn't actually do anything. Huh. Should look into that.
+     * Truncate this plan to start at the given time. Paths that are finished by then are dropped, and the one we're
+     * partway through starts at the time (see DubinsWrapper::updateStartTime). If the whole plan is finished it ends
+     * up empty.
      * @param time
      */
     void changeIntoSuffix(double time);
 
     /**
-     * Get samples at half second intervals.
+     * Get samples at half second intervals (see sampleUniform()).
      * @return
      */
     std::vector<State> getHalfSecondSamples() const;
+    void getHalfSecondSamples(std::vector<State>& result) const;
 
     /**
      * Get the underlying container of Dubins wrappers.
@@ -110,6 +132,16 @@ public:
 
 private:
     std::vector<DubinsWrapper> m_DubinsPaths;
+    // end time of each path, for finding the one containing a time, and whether they're in order (so we can search)
+    std::vector<double> m_EndTimes;
+    bool m_InOrder = true;
+
+    /**
+     * Find the first path containing a time.
+     * @param time
+     * @return its index, or the number of paths if there isn't one
+     */
+    size_t findPath(double time) const;
 
     static constexpr double c_TimeHorizon = 30;
     static constexpr double c_TimeMinimum = 5;
@@ -13,6 +13,16 @@ extern "C" {
  */
 class DubinsWrapper {
 public:
+    /**
+     * A batch of samples along a path, as parallel arrays. Yaw rather than heading, like the dubins library.
+     */
+    struct Samples {
+        std::vector<double> Times, Xs, Ys, Yaws;
+
+        size_t size() const { return Times.size(); }
+        void clear() { Times.clear(); Xs.clear(); Ys.clear(); Yaws.clear(); }
+    };
+
     DubinsWrapper() = default;
 
     /**
@@ -56,6 +66,32 @@ public:
      */
     void sample(State& s) const;
 
+    /**
+     * Sample the path at a constant time interval all at once, from startTime up to but not including endTime. Much
+     * cheaper than calling sample() for each point because the segment endpoints are only worked out once. Times are
+     * accumulated the same way as stepping a state forward by timeInterval, so they match that exactly. Throws a
+     * runtime error if the times aren't contained within this path.
+     * @param startTime
+     * @param timeInterval
+     * @param endTime
+     * @param samples cleared and then filled (reuse it to avoid allocating)
+     */
+    void sampleMany(double startTime, double timeInterval, double endTime, Samples& samples) const;
+
+    /**
+     * The kernel under sample() and sampleMany(): poses at the given distances along a path, worked out from the arc and
+     * line formulas directly instead of through the dubins library one point at a time. No allocation, and the loop over
+     * each segment's samples has no branches in it. Yaws come out in [0, 2pi).
+     * @param path
+     * @param distances distances along the path, in ascending order and no more than its length
+     * @param count how many distances there are
+     * @param xs filled with count x coordinates
+     * @param ys filled with count y coordinates
+     * @param yaws filled with count yaws (may be the same array as distances)
+     */
+    static void evaluate(const DubinsPath& path, const double* distances, size_t count, double* xs, double* ys,
+                         double* yaws);
+
     /**
      * Get samples at a constant time interval, starting at the starting time for this path.
      * @param timeInterval
@@ -97,6 +133,11 @@ public:
      */
     void updateStartTime(double startTime);
 
+    /**
+     * @return the start time the path was made with, before any updateStartTime (which sampling is still relative to)
+     */
+    double getOriginalStartTime() const;
+
     /**
      * Get the underlying Dubins path.
      * @return
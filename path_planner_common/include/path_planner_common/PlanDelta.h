@@ -0,0 +1,84 @@
+#ifndef SRC_PLANDELTA_H
+#define SRC_PLANDELTA_H
+
+#include <cstdint>
+#include <path_planner_common/DubinsPlan.h>
+
+/**
+ * A plan as the change from one the receiver (the controller) already has. From one cycle to the next most of a plan
+ * is usually the same paths as last time, so there's no need to send them again over the radio: the receiver trims its
+ * copy of the base plan to start at KeepFrom, keeps its first KeepCount paths, and appends Segments.
+ *
+ * A BaseVersion of zero means there's no base, and Segments is the whole plan.
+ *
+ * The planner sends these through the UpdatePlanDelta service, but only to a controller that offers it; anything else
+ * gets whole plans through UpdateReferenceTrajectory as before. The controller isn't part of this repository, so
+ * nothing here applies deltas yet except the tests: a controller adding the service should keep a PlanDeltaDecoder and
+ * reply with its version().
+ */
+struct PlanDelta {
+    uint32_t Version = 0;
+    uint32_t BaseVersion = 0;
+    double KeepFrom = 0;
+    uint32_t KeepCount = 0;
+    std::vector<DubinsWrapper> Segments;
+
+    bool full() const { return BaseVersion == 0; }
+};
+
+/**
+ * The sending side. Remembers the last plan the receiver said it has and works out deltas against it.
+ */
+class PlanDeltaEncoder {
+public:
+    /**
+     * Make a delta for a plan, against the last plan acknowledged, or a full one if none is (or the plan doesn't
+     * start on it).
+     * @param plan
+     * @return
+     */
+    PlanDelta encode(const DubinsPlan& plan);
+
+    /**
+     * Tell the encoder which version the receiver has after getting the last delta. If it's not the one the delta
+     * made, the receiver didn't have the base (or couldn't be reached), and the next delta will be a full plan.
+     * @param version the receiver's version (zero if it doesn't know)
+     * @return whether it has the last delta's plan
+     */
+    bool acknowledge(uint32_t version);
+
+    /**
+     * Forget the receiver's plan, so the next delta is a full one.
+     */
+    void reset();
+
+private:
+    DubinsPlan m_Base, m_Pending;
+    uint32_t m_BaseVersion = 0, m_PendingVersion = 0, m_LastVersion = 0;
+
+    static bool samePath(const DubinsWrapper& a, const DubinsWrapper& b);
+};
+
+/**
+ * The receiving side, which keeps the current plan and applies deltas to it.
+ */
+class PlanDeltaDecoder {
+public:
+    /**
+     * Apply a delta. If it's built on a version other than the current one, nothing changes, and the sender should
+     * send the whole plan (it will once it sees version() hasn't moved on).
+     * @param delta
+     * @return whether it was applied
+     */
+    bool apply(const PlanDelta& delta);
+
+    const DubinsPlan& plan() const { return m_Plan; }
+
+    uint32_t version() const { return m_Version; }
+
+private:
+    DubinsPlan m_Plan;
+    uint32_t m_Version = 0;
+};
+
+#endif //SRC_PLANDELTA_H
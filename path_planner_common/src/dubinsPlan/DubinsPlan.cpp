@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <path_planner_common/DubinsPlan.h>
 
 void DubinsPlan::append(const DubinsPlan &plan) {
@@ -5,17 +6,61 @@ void DubinsPlan::append(const DubinsPlan &plan) {
 }
 
 void DubinsPlan::append(const DubinsWrapper& dubinsPath) {
+    if (!m_EndTimes.empty() && dubinsPath.getEndTime() < m_EndTimes.back()) m_InOrder = false;
     m_DubinsPaths.push_back(dubinsPath);
+    m_EndTimes.push_back(dubinsPath.getEndTime());
+}
+
+size_t DubinsPlan::findPath(double time) const {
+    if (!m_InOrder) {
+        for (size_t i = 0; i < m_DubinsPaths.size(); i++) if (m_DubinsPaths[i].containsTime(time)) return i;
+        return m_DubinsPaths.size();
+    }
+    // the paths before this one all end earlier, so the first one containing the time can't be among them
+    auto i = (size_t)(std::lower_bound(m_EndTimes.begin(), m_EndTimes.end(), time) - m_EndTimes.begin());
+    for (; i < m_DubinsPaths.size(); i++) {
+        if (m_DubinsPaths[i].containsTime(time)) return i;
+        if (m_DubinsPaths[i].getStartTime() > time) break; // in a gap
+    }
+    return m_DubinsPaths.size();
 }
 
 void DubinsPlan::sample(State& s) const {
+    auto i = findPath(s.time());
+    if (i == m_DubinsPaths.size()) throw std::runtime_error("Requested time outside plan bounds");
+    m_DubinsPaths[i].sample(s);
+}
+
+std::vector<State> DubinsPlan::sampleUniform(double timeInterval) const {
+    std::vector<State> result;
+    sampleUniform(timeInterval, result);
+    return result;
+}
+
+void DubinsPlan::sampleUniform(double timeInterval, std::vector<State>& result) const {
+    if (timeInterval <= 0) throw std::runtime_error("Invalid time interval for sampling plan");
+    result.clear();
+    if (empty()) return;
+    result.reserve((size_t)(totalTime() / timeInterval) + 1);
+    // reuse the buffer between calls, like the edges do
+    static thread_local DubinsWrapper::Samples samples;
+    State s;
+    auto time = getStartTime();
     for (const auto& p : m_DubinsPaths) {
-        if (p.containsTime(s.time())) {
-            p.sample(s);
-            return;
+        // step over any gap (or overlap) in the same increments so the times stay on one grid
+        while (time < p.getStartTime()) time += timeInterval;
+        if (time >= p.getEndTime()) continue;
+        p.sampleMany(time, timeInterval, p.getEndTime(), samples);
+        for (size_t i = 0; i < samples.size(); i++) {
+            s.time() = samples.Times[i];
+            s.x() = samples.Xs[i];
+            s.y() = samples.Ys[i];
+            s.setYaw(samples.Yaws[i]);
+            s.speed() = p.getSpeed();
+            result.push_back(s);
         }
+        if (samples.size() > 0) time = samples.Times.back() + timeInterval;
     }
-    throw std::runtime_error("Requested time outside plan bounds");
 }
 
 DubinsPlan::DubinsPlan(const State& s1, const State& s2, double rho) {
@@ -27,13 +72,11 @@ bool DubinsPlan::empty() const {
 }
 
 std::vector<State> DubinsPlan::getHalfSecondSamples() const {
-    // should check for duplicates
-    std::vector<State> result;
-    for (const auto& p : m_DubinsPaths) {
-        auto r = p.getSamples(planTimeDensity());
-        for (const auto& s : r) result.push_back(s);
-    }
-    return result;
+    return sampleUniform(planTimeDensity());
+}
+
+void DubinsPlan::getHalfSecondSamples(std::vector<State>& result) const {
+    sampleUniform(planTimeDensity(), result);
 }
 
 const std::vector<DubinsWrapper>& DubinsPlan::get() const {
@@ -46,8 +89,7 @@ double DubinsPlan::totalTime() const {
 }
 
 bool DubinsPlan::containsTime(double time) const {
-    for (const auto& p : m_DubinsPaths) if (p.containsTime(time)) return true;
-    return false;
+    return findPath(time) != m_DubinsPaths.size();
 }
 
 double DubinsPlan::getStartTime() const {
@@ -62,9 +104,14 @@ double DubinsPlan::getEndTime() const {
 
 void DubinsPlan::changeIntoSuffix(double time) {
     if (m_DubinsPaths.empty()) throw std::runtime_error("Cannot access empty plan");
-    for (auto& p : m_DubinsPaths) {
-        if (p.containsTime(time)) {
-
-        }
+    // drop the paths we're done with (one ending right now has nothing left to follow either)
+    std::vector<DubinsWrapper> paths;
+    for (const auto& p : m_DubinsPaths) if (p.getEndTime() > time) paths.push_back(p);
+    m_DubinsPaths.clear();
+    m_EndTimes.clear();
+    m_InOrder = true;
+    for (auto& p : paths) {
+        if (p.containsTime(time)) p.updateStartTime(time);
+        append(p);
     }
 }
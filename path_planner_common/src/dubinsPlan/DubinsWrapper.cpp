@@ -1,6 +1,24 @@
 #include <cassert>
+#include <cmath>
 #include <path_planner_common/DubinsWrapper.h>
 
+namespace {
+// segment types for each path type, the same as the dubins library's table
+enum SegmentType { LeftSegment, StraightSegment, RightSegment };
+const SegmentType c_Segments[6][3] = {
+        {LeftSegment, StraightSegment, LeftSegment},   // LSL
+        {LeftSegment, StraightSegment, RightSegment},  // LSR
+        {RightSegment, StraightSegment, LeftSegment},  // RSL
+        {RightSegment, StraightSegment, RightSegment}, // RSR
+        {RightSegment, LeftSegment, RightSegment},     // RLR
+        {LeftSegment, RightSegment, LeftSegment},      // LRL
+};
+
+double mod2pi(double theta) {
+    return theta - 2 * M_PI * floor(theta / (2 * M_PI));
+}
+}
+
 DubinsWrapper::DubinsWrapper(const State& s1, const State& s2, double rho) {
     set(s1, s2, rho);
 }
@@ -26,37 +44,111 @@ bool DubinsWrapper::containsTime(double time) const {
 
 void DubinsWrapper::sample(State& s) const {
     if (!containsTime(s.time())) throw std::runtime_error("Invalid time in sample for Dubins path");
-    double distance = (s.time() - m_StartTime) * m_Speed;
-    // heading comes back as yaw
-    int err = dubins_path_sample(&m_DubinsPath, distance, s.pose());
-    if (err == EDUBPARAM) {
-        // rounding error sometimes makes us overshoot the length, which causes an error
-        err = dubins_path_sample(&m_DubinsPath, distance - 1e-5, s.pose());
-    }
-    if (err != EDUBOK) {
-        std::cerr << "Encountered error in dubins library" << std::endl;
-    }
-    // set yaw with heading value to correct things
-    s.setYaw(s.heading()); // TODO! -- change state to internally use yaw?
+    // rounding error sometimes makes us overshoot the length, which the dubins library would call an error
+    double distance = fmin((s.time() - m_StartTime) * m_Speed, length()), yaw;
+    evaluate(m_DubinsPath, &distance, 1, &s.x(), &s.y(), &yaw);
+    s.setYaw(yaw);
     s.speed() = m_Speed; // take note of this
 }
 
-bool DubinsWrapper::isInitialized() const {
-    return m_StartTime > 0;
+void DubinsWrapper::sampleMany(double startTime, double timeInterval, double endTime, Samples& samples) const {
+    samples.clear();
+    if (!isInitialized()) throw std::runtime_error("Cannot access unset Dubins wrapper");
+    if (startTime >= endTime) return;
+    if (!containsTime(startTime) || !containsTime(endTime)) {
+        throw std::runtime_error("Invalid time in sampleMany for Dubins path");
+    }
+    auto count = (size_t)ceil((endTime - startTime) / timeInterval) + 1;
+    samples.Times.reserve(count);
+    for (auto time = startTime; time < endTime; time += timeInterval) samples.Times.push_back(time);
+    count = samples.Times.size();
+    samples.Xs.resize(count); samples.Ys.resize(count); samples.Yaws.resize(count);
+    // the distances go where the yaws will, and get overwritten by them
+    auto length = dubins_path_length(&m_DubinsPath);
+    for (size_t i = 0; i < count; i++) samples.Yaws[i] = fmin((samples.Times[i] - m_StartTime) * m_Speed, length);
+    evaluate(m_DubinsPath, samples.Yaws.data(), count, samples.Xs.data(), samples.Ys.data(), samples.Yaws.data());
+}
+
+void DubinsWrapper::evaluate(const DubinsPath& path, const double* distances, size_t count, double* xs, double* ys,
+                             double* yaws) {
+    const double rho = path.rho;
+    const auto* types = c_Segments[path.type];
+    // where each segment starts, in distance along the path and pose
+    double starts[3] = {0, path.param[0] * rho, (path.param[0] + path.param[1]) * rho};
+    double poses[3][3];
+    poses[0][0] = path.qi[0]; poses[0][1] = path.qi[1]; poses[0][2] = path.qi[2];
+    for (int j = 0; j < 2; j++) {
+        double t = path.param[j];
+        const auto& q = poses[j];
+        auto& next = poses[j + 1];
+        if (types[j] == LeftSegment) {
+            next[0] = q[0] + rho * (sin(q[2] + t) - sin(q[2]));
+            next[1] = q[1] + rho * (cos(q[2]) - cos(q[2] + t));
+            next[2] = q[2] + t;
+        } else if (types[j] == RightSegment) {
+            next[0] = q[0] + rho * (sin(q[2]) - sin(q[2] - t));
+            next[1] = q[1] + rho * (cos(q[2] - t) - cos(q[2]));
+            next[2] = q[2] - t;
+        } else {
+            next[0] = q[0] + rho * t * cos(q[2]);
+            next[1] = q[1] + rho * t * sin(q[2]);
+            next[2] = q[2];
+        }
+    }
+    // the distances are in order so each segment's samples are a run of them, and each run is a loop with no branches
+    // in it (which the compiler can vectorize, given a vector sin and cos)
+    size_t begin = 0;
+    for (int j = 0; j < 3 && begin < count; j++) {
+        size_t end = begin;
+        if (j == 2) end = count;
+        else while (end < count && distances[end] < starts[j + 1]) end++;
+        const double x0 = poses[j][0], y0 = poses[j][1], h0 = poses[j][2], d0 = starts[j];
+        const double s0 = sin(h0), c0 = cos(h0);
+        if (types[j] == StraightSegment) {
+            const double yaw = mod2pi(h0);
+            for (size_t i = begin; i < end; i++) {
+                double d = distances[i] - d0;
+                xs[i] = x0 + c0 * d;
+                ys[i] = y0 + s0 * d;
+                yaws[i] = yaw;
+            }
+        } else {
+            // left turns go anticlockwise, right ones clockwise, about a centre a radius off to that side
+            const double direction = types[j] == LeftSegment ? 1 : -1;
+            const double cx = x0 - direction * rho * s0, cy = y0 + direction * rho * c0;
+            for (size_t i = begin; i < end; i++) {
+                double yaw = h0 + direction * (distances[i] - d0) / rho;
+                xs[i] = cx + direction * rho * sin(yaw);
+                ys[i] = cy - direction * rho * cos(yaw);
+                yaws[i] = mod2pi(yaw);
+            }
+        }
+        begin = end;
+    }
 }
 
 std::vector<State> DubinsWrapper::getSamples(double timeInterval) const {
     std::vector<State> result;
+    if (!isInitialized() || m_UpdatedStartTime >= m_EndTime) return result;
+    Samples samples;
+    sampleMany(m_UpdatedStartTime, timeInterval, m_EndTime, samples);
+    result.reserve(samples.size());
     State intermediate;
     intermediate.speed() = m_Speed;
-    for (auto s = m_UpdatedStartTime; s < m_EndTime; s+= timeInterval) {
-        intermediate.time() = s;
-        sample(intermediate);
+    for (size_t i = 0; i < samples.size(); i++) {
+        intermediate.time() = samples.Times[i];
+        intermediate.x() = samples.Xs[i];
+        intermediate.y() = samples.Ys[i];
+        intermediate.setYaw(samples.Yaws[i]);
         result.push_back(intermediate);
     }
     return result;
 }
 
+bool DubinsWrapper::isInitialized() const {
+    return m_StartTime > 0;
+}
+
 double DubinsWrapper::getRho() const {
     return m_DubinsPath.rho;
 }
@@ -69,6 +161,10 @@ double DubinsWrapper::getStartTime() const {
     return m_UpdatedStartTime;
 }
 
+double DubinsWrapper::getOriginalStartTime() const {
+    return m_StartTime;
+}
+
 double DubinsWrapper::getSpeed() const {
     return m_Speed;
 }
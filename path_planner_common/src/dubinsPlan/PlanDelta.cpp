@@ -0,0 +1,65 @@
+#include <path_planner_common/PlanDelta.h>
+
+PlanDelta PlanDeltaEncoder::encode(const DubinsPlan& plan) {
+    PlanDelta delta;
+    // never zero, which means no version
+    if (++m_LastVersion == 0) m_LastVersion = 1;
+    delta.Version = m_LastVersion;
+    delta.KeepFrom = plan.empty() ? 0 : plan.getStartTime();
+    const auto& paths = plan.get();
+    size_t keep = 0;
+    if (m_BaseVersion != 0 && !plan.empty() && m_Base.containsTime(delta.KeepFrom)) {
+        // the receiver trims its copy the same way
+        auto base = m_Base;
+        base.changeIntoSuffix(delta.KeepFrom);
+        const auto& basePaths = base.get();
+        while (keep < basePaths.size() && keep < paths.size() && samePath(basePaths[keep], paths[keep])) keep++;
+        delta.BaseVersion = m_BaseVersion;
+        delta.KeepCount = (uint32_t)keep;
+    }
+    delta.Segments.assign(paths.begin() + keep, paths.end());
+    m_Pending = plan;
+    m_PendingVersion = delta.Version;
+    return delta;
+}
+
+bool PlanDeltaEncoder::acknowledge(uint32_t version) {
+    if (version != 0 && version == m_PendingVersion) {
+        m_Base = std::move(m_Pending);
+        m_BaseVersion = m_PendingVersion;
+        m_Pending = DubinsPlan();
+        m_PendingVersion = 0;
+        return true;
+    }
+    reset();
+    return false;
+}
+
+void PlanDeltaEncoder::reset() {
+    m_Base = m_Pending = DubinsPlan();
+    m_BaseVersion = m_PendingVersion = 0;
+}
+
+bool PlanDeltaEncoder::samePath(const DubinsWrapper& a, const DubinsWrapper& b) {
+    const auto& p = a.unwrap();
+    const auto& q = b.unwrap();
+    for (int i = 0; i < 3; i++) if (p.qi[i] != q.qi[i] || p.param[i] != q.param[i]) return false;
+    return p.rho == q.rho && p.type == q.type && a.getSpeed() == b.getSpeed() &&
+        a.getOriginalStartTime() == b.getOriginalStartTime() && a.getStartTime() == b.getStartTime() &&
+        a.getEndTime() == b.getEndTime();
+}
+
+bool PlanDeltaDecoder::apply(const PlanDelta& delta) {
+    DubinsPlan plan;
+    if (!delta.full()) {
+        if (delta.BaseVersion != m_Version || m_Plan.empty()) return false;
+        auto base = m_Plan;
+        base.changeIntoSuffix(delta.KeepFrom);
+        if (base.get().size() < delta.KeepCount) return false;
+        for (uint32_t i = 0; i < delta.KeepCount; i++) plan.append(base.get()[i]);
+    }
+    for (const auto& p : delta.Segments) plan.append(p);
+    m_Plan = std::move(plan);
+    m_Version = delta.Version;
+    return true;
+}
@@ -17,7 +17,13 @@ void TrajectoryDisplayerHelper::displayTrajectory(const std::vector<State>& traj
 void TrajectoryDisplayerHelper::displayTrajectory(const std::vector<State>& trajectory, bool plannerTrajectory,
                                                   bool achievable) {
     if (!m_display_pub) throw std::runtime_error("Trajectory displayer not properly initialized");
-    geographic_visualization_msgs::GeoVizPointList displayPoints;
+    // reuse the message between calls (per thread, since the planner and the node both display things), so once the
+    // points have grown big enough for a plan displaying another one doesn't allocate
+    static thread_local geographic_visualization_msgs::GeoVizItem geoVizItem;
+    geoVizItem.lines.resize(1);
+    auto& displayPoints = geoVizItem.lines.front();
+    displayPoints.color.r = 0;
+    displayPoints.color.g = 0;
     displayPoints.color.b = 1;
     if (!plannerTrajectory) {
         displayPoints.color.a = 0.8;
@@ -32,17 +38,15 @@ void TrajectoryDisplayerHelper::displayTrajectory(const std::vector<State>& traj
         displayPoints.color.a = 1;
         displayPoints.size = 3.0;
     }
-    for (const State& s : trajectory) {
-        geographic_msgs::GeoPoint point;
-        displayPoints.points.push_back(convertToLatLong(s));
+    displayPoints.points.resize(trajectory.size());
+    for (size_t i = 0; i < trajectory.size(); i++) {
+        displayPoints.points[i] = convertToLatLong(trajectory[i]);
     }
-    geographic_visualization_msgs::GeoVizItem geoVizItem;
     if (plannerTrajectory) {
         geoVizItem.id = "planner_trajectory";
     } else {
         geoVizItem.id = "controller_trajectory";
     }
-    geoVizItem.lines.push_back(displayPoints);
     m_display_pub->publish(geoVizItem);
 }
 